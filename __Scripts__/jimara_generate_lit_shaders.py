@@ -13,7 +13,21 @@ instructions = (
 	"                        Ignored if model_src_dir is a single file; defaults to \"jlm\"<stands for \"Jimara Lighting Model\">;\n" +
 	"    shader_exts       - Comma-separated list of extensions to search for shaders with.\n" +
 	"                        Ignored if shader_src_dir is a single file; defaults to \"jls\"<stands for \"Jimara Lit Shader\">;\n" + 
-	"    out_ext           - Extension to be used by the output file; defaults to \"glsl\".")
+	"    out_ext           - Extension to be used by the output file; defaults to \"glsl\".\n" +
+	"Note: Lighting models, that reference Jimara_LitShaderVertexMain, get to define the vertex shader entry point themselves;\n" +
+	"      main function of the lit shader gets renamed to Jimara_LitShaderVertexMain and the model is expected to call it from it's own main\n" +
+	"      (this lets the model forward per-instance data to the fragment shader, like the per-object light lists);\n" +
+	"      gl_Position is always declared invariant, so that the same lit shader, generated for different lighting models,\n" +
+	"      produces bit-identical depth (depth prepass draws with one model and tests for equal depth with another).")
+
+# Lighting models, that reference this function, wrap the vertex entry point of the lit shaders:
+vertex_main_wrapper = "Jimara_LitShaderVertexMain"
+
+# Prepended to the lit shader source (has to come before any use of gl_Position):
+invariant_position = (
+	"#ifdef JIMARA_VERTEX_SHADER\n" +
+	"invariant gl_Position;\n" +
+	"#endif\n")
 
 
 class job_arguments:
@@ -117,6 +131,15 @@ def execute_job(desc):
 		return
 
 	def build_shader(model_src, shader_src):
+		if vertex_main_wrapper in model_src:
+			shader_src = (
+				"#ifdef JIMARA_VERTEX_SHADER\n" +
+				"#define main " + vertex_main_wrapper + "\n" +
+				"#endif\n" +
+				shader_src + "\n" +
+				"#ifdef JIMARA_VERTEX_SHADER\n" +
+				"#undef main\n" +
+				"#endif\n")
 		return (
 			"/**\n" + 
 			"################################################################################\n" +
@@ -128,6 +151,7 @@ def execute_job(desc):
 			"################################ SHADER SOURCE: ################################\n" + 
 			"*/\n" +
 			"#define MATERIAL_BINDING_SET_ID (LIGHT_BINDING_SET_ID + 1)\n" +
+			invariant_position +
 			shader_src + "\n\n\n\n\n" +
 			"/**\n" + 
 			"################################################################################\n" +
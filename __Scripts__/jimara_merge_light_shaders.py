@@ -3,9 +3,10 @@ import jimara_file_tools, sys
 instructions = (
 			"Usage: python jimara_merge_light_shaders.py source_directory glsl_output_file cpp_output_file <light_type_info> <extensions...>\n" +
 			"    source_directory - Light shaders will be searched in this directory, as well as it's subfolders;\n" +
-			"    glsl_output_file - Merged light shader code will be stored in this \"output\" header file containing Jimara_GetLightSamples function;\n" +
+			"    glsl_output_file - Merged light shader code will be stored in this \"output\" header file containing Jimara_GetLightSamples and Jimara_IterateLightsByType functions;\n" +
 			"    cpp_output_file  - glsl_output_file will depend on \"Light Type identifiers\" to decide which light shader to run.\n" +
-			"                       Those identifiers will be stored in this header as <light_type_info> unordered_map;\n" + 
+			"                       Those identifiers will be stored in this header as <light_type_info> unordered_map,\n" + 
+			"                       alongside the number of light type groups Jimara_IterateLightsByType iterates over (same as the number of light types);\n" + 
 			"    light_type_info  - Optional name for the information container stored in cpp_output_file (defaults to JIMARA_LIGHT_TYPE_INFO);\n" + 
 			"    extensions       - Optional list of light shader extensions to find the shader files in source_directory (defaults to \"jld\"<stands for \"Jimara Light Definition\">).")
 
@@ -35,7 +36,13 @@ def merge_light_shaders(shader_paths):
 		"#ifndef PHOTON_DEFINED\n" +
 		"struct Photon { vec3 origin; vec3 color; };\n" +
 		"#define PHOTON_DEFINED\n" +
-		"#endif\n\n")
+		"#endif\n\n" +
+		"// SHADOW MAPS (Lighting models, that evaluate lights, are expected to define Jimara_SampleShadow):\n" +
+		"#ifndef JIMARA_NO_SHADOW_VIEW\n" +
+		"#define JIMARA_NO_SHADOW_VIEW 0xFFFFFFFFu\n" +
+		"#endif\n" +
+		"// Fraction of the light, reaching the position within the given ShadowAtlas view (negative, if the position is outside the view)\n" +
+		"float Jimara_SampleShadow(uint shadowViewId, in vec3 position);\n\n")
 
 	type_names = get_type_names(shader_paths)
 
@@ -47,6 +54,7 @@ def merge_light_shaders(shader_paths):
 	code += "\n// TYPE ID-s:\n"
 	for i, type_name in enumerate(type_names):
 		code += "#define " + light_type_id_name(type_name) + " " + str(i) + "\n"
+	code += "#define JIMARA_LIGHT_TYPE_COUNT " + str(len(type_names)) + "\n"
 
 	light_binding_stride = 0
 	data_sizes = []
@@ -93,7 +101,9 @@ def merge_light_shaders(shader_paths):
 
 	code += (
 		"\n// Computes sample photons coming to the hit point from light defined by light buffer index and light type index\n" +
-		"uint Jimara_GetLightSamples(uint lightBufferId, uint lightTypeId, in HitPoint hitPoint, out Photon samples[MAX_PER_LIGHT_SAMPLES]) {\n")
+		"uint Jimara_GetLightSamples(uint lightBufferId, uint lightTypeId, in HitPoint hitPoint, out Photon samples[MAX_PER_LIGHT_SAMPLES]) {\n" +
+		"\t// Empty light slots have out of range type identifiers:\n" +
+		"\tif (lightTypeId >= JIMARA_LIGHT_TYPE_COUNT) return 0;\n")
 	def search_type(types, tab):
 		if len(types) < 1:
 			return tab + "return 0;\n"
@@ -109,7 +119,31 @@ def merge_light_shaders(shader_paths):
 	code += search_type(type_names, "\t")
 	code += (
 		"}\n" + 
-		"#define JIMARA_GetLightSamples_FN Jimara_GetLightSamples\n" +
+		"#define JIMARA_GetLightSamples_FN Jimara_GetLightSamples\n\n")
+
+	code += (
+		"// TYPE GROUPS (Lighting models, that use Jimara_IterateLightsByType, are expected to define Jimara_LightTypeRange, Jimara_GroupedLightSlot and Jimara_OnLightSamples):\n" +
+		"// Range of the type-grouped light list, occupied by the given light type (x - first entry, y - number of lights; see SceneLightInfo::LightTypeRange)\n" +
+		"uvec2 Jimara_LightTypeRange(uint lightTypeId);\n" +
+		"// Light buffer index, stored at the given entry of the type-grouped light list\n" +
+		"uint Jimara_GroupedLightSlot(uint groupedLightId);\n" +
+		"// Receives sample photons of each light, visited by Jimara_IterateLightsByType\n" +
+		"void Jimara_OnLightSamples(in Photon samples[MAX_PER_LIGHT_SAMPLES], uint sampleCount);\n\n" +
+		"// Computes sample photons coming to the hit point from every light, evaluating each light type in it's own loop (no per-light branching on the type)\n" +
+		"void Jimara_IterateLightsByType(in HitPoint hitPoint) {\n" +
+		"\tPhoton samples[MAX_PER_LIGHT_SAMPLES];\n")
+	for type_name in type_names:
+		code += (
+			"\t{\n" +
+			"\t\tuvec2 range = Jimara_LightTypeRange(" + light_type_id_name(type_name) + ");\n" +
+			"\t\tfor (uint i = range.x; i < (range.x + range.y); i++) {\n" +
+			"\t\t\tuint sampleCount = " + light_function_name(type_name) + "(hitPoint, " + buffer_attachment_name(type_name) + "[Jimara_GroupedLightSlot(i)].data, samples);\n" +
+			"\t\t\tJimara_OnLightSamples(samples, sampleCount);\n" +
+			"\t\t}\n" +
+			"\t}\n")
+	code += (
+		"}\n" + 
+		"#define JIMARA_IterateLightsByType_FN Jimara_IterateLightsByType\n" +
 		"#define LIGHT_BINDING_END_ID (LIGHT_BINDING_START_ID + 1)\n")
 
 	return code, light_binding_stride
@@ -135,13 +169,15 @@ def generate_engine_type_indices(shader_paths, storage_name, light_elem_size, na
 		inset + "static const struct {\n" + 
 		inset + "\tconst std::unordered_map<std::string, uint32_t> typeIds;\n" +
 		inset + "\tconst std::size_t perLightDataSize;\n" + 
+		inset + "\tconst std::size_t lightTypeCount;\n" + 
 		inset + "} " + storage_name + " = {\n" +
 		inset + "\tstd::unordered_map<std::string, uint32_t>({")
 	for i, type_name in enumerate(get_type_names(shader_paths)):
 		code += ("\n" if i <= 0 else ",\n") + inset + "\t\t{ \"" + escape(type_name) + "\", " + str(i) + " }"
 	code += (
 		"\n" + inset + "\t}),\n" + 
-		inset + "\t" + str(light_elem_size) + "\n" + 
+		inset + "\t" + str(light_elem_size) + ",\n" + 
+		inset + "\t" + str(len(get_type_names(shader_paths))) + "\n" + 
 		inset + "};\n")
 
 	return code
@@ -10,7 +10,12 @@
 #include "Components/Lights/DirectionalLight.h"
 #include "Environment/GraphicsContext/Lights/LightDataBuffer.h"
 #include "Environment/GraphicsContext/Lights/LightTypeIdBuffer.h"
+#include "Environment/GraphicsContext/Lights/LightClusterGrid.h"
+#include "Environment/GraphicsContext/Lights/ShadowAtlas.h"
+#include "Environment/GraphicsContext/Lights/ObjectLightSelector.h"
 #include "../__Generated__/JIMARA_TEST_LIGHT_IDENTIFIERS.h"
+#include <unordered_map>
+#include <unordered_set>
 #include <sstream>
 #include <iomanip>
 #include <thread>
@@ -149,45 +154,107 @@ namespace Jimara {
 
 
 		class EnvironmentBinding : public virtual Graphics::PipelineDescriptor::BindingSetDescriptor {
+		private:
+			// Forward lighting model binds light count at binding 3, ShadowAtlas views/maps at bindings 4 and 5 and light type ranges/grouped slots at bindings 6 and 7;
+			// Clustered lighting model binds LightClusterGrid settings (binding 3), clusters (binding 4) and light indices (binding 5) instead, 
+			// followed by ShadowAtlas views/maps at bindings 6 and 7
+			const bool m_clustered;
+
+			// Structured buffer bindings (light data, light type identifiers and the model-specific buffers)
+			inline const uint32_t* StructuredBufferBindings()const {
+				static const uint32_t FORWARD_BINDINGS[] = { 0u, 2u, 4u, 6u, 7u };
+				static const uint32_t CLUSTERED_BINDINGS[] = { 0u, 2u, 4u, 5u, 6u };
+				return m_clustered ? CLUSTERED_BINDINGS : FORWARD_BINDINGS;
+			}
+
 		public:
+			inline EnvironmentBinding(bool clustered = false) : m_clustered(clustered) {}
+
+			inline bool Clustered()const { return m_clustered; }
+
 			inline virtual bool SetByEnvironment()const override { return true; }
 			
-			inline virtual size_t ConstantBufferCount()const override { return 1; }
-			inline virtual BindingInfo ConstantBufferInfo(size_t index)const override { return { Graphics::StageMask(Graphics::PipelineStage::VERTEX), 1 }; }
+			inline virtual size_t ConstantBufferCount()const override { return 2; }
+			inline virtual BindingInfo ConstantBufferInfo(size_t index)const override {
+				return (index < 1)
+					? (BindingInfo{ Graphics::StageMask(Graphics::PipelineStage::VERTEX), 1u })
+					: (BindingInfo{ Graphics::StageMask(Graphics::PipelineStage::FRAGMENT), 3u });
+			}
 			inline virtual Reference<Graphics::Buffer> ConstantBuffer(size_t index)const override { return nullptr; }
 
-			inline virtual size_t StructuredBufferCount()const override { return 2; }
+			inline virtual size_t StructuredBufferCount()const override { return 5; }
 			inline BindingInfo StructuredBufferInfo(size_t index)const override {
 				return (index < 1)
 					? (BindingInfo{ Graphics::StageMask(Graphics::PipelineStage::VERTEX, Graphics::PipelineStage::FRAGMENT), 0u })
-					: (BindingInfo{ Graphics::StageMask(Graphics::PipelineStage::FRAGMENT), 2u });
+					: (BindingInfo{ Graphics::StageMask(Graphics::PipelineStage::FRAGMENT), StructuredBufferBindings()[index] });
 			}
 			inline Reference<Graphics::ArrayBuffer> StructuredBuffer(size_t index)const override { return nullptr; }
 
-			inline size_t TextureSamplerCount()const override { return 0; }
-			inline BindingInfo TextureSamplerInfo(size_t index)const override { return BindingInfo(); }
+			inline size_t TextureSamplerCount()const override { return 1; }
+			inline BindingInfo TextureSamplerInfo(size_t index)const override {
+				return BindingInfo{ Graphics::StageMask(Graphics::PipelineStage::FRAGMENT), m_clustered ? 7u : 5u };
+			}
 			inline Reference<Graphics::TextureSampler> Sampler(size_t index)const override { return nullptr; }
 
-			static EnvironmentBinding* Instance() { static EnvironmentBinding binding; return &binding; }
+			static EnvironmentBinding* Instance(bool clustered = false) { 
+				static EnvironmentBinding binding(false); 
+				static EnvironmentBinding clusteredBinding(true);
+				return clustered ? (&clusteredBinding) : (&binding);
+			}
+		};
+
+		// Lighting models, the test materials can use:
+		enum class TestLightingModel : uint8_t {
+			// Test_ForwardLightingModel (each fragment iterates over every light)
+			FORWARD = 0,
+
+			// Test_ClusteredForwardLightingModel (each fragment iterates over the lights from it's LightClusterGrid cluster; expects clustered TestRenderer)
+			CLUSTERED_FORWARD = 1,
+
+			// Test_PerObjectForwardLightingModel (each fragment iterates over the per-instance light list from ObjectLightSelector; same environment as FORWARD)
+			PER_OBJECT_FORWARD = 2,
+
+			// Test_GBufferLightingModel (fragments only fill the G-buffer and the lights get evaluated per pixel by Test_DeferredLightingModel; expects deferred TestRenderer)
+			DEFERRED = 3
 		};
 
 		class TestMaterial : public virtual Material {
 		private:
 			const Reference<Graphics::Shader> m_vertexShader;
 			const Reference<Graphics::Shader> m_fragmentShader;
+			const Reference<Graphics::Shader> m_shadowCasterVertexShader;
+			const Reference<Graphics::Shader> m_shadowCasterFragmentShader;
 			const Reference<Graphics::TextureSampler> m_sampler;
+			const bool m_clustered;
+			const bool m_perObjectLights;
 
-		public:
-			inline TestMaterial(Graphics::ShaderCache* cache, Graphics::Texture* texture)
-				: m_vertexShader(cache->GetShader("Shaders/Components/Shaders/Test_ForwardLightingModel/Components/Shaders/Test_SampleDiffuseShader.vert.spv"))
-				, m_fragmentShader(cache->GetShader("Shaders/Components/Shaders/Test_ForwardLightingModel/Components/Shaders/Test_SampleDiffuseShader.frag.spv"))
-				, m_sampler(texture->CreateView(Graphics::TextureView::ViewType::VIEW_2D)->CreateSampler()) {}
+			inline static std::string ShaderPath(TestLightingModel model, const char* stage) {
+				static const char* const MODEL_NAMES[] = { "Test_ForwardLightingModel", "Test_ClusteredForwardLightingModel", "Test_PerObjectForwardLightingModel", "Test_GBufferLightingModel" };
+				return std::string("Shaders/Components/Shaders/") + MODEL_NAMES[static_cast<uint8_t>(model)] + "/Components/Shaders/Test_SampleDiffuseShader." + stage + ".spv";
+			}
 
-			inline virtual Graphics::PipelineDescriptor::BindingSetDescriptor* EnvironmentDescriptor()const override { return EnvironmentBinding::Instance(); }
+		public:
+			inline TestMaterial(Graphics::ShaderCache* cache, Graphics::Texture* texture, TestLightingModel model = TestLightingModel::FORWARD)
+				: m_vertexShader(cache->GetShader(ShaderPath(model, "vert")))
+				, m_fragmentShader(cache->GetShader(ShaderPath(model, "frag")))
+				, m_shadowCasterVertexShader(cache->GetShader(
+					"Shaders/Environment/GraphicsContext/Lights/Shaders/Jimara_ShadowCasterModel/Components/Shaders/Test_SampleDiffuseShader.vert.spv"))
+				, m_shadowCasterFragmentShader(cache->GetShader(
+					"Shaders/Environment/GraphicsContext/Lights/Shaders/Jimara_ShadowCasterModel/Components/Shaders/Test_SampleDiffuseShader.frag.spv"))
+				, m_sampler(texture->CreateView(Graphics::TextureView::ViewType::VIEW_2D)->CreateSampler())
+				, m_clustered(model == TestLightingModel::CLUSTERED_FORWARD)
+				, m_perObjectLights(model == TestLightingModel::PER_OBJECT_FORWARD) {}
+
+			inline virtual Graphics::PipelineDescriptor::BindingSetDescriptor* EnvironmentDescriptor()const override { return EnvironmentBinding::Instance(m_clustered); }
 
 			inline virtual Reference<Graphics::Shader> VertexShader()const override { return m_vertexShader; }
 			inline virtual Reference<Graphics::Shader> FragmentShader()const override { return m_fragmentShader; }
 
+			inline virtual Reference<Graphics::Shader> ShadowCasterVertexShader()const override { return m_shadowCasterVertexShader; }
+			inline virtual Reference<Graphics::Shader> ShadowCasterFragmentShader()const override { return m_shadowCasterFragmentShader; }
+
+			inline virtual bool UsesPerObjectLights()const override { return m_perObjectLights; }
+
 			inline virtual bool SetByEnvironment()const override { return false; }
 
 			inline virtual size_t ConstantBufferCount()const override { return 0; }
@@ -214,34 +281,221 @@ namespace Jimara {
 				Graphics::BufferReference<Matrix4> m_cameraTransform;
 				Reference<LightDataBuffer> m_lightDataBuffer;
 				Reference<LightTypeIdBuffer> m_lightTypeIdBuffer;
+				Reference<LightClusterGrid> m_lightClusterGrid;
+				Reference<ShadowAtlas> m_shadowAtlas;
 
 				Stopwatch m_stopwatch;
 
 			public:
-				inline EnvironmentPipeline(GraphicsContext* context)
-					: m_device(context->Device())
+				inline EnvironmentPipeline(GraphicsContext* context, bool clustered)
+					: EnvironmentBinding(clustered)
+					, m_device(context->Device())
 					, m_cameraTransform(context->Device()->CreateConstantBuffer<Matrix4>())
 					, m_lightDataBuffer(LightDataBuffer::Instance(context))
-					, m_lightTypeIdBuffer(LightTypeIdBuffer::Instance(context)) {}
+					, m_lightTypeIdBuffer(LightTypeIdBuffer::Instance(context))
+					, m_lightClusterGrid(clustered ? Object::Instantiate<LightClusterGrid>(context) : nullptr)
+					, m_shadowAtlas(ShadowAtlas::Instance(context)) {}
 
 				inline virtual bool SetByEnvironment()const override { return false; }
-				inline virtual Reference<Graphics::Buffer> ConstantBuffer(size_t)const override { return m_cameraTransform; }
-				inline Reference<Graphics::ArrayBuffer> StructuredBuffer(size_t index)const override { return index < 1 ? m_lightDataBuffer->Buffer() : m_lightTypeIdBuffer->Buffer(); }
+				inline virtual Reference<Graphics::Buffer> ConstantBuffer(size_t index)const override { 
+					if (index < 1) return Reference<Graphics::Buffer>(m_cameraTransform);
+					else if (Clustered()) return Reference<Graphics::Buffer>(m_lightClusterGrid->SettingsBuffer());
+					else return Reference<Graphics::Buffer>(m_lightTypeIdBuffer->CountBuffer());
+				}
+				inline Reference<Graphics::ArrayBuffer> StructuredBuffer(size_t index)const override {
+					switch (index) {
+					case 0: return m_lightDataBuffer->Buffer();
+					case 1: return m_lightTypeIdBuffer->Buffer();
+					default: break;
+					}
+					if (Clustered()) switch (index) {
+					case 2: return m_lightClusterGrid->ClusterBuffer();
+					case 3: return m_lightClusterGrid->LightIndexBuffer();
+					default: return Reference<Graphics::ArrayBuffer>(m_shadowAtlas->ViewBuffer());
+					}
+					else switch (index) {
+					case 2: return Reference<Graphics::ArrayBuffer>(m_shadowAtlas->ViewBuffer());
+					case 3: return Reference<Graphics::ArrayBuffer>(m_lightTypeIdBuffer->TypeRangeBuffer());
+					default: return Reference<Graphics::ArrayBuffer>(m_lightTypeIdBuffer->GroupedSlotBuffer());
+					}
+				}
+
+				inline Reference<Graphics::TextureSampler> Sampler(size_t index)const override { return m_shadowAtlas->Sampler(); }
 
 				inline virtual size_t BindingSetCount()const override { return 1; }
 				inline virtual const Graphics::PipelineDescriptor::BindingSetDescriptor* BindingSet(size_t index)const override {
 					return (const Graphics::PipelineDescriptor::BindingSetDescriptor*)this;
 				}
 
+				inline ShadowAtlas* Shadows()const { return m_shadowAtlas; }
+
+				inline Reference<Graphics::Buffer> CameraTransform()const { return Reference<Graphics::Buffer>(m_cameraTransform); }
+
 				inline void UpdateCamera(Size2 imageSize) {
 					Matrix4 projection = glm::perspective(glm::radians(64.0f), (float)imageSize.x / (float)imageSize.y, 0.001f, 10000.0f);
 					projection[2] *= -1.0f;
 					float time = m_stopwatch.Elapsed();
 					const Vector3 position = Vector3(1.5f, 1.0f + 0.8f * cos(time * glm::radians(15.0f)), 1.5f);
 					const Vector3 target = Vector3(0.0f, 0.25f, 0.0f);
-					m_cameraTransform.Map() = (projection * Math::Inverse(Math::LookAt(position, target)) * Math::MatrixFromEulerAngles(Vector3(0.0f, time * 10.0f, 0.0f)));
+					const Matrix4 cameraTransform = (projection * Math::Inverse(Math::LookAt(position, target)) * Math::MatrixFromEulerAngles(Vector3(0.0f, time * 10.0f, 0.0f)));
+					m_cameraTransform.Map() = cameraTransform;
 					m_cameraTransform->Unmap(true);
+					if (m_lightClusterGrid != nullptr)
+						m_lightClusterGrid->Update(cameraTransform, 0.001f, 10000.0f);
+					m_shadowAtlas->SetViewer(ShadowAtlas::Viewer{ cameraTransform, 0.001f, 10000.0f });
+				}
+			};
+
+			// Lighting pass of the deferred path (full-screen triangle, that evaluates the lights per pixel from the G-buffer, rendered by Test_GBufferLightingModel materials)
+			class DeferredLightingPipeline : public virtual Graphics::GraphicsPipeline::Descriptor, public virtual Graphics::PipelineDescriptor::BindingSetDescriptor {
+			private:
+				const Reference<Graphics::Shader> m_vertexShader;
+				const Reference<Graphics::Shader> m_fragmentShader;
+				const Reference<LightDataBuffer> m_lightDataBuffer;
+				const Reference<LightTypeIdBuffer> m_lightTypeIdBuffer;
+				const Reference<ShadowAtlas> m_shadowAtlas;
+
+				// G-buffer attachment samplers, followed by the G-buffer depth sampler
+				const std::vector<Reference<Graphics::TextureSampler>> m_gbufferSamplers;
+
+			public:
+				inline DeferredLightingPipeline(SceneContext* context, const std::vector<Reference<Graphics::TextureSampler>>& gbufferSamplers)
+					: m_vertexShader(context->Context()->ShaderCache()->GetShader(
+						"Shaders/Components/Shaders/Test_DeferredLightingModel/Components/Shaders/Test_SampleDiffuseShader.vert.spv"))
+					, m_fragmentShader(context->Context()->ShaderCache()->GetShader(
+						"Shaders/Components/Shaders/Test_DeferredLightingModel/Components/Shaders/Test_SampleDiffuseShader.frag.spv"))
+					, m_lightDataBuffer(LightDataBuffer::Instance(context->Graphics()))
+					, m_lightTypeIdBuffer(LightTypeIdBuffer::Instance(context->Graphics()))
+					, m_shadowAtlas(ShadowAtlas::Instance(context->Graphics()))
+					, m_gbufferSamplers(gbufferSamplers) {}
+
+				inline virtual bool SetByEnvironment()const override { return false; }
+
+				inline virtual size_t ConstantBufferCount()const override { return 0; }
+				inline virtual BindingInfo ConstantBufferInfo(size_t index)const override { return BindingInfo(); }
+				inline virtual Reference<Graphics::Buffer> ConstantBuffer(size_t index)const override { return nullptr; }
+
+				// Light data, ShadowAtlas views, light type ranges and grouped slots (same bindings as the forward environment):
+				inline virtual size_t StructuredBufferCount()const override { return 4; }
+				inline virtual BindingInfo StructuredBufferInfo(size_t index)const override {
+					static const uint32_t BINDINGS[] = { 0u, 4u, 6u, 7u };
+					return BindingInfo{ Graphics::StageMask(Graphics::PipelineStage::FRAGMENT), BINDINGS[index] };
+				}
+				inline virtual Reference<Graphics::ArrayBuffer> StructuredBuffer(size_t index)const override {
+					switch (index) {
+					case 0: return m_lightDataBuffer->Buffer();
+					case 1: return Reference<Graphics::ArrayBuffer>(m_shadowAtlas->ViewBuffer());
+					case 2: return Reference<Graphics::ArrayBuffer>(m_lightTypeIdBuffer->TypeRangeBuffer());
+					default: return Reference<Graphics::ArrayBuffer>(m_lightTypeIdBuffer->GroupedSlotBuffer());
+					}
+				}
+
+				// ShadowAtlas at binding 5, followed by the G-buffer from binding 8 onwards:
+				inline virtual size_t TextureSamplerCount()const override { return m_gbufferSamplers.size() + 1; }
+				inline virtual BindingInfo TextureSamplerInfo(size_t index)const override {
+					return BindingInfo{ Graphics::StageMask(Graphics::PipelineStage::FRAGMENT), static_cast<uint32_t>((index < 1) ? 5u : (index + 7u)) };
+				}
+				inline virtual Reference<Graphics::TextureSampler> Sampler(size_t index)const override {
+					return (index < 1) ? m_shadowAtlas->Sampler() : m_gbufferSamplers[index - 1];
+				}
+
+				inline virtual size_t BindingSetCount()const override { return 1; }
+				inline virtual const Graphics::PipelineDescriptor::BindingSetDescriptor* BindingSet(size_t index)const override {
+					return (const Graphics::PipelineDescriptor::BindingSetDescriptor*)this;
+				}
+
+				inline virtual Reference<Graphics::Shader> VertexShader() override { return m_vertexShader; }
+				inline virtual Reference<Graphics::Shader> FragmentShader() override { return m_fragmentShader; }
+
+				// Full-screen triangle is generated from gl_VertexIndex (pipeline fills in the default index buffer):
+				inline virtual size_t VertexBufferCount() override { return 0; }
+				inline virtual Reference<Graphics::VertexBuffer> VertexBuffer(size_t index) override { return nullptr; }
+				inline virtual size_t InstanceBufferCount() override { return 0; }
+				inline virtual Reference<Graphics::InstanceBuffer> InstanceBuffer(size_t index) override { return nullptr; }
+				inline virtual Graphics::ArrayBufferReference<uint32_t> IndexBuffer() override { return nullptr; }
+				inline virtual size_t IndexCount() override { return 3; }
+				inline virtual size_t InstanceCount() override { return 1; }
+			};
+
+			// Environment of the depth prepass, laid out as Jimara_ShadowCasterModel expects it (light data at binding 0 and Jimara_ShadowView at MODEL_BINDING_START_ID, which is binding 1);
+			// Camera transform gets bound to the view slot explicitly, so the prepass does not depend on the forward environment keeping the camera at the same binding
+			class DepthPrepassEnvironment : public virtual Graphics::PipelineDescriptor, public virtual Graphics::PipelineDescriptor::BindingSetDescriptor {
+			private:
+				const Reference<EnvironmentPipeline> m_environment;
+				const Reference<LightDataBuffer> m_lightDataBuffer;
+
+			public:
+				// Without the environment, the descriptor only describes the shape of the binding set (depth-only variants are created with that)
+				inline DepthPrepassEnvironment(EnvironmentPipeline* environment = nullptr, LightDataBuffer* lightDataBuffer = nullptr)
+					: m_environment(environment), m_lightDataBuffer(lightDataBuffer) {}
+
+				inline static const DepthPrepassEnvironment* Shape() {
+					static const DepthPrepassEnvironment shape;
+					return &shape;
+				}
+
+				inline virtual bool SetByEnvironment()const override { return m_environment == nullptr; }
+
+				inline virtual size_t ConstantBufferCount()const override { return 1; }
+				inline virtual BindingInfo ConstantBufferInfo(size_t index)const override { return BindingInfo{ Graphics::StageMask(Graphics::PipelineStage::VERTEX), 1u }; }
+				inline virtual Reference<Graphics::Buffer> ConstantBuffer(size_t index)const override { return (m_environment != nullptr) ? m_environment->CameraTransform() : nullptr; }
+
+				inline virtual size_t StructuredBufferCount()const override { return 1; }
+				inline virtual BindingInfo StructuredBufferInfo(size_t index)const override {
+					return BindingInfo{ Graphics::StageMask(Graphics::PipelineStage::VERTEX, Graphics::PipelineStage::FRAGMENT), 0u };
+				}
+				inline virtual Reference<Graphics::ArrayBuffer> StructuredBuffer(size_t index)const override { return (m_lightDataBuffer != nullptr) ? m_lightDataBuffer->Buffer() : nullptr; }
+
+				inline virtual size_t TextureSamplerCount()const override { return 0; }
+				inline virtual BindingInfo TextureSamplerInfo(size_t index)const override { return BindingInfo(); }
+				inline virtual Reference<Graphics::TextureSampler> Sampler(size_t index)const override { return nullptr; }
+
+				inline virtual size_t BindingSetCount()const override { return 1; }
+				inline virtual const Graphics::PipelineDescriptor::BindingSetDescriptor* BindingSet(size_t index)const override {
+					return (const Graphics::PipelineDescriptor::BindingSetDescriptor*)this;
+				}
+			};
+
+			// Scene object pipeline, as drawn by the depth prepass (shadow caster shaders, that only output depth) or by the color pass after it
+			// (LESS_OR_EQUAL depth test for the objects with shadow caster shaders, so that the ones, the prepass has not drawn yet, are still shaded like without the prepass; 
+			// objects without shadow caster shaders keep the regular depth test)
+			class DepthPrepassVariant : public virtual Graphics::GraphicsPipeline::Descriptor {
+			private:
+				const Reference<Graphics::GraphicsPipeline::Descriptor> m_source;
+				ShadowCasterDescriptor* const m_depthOnly;
+				const Graphics::GraphicsPipeline::DepthTest m_depthTest;
+
+			public:
+				inline DepthPrepassVariant(Graphics::GraphicsPipeline::Descriptor* source, ShadowCasterDescriptor* depthOnly, Graphics::GraphicsPipeline::DepthTest depthTest)
+					: m_source(source), m_depthOnly(depthOnly), m_depthTest(depthTest) {}
+
+				inline static bool HasDepthOnlyShaders(Graphics::GraphicsPipeline::Descriptor* source) {
+					ShadowCasterDescriptor* caster = dynamic_cast<ShadowCasterDescriptor*>(source);
+					return (caster != nullptr) && (caster->ShadowCasterVertexShader() != nullptr) && (caster->ShadowCasterFragmentShader() != nullptr);
+				}
+
+				// Depth-only variants replace the environment set with the one, Jimara_ShadowCasterModel expects (the rest are shared with the source):
+				inline virtual size_t BindingSetCount()const override { 
+					return (m_depthOnly != nullptr) ? std::max(m_source->BindingSetCount(), static_cast<size_t>(1)) : m_source->BindingSetCount();
+				}
+				inline virtual const Graphics::PipelineDescriptor::BindingSetDescriptor* BindingSet(size_t index)const override { 
+					return (m_depthOnly != nullptr && index < 1) ? DepthPrepassEnvironment::Shape() : m_source->BindingSet(index);
 				}
+
+				inline virtual Reference<Graphics::Shader> VertexShader() override { return (m_depthOnly != nullptr) ? m_depthOnly->ShadowCasterVertexShader() : m_source->VertexShader(); }
+				inline virtual Reference<Graphics::Shader> FragmentShader() override { return (m_depthOnly != nullptr) ? m_depthOnly->ShadowCasterFragmentShader() : m_source->FragmentShader(); }
+
+				inline virtual size_t VertexBufferCount() override { return m_source->VertexBufferCount(); }
+				inline virtual Reference<Graphics::VertexBuffer> VertexBuffer(size_t index) override { return m_source->VertexBuffer(index); }
+
+				inline virtual size_t InstanceBufferCount() override { return m_source->InstanceBufferCount(); }
+				inline virtual Reference<Graphics::InstanceBuffer> InstanceBuffer(size_t index) override { return m_source->InstanceBuffer(index); }
+
+				inline virtual Graphics::ArrayBufferReference<uint32_t> IndexBuffer() override { return m_source->IndexBuffer(); }
+				inline virtual size_t IndexCount() override { return m_source->IndexCount(); }
+				inline virtual size_t InstanceCount() override { return m_source->InstanceCount(); }
+
+				inline virtual Graphics::GraphicsPipeline::DepthTest DepthTestMode() override { return m_depthTest; }
 			};
 
 			class Data : public virtual Object {
@@ -253,39 +507,155 @@ namespace Jimara {
 				Reference<Graphics::RenderPass> m_renderPass;
 				std::vector<Reference<Graphics::FrameBuffer>> m_frameBuffers;
 
+				// Deferred path: scene objects are rendered to the G-buffer through m_renderPass and the lighting pass resolves it to the target images
+				std::vector<Vector4> m_clearValues;
+				Reference<Graphics::RenderPass> m_lightingPass;
+				std::vector<Reference<Graphics::FrameBuffer>> m_lightingFrameBuffers;
+				Reference<DeferredLightingPipeline> m_lightingDescriptor;
+				Reference<Graphics::GraphicsPipeline> m_lightingPipeline;
+
+				// Depth prepass: scene objects get drawn into m_depthAttachment with depth-only variants of their pipelines before the color pass
+				Reference<Graphics::TextureView> m_depthAttachment;
+				Reference<Graphics::RenderPass> m_depthPrepass;
+				Reference<Graphics::FrameBuffer> m_depthPrepassFrameBuffer;
+				Reference<Graphics::GraphicsPipelineSet> m_depthPrepassPipelineSet;
+				Reference<Graphics::Pipeline> m_depthPrepassEnvironment;
+				std::unordered_map<Graphics::GraphicsPipeline::Descriptor*, std::pair<Reference<DepthPrepassVariant>, Reference<DepthPrepassVariant>>> m_depthPrepassVariants;
+
 				Reference<Graphics::Pipeline> m_environmentPipeline;
 				Reference<Graphics::GraphicsPipelineSet> m_sceneObjectPipelineSet;
 
 				void AddGraphicsPipelines(const Reference<Graphics::GraphicsPipeline::Descriptor>* descriptors, size_t count) {
-					m_sceneObjectPipelineSet->AddPipelines(descriptors, count);
+					if (m_depthPrepassPipelineSet == nullptr) {
+						m_sceneObjectPipelineSet->AddPipelines(descriptors, count);
+						return;
+					}
+					static thread_local std::vector<Reference<Graphics::GraphicsPipeline::Descriptor>> colorPipelines;
+					static thread_local std::vector<Reference<Graphics::GraphicsPipeline::Descriptor>> depthPipelines;
+					for (size_t i = 0; i < count; i++) {
+						Graphics::GraphicsPipeline::Descriptor* source = descriptors[i];
+						if (source == nullptr || m_depthPrepassVariants.find(source) != m_depthPrepassVariants.end()) continue;
+						const bool drawnByPrepass = DepthPrepassVariant::HasDepthOnlyShaders(source);
+						const Reference<DepthPrepassVariant> colorVariant = Object::Instantiate<DepthPrepassVariant>(
+							source, nullptr, drawnByPrepass ? Graphics::GraphicsPipeline::DepthTest::LESS_OR_EQUAL : Graphics::GraphicsPipeline::DepthTest::LESS);
+						const Reference<DepthPrepassVariant> depthVariant = drawnByPrepass ? Object::Instantiate<DepthPrepassVariant>(
+							source, dynamic_cast<ShadowCasterDescriptor*>(source), Graphics::GraphicsPipeline::DepthTest::LESS) : nullptr;
+						m_depthPrepassVariants[source] = std::make_pair(colorVariant, depthVariant);
+						colorPipelines.push_back(colorVariant);
+						if (depthVariant != nullptr) depthPipelines.push_back(depthVariant);
+					}
+					m_sceneObjectPipelineSet->AddPipelines(colorPipelines.data(), colorPipelines.size());
+					m_depthPrepassPipelineSet->AddPipelines(depthPipelines.data(), depthPipelines.size());
+					colorPipelines.clear();
+					depthPipelines.clear();
 				};
 
 				void RemoveGraphicsPipelines(const Reference<Graphics::GraphicsPipeline::Descriptor>* descriptors, size_t count) {
-					m_sceneObjectPipelineSet->RemovePipelines(descriptors, count);
+					if (m_depthPrepassPipelineSet == nullptr) {
+						m_sceneObjectPipelineSet->RemovePipelines(descriptors, count);
+						return;
+					}
+					static thread_local std::vector<Reference<Graphics::GraphicsPipeline::Descriptor>> colorPipelines;
+					static thread_local std::vector<Reference<Graphics::GraphicsPipeline::Descriptor>> depthPipelines;
+					for (size_t i = 0; i < count; i++) {
+						auto it = m_depthPrepassVariants.find(descriptors[i]);
+						if (it == m_depthPrepassVariants.end()) continue;
+						colorPipelines.push_back(it->second.first);
+						if (it->second.second != nullptr) depthPipelines.push_back(it->second.second);
+						m_depthPrepassVariants.erase(it);
+					}
+					m_sceneObjectPipelineSet->RemovePipelines(colorPipelines.data(), colorPipelines.size());
+					m_depthPrepassPipelineSet->RemovePipelines(depthPipelines.data(), depthPipelines.size());
+					colorPipelines.clear();
+					depthPipelines.clear();
 				};
 
 			public:
-				inline Data(SceneContext* context, Graphics::RenderEngineInfo* engineInfo, EnvironmentPipeline* environmentDescriptor)
-					: m_context(context), m_engineInfo(engineInfo), m_environmentDescriptor(environmentDescriptor) {
+				inline void CreateForwardPass(bool loadDepth) {
+					Graphics::Texture::PixelFormat pixelFormat = m_engineInfo->ImageFormat();
+					Graphics::GraphicsDevice* const device = m_engineInfo->Device();
 
-					Graphics::Texture::PixelFormat pixelFormat = engineInfo->ImageFormat();
-
-					Reference<Graphics::TextureView> colorAttachment = engineInfo->Device()->CreateMultisampledTexture(
-						Graphics::Texture::TextureType::TEXTURE_2D, pixelFormat, Size3(engineInfo->ImageSize(), 1), 1, Graphics::Texture::Multisampling::MAX_AVAILABLE)
+					Reference<Graphics::TextureView> colorAttachment = device->CreateMultisampledTexture(
+						Graphics::Texture::TextureType::TEXTURE_2D, pixelFormat, Size3(m_engineInfo->ImageSize(), 1), 1, Graphics::Texture::Multisampling::MAX_AVAILABLE)
 						->CreateView(Graphics::TextureView::ViewType::VIEW_2D);
 
-					Reference<Graphics::TextureView> depthAttachment = engineInfo->Device()->CreateMultisampledTexture(
-						Graphics::Texture::TextureType::TEXTURE_2D, engineInfo->Device()->GetDepthFormat()
+					Reference<Graphics::TextureView> depthAttachment = device->CreateMultisampledTexture(
+						Graphics::Texture::TextureType::TEXTURE_2D, device->GetDepthFormat()
 						, colorAttachment->TargetTexture()->Size(), 1, colorAttachment->TargetTexture()->SampleCount())
 						->CreateView(Graphics::TextureView::ViewType::VIEW_2D);
 
-					m_renderPass = m_context->Graphics()->Device()->CreateRenderPass(
-						colorAttachment->TargetTexture()->SampleCount(), 1, &pixelFormat, depthAttachment->TargetTexture()->ImageFormat(), true);
+					m_renderPass = device->CreateRenderPass(
+						colorAttachment->TargetTexture()->SampleCount(), 1, &pixelFormat, depthAttachment->TargetTexture()->ImageFormat(), true, loadDepth);
+					m_depthAttachment = depthAttachment;
 
 					for (size_t i = 0; i < m_engineInfo->ImageCount(); i++) {
-						Reference<Graphics::TextureView> resolveView = engineInfo->Image(i)->CreateView(Graphics::TextureView::ViewType::VIEW_2D);
+						Reference<Graphics::TextureView> resolveView = m_engineInfo->Image(i)->CreateView(Graphics::TextureView::ViewType::VIEW_2D);
 						m_frameBuffers.push_back(m_renderPass->CreateFrameBuffer(&colorAttachment, depthAttachment, &resolveView));
 					}
+					m_clearValues.assign(1, Vector4(0.0f, 0.25f, 0.25f, 1.0f));
+				}
+
+				inline void CreateDeferredPasses(bool loadDepth) {
+					Graphics::GraphicsDevice* const device = m_engineInfo->Device();
+
+					// G-buffer attachments (Test_SampleDiffuseShader packs world-space position, normal and color into them):
+					static Graphics::Texture::PixelFormat GBUFFER_FORMATS[] = {
+						Graphics::Texture::PixelFormat::R32G32B32A32_SFLOAT,
+						Graphics::Texture::PixelFormat::R16G16B16A16_SFLOAT,
+						Graphics::Texture::PixelFormat::R8G8B8A8_UNORM
+					};
+					static const constexpr size_t GBUFFER_ATTACHMENT_COUNT = (sizeof(GBUFFER_FORMATS) / sizeof(Graphics::Texture::PixelFormat));
+					Reference<Graphics::TextureView> gbufferAttachments[GBUFFER_ATTACHMENT_COUNT];
+					std::vector<Reference<Graphics::TextureSampler>> gbufferSamplers;
+					for (size_t i = 0; i < GBUFFER_ATTACHMENT_COUNT; i++) {
+						gbufferAttachments[i] = device->CreateMultisampledTexture(
+							Graphics::Texture::TextureType::TEXTURE_2D, GBUFFER_FORMATS[i], Size3(m_engineInfo->ImageSize(), 1), 1, Graphics::Texture::Multisampling::SAMPLE_COUNT_1)
+							->CreateView(Graphics::TextureView::ViewType::VIEW_2D);
+						gbufferSamplers.push_back(gbufferAttachments[i]->CreateSampler(
+							Graphics::TextureSampler::FilteringMode::NEAREST, Graphics::TextureSampler::WrappingMode::CLAMP_TO_EDGE));
+					}
+					const Reference<Graphics::TextureView> depthAttachment = device->CreateMultisampledTexture(
+						Graphics::Texture::TextureType::TEXTURE_2D, device->GetDepthFormat(), Size3(m_engineInfo->ImageSize(), 1), 1, Graphics::Texture::Multisampling::SAMPLE_COUNT_1)
+						->CreateView(Graphics::TextureView::ViewType::VIEW_2D);
+					gbufferSamplers.push_back(depthAttachment->CreateSampler(
+						Graphics::TextureSampler::FilteringMode::NEAREST, Graphics::TextureSampler::WrappingMode::CLAMP_TO_EDGE));
+
+					// G-buffer pass renders the scene objects (same G-buffer is reused by all in-flight frames, just like the forward pass attachments):
+					m_renderPass = device->CreateRenderPass(
+						Graphics::Texture::Multisampling::SAMPLE_COUNT_1, GBUFFER_ATTACHMENT_COUNT, GBUFFER_FORMATS, depthAttachment->TargetTexture()->ImageFormat(), false, loadDepth);
+					m_depthAttachment = depthAttachment;
+					const Reference<Graphics::FrameBuffer> gbuffer = m_renderPass->CreateFrameBuffer(gbufferAttachments, depthAttachment, nullptr);
+					m_frameBuffers.assign(m_engineInfo->ImageCount(), gbuffer);
+					m_clearValues.assign(GBUFFER_ATTACHMENT_COUNT, Vector4(0.0f));
+
+					// Lighting pass writes directly to the target images:
+					Graphics::Texture::PixelFormat pixelFormat = m_engineInfo->ImageFormat();
+					m_lightingPass = device->CreateRenderPass(
+						Graphics::Texture::Multisampling::SAMPLE_COUNT_1, 1, &pixelFormat, Graphics::Texture::PixelFormat::OTHER, false);
+					for (size_t i = 0; i < m_engineInfo->ImageCount(); i++) {
+						Reference<Graphics::TextureView> targetView = m_engineInfo->Image(i)->CreateView(Graphics::TextureView::ViewType::VIEW_2D);
+						m_lightingFrameBuffers.push_back(m_lightingPass->CreateFrameBuffer(&targetView, nullptr, nullptr));
+					}
+					m_lightingDescriptor = Object::Instantiate<DeferredLightingPipeline>(m_context, gbufferSamplers);
+					m_lightingPipeline = m_lightingPass->CreateGraphicsPipeline(m_lightingDescriptor, m_engineInfo->ImageCount());
+				}
+
+				inline void CreateDepthPrepass() {
+					Graphics::GraphicsDevice* const device = m_engineInfo->Device();
+					m_depthPrepass = device->CreateRenderPass(
+						m_depthAttachment->TargetTexture()->SampleCount(), 0, nullptr, m_depthAttachment->TargetTexture()->ImageFormat(), false);
+					m_depthPrepassFrameBuffer = m_depthPrepass->CreateFrameBuffer(nullptr, m_depthAttachment, nullptr);
+					m_depthPrepassPipelineSet = Object::Instantiate<Graphics::GraphicsPipelineSet>(device->GraphicsQueue(), m_depthPrepass, m_engineInfo->ImageCount());
+					m_depthPrepassEnvironment = device->CreateEnvironmentPipeline(
+						Object::Instantiate<DepthPrepassEnvironment>(m_environmentDescriptor, LightDataBuffer::Instance(m_context->Graphics())), m_engineInfo->ImageCount());
+				}
+
+			public:
+				inline Data(SceneContext* context, Graphics::RenderEngineInfo* engineInfo, EnvironmentPipeline* environmentDescriptor, bool deferred, bool depthPrepass)
+					: m_context(context), m_engineInfo(engineInfo), m_environmentDescriptor(environmentDescriptor) {
+					if (deferred) CreateDeferredPasses(depthPrepass);
+					else CreateForwardPass(depthPrepass);
+					if (depthPrepass) CreateDepthPrepass();
 
 					m_environmentPipeline = m_context->Graphics()->Device()->CreateEnvironmentPipeline(m_environmentDescriptor, m_engineInfo->ImageCount());
 
@@ -320,13 +690,28 @@ namespace Jimara {
 					}
 
 					m_environmentDescriptor->UpdateCamera(m_engineInfo->ImageSize());
+					m_environmentDescriptor->Shadows()->Render(buffer, bufferInfo.inFlightBufferId, m_engineInfo->ImageCount());
+
+					// Depth prepass (always clears the depth attachment; objects, the prepass skips because their depth-only pipelines are not there yet, pass the LESS_OR_EQUAL test as usual, 
+					// but the prepass itself is skipped, while any of the color pipelines is missing, since it would otherwise leave holes in place of the objects, that the color pass can not draw):
+					if (m_depthPrepass != nullptr) {
+						m_depthPrepass->BeginPass(bufferInfo.commandBuffer, m_depthPrepassFrameBuffer, nullptr, true);
+						if (m_sceneObjectPipelineSet->PendingPipelineCount() <= 0 && m_sceneObjectPipelineSet->FailedPipelineCount() <= 0)
+							m_depthPrepassPipelineSet->ExecutePipelines(buffer, bufferInfo.inFlightBufferId, m_depthPrepassFrameBuffer, m_depthPrepassEnvironment);
+						m_depthPrepass->EndPass(bufferInfo.commandBuffer);
+					}
 
 					Graphics::FrameBuffer* const frameBuffer = m_frameBuffers[bufferInfo.inFlightBufferId];
-					const Vector4 CLEAR_VALUE(0.0f, 0.25f, 0.25f, 1.0f);
 
-					m_renderPass->BeginPass(bufferInfo.commandBuffer, frameBuffer, &CLEAR_VALUE, true);
+					m_renderPass->BeginPass(bufferInfo.commandBuffer, frameBuffer, m_clearValues.data(), true);
 					m_sceneObjectPipelineSet->ExecutePipelines(buffer, bufferInfo.inFlightBufferId, frameBuffer, m_environmentPipeline);
 					m_renderPass->EndPass(bufferInfo.commandBuffer);
+
+					if (m_lightingPipeline == nullptr) return;
+					const Vector4 CLEAR_VALUE(0.0f, 0.25f, 0.25f, 1.0f);
+					m_lightingPass->BeginPass(bufferInfo.commandBuffer, m_lightingFrameBuffers[bufferInfo.inFlightBufferId], &CLEAR_VALUE, false);
+					m_lightingPipeline->Execute(bufferInfo);
+					m_lightingPass->EndPass(bufferInfo.commandBuffer);
 				}
 			};
 
@@ -334,13 +719,19 @@ namespace Jimara {
 		private:
 			Reference<SceneContext> m_context;
 			Reference<EnvironmentPipeline> m_environmentDescriptor;
+			bool m_deferred;
+			bool m_depthPrepass;
 
 
 		public:
-			TestRenderer(SceneContext* context) : m_context(context), m_environmentDescriptor(Object::Instantiate<EnvironmentPipeline>(context->Graphics())) {}
+			// Deferred renderers expect TestLightingModel::DEFERRED materials and can not be clustered (G-buffer pass uses the forward environment);
+			// Depth prepass draws the scene objects with their shadow caster shaders first and lets the color/G-buffer pass shade only the visible fragments (LESS_OR_EQUAL depth test)
+			TestRenderer(SceneContext* context, bool clustered = false, bool deferred = false, bool depthPrepass = false) 
+				: m_context(context), m_environmentDescriptor(Object::Instantiate<EnvironmentPipeline>(context->Graphics(), clustered && (!deferred)))
+				, m_deferred(deferred), m_depthPrepass(depthPrepass) {}
 
 			inline virtual Reference<Object> CreateEngineData(Graphics::RenderEngineInfo* engineInfo) override {
-				return Object::Instantiate<Data>(m_context, engineInfo, m_environmentDescriptor);
+				return Object::Instantiate<Data>(m_context, engineInfo, m_environmentDescriptor, m_deferred, m_depthPrepass);
 			}
 
 			inline virtual void Render(Object* engineData, Graphics::Pipeline::CommandBufferInfo bufferInfo) override {
@@ -954,4 +1345,733 @@ namespace Jimara {
 
 		environment.SetWindowName("Loaded scene");
 	}
+
+
+
+
+
+	namespace {
+		// Creates a white test material
+		inline static Reference<Material> CreateWhiteMaterial(Environment& environment, TestLightingModel model = TestLightingModel::FORWARD) {
+			Reference<Graphics::ImageTexture> texture = environment.RootObject()->Context()->Graphics()->Device()->CreateTexture(
+				Graphics::Texture::TextureType::TEXTURE_2D, Graphics::Texture::PixelFormat::R8G8B8A8_UNORM, Size3(1, 1, 1), 1, true);
+			(*static_cast<uint32_t*>(texture->Map())) = 0xFFFFFFFF;
+			texture->Unmap(true);
+			return Object::Instantiate<TestMaterial>(environment.RootObject()->Context()->Context()->ShaderCache(), texture, model);
+		}
+
+		// Creates a floor of FLOOR_SIZE x FLOOR_SIZE static boxes, covering [-2; 2] on XZ plane (heights vary from tile to tile, if varyHeights is set) and returns world-space tile bounds
+		inline static std::vector<AABB> CreateTileFloor(Environment& environment, Material* material, size_t floorSize, bool varyHeights) {
+			Reference<TriMesh> cubeMesh = TriMesh::Box(Vector3(-0.5f, -0.5f, -0.5f), Vector3(0.5f, 0.5f, 0.5f));
+			const float tileSize = (4.0f / static_cast<float>(floorSize));
+			std::vector<AABB> bounds;
+			for (size_t i = 0; i < floorSize; i++)
+				for (size_t j = 0; j < floorSize; j++) {
+					const Vector3 position(
+						(static_cast<float>(i) + 0.5f) * tileSize - 2.0f, -0.5f,
+						(static_cast<float>(j) + 0.5f) * tileSize - 2.0f);
+					const Vector3 scale(tileSize * 0.9f, tileSize * static_cast<float>(varyHeights ? (((i + j) % 3) + 1) : 1), tileSize * 0.9f);
+					Transform* transform = Object::Instantiate<Transform>(environment.RootObject(), "Tile", position);
+					transform->SetLocalScale(scale);
+					Object::Instantiate<MeshRenderer>(transform, "Tile_Renderer", cubeMesh, material)->MarkStatic(true);
+					bounds.push_back(AABB{ position - scale * 0.5f, position + scale * 0.5f });
+				}
+			return bounds;
+		}
+
+		// Creates small point lights, swirling around above the tile floor (colors are random, up to maxColor per channel; heights are random, between minY and maxY; static, if swirl is false)
+		inline static void CreateSwirlingLights(
+			Environment& environment, size_t count, float maxColor, float radius,
+			uint32_t seed = std::mt19937::default_seed, float minY = -0.4f, float maxY = 0.25f, bool swirl = true) {
+			std::mt19937 rng(seed);
+			std::uniform_real_distribution<float> disH(-2.0f, 2.0f);
+			std::uniform_real_distribution<float> disV(minY, maxY);
+			std::uniform_real_distribution<float> disColor(0.0f, maxColor);
+			for (size_t i = 0; i < count; i++) {
+				Transform* transform = Object::Instantiate<Transform>(environment.RootObject(), "PointLight", Vector3(disH(rng), disV(rng), disH(rng)));
+				Object::Instantiate<PointLight>(transform, "Light", Vector3(disColor(rng), disColor(rng), disColor(rng)), radius);
+				if (swirl) Object::Instantiate<TransformUpdater>(transform, "Updater", &environment, Swirl);
+			}
+		}
+
+		// Waits till SceneLightInfo reports given number of lights (or a timeout)
+		inline static bool WaitForLightCount(SceneLightInfo* lightInfo, size_t count, float timeout = 10.0f) {
+			Stopwatch stopwatch;
+			while (lightInfo->LightCount() != count && stopwatch.Elapsed() < timeout)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			return lightInfo->LightCount() == count;
+		}
+	}
+
+	// Renders a floor of boxes, lit by a large number of small moving lights, through the clustered lighting model
+	// (also bins the same lights with a standalone grid and makes sure, the cluster lists are consistent with the light bounds)
+	TEST(MeshRendererTest, ClusteredLighting) {
+		Environment environment("Clustered Lighting (Each fragment iterates only over the lights from it's cluster)");
+		SceneContext* context = environment.RootObject()->Context();
+		Reference<TestRenderer> renderer = Object::Instantiate<TestRenderer>(context, true);
+		environment.RenderEngine()->AddRenderer(renderer);
+
+		static const size_t LIGHT_COUNT = 512;
+		CreateSwirlingLights(environment, LIGHT_COUNT, 0.05f, 0.5f);
+		CreateTileFloor(environment, CreateWhiteMaterial(environment, TestLightingModel::CLUSTERED_FORWARD), 32, true);
+
+		const Reference<SceneLightInfo> lightInfo = SceneLightInfo::Instance(context->Graphics());
+		ASSERT_TRUE(WaitForLightCount(lightInfo, LIGHT_COUNT));
+
+		// Camera above the floor, looking down (most of the lights are visible, but some swirl out of view):
+		const Reference<LightClusterGrid> grid = Object::Instantiate<LightClusterGrid>(context->Graphics());
+		Matrix4 projection = glm::perspective(glm::radians(64.0f), 1.0f, 0.001f, 100.0f);
+		projection[2] *= -1.0f;
+		const Matrix4 viewProjection = projection * Math::Inverse(Math::LookAt(Vector3(0.0f, 3.0f, 0.5f), Vector3(0.0f, 0.0f, 0.0f)));
+
+		struct Snapshot {
+			std::vector<LightClusterGrid::Cluster> clusters;
+			std::vector<uint32_t> indices;
+			std::vector<AABB> bounds;
+
+			inline void StoreClusters(const LightClusterGrid::Cluster* clusterList, size_t clusterCount, const uint32_t* indexList, size_t indexCount) {
+				clusters.assign(clusterList, clusterList + clusterCount);
+				indices.assign(indexList, indexList + indexCount);
+			}
+
+			inline void StoreBounds(const AABB* boundList, size_t count) { bounds.assign(boundList, boundList + count); }
+		} snapshot;
+		{
+			// Lights can not move while we hold the lock, so the bounds are the same, the grid used:
+			GraphicsContext::ReadLock lock(context->Graphics());
+			grid->Update(viewProjection, 0.001f, 100.0f);
+			grid->ProcessClusters(Callback<const LightClusterGrid::Cluster*, size_t, const uint32_t*, size_t>(&Snapshot::StoreClusters, &snapshot));
+			lightInfo->ProcessLightBounds(Callback<const AABB*, size_t>(&Snapshot::StoreBounds, &snapshot));
+		}
+		const Size3 clusterCount = grid->ClusterCount();
+		ASSERT_EQ(snapshot.clusters.size(), static_cast<size_t>(clusterCount.x) * clusterCount.y * clusterCount.z);
+		EXPECT_EQ(snapshot.indices.size(), grid->LightIndexCount());
+
+		// Cluster lists cover the index buffer and each one of them references a light at most once:
+		size_t totalCount = 0;
+		std::vector<size_t> clustersPerLight(snapshot.bounds.size(), 0);
+		for (size_t i = 0; i < snapshot.clusters.size(); i++) {
+			const LightClusterGrid::Cluster& cluster = snapshot.clusters[i];
+			ASSERT_LE(static_cast<size_t>(cluster.firstIndex) + cluster.lightCount, snapshot.indices.size());
+			totalCount += cluster.lightCount;
+			std::unordered_set<uint32_t> clusterLights;
+			for (uint32_t j = 0; j < cluster.lightCount; j++) {
+				const uint32_t lightId = snapshot.indices[static_cast<size_t>(cluster.firstIndex) + j];
+				ASSERT_LT(lightId, snapshot.bounds.size());
+				EXPECT_TRUE(clusterLights.insert(lightId).second);
+				clustersPerLight[lightId]++;
+			}
+		}
+		EXPECT_EQ(totalCount, snapshot.indices.size());
+
+		// Every light, that has it's center in view, lands in at least one cluster:
+		size_t visibleCount = 0;
+		for (size_t i = 0; i < snapshot.bounds.size(); i++) {
+			const Vector4 clipPosition = viewProjection * Vector4((snapshot.bounds[i].start + snapshot.bounds[i].end) * 0.5f, 1.0f);
+			if (clipPosition.w <= 0.001f || std::abs(clipPosition.x) >= clipPosition.w || std::abs(clipPosition.y) >= clipPosition.w) continue;
+			visibleCount++;
+			EXPECT_GT(clustersPerLight[i], 0u);
+		}
+		EXPECT_GT(visibleCount, 0u);
+		EXPECT_GE(snapshot.indices.size(), visibleCount);
+	}
+
+
+
+
+	namespace {
+		// Swirls around for a couple of seconds and then gets destroyed
+		bool ShortLivedSwirl(const CapturedTransformState& initialState, float totalTime, Environment* environment, Transform* transform) {
+			Swirl(initialState, totalTime, environment, transform);
+			return totalTime < 2.0f;
+		}
+
+		// Keeps spawning short-lived lights, so that the light slots get freed and reused all the time
+		class LightSpawner : public virtual Updatable, public virtual Component {
+		private:
+			Environment* const m_environment;
+			std::mt19937 m_rng;
+			Stopwatch m_stopwatch;
+			std::atomic<size_t> m_spawnedCount;
+
+		public:
+			inline LightSpawner(Component* parent, const std::string& name, Environment* environment)
+				: Component(parent, name), m_environment(environment), m_spawnedCount(0) {}
+
+			inline size_t SpawnedCount()const { return m_spawnedCount; }
+
+			inline virtual void Update()override {
+				if (m_stopwatch.Elapsed() < 0.02f) return;
+				m_stopwatch.Reset();
+				m_spawnedCount++;
+				std::uniform_real_distribution<float> disH(-2.0f, 2.0f);
+				std::uniform_real_distribution<float> disColor(0.0f, 0.5f);
+				Transform* transform = Object::Instantiate<Transform>(RootObject(), "PointLight", Vector3(disH(m_rng), 0.25f, disH(m_rng)));
+				Object::Instantiate<PointLight>(transform, "Light", Vector3(disColor(m_rng), disColor(m_rng), disColor(m_rng)), 1.0f);
+				Object::Instantiate<TransformUpdater>(transform, "Updater", m_environment, ShortLivedSwirl);
+			}
+		};
+
+		// Tracks the slot list size and the peak light count from SceneLightInfo updates
+		struct SlotUsage {
+			SceneLightInfo* lightInfo = nullptr;
+			std::mutex lock;
+			size_t slotCount = 0;
+			size_t peakLightCount = 0;
+
+			inline void OnUpdateLightInfo(const LightDescriptor::LightInfo*, size_t count) {
+				std::unique_lock<std::mutex> guard(lock);
+				slotCount = count;
+				peakLightCount = std::max(peakLightCount, lightInfo->LightCount());
+			}
+		};
+	}
+
+	// Renders a floor of boxes, lit by the lights that keep getting destroyed and replaced (light slots get freed and reused all the time)
+	// (the slot list should never grow past the largest number of simultaneously existing lights)
+	TEST(MeshRendererTest, LightSlotReuse) {
+		Environment environment("Light Slot Reuse (Lights keep getting destroyed and replaced)");
+		SceneContext* context = environment.RootObject()->Context();
+		Reference<TestRenderer> renderer = Object::Instantiate<TestRenderer>(context);
+		environment.RenderEngine()->AddRenderer(renderer);
+
+		const Reference<SceneLightInfo> lightInfo = SceneLightInfo::Instance(context->Graphics());
+		SlotUsage usage;
+		usage.lightInfo = lightInfo;
+		lightInfo->OnUpdateLightInfo() += Callback<const LightDescriptor::LightInfo*, size_t>(&SlotUsage::OnUpdateLightInfo, &usage);
+
+		CreateTileFloor(environment, CreateWhiteMaterial(environment), 16, false);
+		LightSpawner* spawner = Object::Instantiate<LightSpawner>(environment.RootObject(), "LightSpawner", &environment);
+
+		// Each light lives for a couple of seconds, so by the time a few hundred get spawned, most of the early ones are gone:
+		static const size_t SPAWN_COUNT = 300;
+		{
+			Stopwatch timeout;
+			while (spawner->SpawnedCount() < SPAWN_COUNT && timeout.Elapsed() < 30.0f)
+				std::this_thread::sleep_for(std::chrono::milliseconds(16));
+		}
+		lightInfo->OnUpdateLightInfo() -= Callback<const LightDescriptor::LightInfo*, size_t>(&SlotUsage::OnUpdateLightInfo, &usage);
+
+		std::unique_lock<std::mutex> guard(usage.lock);
+		EXPECT_GE(spawner->SpawnedCount(), SPAWN_COUNT);
+		EXPECT_GT(usage.peakLightCount, 0u);
+		EXPECT_EQ(usage.slotCount, usage.peakLightCount);
+		EXPECT_LT(usage.slotCount * 2, spawner->SpawnedCount());
+	}
+
+
+
+
+	namespace {
+		// Creates a floor and a few pillars for the shadows to fall on/from
+		inline static std::vector<Transform*> CreateShadowTestScene(Environment& environment, Material* material) {
+			Reference<TriMesh> cubeMesh = TriMesh::Box(Vector3(-0.5f, -0.5f, -0.5f), Vector3(0.5f, 0.5f, 0.5f));
+			{
+				Transform* floor = Object::Instantiate<Transform>(environment.RootObject(), "Floor", Vector3(0.0f, -0.55f, 0.0f));
+				floor->SetLocalScale(Vector3(4.0f, 0.1f, 4.0f));
+				Object::Instantiate<MeshRenderer>(floor, "Floor_Renderer", cubeMesh, material)->MarkStatic(true);
+			}
+			std::vector<Transform*> pillars;
+			for (size_t i = 0; i < 4; i++) {
+				const float angle = Math::Radians(90.0f * static_cast<float>(i) + 45.0f);
+				Transform* pillar = Object::Instantiate<Transform>(environment.RootObject(), "Pillar", Vector3(std::cos(angle), 0.0f, std::sin(angle)) * 0.75f);
+				pillar->SetLocalScale(Vector3(0.2f, 1.0f, 0.2f));
+				Object::Instantiate<MeshRenderer>(pillar, "Pillar_Renderer", cubeMesh, material);
+				pillars.push_back(pillar);
+			}
+			return pillars;
+		}
+	}
+
+	// Renders pillars, casting shadows from a directional light (cascades follow the camera) and a point light (cube faces)
+	TEST(MeshRendererTest, Shadows) {
+		Environment environment("Shadows (Directional and point light shadows)");
+		Reference<TestRenderer> renderer = Object::Instantiate<TestRenderer>(environment.RootObject()->Context());
+		environment.RenderEngine()->AddRenderer(renderer);
+
+		{
+			Transform* transform = Object::Instantiate<Transform>(environment.RootObject(), "DirectionalLight");
+			transform->LookTowards(Vector3(-1.0f, -2.0f, -0.5f));
+			Object::Instantiate<DirectionalLight>(transform, "Light", Vector3(0.5f, 0.5f, 0.5f))->CastShadows(true);
+		}
+		{
+			Transform* transform = Object::Instantiate<Transform>(environment.RootObject(), "PointLight", Vector3(0.0f, 0.25f, 0.0f));
+			Object::Instantiate<PointLight>(transform, "Light", Vector3(1.0f, 0.75f, 0.5f), 4.0f)->CastShadows(true);
+			Object::Instantiate<TransformUpdater>(transform, "Updater", &environment, Swirl);
+		}
+
+		CreateShadowTestScene(environment, CreateWhiteMaterial(environment));
+	}
+
+	// Makes sure, the shadow maps get rendered once and then re-rendered only when the casters move
+	TEST(MeshRendererTest, ShadowCaching) {
+		Environment environment("Shadow Caching (Shadow maps are re-rendered only when something moves)");
+		Reference<TestRenderer> renderer = Object::Instantiate<TestRenderer>(environment.RootObject()->Context());
+		environment.RenderEngine()->AddRenderer(renderer);
+		const Reference<ShadowAtlas> atlas = ShadowAtlas::Instance(environment.RootObject()->Context()->Graphics());
+
+		{
+			Transform* transform = Object::Instantiate<Transform>(environment.RootObject(), "PointLight", Vector3(0.0f, 0.25f, 0.0f));
+			Object::Instantiate<PointLight>(transform, "Light", Vector3(1.0f, 1.0f, 1.0f), 4.0f)->CastShadows(true);
+		}
+		const std::vector<Transform*> pillars = CreateShadowTestScene(environment, CreateWhiteMaterial(environment));
+
+		// Waits till the rendered view count stays the same for a while:
+		auto settledViewCount = [&]() -> size_t {
+			Stopwatch timeout;
+			size_t count = atlas->RenderedViewCount();
+			Stopwatch stableFor;
+			while (timeout.Elapsed() < 10.0f && stableFor.Elapsed() < 1.0f) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(16));
+				const size_t newCount = atlas->RenderedViewCount();
+				if (newCount == count) continue;
+				count = newCount;
+				stableFor.Reset();
+			}
+			return count;
+		};
+
+		const size_t initialCount = settledViewCount();
+		EXPECT_GE(initialCount, 6u);
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+		EXPECT_EQ(atlas->RenderedViewCount(), initialCount);
+
+		// Moving a pillar re-renders only the faces, the pillar batch overlaps with (each one just once):
+		pillars[0]->SetLocalPosition(pillars[0]->LocalPosition() + Vector3(0.0f, 0.1f, 0.0f));
+		const size_t movedCount = settledViewCount();
+		EXPECT_GT(movedCount, initialCount);
+		EXPECT_LE(movedCount - initialCount, 6u);
+	}
+
+
+
+
+	// Renders a floor of boxes, lit by a large number of small moving lights, through the per-object light lists (each instance considers only it's most influential lights)
+	// (also selects the lights for the tile bounds and makes sure, the lists contain only the lights, that reach the tiles, and miss none of them, unless full)
+	TEST(MeshRendererTest, PerObjectLightLists) {
+		Environment environment("Per-Object Light Lists (Each instance iterates only over it's most influential lights)");
+		SceneContext* context = environment.RootObject()->Context();
+		Reference<TestRenderer> renderer = Object::Instantiate<TestRenderer>(context);
+		environment.RenderEngine()->AddRenderer(renderer);
+
+		static const size_t LIGHT_COUNT = 512;
+		CreateSwirlingLights(environment, LIGHT_COUNT, 0.25f, 0.5f);
+		const std::vector<AABB> tiles = CreateTileFloor(environment, CreateWhiteMaterial(environment, TestLightingModel::PER_OBJECT_FORWARD), 32, true);
+
+		const Reference<SceneLightInfo> lightInfo = SceneLightInfo::Instance(context->Graphics());
+		const Reference<ObjectLightSelector> selector = ObjectLightSelector::Instance(context->Graphics());
+		ASSERT_TRUE(WaitForLightCount(lightInfo, LIGHT_COUNT));
+
+		struct Snapshot {
+			std::vector<AABB> bounds;
+			std::vector<float> intensities;
+
+			inline void Store(const AABB* boundList, const float* intensityList, size_t count) {
+				bounds.assign(boundList, boundList + count);
+				intensities.assign(intensityList, intensityList + count);
+			}
+		} snapshot;
+		std::vector<ObjectLightSelector::LightList> lists(tiles.size());
+		{
+			// Lights can not move while we hold the lock, so the bounds are the same, the selector used:
+			GraphicsContext::ReadLock lock(context->Graphics());
+			selector->SelectLights(tiles.data(), tiles.size(), lists.data());
+			lightInfo->ProcessLightBounds(Callback<const AABB*, const float*, size_t>(&Snapshot::Store, &snapshot));
+		}
+
+		// Bounding sphere of a light and it's distance from a tile (same as the ones, ObjectLightSelector uses):
+		auto lightRadius = [&](uint32_t lightId) {
+			const Vector3 extents = (snapshot.bounds[lightId].end - snapshot.bounds[lightId].start) * 0.5f;
+			return std::max(extents.x, std::max(extents.y, extents.z));
+		};
+		auto lightDistance = [&](uint32_t lightId, const AABB& tile) {
+			return Math::Distance((snapshot.bounds[lightId].start + snapshot.bounds[lightId].end) * 0.5f, tile);
+		};
+
+		size_t litTileCount = 0;
+		for (size_t i = 0; i < tiles.size(); i++) {
+			const ObjectLightSelector::LightList& list = lists[i];
+			size_t listSize = 0;
+			while (listSize < ObjectLightSelector::MAX_LIGHTS_PER_OBJECT && list.lightIds[listSize] != ObjectLightSelector::NO_LIGHT) listSize++;
+			if (listSize > 0) litTileCount++;
+
+			// Listed lights are distinct, exist and reach the tile:
+			for (size_t j = 0; j < listSize; j++) {
+				const uint32_t lightId = list.lightIds[j];
+				ASSERT_LT(lightId, snapshot.bounds.size());
+				EXPECT_GT(snapshot.intensities[lightId], 0.0f);
+				EXPECT_LT(lightDistance(lightId, tiles[i]), lightRadius(lightId));
+				for (size_t k = 0; k < j; k++)
+					EXPECT_NE(list.lightIds[k], lightId);
+			}
+			for (size_t j = listSize; j < ObjectLightSelector::MAX_LIGHTS_PER_OBJECT; j++)
+				EXPECT_EQ(list.lightIds[j], ObjectLightSelector::NO_LIGHT);
+
+			// Lists with free entries include every light, that clearly reaches the tile (lights, touching the tile boundary, may go either way):
+			if (listSize >= ObjectLightSelector::MAX_LIGHTS_PER_OBJECT) continue;
+			for (uint32_t lightId = 0; lightId < snapshot.bounds.size(); lightId++) {
+				if (Math::IsEmpty(snapshot.bounds[lightId]) || snapshot.intensities[lightId] <= 0.0f) continue;
+				if (lightDistance(lightId, tiles[i]) >= (lightRadius(lightId) * 0.99f)) continue;
+				EXPECT_NE(std::find(list.lightIds, list.lightIds + listSize, lightId), list.lightIds + listSize);
+			}
+		}
+		EXPECT_GT(litTileCount, 0u);
+	}
+
+	// Checks, that ObjectLightSelector ranks the lights by intensity and falloff and leaves out the ones, that can not reach the objects
+	TEST(MeshRendererTest, PerObjectLightSelection) {
+		Environment environment;
+		SceneContext* context = environment.RootObject()->Context();
+		const Reference<ObjectLightSelector> selector = ObjectLightSelector::Instance(context->Graphics());
+		const Reference<SceneLightInfo> lightInfo = SceneLightInfo::Instance(context->Graphics());
+
+		// Lights are added one by one, so that their slots are the same as the order of creation:
+		auto waitForLightCount = [&](size_t count) {
+			Stopwatch timeout;
+			while (lightInfo->LightCount() < count && timeout.Elapsed() < 5.0f)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			EXPECT_EQ(lightInfo->LightCount(), count);
+		};
+		auto addPointLight = [&](const Vector3& position, float intensity, float radius) {
+			Transform* transform = Object::Instantiate<Transform>(environment.RootObject(), "PointLight", position);
+			Object::Instantiate<PointLight>(transform, "Light", Vector3(intensity), radius);
+			waitForLightCount(lightInfo->LightCount() + 1);
+		};
+		addPointLight(Vector3(0.0f, 0.0f, 0.5f), 1.0f, 2.0f);		// 0: Touches the first box with full intensity (score 1)
+		addPointLight(Vector3(0.0f, 3.0f, 0.0f), 4.0f, 4.0f);		// 1: Bright, but far (score 4 * (1 - 2.5 / 4)^2 = 0.5625)
+		addPointLight(Vector3(10.0f, 0.0f, 0.0f), 1.0f, 1.0f);		// 2: Reaches only the second box
+		addPointLight(Vector3(1.5f, 0.0f, 0.0f), 0.05f, 2.0f);		// 3: Dim (score 0.05 * (1 - 1 / 2)^2 = 0.0125)
+		{
+			Object::Instantiate<DirectionalLight>(Object::Instantiate<Transform>(environment.RootObject(), "DirectionalLight"), "Light", Vector3(0.1f));
+			waitForLightCount(5);	// 4: Reaches everything with no falloff (score 0.1)
+		}
+
+		const AABB bounds[] = {
+			AABB{ Vector3(-0.5f, -0.5f, -0.5f), Vector3(0.5f, 0.5f, 0.5f) },
+			AABB{ Vector3(9.5f, -0.5f, -0.5f), Vector3(10.5f, 0.5f, 0.5f) }
+		};
+		ObjectLightSelector::LightList lists[2];
+		{
+			GraphicsContext::ReadLock lock(context->Graphics());
+			selector->SelectLights(bounds, 2, lists);
+		}
+		EXPECT_EQ(lists[0].lightIds[0], 0u);
+		EXPECT_EQ(lists[0].lightIds[1], 1u);
+		EXPECT_EQ(lists[0].lightIds[2], 4u);
+		EXPECT_EQ(lists[0].lightIds[3], 3u);
+		EXPECT_EQ(lists[1].lightIds[0], 2u);
+		EXPECT_EQ(lists[1].lightIds[1], 4u);
+		EXPECT_EQ(lists[1].lightIds[2], ObjectLightSelector::NO_LIGHT);
+		EXPECT_EQ(lists[1].lightIds[3], ObjectLightSelector::NO_LIGHT);
+
+		// A fifth influential light pushes the weakest one out of the list:
+		addPointLight(Vector3(0.0f, -0.5f, 0.0f), 0.5f, 1.0f);
+		{
+			GraphicsContext::ReadLock lock(context->Graphics());
+			selector->SelectLights(bounds, 1, lists);
+		}
+		EXPECT_EQ(lists[0].lightIds[0], 0u);
+		EXPECT_EQ(lists[0].lightIds[1], 1u);
+		EXPECT_EQ(lists[0].lightIds[2], 5u);
+		EXPECT_EQ(lists[0].lightIds[3], 4u);
+	}
+
+	// Checks, that SceneLightInfo groups the light slots by type and keeps the groups up to date as the lights come and go
+	TEST(MeshRendererTest, LightTypeGroups) {
+		Environment environment;
+		SceneContext* context = environment.RootObject()->Context();
+		const Reference<SceneLightInfo> lightInfo = SceneLightInfo::Instance(context->Graphics());
+
+		uint32_t pointLightType, directionalLightType;
+		ASSERT_TRUE(context->Graphics()->GetLightTypeId("Jimara_PointLight", pointLightType));
+		ASSERT_TRUE(context->Graphics()->GetLightTypeId("Jimara_DirectionalLight", directionalLightType));
+
+		struct Groups {
+			std::vector<SceneLightInfo::LightTypeRange> ranges;
+			std::vector<uint32_t> slots;
+
+			inline void Store(const SceneLightInfo::LightTypeRange* typeRanges, size_t rangeCount, const uint32_t* groupedSlots, size_t slotCount) {
+				ranges.assign(typeRanges, typeRanges + rangeCount);
+				slots.assign(groupedSlots, groupedSlots + slotCount);
+			}
+
+			inline SceneLightInfo::LightTypeRange Range(uint32_t typeId)const {
+				return (typeId < ranges.size()) ? ranges[typeId] : SceneLightInfo::LightTypeRange{ 0u, 0u };
+			}
+		};
+		auto getGroups = [&]() {
+			Groups groups;
+			lightInfo->ProcessLightTypeGroups(Callback<const SceneLightInfo::LightTypeRange*, size_t, const uint32_t*, size_t>(&Groups::Store, &groups));
+			EXPECT_LE(groups.ranges.size(), LightRegistry::JIMARA_TEST_LIGHT_IDENTIFIERS.lightTypeCount);
+			return groups;
+		};
+
+		// Lights are added one by one, so that their slots are the same as the order of creation:
+		auto waitForLightCount = [&](size_t count) {
+			Stopwatch timeout;
+			while (lightInfo->LightCount() != count && timeout.Elapsed() < 5.0f)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			EXPECT_EQ(lightInfo->LightCount(), count);
+		};
+		auto addPointLight = [&]() {
+			PointLight* light = Object::Instantiate<PointLight>(Object::Instantiate<Transform>(environment.RootObject(), "PointLight"), "Light");
+			waitForLightCount(lightInfo->LightCount() + 1);
+			return light;
+		};
+		addPointLight();
+		PointLight* removedLight = addPointLight();
+		{
+			Object::Instantiate<DirectionalLight>(Object::Instantiate<Transform>(environment.RootObject(), "DirectionalLight"), "Light");
+			waitForLightCount(3);
+		}
+		addPointLight();
+
+		{
+			const Groups groups = getGroups();
+			EXPECT_EQ(groups.Range(pointLightType).count, 3u);
+			EXPECT_EQ(groups.Range(directionalLightType).count, 1u);
+			ASSERT_EQ(groups.slots.size(), 4u);
+			const SceneLightInfo::LightTypeRange points = groups.Range(pointLightType);
+			EXPECT_EQ(groups.slots[points.start], 0u);
+			EXPECT_EQ(groups.slots[points.start + 1], 1u);
+			EXPECT_EQ(groups.slots[points.start + 2], 3u);
+			EXPECT_EQ(groups.slots[groups.Range(directionalLightType).start], 2u);
+		}
+
+		// Removed light leaves the group, while the rest of the lights keep their slots:
+		const uint64_t revision = lightInfo->LightTypeGroupRevision();
+		removedLight->GetTransfrom()->Destroy();
+		waitForLightCount(3);
+		EXPECT_NE(lightInfo->LightTypeGroupRevision(), revision);
+		{
+			const Groups groups = getGroups();
+			ASSERT_EQ(groups.slots.size(), 3u);
+			const SceneLightInfo::LightTypeRange points = groups.Range(pointLightType);
+			EXPECT_EQ(points.count, 2u);
+			EXPECT_EQ(groups.slots[points.start], 0u);
+			EXPECT_EQ(groups.slots[points.start + 1], 3u);
+			EXPECT_EQ(groups.Range(directionalLightType).count, 1u);
+			EXPECT_EQ(groups.slots[groups.Range(directionalLightType).start], 2u);
+		}
+	}
+
+	// Renders the shadow test scene, lit by a bunch of moving point lights, through the deferred path (G-buffer pass, followed by a full-screen lighting pass)
+	TEST(MeshRendererTest, DeferredShading) {
+		Environment environment("Deferred Shading (Lights are evaluated once per pixel from the G-buffer)");
+		Reference<TestRenderer> renderer = Object::Instantiate<TestRenderer>(environment.RootObject()->Context(), false, true);
+		environment.RenderEngine()->AddRenderer(renderer);
+
+		{
+			Transform* transform = Object::Instantiate<Transform>(environment.RootObject(), "DirectionalLight");
+			transform->LookTowards(Vector3(-1.0f, -2.0f, -0.5f));
+			Object::Instantiate<DirectionalLight>(transform, "Light", Vector3(0.25f, 0.25f, 0.25f))->CastShadows(true);
+		}
+
+		CreateSwirlingLights(environment, 64, 0.5f, 1.0f, std::mt19937::default_seed, -0.4f, 0.5f);
+
+		CreateShadowTestScene(environment, CreateWhiteMaterial(environment, TestLightingModel::DEFERRED));
+	}
+
+	namespace {
+		// Creates nested boxes around the origin (with back faces culled, the front faces of every box cover the same pixels, so each visible pixel gets drawn once per box)
+		inline static void CreateOverdrawTestScene(Environment& environment, Material* material, size_t layerCount) {
+			Reference<TriMesh> cubeMesh = TriMesh::Box(Vector3(-0.5f, -0.5f, -0.5f), Vector3(0.5f, 0.5f, 0.5f));
+			for (size_t i = 0; i < layerCount; i++) {
+				Transform* transform = Object::Instantiate<Transform>(environment.RootObject(), "Layer", Vector3(0.0f, 0.25f, 0.0f));
+				transform->SetLocalScale(Vector3(1.5f * static_cast<float>(i + 1) / static_cast<float>(layerCount)));
+				Object::Instantiate<MeshRenderer>(transform, "Layer_Renderer", cubeMesh, material)->MarkStatic(true);
+			}
+		}
+	}
+
+	// Renders nested boxes, lit by a bunch of moving point lights, with the depth prepass (only the outermost box should ever get shaded)
+	TEST(MeshRendererTest, DepthPrepass) {
+		Environment environment("Depth Prepass (Color pass shades only the fragments, that have survived the depth-only pass)");
+		Reference<TestRenderer> renderer = Object::Instantiate<TestRenderer>(environment.RootObject()->Context(), false, false, true);
+		environment.RenderEngine()->AddRenderer(renderer);
+
+		CreateSwirlingLights(environment, 64, 0.5f, 1.0f, std::mt19937::default_seed, -0.4f, 1.0f);
+
+		CreateOverdrawTestScene(environment, CreateWhiteMaterial(environment), 16);
+	}
+
+
+
+
+	namespace {
+		// Render engine info for offscreen rendering (single target image, no surface)
+		class HeadlessEngineInfo : public virtual Graphics::RenderEngineInfo {
+		private:
+			const Reference<Graphics::GraphicsDevice> m_device;
+			const Reference<Graphics::Texture> m_image;
+
+		public:
+			inline HeadlessEngineInfo(Graphics::GraphicsDevice* device, Size2 size)
+				: m_device(device)
+				, m_image(device->CreateMultisampledTexture(
+					Graphics::Texture::TextureType::TEXTURE_2D, Graphics::Texture::PixelFormat::R8G8B8A8_UNORM, Size3(size, 1), 1, Graphics::Texture::Multisampling::SAMPLE_COUNT_1)) {}
+
+			inline virtual Graphics::GraphicsDevice* Device()const override { return m_device; }
+			inline virtual Size2 ImageSize()const override { return Size2(m_image->Size()); }
+			inline virtual Graphics::Texture::PixelFormat ImageFormat()const override { return m_image->ImageFormat(); }
+			inline virtual size_t ImageCount()const override { return 1; }
+			inline virtual Graphics::Texture* Image(size_t)const override { return m_image; }
+		};
+	}
+
+	// Measures how the lighting cost scales with the number of moving point lights (1 to 100'000):
+	// CPU time of SceneLightInfo, LightDataBuffer and LightTypeIdBuffer updates and GPU frame time of the forward lighting model (through timestamp queries).
+	// Renders offscreen, so it can run headlessly (against a software Vulkan ICD, like lavapipe, by pointing VK_ICD_FILENAMES to it);
+	// disabled by default, run with: --gtest_also_run_disabled_tests --gtest_filter=MeshRendererTest.DISABLED_LightCountScaling
+	TEST(MeshRendererTest, DISABLED_LightCountScaling) {
+		static const size_t LIGHT_COUNTS[] = { 1, 100, 1000, 10000, 100000 };
+		static const size_t FRAME_COUNT = 8;
+		static const Size2 IMAGE_SIZE = Size2(64, 64);
+
+		std::stringstream report;
+		report << std::fixed << std::setprecision(3) << "MeshRendererTest::LightCountScaling - Average times per frame (milliseconds):" << std::endl
+			<< "    LIGHTS     | SceneLightInfo | LightDataBuffer | LightTypeIdBuffer | GPU frame" << std::endl;
+		Reference<OS::Logger> logger;
+
+		for (size_t countId = 0; countId < (sizeof(LIGHT_COUNTS) / sizeof(size_t)); countId++) {
+			const size_t lightCount = LIGHT_COUNTS[countId];
+			Environment environment;
+			SceneContext* context = environment.RootObject()->Context();
+			Graphics::GraphicsDevice* device = context->Graphics()->Device();
+			logger = context->Log();
+			const Reference<SceneLightInfo> lightInfo = SceneLightInfo::Instance(context->Graphics());
+			const Reference<LightDataBuffer> lightDataBuffer = LightDataBuffer::Instance(context->Graphics());
+			const Reference<LightTypeIdBuffer> lightTypeIdBuffer = LightTypeIdBuffer::Instance(context->Graphics());
+
+			// Floor and a procedurally generated light swarm above it (lights keep moving, so every light gets updated each frame):
+			{
+				const Reference<Material> material = CreateWhiteMaterial(environment);
+				Reference<TriMesh> cubeMesh = TriMesh::Box(Vector3(-0.5f, -0.5f, -0.5f), Vector3(0.5f, 0.5f, 0.5f));
+				Transform* floor = Object::Instantiate<Transform>(environment.RootObject(), "Floor", Vector3(0.0f, -0.55f, 0.0f));
+				floor->SetLocalScale(Vector3(4.0f, 0.1f, 4.0f));
+				Object::Instantiate<MeshRenderer>(floor, "Floor_Renderer", cubeMesh, material)->MarkStatic(true);
+
+				CreateSwirlingLights(environment, lightCount, 0.25f, 0.5f, static_cast<uint32_t>(lightCount));
+				Stopwatch timeout;
+				while (lightInfo->LightCount() < lightCount && timeout.Elapsed() < 60.0f)
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				EXPECT_EQ(lightInfo->LightCount(), lightCount);
+			}
+
+			const Reference<TestRenderer> renderer = Object::Instantiate<TestRenderer>(context);
+			const Reference<Graphics::RenderEngineInfo> engineInfo = Object::Instantiate<HeadlessEngineInfo>(device, IMAGE_SIZE);
+			const Reference<Object> engineData = renderer->CreateEngineData(engineInfo);
+			const Reference<Graphics::CommandPool> commandPool = device->GraphicsQueue()->CreateCommandPool();
+			const Reference<Graphics::PrimaryCommandBuffer> commandBuffer = commandPool->CreatePrimaryCommandBuffer();
+			const Reference<Graphics::TimestampQuery> timestamps = device->CreateTimestampQuery(2);
+
+			double sceneLightInfoTime = 0.0;
+			double lightDataBufferTime = 0.0;
+			double lightTypeIdBufferTime = 0.0;
+			double gpuTime = 0.0;
+			size_t gpuFrameCount = 0;
+			for (size_t frame = 0; frame < FRAME_COUNT; frame++) {
+				// Update durations are sampled once per frame, while the environment keeps synchronizing in the background:
+				std::this_thread::sleep_for(std::chrono::milliseconds(16));
+				sceneLightInfoTime += lightInfo->LastUpdateDuration();
+				lightDataBufferTime += lightDataBuffer->LastUpdateDuration();
+				lightTypeIdBufferTime += lightTypeIdBuffer->LastUpdateDuration();
+
+				commandBuffer->Reset();
+				commandBuffer->BeginRecording();
+				timestamps->Reset(commandBuffer);
+				timestamps->Write(commandBuffer, 0);
+				renderer->Render(engineData, Graphics::Pipeline::CommandBufferInfo(commandBuffer, 0));
+				timestamps->Write(commandBuffer, 1);
+				commandBuffer->EndRecording();
+				device->GraphicsQueue()->ExecuteCommandBuffer(commandBuffer);
+				commandBuffer->Wait();
+
+				double frameTimestamps[2];
+				if (timestamps->Read(0, 2, frameTimestamps)) {
+					gpuTime += (frameTimestamps[1] - frameTimestamps[0]);
+					gpuFrameCount++;
+				}
+			}
+
+			report << "    " << std::setw(10) << lightCount
+				<< " | " << std::setw(14) << (sceneLightInfoTime * 1000.0 / FRAME_COUNT)
+				<< " | " << std::setw(15) << (lightDataBufferTime * 1000.0 / FRAME_COUNT)
+				<< " | " << std::setw(17) << (lightTypeIdBufferTime * 1000.0 / FRAME_COUNT)
+				<< " | ";
+			if (gpuFrameCount > 0) report << (gpuTime * 1000.0 / gpuFrameCount) << std::endl;
+			else report << "N/A (timestamps not supported)" << std::endl;
+		}
+
+		if (logger != nullptr) logger->Info(report.str());
+	}
+
+	// Compares GPU frame times with and without the depth prepass on a high-overdraw scene (nested boxes, lit by a few hundred point lights);
+	// Renders offscreen, just like DISABLED_LightCountScaling; run with: --gtest_also_run_disabled_tests --gtest_filter=MeshRendererTest.DISABLED_DepthPrepassOverdraw
+	TEST(MeshRendererTest, DISABLED_DepthPrepassOverdraw) {
+		static const size_t LAYER_COUNTS[] = { 1, 4, 16, 64 };
+		static const size_t LIGHT_COUNT = 256;
+		static const size_t FRAME_COUNT = 16;
+		static const Size2 IMAGE_SIZE = Size2(512, 512);
+
+		std::stringstream report;
+		report << std::fixed << std::setprecision(3) << "MeshRendererTest::DepthPrepassOverdraw - Average GPU frame time (milliseconds):" << std::endl
+			<< "    LAYERS | NO PREPASS | DEPTH PREPASS" << std::endl;
+		Reference<OS::Logger> logger;
+
+		for (size_t layerId = 0; layerId < (sizeof(LAYER_COUNTS) / sizeof(size_t)); layerId++) {
+			const size_t layerCount = LAYER_COUNTS[layerId];
+			Environment environment;
+			SceneContext* context = environment.RootObject()->Context();
+			Graphics::GraphicsDevice* device = context->Graphics()->Device();
+			logger = context->Log();
+
+			{
+				CreateSwirlingLights(environment, LIGHT_COUNT, 0.25f, 1.0f, static_cast<uint32_t>(layerCount), -0.4f, 1.0f, false);
+				CreateOverdrawTestScene(environment, CreateWhiteMaterial(environment), layerCount);
+			}
+
+			// Same scene, rendered by two renderers (one with the prepass and one without), frames interleaved:
+			const Reference<Graphics::RenderEngineInfo> engineInfo = Object::Instantiate<HeadlessEngineInfo>(device, IMAGE_SIZE);
+			const Reference<TestRenderer> renderers[2] = {
+				Object::Instantiate<TestRenderer>(context, false, false, false),
+				Object::Instantiate<TestRenderer>(context, false, false, true)
+			};
+			const Reference<Object> engineData[2] = { renderers[0]->CreateEngineData(engineInfo), renderers[1]->CreateEngineData(engineInfo) };
+			const Reference<Graphics::CommandPool> commandPool = device->GraphicsQueue()->CreateCommandPool();
+			const Reference<Graphics::PrimaryCommandBuffer> commandBuffer = commandPool->CreatePrimaryCommandBuffer();
+			const Reference<Graphics::TimestampQuery> timestamps = device->CreateTimestampQuery(2);
+
+			// Pipelines are created asynchronously, so we give them some time to get ready:
+			std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+			double gpuTime[2] = { 0.0, 0.0 };
+			size_t gpuFrameCount[2] = { 0, 0 };
+			for (size_t frame = 0; frame < (FRAME_COUNT << 1); frame++) {
+				const size_t rendererId = (frame & 1);
+				commandBuffer->Reset();
+				commandBuffer->BeginRecording();
+				timestamps->Reset(commandBuffer);
+				timestamps->Write(commandBuffer, 0);
+				renderers[rendererId]->Render(engineData[rendererId], Graphics::Pipeline::CommandBufferInfo(commandBuffer, 0));
+				timestamps->Write(commandBuffer, 1);
+				commandBuffer->EndRecording();
+				device->GraphicsQueue()->ExecuteCommandBuffer(commandBuffer);
+				commandBuffer->Wait();
+
+				double frameTimestamps[2];
+				if (timestamps->Read(0, 2, frameTimestamps)) {
+					gpuTime[rendererId] += (frameTimestamps[1] - frameTimestamps[0]);
+					gpuFrameCount[rendererId]++;
+				}
+			}
+
+			report << "    " << std::setw(6) << layerCount << " | ";
+			if (gpuFrameCount[0] > 0 && gpuFrameCount[1] > 0)
+				report << std::setw(10) << (gpuTime[0] * 1000.0 / gpuFrameCount[0]) << " | " << (gpuTime[1] * 1000.0 / gpuFrameCount[1]) << std::endl;
+			else report << "N/A (timestamps not supported)" << std::endl;
+		}
+
+		if (logger != nullptr) logger->Info(report.str());
+	}
 }
@@ -0,0 +1,126 @@
+#pragma once
+#include "Graphics/Pipeline/GraphicsPipeline.h"
+
+namespace Jimara {
+	namespace Graphics {
+		namespace Test {
+			/// <summary>
+			/// Vertex/Instance buffer with a single FLOAT2 attribute
+			/// </summary>
+			class Float2Buffer : public virtual InstanceBuffer {
+			private:
+				// Underlying buffer
+				const ArrayBufferReference<Vector2> m_buffer;
+
+				// Shader location of the attribute
+				const uint32_t m_location;
+
+			public:
+				/// <summary>
+				/// Constructor
+				/// </summary>
+				/// <param name="device"> Graphics device </param>
+				/// <param name="count"> Number of elements </param>
+				/// <param name="location"> Shader location of the attribute </param>
+				inline Float2Buffer(GraphicsDevice* device, size_t count, uint32_t location)
+					: m_buffer(device->CreateArrayBuffer<Vector2>(count)), m_location(location) {}
+
+				/// <summary> Underlying buffer </summary>
+				inline virtual Reference<ArrayBuffer> Buffer() override { return m_buffer; }
+
+				/// <summary> Number of attributes (always 1) </summary>
+				inline virtual size_t AttributeCount()const override { return 1; }
+
+				/// <summary> FLOAT2 attribute at the location </summary>
+				inline virtual AttributeInfo Attribute(size_t)const override {
+					AttributeInfo info = {};
+					{
+						info.location = m_location;
+						info.offset = 0;
+						info.type = AttributeInfo::Type::FLOAT2;
+					}
+					return info;
+				}
+
+				/// <summary> sizeof(Vector2) </summary>
+				inline virtual size_t BufferElemSize()const override { return sizeof(Vector2); }
+			};
+
+			/// <summary>
+			/// Pipeline descriptor, compatible with TriangleRenderer shaders (optionally reports binding revision)
+			/// </summary>
+			class TriangleRendererPipelineDescriptor
+				: public virtual GraphicsPipeline::Descriptor
+				, public virtual PipelineDescriptor::BindingSetDescriptor {
+			private:
+				// Shader cache
+				const Reference<ShaderCache> m_shaderCache;
+
+				// Constant buffer
+				const Reference<Buffer> m_constantBuffer;
+
+				// Texture sampler
+				const Reference<TextureSampler> m_sampler;
+
+				// Vertex positions
+				const Reference<Float2Buffer> m_vertexBuffer;
+
+				// Instance offsets
+				const Reference<Float2Buffer> m_instanceBuffer;
+
+				// If true, Revision() will report the bindings as static
+				const bool m_trackRevision;
+
+			public:
+				/// <summary>
+				/// Constructor
+				/// </summary>
+				/// <param name="device"> Graphics device </param>
+				/// <param name="shaderCache"> Shader cache (if nullptr, a new one will be created) </param>
+				/// <param name="sampler"> Texture sampler (if nullptr, a new one will be created) </param>
+				/// <param name="trackRevision"> If true, Revision() will report the bindings as static </param>
+				inline TriangleRendererPipelineDescriptor(GraphicsDevice* device, ShaderCache* shaderCache = nullptr, TextureSampler* sampler = nullptr, bool trackRevision = false)
+					: m_shaderCache(shaderCache != nullptr ? Reference<ShaderCache>(shaderCache) : device->CreateShaderCache())
+					, m_constantBuffer(device->CreateConstantBuffer<float>())
+					, m_sampler(sampler != nullptr ? Reference<TextureSampler>(sampler) :
+						device->CreateTexture(Texture::TextureType::TEXTURE_2D, Texture::PixelFormat::R8G8B8A8_UNORM, Size3(4, 4, 1), 1, false)
+						->CreateView(TextureView::ViewType::VIEW_2D)->CreateSampler())
+					, m_vertexBuffer(Object::Instantiate<Float2Buffer>(device, 3, 0))
+					, m_instanceBuffer(Object::Instantiate<Float2Buffer>(device, 1, 1))
+					, m_trackRevision(trackRevision) {}
+
+				inline virtual size_t BindingSetCount()const override { return 1; }
+				inline virtual const PipelineDescriptor::BindingSetDescriptor* BindingSet(size_t)const override { return this; }
+
+				inline virtual bool SetByEnvironment()const override { return false; }
+
+				inline virtual size_t ConstantBufferCount()const override { return 1; }
+				inline virtual BindingInfo ConstantBufferInfo(size_t)const override { return { StageMask(PipelineStage::VERTEX), 1 }; }
+				inline virtual Reference<Buffer> ConstantBuffer(size_t)const override { return m_constantBuffer; }
+
+				inline virtual size_t StructuredBufferCount()const override { return 0; }
+				inline virtual BindingInfo StructuredBufferInfo(size_t)const override { return BindingInfo(); }
+				inline virtual Reference<ArrayBuffer> StructuredBuffer(size_t)const override { return nullptr; }
+
+				inline virtual size_t TextureSamplerCount()const override { return 1; }
+				inline virtual BindingInfo TextureSamplerInfo(size_t)const override { return { StageMask(PipelineStage::FRAGMENT), 0 }; }
+				inline virtual Reference<TextureSampler> Sampler(size_t)const override { return m_sampler; }
+
+				inline virtual size_t Revision()const override { return m_trackRevision ? 1 : 0; }
+
+				inline virtual Reference<Shader> VertexShader() override { return m_shaderCache->GetShader("Shaders/TriangleRenderer.vert.spv", false); }
+				inline virtual Reference<Shader> FragmentShader() override { return m_shaderCache->GetShader("Shaders/TriangleRenderer.frag.spv", false); }
+
+				inline virtual size_t VertexBufferCount() override { return 1; }
+				inline virtual Reference<Graphics::VertexBuffer> VertexBuffer(size_t) override { return m_vertexBuffer; }
+
+				inline virtual size_t InstanceBufferCount() override { return 1; }
+				inline virtual Reference<Graphics::InstanceBuffer> InstanceBuffer(size_t) override { return m_instanceBuffer; }
+
+				inline virtual ArrayBufferReference<uint32_t> IndexBuffer() override { return nullptr; }
+				inline virtual size_t IndexCount() override { return 3; }
+				inline virtual size_t InstanceCount() override { return 1; }
+			};
+		}
+	}
+}
@@ -0,0 +1,120 @@
+#include "../../GtestHeaders.h"
+#include "Graphics/GraphicsInstance.h"
+#include "Graphics/Vulkan/VulkanDevice.h"
+#include "Graphics/Vulkan/Pipeline/VulkanBindlessSet.h"
+#include "OS/Logging/StreamLogger.h"
+
+
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			namespace {
+				inline static Reference<TextureSampler> CreateSampler(GraphicsDevice* device) {
+					return device->CreateTexture(Texture::TextureType::TEXTURE_2D, Texture::PixelFormat::R8G8B8A8_UNORM, Size3(4, 4, 1), 1, false)
+						->CreateView(TextureView::ViewType::VIEW_2D)->CreateSampler();
+				}
+			}
+
+			// Checks index assignment and sharing within the bindless set
+			TEST(VulkanBindlessSetTest, BindingIndices) {
+				Reference<OS::Logger> logger = Object::Instantiate<OS::StreamLogger>();
+				Reference<Application::AppInformation> appInfo = Object::Instantiate<Application::AppInformation>("VulkanBindlessSetTest", Application::AppVersion(1, 0, 0));
+				Reference<GraphicsInstance> instance = GraphicsInstance::Create(logger, appInfo, GraphicsInstance::Backend::VULKAN);
+				ASSERT_NE(instance, nullptr);
+
+				for (size_t deviceId = 0; deviceId < instance->PhysicalDeviceCount(); deviceId++) {
+					PhysicalDevice* physicalDevice = instance->GetPhysicalDevice(deviceId);
+					if (!physicalDevice->HasFeature(PhysicalDevice::DeviceFeature::GRAPHICS)) continue;
+					Reference<GraphicsDevice> device = physicalDevice->CreateLogicalDevice();
+					ASSERT_NE(device, nullptr);
+
+					BindlessSet* bindless = device->BindlessResources();
+					if (!physicalDevice->HasFeature(PhysicalDevice::DeviceFeature::BINDLESS_DESCRIPTORS)) {
+						EXPECT_EQ(bindless, nullptr);
+						logger->Warning(std::string("VulkanBindlessSetTest - Bindless descriptors not supported by ") + physicalDevice->Name());
+						continue;
+					}
+					ASSERT_NE(bindless, nullptr);
+
+					EXPECT_EQ(bindless->GetBinding((TextureSampler*)nullptr), nullptr);
+					EXPECT_EQ(bindless->GetBinding((ArrayBuffer*)nullptr), nullptr);
+
+					const Reference<TextureSampler> samplerA = CreateSampler(device);
+					const Reference<TextureSampler> samplerB = CreateSampler(device);
+					const Reference<ArrayBuffer> buffer = device->CreateArrayBuffer<float>(4);
+
+					Reference<BindlessSet::Binding> bindingA = bindless->GetBinding(samplerA);
+					ASSERT_NE(bindingA, nullptr);
+					EXPECT_EQ(bindingA, bindless->GetBinding(samplerA));
+
+					Reference<BindlessSet::Binding> bindingB = bindless->GetBinding(samplerB);
+					ASSERT_NE(bindingB, nullptr);
+					EXPECT_NE(bindingA->Index(), bindingB->Index());
+
+					Reference<BindlessSet::Binding> bufferBinding = bindless->GetBinding(buffer);
+					ASSERT_NE(bufferBinding, nullptr);
+					EXPECT_NE(bufferBinding, bindingA);
+
+					// Released slots are not reused while there are fresh ones:
+					const uint32_t releasedIndex = bindingA->Index();
+					bindingA = nullptr;
+					const Reference<TextureSampler> samplerC = CreateSampler(device);
+					Reference<BindlessSet::Binding> bindingC = bindless->GetBinding(samplerC);
+					ASSERT_NE(bindingC, nullptr);
+					EXPECT_NE(bindingC->Index(), releasedIndex);
+					EXPECT_NE(bindingC->Index(), bindingB->Index());
+				}
+			}
+
+			// Makes sure released slots are not recycled while command buffers, that may still read them, are pending
+			TEST(VulkanBindlessSetTest, DeferredSlotRecycling) {
+				Reference<OS::Logger> logger = Object::Instantiate<OS::StreamLogger>();
+				Reference<Application::AppInformation> appInfo = Object::Instantiate<Application::AppInformation>("VulkanBindlessSetTest", Application::AppVersion(1, 0, 0));
+				Reference<GraphicsInstance> instance = GraphicsInstance::Create(logger, appInfo, GraphicsInstance::Backend::VULKAN);
+				ASSERT_NE(instance, nullptr);
+
+				for (size_t deviceId = 0; deviceId < instance->PhysicalDeviceCount(); deviceId++) {
+					PhysicalDevice* physicalDevice = instance->GetPhysicalDevice(deviceId);
+					if (!physicalDevice->HasFeature(PhysicalDevice::DeviceFeature::GRAPHICS)) continue;
+					if (!physicalDevice->HasFeature(PhysicalDevice::DeviceFeature::BINDLESS_DESCRIPTORS)) continue;
+					Reference<GraphicsDevice> device = physicalDevice->CreateLogicalDevice();
+					ASSERT_NE(device, nullptr);
+					VulkanDevice* vulkanDevice = dynamic_cast<VulkanDevice*>(device.operator->());
+					ASSERT_NE(vulkanDevice, nullptr);
+
+					const Reference<VulkanBindlessSet> bindless = Object::Instantiate<VulkanBindlessSet>(*vulkanDevice, 2, 2, 2);
+					EXPECT_NE(bindless->DescriptorSet(0), bindless->DescriptorSet(1));
+
+					const Reference<TextureSampler> samplerA = CreateSampler(device);
+					const Reference<TextureSampler> samplerB = CreateSampler(device);
+					const Reference<TextureSampler> samplerC = CreateSampler(device);
+					Reference<BindlessSet::Binding> bindingA = bindless->GetBinding(samplerA);
+					Reference<BindlessSet::Binding> bindingB = bindless->GetBinding(samplerB);
+					ASSERT_NE(bindingA, nullptr);
+					ASSERT_NE(bindingB, nullptr);
+
+					// Command buffer, recorded while the slot was still in use:
+					Reference<CommandPool> commandPool = device->GraphicsQueue()->CreateCommandPool();
+					ASSERT_NE(commandPool, nullptr);
+					Reference<PrimaryCommandBuffer> commandBuffer = commandPool->CreatePrimaryCommandBuffer();
+					VulkanPrimaryCommandBuffer* vulkanBuffer = dynamic_cast<VulkanPrimaryCommandBuffer*>(commandBuffer.operator->());
+					ASSERT_NE(vulkanBuffer, nullptr);
+					vulkanBuffer->BeginRecording();
+					bindless->Update(vulkanBuffer, 0);
+					vulkanBuffer->EndRecording();
+
+					// Released slot stays retired while the command buffer is alive:
+					const uint32_t releasedIndex = bindingA->Index();
+					bindingA = nullptr;
+					EXPECT_EQ(bindless->GetBinding(samplerC), nullptr);
+
+					// ...and becomes available once the command buffer gets reset:
+					vulkanBuffer->Reset();
+					Reference<BindlessSet::Binding> bindingC = bindless->GetBinding(samplerC);
+					ASSERT_NE(bindingC, nullptr);
+					EXPECT_EQ(bindingC->Index(), releasedIndex);
+				}
+			}
+		}
+	}
+}
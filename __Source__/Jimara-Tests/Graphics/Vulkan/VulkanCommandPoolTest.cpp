@@ -0,0 +1,59 @@
+#include "../../GtestHeaders.h"
+#include "Graphics/GraphicsInstance.h"
+#include "Graphics/Vulkan/Pipeline/VulkanCommandPool.h"
+#include "OS/Logging/StreamLogger.h"
+
+
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			// Submits a bunch of single-time command buffers asynchronously and waits for them through the completion tokens
+			TEST(VulkanCommandPoolTest, AsynchronousSubmission) {
+				Reference<OS::Logger> logger = Object::Instantiate<OS::StreamLogger>();
+				Reference<Application::AppInformation> appInfo = Object::Instantiate<Application::AppInformation>("VulkanCommandPoolTest", Application::AppVersion(1, 0, 0));
+				Reference<GraphicsInstance> instance = GraphicsInstance::Create(logger, appInfo, GraphicsInstance::Backend::VULKAN);
+				ASSERT_NE(instance, nullptr);
+
+				static const size_t SUBMISSION_COUNT = 64;
+
+				for (size_t deviceId = 0; deviceId < instance->PhysicalDeviceCount(); deviceId++) {
+					PhysicalDevice* physicalDevice = instance->GetPhysicalDevice(deviceId);
+					if (!physicalDevice->HasFeature(PhysicalDevice::DeviceFeature::GRAPHICS)) continue;
+					Reference<VulkanDevice> device = physicalDevice->CreateLogicalDevice();
+					ASSERT_NE(device, nullptr);
+					Reference<VulkanCommandPool> commandPool = device->GraphicsQueue()->CreateCommandPool();
+					ASSERT_NE(commandPool, nullptr);
+					ASSERT_NE(commandPool->SubmissionTimeline(), nullptr);
+					EXPECT_TRUE(commandPool->SubmissionComplete(0));
+
+					std::vector<uint64_t> tokens;
+					size_t recordedCount = 0;
+					for (size_t i = 0; i < SUBMISSION_COUNT; i++) {
+						tokens.push_back(commandPool->SubmitAsynchronousCommandBuffer([&](VkCommandBuffer buffer) {
+							VkMemoryBarrier barrier = {};
+							barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+							barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+							barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+							vkCmdPipelineBarrier(buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+							recordedCount++;
+							}));
+						ASSERT_GT(tokens.back(), 0u);
+						if (i > 0) EXPECT_GT(tokens[i], tokens[i - 1]);
+					}
+					EXPECT_EQ(recordedCount, SUBMISSION_COUNT);
+
+					// Later submissions signal after the earlier ones:
+					commandPool->WaitForSubmission(tokens.back());
+					for (size_t i = 0; i < tokens.size(); i++)
+						EXPECT_TRUE(commandPool->SubmissionComplete(tokens[i]));
+
+					// Blocking call only waits for its own submission:
+					bool recorded = false;
+					commandPool->SubmitSingleTimeCommandBuffer([&](VkCommandBuffer) { recorded = true; });
+					EXPECT_TRUE(recorded);
+					EXPECT_GT(commandPool->SubmissionTimeline()->Count(), tokens.back());
+				}
+			}
+		}
+	}
+}
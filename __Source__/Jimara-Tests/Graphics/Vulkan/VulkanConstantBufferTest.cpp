@@ -0,0 +1,143 @@
+#include "../../GtestHeaders.h"
+#include "Graphics/GraphicsInstance.h"
+#include "Graphics/Vulkan/Memory/Buffers/VulkanConstantBuffer.h"
+#include "OS/Logging/StreamLogger.h"
+
+
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			// Allocates and frees a bunch of heap slices, checking alignment, overlaps and chunk reuse
+			TEST(VulkanConstantBufferTest, HeapSlices) {
+				Reference<OS::Logger> logger = Object::Instantiate<OS::StreamLogger>();
+				Reference<Application::AppInformation> appInfo = Object::Instantiate<Application::AppInformation>("VulkanConstantBufferTest", Application::AppVersion(1, 0, 0));
+				Reference<GraphicsInstance> instance = GraphicsInstance::Create(logger, appInfo, GraphicsInstance::Backend::VULKAN);
+				ASSERT_NE(instance, nullptr);
+
+				static const size_t SLICE_COUNT = 1024;
+				static const VkDeviceSize CHUNK_SIZE = (static_cast<VkDeviceSize>(1) << 16);
+
+				for (size_t deviceId = 0; deviceId < instance->PhysicalDeviceCount(); deviceId++) {
+					PhysicalDevice* physicalDevice = instance->GetPhysicalDevice(deviceId);
+					if (!physicalDevice->HasFeature(PhysicalDevice::DeviceFeature::GRAPHICS)) continue;
+					Reference<VulkanDevice> device = physicalDevice->CreateLogicalDevice();
+					ASSERT_NE(device, nullptr);
+					EXPECT_EQ(VulkanConstantBufferHeap::Instance(device), VulkanConstantBufferHeap::Instance(device));
+
+					Reference<VulkanConstantBufferHeap> heap = Object::Instantiate<VulkanConstantBufferHeap>(device, CHUNK_SIZE);
+					const VkDeviceSize alignment = heap->OffsetAlignment();
+					EXPECT_EQ(alignment % device->PhysicalDeviceInfo()->DeviceProperties().limits.minUniformBufferOffsetAlignment, 0u);
+					EXPECT_EQ(heap->ChunkCount(), 0u);
+					EXPECT_EQ(heap->Allocate(0), nullptr);
+
+					std::vector<Reference<VulkanConstantBufferHeap::Slice>> slices;
+					for (size_t i = 0; i < SLICE_COUNT; i++) {
+						const VkDeviceSize size = static_cast<VkDeviceSize>(16 + (i % 7) * 48);
+						Reference<VulkanConstantBufferHeap::Slice> slice = heap->Allocate(size);
+						ASSERT_NE(slice, nullptr);
+						EXPECT_GE(slice->Size(), size);
+						EXPECT_EQ(slice->Offset() % alignment, 0u);
+						EXPECT_LE(slice->Offset() + slice->Size(), slice->Buffer()->ObjectSize());
+						memset(slice->Data(), static_cast<int>(i & 255), static_cast<size_t>(size));
+						slices.push_back(slice);
+					}
+					const size_t chunkCount = heap->ChunkCount();
+					EXPECT_GT(chunkCount, 1u);
+
+					// No two slices within the same chunk should overlap (each one still has it's own content):
+					size_t corruptedCount = 0;
+					for (size_t i = 0; i < slices.size(); i++) {
+						const VkDeviceSize size = static_cast<VkDeviceSize>(16 + (i % 7) * 48);
+						for (VkDeviceSize j = 0; j < size; j++)
+							if (slices[i]->Data()[j] != static_cast<uint8_t>(i & 255)) corruptedCount++;
+					}
+					EXPECT_EQ(corruptedCount, 0u);
+
+					// Slices larger than the chunk size get a chunk of their own:
+					{
+						Reference<VulkanConstantBufferHeap::Slice> largeSlice = heap->Allocate(CHUNK_SIZE * 2);
+						ASSERT_NE(largeSlice, nullptr);
+						EXPECT_GE(largeSlice->Buffer()->ObjectSize(), CHUNK_SIZE * 2);
+						EXPECT_EQ(heap->ChunkCount(), chunkCount + 1);
+					}
+					EXPECT_EQ(heap->ChunkCount(), chunkCount);
+
+					// Empty chunks are released, except for the last one:
+					slices.clear();
+					EXPECT_EQ(heap->ChunkCount(), 1u);
+				}
+			}
+
+			// Makes sure pipeline constant buffer copies share the heap and keep stable per-command buffer offsets
+			TEST(VulkanConstantBufferTest, PipelineConstantBuffers) {
+				Reference<OS::Logger> logger = Object::Instantiate<OS::StreamLogger>();
+				Reference<Application::AppInformation> appInfo = Object::Instantiate<Application::AppInformation>("VulkanConstantBufferTest", Application::AppVersion(1, 0, 0));
+				Reference<GraphicsInstance> instance = GraphicsInstance::Create(logger, appInfo, GraphicsInstance::Backend::VULKAN);
+				ASSERT_NE(instance, nullptr);
+
+				static const size_t COMMAND_BUFFER_COUNT = 3;
+				static const size_t PIPELINE_COUNT = 16;
+
+				for (size_t deviceId = 0; deviceId < instance->PhysicalDeviceCount(); deviceId++) {
+					PhysicalDevice* physicalDevice = instance->GetPhysicalDevice(deviceId);
+					if (!physicalDevice->HasFeature(PhysicalDevice::DeviceFeature::GRAPHICS)) continue;
+					Reference<VulkanDevice> device = physicalDevice->CreateLogicalDevice();
+					ASSERT_NE(device, nullptr);
+					const VkDeviceSize alignment = VulkanConstantBufferHeap::Instance(device)->OffsetAlignment();
+
+					Reference<Buffer> buffer = device->CreateConstantBuffer(sizeof(float) * 4);
+					Reference<VulkanConstantBuffer> constantBuffer = dynamic_cast<VulkanConstantBuffer*>(buffer.operator->());
+					ASSERT_NE(constantBuffer, nullptr);
+					{
+						float* data = static_cast<float*>(constantBuffer->Map());
+						ASSERT_NE(data, nullptr);
+						for (size_t i = 0; i < 4; i++) data[i] = static_cast<float>(i);
+						constantBuffer->Unmap(true);
+					}
+					{
+						// Map() exposes the current content:
+						const float* data = static_cast<const float*>(constantBuffer->Map());
+						for (size_t i = 0; i < 4; i++) EXPECT_EQ(data[i], static_cast<float>(i));
+						constantBuffer->Unmap(false);
+					}
+
+					std::vector<Reference<VulkanPipelineConstantBuffer>> pipelineBuffers;
+					for (size_t i = 0; i < PIPELINE_COUNT; i++)
+						pipelineBuffers.push_back(Object::Instantiate<VulkanPipelineConstantBuffer>(device, constantBuffer, COMMAND_BUFFER_COUNT));
+
+					std::vector<std::pair<VkBuffer, VkDeviceSize>> bindings;
+					for (size_t i = 0; i < pipelineBuffers.size(); i++) {
+						EXPECT_EQ(pipelineBuffers[i]->TargetBuffer(), constantBuffer);
+						for (size_t j = 0; j < COMMAND_BUFFER_COUNT; j++) {
+							std::pair<VkBuffer, VkDeviceSize> binding = pipelineBuffers[i]->GetBuffer(j);
+							EXPECT_NE(binding.first, VK_NULL_HANDLE);
+							EXPECT_EQ(binding.second % alignment, 0u);
+							bindings.push_back(binding);
+						}
+					}
+
+					// All the copies reside in a single heap buffer and never overlap:
+					for (size_t i = 0; i < bindings.size(); i++) {
+						EXPECT_EQ(bindings[i].first, bindings[0].first);
+						for (size_t j = 0; j < i; j++)
+							EXPECT_NE(bindings[i].second, bindings[j].second);
+					}
+
+					// Offsets stay the same after the content changes:
+					{
+						float* data = static_cast<float*>(constantBuffer->Map());
+						data[0] = 8.0f;
+						constantBuffer->Unmap(true);
+					}
+					for (size_t i = 0; i < pipelineBuffers.size(); i++)
+						for (size_t j = 0; j < COMMAND_BUFFER_COUNT; j++) {
+							const std::pair<VkBuffer, VkDeviceSize>& expected = bindings[i * COMMAND_BUFFER_COUNT + j];
+							std::pair<VkBuffer, VkDeviceSize> binding = pipelineBuffers[i]->GetBuffer(j);
+							EXPECT_EQ(binding.first, expected.first);
+							EXPECT_EQ(binding.second, expected.second);
+						}
+				}
+			}
+		}
+	}
+}
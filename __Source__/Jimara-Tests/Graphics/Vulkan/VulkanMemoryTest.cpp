@@ -0,0 +1,291 @@
+#include "../../GtestHeaders.h"
+#include "Graphics/GraphicsInstance.h"
+#include "Graphics/Vulkan/Memory/VulkanMemory.h"
+#include "OS/Logging/StreamLogger.h"
+#include <algorithm>
+#include <random>
+#include <sstream>
+
+
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			namespace {
+				// Requested size of a random resource (mostly small buffers, some medium-sized meshes and a few large textures)
+				inline static VkDeviceSize RandomResourceSize(std::mt19937& generator) {
+					const uint32_t kind = (generator() % 100);
+					if (kind < 70) return static_cast<VkDeviceSize>(64 + (generator() % (16 << 10)));
+					else if (kind < 95) return static_cast<VkDeviceSize>((16 << 10) + (generator() % (1 << 20)));
+					else return static_cast<VkDeviceSize>((1 << 20) + (generator() % (8 << 20)));
+				}
+
+				// Size, the old allocator would have reserved for a request (power of two block pools, starting from 16 bytes)
+				inline static VkDeviceSize PowerOfTwoReservation(VkDeviceSize size, VkDeviceSize alignment) {
+					VkDeviceSize blockSize = 16;
+					while (blockSize < size || blockSize < alignment) blockSize <<= 1;
+					return blockSize;
+				}
+			}
+
+			// Replays a random allocation trace against the power-of-two scheme and VulkanMemoryTLSF and compares the waste
+			TEST(VulkanMemoryTest, FragmentationBenchmark) {
+				Reference<OS::Logger> logger = Object::Instantiate<OS::StreamLogger>();
+
+				static const VkDeviceSize BLOCK_SIZE = VulkanMemoryPool::DEFAULT_BLOCK_SIZE;
+				static const VkDeviceSize ALIGNMENT = 256;
+				static const size_t OPERATION_COUNT = 200000;
+				static const size_t TARGET_LIVE_ALLOCATIONS = 2000;
+
+				struct LiveAllocation {
+					VkDeviceSize size;
+					VkDeviceSize powerOfTwoSize;
+					size_t block;
+					uint32_t handle;
+				};
+				std::vector<LiveAllocation> live;
+				std::vector<std::unique_ptr<VulkanMemoryTLSF>> blocks;
+
+				VkDeviceSize requestedBytes = 0;
+				VkDeviceSize powerOfTwoBytes = 0;
+				VkDeviceSize peakRequestedBytes = 0;
+				VkDeviceSize peakPowerOfTwoBytes = 0;
+
+				std::mt19937 generator(0);
+				for (size_t operation = 0; operation < OPERATION_COUNT; operation++) {
+					if (live.size() < TARGET_LIVE_ALLOCATIONS ? ((generator() % 4) != 0) : ((generator() % 4) == 0)) {
+						LiveAllocation allocation = {};
+						allocation.size = RandomResourceSize(generator);
+						allocation.powerOfTwoSize = PowerOfTwoReservation(allocation.size, ALIGNMENT);
+						VulkanMemoryTLSF::Allocation range;
+						for (allocation.block = 0; allocation.block < blocks.size(); allocation.block++) {
+							range = blocks[allocation.block]->Allocate(allocation.size, ALIGNMENT);
+							if (range.handle != VulkanMemoryTLSF::NO_ALLOCATION) break;
+						}
+						if (allocation.block >= blocks.size()) {
+							blocks.push_back(std::make_unique<VulkanMemoryTLSF>(BLOCK_SIZE));
+							range = blocks.back()->Allocate(allocation.size, ALIGNMENT);
+						}
+						ASSERT_TRUE(range.handle != VulkanMemoryTLSF::NO_ALLOCATION);
+						EXPECT_EQ(range.offset % ALIGNMENT, 0);
+						EXPECT_GE(range.size, allocation.size);
+						allocation.handle = range.handle;
+						live.push_back(allocation);
+						requestedBytes += allocation.size;
+						powerOfTwoBytes += allocation.powerOfTwoSize;
+					}
+					else if (live.size() > 0) {
+						const size_t index = (generator() % live.size());
+						const LiveAllocation allocation = live[index];
+						live[index] = live.back();
+						live.pop_back();
+						blocks[allocation.block]->Free(allocation.handle);
+						requestedBytes -= allocation.size;
+						powerOfTwoBytes -= allocation.powerOfTwoSize;
+					}
+					peakRequestedBytes = std::max(peakRequestedBytes, requestedBytes);
+					peakPowerOfTwoBytes = std::max(peakPowerOfTwoBytes, powerOfTwoBytes);
+				}
+
+				// Power-of-two waste is just the rounding (the old pools never released or shared anything, so the real figure was even worse):
+				const VkDeviceSize tlsfCommittedBytes = static_cast<VkDeviceSize>(blocks.size()) * BLOCK_SIZE;
+				VkDeviceSize tlsfAllocatedBytes = 0;
+				VkDeviceSize largestFreeRange = 0;
+				for (size_t i = 0; i < blocks.size(); i++) {
+					tlsfAllocatedBytes += blocks[i]->AllocatedBytes();
+					largestFreeRange = std::max(largestFreeRange, blocks[i]->LargestFreeRange());
+				}
+				const float powerOfTwoWaste = static_cast<float>(peakPowerOfTwoBytes - peakRequestedBytes) / static_cast<float>(peakRequestedBytes);
+				const float tlsfRoundingWaste = static_cast<float>(tlsfAllocatedBytes - requestedBytes) / static_cast<float>(requestedBytes);
+				const float tlsfCommittedWaste = static_cast<float>(tlsfCommittedBytes - peakRequestedBytes) / static_cast<float>(peakRequestedBytes);
+
+				std::stringstream stream;
+				stream << "VulkanMemoryTest::FragmentationBenchmark - " << OPERATION_COUNT << " operations; peak requested: " << (peakRequestedBytes >> 20) << "MB" << std::endl
+					<< "    POWER OF TWO: peak reserved " << (peakPowerOfTwoBytes >> 20) << "MB (waste: " << (powerOfTwoWaste * 100.0f) << "%)" << std::endl
+					<< "    TLSF:         committed " << (tlsfCommittedBytes >> 20) << "MB in " << blocks.size() << " blocks (waste vs peak: " << (tlsfCommittedWaste * 100.0f)
+					<< "%; rounding waste: " << (tlsfRoundingWaste * 100.0f) << "%; largest free range: " << (largestFreeRange >> 10) << "KB)" << std::endl;
+				logger->Info(stream.str());
+
+				EXPECT_LT(tlsfRoundingWaste, 0.01f);
+				EXPECT_LT(tlsfCommittedBytes, peakPowerOfTwoBytes);
+
+				// Releasing everything has to coalesce each block back into a single range:
+				for (size_t i = 0; i < live.size(); i++)
+					blocks[live[i].block]->Free(live[i].handle);
+				for (size_t i = 0; i < blocks.size(); i++) {
+					EXPECT_TRUE(blocks[i]->Empty());
+					EXPECT_EQ(blocks[i]->LargestFreeRange(), blocks[i]->Capacity());
+				}
+			}
+
+			// Checks allocation strategies and heap statistics on real devices
+			TEST(VulkanMemoryTest, PoolStatistics) {
+				Reference<OS::Logger> logger = Object::Instantiate<OS::StreamLogger>();
+				Reference<Application::AppInformation> appInfo = Object::Instantiate<Application::AppInformation>("VulkanMemoryTest", Application::AppVersion(1, 0, 0));
+				Reference<GraphicsInstance> instance = GraphicsInstance::Create(logger, appInfo, GraphicsInstance::Backend::VULKAN);
+				ASSERT_NE(instance, nullptr);
+
+				for (size_t deviceId = 0; deviceId < instance->PhysicalDeviceCount(); deviceId++) {
+					PhysicalDevice* physicalDevice = instance->GetPhysicalDevice(deviceId);
+					if (!physicalDevice->HasFeature(PhysicalDevice::DeviceFeature::GRAPHICS)) continue;
+					Reference<VulkanDevice> device = physicalDevice->CreateLogicalDevice();
+					ASSERT_NE(device, nullptr);
+					VulkanMemoryPool* pool = device->MemoryPool();
+					ASSERT_NE(pool, nullptr);
+
+					VkMemoryRequirements requirements = {};
+					requirements.memoryTypeBits = ~static_cast<uint32_t>(0);
+					requirements.alignment = 256;
+
+					// Small allocations share a block:
+					requirements.size = (65 << 10);
+					Reference<VulkanMemoryAllocation> first = pool->Allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+					Reference<VulkanMemoryAllocation> second = pool->Allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+					ASSERT_NE(first, nullptr);
+					ASSERT_NE(second, nullptr);
+					EXPECT_EQ(first->Memory(), second->Memory());
+					EXPECT_EQ(first->Size(), requirements.size);
+					EXPECT_EQ(first->Offset() % requirements.alignment, 0);
+					EXPECT_GE(std::max(first->Offset(), second->Offset()), std::min(first->Offset(), second->Offset()) + requirements.size);
+
+					// Large ones get their own memory:
+					requirements.size = VulkanMemoryPool::DEFAULT_BLOCK_SIZE;
+					Reference<VulkanMemoryAllocation> large = pool->Allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+					ASSERT_NE(large, nullptr);
+					EXPECT_NE(large->Memory(), first->Memory());
+					EXPECT_EQ(large->Offset(), 0);
+
+					uint32_t heapIndex = 0;
+					{
+						const VkPhysicalDeviceMemoryProperties& properties = device->PhysicalDeviceInfo()->MemoryProperties();
+						for (uint32_t i = 0; i < properties.memoryTypeCount; i++)
+							if ((properties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0) {
+								heapIndex = properties.memoryTypes[i].heapIndex;
+								break;
+							}
+					}
+					const VkDeviceSize usedBytes = (VulkanMemoryPool::DEFAULT_BLOCK_SIZE + (130 << 10));
+					const VulkanMemoryPool::HeapStatistics busy = pool->Statistics(heapIndex);
+					EXPECT_GE(busy.usedBytes, usedBytes);
+					EXPECT_GE(busy.allocatedBytes, busy.usedBytes);
+					EXPECT_GE(busy.dedicatedAllocationCount, 1);
+					EXPECT_GE(busy.allocationCount, 3);
+					EXPECT_GT(busy.budget, 0);
+
+					first = second = large = nullptr;
+					const VulkanMemoryPool::HeapStatistics idle = pool->Statistics(heapIndex);
+					EXPECT_EQ(idle.usedBytes + usedBytes, busy.usedBytes);
+					EXPECT_EQ(idle.allocationCount + 3, busy.allocationCount);
+					EXPECT_EQ(idle.dedicatedAllocationCount + 1, busy.dedicatedAllocationCount);
+
+					// Transient ones are bumped from a linear page:
+					requirements.size = 1000;
+					Reference<VulkanMemoryAllocation> transientA = pool->Allocate(requirements
+						, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VulkanMemoryPool::AllocationStrategy::TRANSIENT);
+					Reference<VulkanMemoryAllocation> transientB = pool->Allocate(requirements
+						, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VulkanMemoryPool::AllocationStrategy::TRANSIENT);
+					ASSERT_NE(transientA, nullptr);
+					ASSERT_NE(transientB, nullptr);
+					EXPECT_EQ(transientA->Memory(), transientB->Memory());
+					EXPECT_EQ(transientB->Offset(), transientA->Offset() + 1024);
+					EXPECT_NE(transientA->Map(false), nullptr);
+					transientA->Unmap(true);
+
+					std::stringstream stream;
+					stream << "VulkanMemoryTest::PoolStatistics - " << physicalDevice->Name() << " heap " << heapIndex << ": "
+						<< (idle.allocatedBytes >> 20) << "MB allocated; " << (idle.budget >> 20) << "MB budget; fragmentation: " << idle.fragmentation;
+					logger->Info(stream.str());
+				}
+			}
+
+			// Checks delayed release of the empty blocks and evacuation of the sparse ones
+			TEST(VulkanMemoryTest, DefragmentationAndRelease) {
+				Reference<OS::Logger> logger = Object::Instantiate<OS::StreamLogger>();
+				Reference<Application::AppInformation> appInfo = Object::Instantiate<Application::AppInformation>("VulkanMemoryTest", Application::AppVersion(1, 0, 0));
+				Reference<GraphicsInstance> instance = GraphicsInstance::Create(logger, appInfo, GraphicsInstance::Backend::VULKAN);
+				ASSERT_NE(instance, nullptr);
+
+				for (size_t deviceId = 0; deviceId < instance->PhysicalDeviceCount(); deviceId++) {
+					PhysicalDevice* physicalDevice = instance->GetPhysicalDevice(deviceId);
+					if (!physicalDevice->HasFeature(PhysicalDevice::DeviceFeature::GRAPHICS)) continue;
+					Reference<VulkanDevice> device = physicalDevice->CreateLogicalDevice();
+					ASSERT_NE(device, nullptr);
+					VulkanMemoryPool* pool = device->MemoryPool();
+					ASSERT_NE(pool, nullptr);
+
+					VkMemoryRequirements requirements = {};
+					requirements.memoryTypeBits = ~static_cast<uint32_t>(0);
+					requirements.alignment = 256;
+					requirements.size = (1 << 20);
+
+					// Fills the first block and spills into the second one:
+					std::vector<Reference<VulkanMemoryAllocation>> allocations;
+					std::vector<VkDeviceMemory> blocks;
+					while (blocks.size() < 2 && allocations.size() < 1024) {
+						Reference<VulkanMemoryAllocation> allocation = pool->Allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VulkanMemoryPool::AllocationStrategy::RELOCATABLE);
+						ASSERT_NE(allocation, nullptr);
+						if (std::find(blocks.begin(), blocks.end(), allocation->Memory()) == blocks.end()) blocks.push_back(allocation->Memory());
+						allocations.push_back(allocation);
+					}
+					ASSERT_EQ(blocks.size(), 2);
+					EXPECT_FALSE(allocations[0]->RelocationRequested());
+
+					// Leaving a couple of allocations in the first block makes it sparse enough to get evacuated:
+					{
+						size_t survivors = 0;
+						for (size_t i = 0; i < allocations.size(); i++)
+							if (allocations[i]->Memory() == blocks[0]) {
+								if (survivors < 2) survivors++;
+								else allocations[i] = nullptr;
+							}
+						allocations.erase(std::remove(allocations.begin(), allocations.end(), nullptr), allocations.end());
+					}
+					const VulkanMemoryPool::DefragmentationReport flagged = pool->Defragment(~static_cast<VkDeviceSize>(0));
+					EXPECT_GE(flagged.evacuatingBlockCount, 1);
+
+					// Owners move the flagged allocations elsewhere:
+					size_t relocatedCount = 0;
+					VkDeviceMemory evacuatedBlock = VK_NULL_HANDLE;
+					for (size_t i = 0; i < allocations.size(); i++) {
+						if (!allocations[i]->RelocationRequested()) continue;
+						if (evacuatedBlock == VK_NULL_HANDLE) evacuatedBlock = allocations[i]->Memory();
+						EXPECT_EQ(allocations[i]->Memory(), evacuatedBlock);
+						EXPECT_TRUE(allocations[i]->ShouldRelocate());
+						allocations[i] = pool->Allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VulkanMemoryPool::AllocationStrategy::RELOCATABLE);
+						ASSERT_NE(allocations[i], nullptr);
+						EXPECT_NE(allocations[i]->Memory(), evacuatedBlock);
+						relocatedCount++;
+					}
+					EXPECT_GE(relocatedCount, 1);
+
+					// Evacuated block gets released on the next tick:
+					const VulkanMemoryPool::DefragmentationReport evacuated = pool->Defragment();
+					EXPECT_EQ(evacuated.movedBytes, relocatedCount * requirements.size);
+					EXPECT_GT(evacuated.reclaimedBytes, 0);
+
+					// Empty blocks are released after a delay, with one of them kept around:
+					blocks.clear();
+					for (size_t i = 0; i < allocations.size(); i++)
+						if (std::find(blocks.begin(), blocks.end(), allocations[i]->Memory()) == blocks.end()) blocks.push_back(allocations[i]->Memory());
+					while (blocks.size() < 2 && allocations.size() < 1024) {
+						Reference<VulkanMemoryAllocation> allocation = pool->Allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VulkanMemoryPool::AllocationStrategy::RELOCATABLE);
+						ASSERT_NE(allocation, nullptr);
+						if (std::find(blocks.begin(), blocks.end(), allocation->Memory()) == blocks.end()) blocks.push_back(allocation->Memory());
+						allocations.push_back(allocation);
+					}
+					ASSERT_EQ(blocks.size(), 2);
+					allocations.clear();
+					for (uint64_t i = 1; i < VulkanMemoryPool::EMPTY_BLOCK_RELEASE_DELAY; i++)
+						EXPECT_EQ(pool->Defragment().reclaimedBytes, 0);
+					const VulkanMemoryPool::DefragmentationReport released = pool->Defragment();
+					EXPECT_GT(released.reclaimedBytes, 0);
+					EXPECT_EQ(pool->Defragment().reclaimedBytes, 0);
+
+					std::stringstream stream;
+					stream << "VulkanMemoryTest::DefragmentationAndRelease - " << physicalDevice->Name() << ": "
+						<< relocatedCount << " allocations relocated; " << (evacuated.reclaimedBytes >> 20) << "MB reclaimed";
+					logger->Info(stream.str());
+				}
+			}
+		}
+	}
+}
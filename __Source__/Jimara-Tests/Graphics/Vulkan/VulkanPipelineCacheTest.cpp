@@ -0,0 +1,134 @@
+#include "../../GtestHeaders.h"
+#include "../TriangleRenderer/TriangleRendererPipeline.h"
+#include "Graphics/GraphicsInstance.h"
+#include "Graphics/Vulkan/VulkanInstance.h"
+#include "Graphics/Vulkan/VulkanPhysicalDevice.h"
+#include "Graphics/Vulkan/VulkanDevice.h"
+#include "Graphics/Vulkan/Pipeline/VulkanPipelineCache.h"
+#include "Graphics/Pipeline/GraphicsPipeline.h"
+#include "OS/Logging/StreamLogger.h"
+#include "Core/Stopwatch.h"
+#include <filesystem>
+#include <sstream>
+
+
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			namespace {
+				// Picks a software device if there is one (that's where the pipeline compilation is the most expensive and the results are the most stable)
+				inline static PhysicalDevice* PickDevice(GraphicsInstance* instance) {
+					PhysicalDevice* fallback = nullptr;
+					for (size_t i = 0; i < instance->PhysicalDeviceCount(); i++) {
+						PhysicalDevice* device = instance->GetPhysicalDevice(i);
+						if (!device->HasFeature(PhysicalDevice::DeviceFeature::GRAPHICS)) continue;
+						else if (device->Type() == PhysicalDevice::DeviceType::CPU) return device;
+						else if (fallback == nullptr) fallback = device;
+					}
+					return fallback;
+				}
+
+				struct StartupTime {
+					float deviceCreation;
+					float pipelineCreation;
+					bool loadedFromFile;
+				};
+
+				// Creates a logical device and a graphics pipeline per render pass variant, measuring the time it takes
+				inline static StartupTime MeasureStartup(PhysicalDevice* physicalDevice) {
+					StartupTime result = {};
+					Stopwatch stopwatch;
+					Reference<VulkanDevice> device = physicalDevice->CreateLogicalDevice();
+					result.deviceCreation = stopwatch.Reset();
+					if (device == nullptr) return result;
+					result.loadedFromFile = device->PipelineCache()->LoadedFromFile();
+
+					Reference<Test::TriangleRendererPipelineDescriptor> descriptor = Object::Instantiate<Test::TriangleRendererPipelineDescriptor>(device);
+					descriptor->VertexShader();
+					descriptor->FragmentShader();
+					stopwatch.Reset();
+
+					static const Texture::PixelFormat FORMATS[] = {
+						Texture::PixelFormat::R8G8B8A8_UNORM, Texture::PixelFormat::R8G8B8A8_SRGB,
+						Texture::PixelFormat::B8G8R8A8_UNORM, Texture::PixelFormat::B8G8R8A8_SRGB,
+						Texture::PixelFormat::R16G16B16A16_SFLOAT, Texture::PixelFormat::R32G32B32A32_SFLOAT
+					};
+					static const Texture::Multisampling SAMPLE_COUNTS[] = {
+						Texture::Multisampling::SAMPLE_COUNT_1, Texture::Multisampling::SAMPLE_COUNT_4
+					};
+					std::vector<Reference<GraphicsPipeline>> pipelines;
+					for (size_t formatId = 0; formatId < (sizeof(FORMATS) / sizeof(Texture::PixelFormat)); formatId++)
+						for (size_t sampleId = 0; sampleId < (sizeof(SAMPLE_COUNTS) / sizeof(Texture::Multisampling)); sampleId++)
+							for (size_t depth = 0; depth < 2; depth++) {
+								Texture::PixelFormat format = FORMATS[formatId];
+								Reference<RenderPass> renderPass = device->CreateRenderPass(
+									SAMPLE_COUNTS[sampleId], 1, &format, (depth > 0) ? device->GetDepthFormat() : Texture::PixelFormat::FORMAT_COUNT, false);
+								if (renderPass == nullptr) continue;
+								pipelines.push_back(renderPass->CreateGraphicsPipeline(descriptor, 1));
+							}
+					result.pipelineCreation = stopwatch.Elapsed();
+					return result;
+				}
+			}
+
+			// Compares startup time with cold and warm pipeline cache
+			TEST(VulkanPipelineCacheTest, ColdVersusWarmStartup) {
+				// Cache goes to a test-only directory, so that the real cache of the user stays intact:
+				const std::filesystem::path cacheDirectory = std::filesystem::temp_directory_path() / "Jimara_VulkanPipelineCacheTest";
+				std::error_code error;
+				std::filesystem::remove_all(cacheDirectory, error);
+
+				Reference<OS::Logger> logger = Object::Instantiate<OS::StreamLogger>();
+				Reference<Application::AppInformation> appInfo = Object::Instantiate<Application::AppInformation>(
+					"VulkanPipelineCacheTest", Application::AppVersion(1, 0, 0), cacheDirectory.string());
+				Reference<GraphicsInstance> instance = GraphicsInstance::Create(logger, appInfo, GraphicsInstance::Backend::VULKAN);
+				ASSERT_NE(instance, nullptr);
+				PhysicalDevice* physicalDevice = PickDevice(instance);
+				ASSERT_NE(physicalDevice, nullptr);
+
+				const std::string cacheFile = VulkanPipelineCache::DefaultFilename(cacheDirectory.string(), dynamic_cast<VulkanPhysicalDevice*>(physicalDevice));
+				EXPECT_EQ(std::filesystem::path(cacheFile).parent_path(), cacheDirectory);
+
+				const StartupTime cold = MeasureStartup(physicalDevice);
+				EXPECT_FALSE(cold.loadedFromFile);
+				EXPECT_TRUE(std::filesystem::exists(cacheFile));
+
+				const StartupTime warm = MeasureStartup(physicalDevice);
+				EXPECT_TRUE(warm.loadedFromFile);
+
+				// No temporary files should be left behind:
+				size_t fileCount = 0;
+				for (const auto& entry : std::filesystem::directory_iterator(cacheDirectory, error)) {
+					EXPECT_EQ(entry.path().extension().string(), ".bin");
+					fileCount++;
+				}
+				EXPECT_EQ(fileCount, 1u);
+
+				std::stringstream stream;
+				stream << "VulkanPipelineCacheTest - " << physicalDevice->Name() << ":" << std::endl
+					<< "    COLD: device - " << cold.deviceCreation << "s; pipelines - " << cold.pipelineCreation << "s" << std::endl
+					<< "    WARM: device - " << warm.deviceCreation << "s; pipelines - " << warm.pipelineCreation << "s" << std::endl;
+				logger->Info(stream.str());
+
+				std::filesystem::remove_all(cacheDirectory, error);
+			}
+
+			// Empty cache directory disables the on-disk cache
+			TEST(VulkanPipelineCacheTest, DisabledCache) {
+				Reference<OS::Logger> logger = Object::Instantiate<OS::StreamLogger>();
+				Reference<Application::AppInformation> appInfo = Object::Instantiate<Application::AppInformation>(
+					"VulkanPipelineCacheTest", Application::AppVersion(1, 0, 0), "");
+				Reference<GraphicsInstance> instance = GraphicsInstance::Create(logger, appInfo, GraphicsInstance::Backend::VULKAN);
+				ASSERT_NE(instance, nullptr);
+				PhysicalDevice* physicalDevice = PickDevice(instance);
+				ASSERT_NE(physicalDevice, nullptr);
+
+				Reference<VulkanDevice> device = physicalDevice->CreateLogicalDevice();
+				ASSERT_NE(device, nullptr);
+				EXPECT_TRUE(device->PipelineCache()->Filename().empty());
+				EXPECT_FALSE(device->PipelineCache()->LoadedFromFile());
+				EXPECT_FALSE(device->PipelineCache()->Save());
+			}
+		}
+	}
+}
@@ -0,0 +1,81 @@
+#include "../../GtestHeaders.h"
+#include "../TriangleRenderer/TriangleRendererPipeline.h"
+#include "Graphics/GraphicsInstance.h"
+#include "Graphics/Vulkan/VulkanDevice.h"
+#include "Graphics/Pipeline/GraphicsPipeline.h"
+#include "OS/Logging/StreamLogger.h"
+#include "Core/Stopwatch.h"
+#include <sstream>
+
+
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			namespace {
+				static const size_t PIPELINE_COUNT = 10000;
+				static const size_t FRAME_COUNT = 8;
+
+				// Creates PIPELINE_COUNT pipelines and measures average Execute() time per pipeline for static bindings
+				inline static float MeasureDescriptorUpdates(GraphicsDevice* device, RenderPass* renderPass, bool trackRevision) {
+					const Reference<ShaderCache> shaderCache = device->CreateShaderCache();
+					const Reference<TextureSampler> sampler = device->CreateTexture(
+						Texture::TextureType::TEXTURE_2D, Texture::PixelFormat::R8G8B8A8_UNORM, Size3(4, 4, 1), 1, false)
+						->CreateView(TextureView::ViewType::VIEW_2D)->CreateSampler();
+
+					std::vector<Reference<GraphicsPipeline>> pipelines;
+					for (size_t i = 0; i < PIPELINE_COUNT; i++) {
+						const Reference<Test::TriangleRendererPipelineDescriptor> descriptor =
+							Object::Instantiate<Test::TriangleRendererPipelineDescriptor>(device, shaderCache, sampler, trackRevision);
+						pipelines.push_back(renderPass->CreateGraphicsPipeline(descriptor, 1));
+					}
+
+					// Commands are recorded the same way GraphicsPipelineSet records them, but never submitted (we only care about the CPU side):
+					const Reference<SecondaryCommandBuffer> commandBuffer = device->GraphicsQueue()->CreateCommandPool()->CreateSecondaryCommandBuffer();
+					float totalTime = 0.0f;
+					for (size_t frame = 0; frame < FRAME_COUNT; frame++) {
+						commandBuffer->Reset();
+						commandBuffer->BeginRecording(renderPass, nullptr);
+						Stopwatch stopwatch;
+						for (size_t i = 0; i < pipelines.size(); i++)
+							pipelines[i]->Execute(commandBuffer, 0);
+						// First frame writes every descriptor set regardless, so we only measure the steady state:
+						if (frame > 0) totalTime += stopwatch.Elapsed();
+						commandBuffer->EndRecording();
+					}
+					return totalTime / static_cast<float>((FRAME_COUNT - 1) * PIPELINE_COUNT);
+				}
+			}
+
+			// Measures descriptor update overhead per pipeline with and without binding revision tracking
+			TEST(VulkanPipelineDescriptorTest, StaticBindingUpdateCost) {
+				Reference<OS::Logger> logger = Object::Instantiate<OS::StreamLogger>();
+				Reference<Application::AppInformation> appInfo = Object::Instantiate<Application::AppInformation>("VulkanPipelineDescriptorTest", Application::AppVersion(1, 0, 0));
+				Reference<GraphicsInstance> instance = GraphicsInstance::Create(logger, appInfo, GraphicsInstance::Backend::VULKAN);
+				ASSERT_NE(instance, nullptr);
+
+				PhysicalDevice* physicalDevice = nullptr;
+				for (size_t i = 0; i < instance->PhysicalDeviceCount(); i++) {
+					physicalDevice = instance->GetPhysicalDevice(i);
+					if (physicalDevice->HasFeature(PhysicalDevice::DeviceFeature::GRAPHICS)) break;
+					else physicalDevice = nullptr;
+				}
+				ASSERT_NE(physicalDevice, nullptr);
+				Reference<GraphicsDevice> device = physicalDevice->CreateLogicalDevice();
+				ASSERT_NE(device, nullptr);
+
+				const Texture::PixelFormat format = Texture::PixelFormat::R8G8B8A8_UNORM;
+				Reference<RenderPass> renderPass = device->CreateRenderPass(Texture::Multisampling::SAMPLE_COUNT_1, 1, &format, Texture::PixelFormat::FORMAT_COUNT, false);
+				ASSERT_NE(renderPass, nullptr);
+
+				const float untracked = MeasureDescriptorUpdates(device, renderPass, false);
+				const float tracked = MeasureDescriptorUpdates(device, renderPass, true);
+
+				std::stringstream stream;
+				stream << "VulkanPipelineDescriptorTest - " << physicalDevice->Name() << " (" << PIPELINE_COUNT << " pipelines):" << std::endl
+					<< "    UNTRACKED: " << (untracked * 1000000.0f) << "us per pipeline" << std::endl
+					<< "    TRACKED:   " << (tracked * 1000000.0f) << "us per pipeline" << std::endl;
+				logger->Info(stream.str());
+			}
+		}
+	}
+}
@@ -0,0 +1,245 @@
+#include "../../GtestHeaders.h"
+#include "Graphics/GraphicsInstance.h"
+#include "Graphics/Vulkan/Memory/Textures/VulkanTextureStreamer.h"
+#include "Graphics/Vulkan/Memory/Textures/VulkanDynamicTexture.h"
+#include "OS/Logging/StreamLogger.h"
+#include <cstring>
+
+
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			namespace {
+				inline static Reference<VulkanTextureStreamer::Request> EnqueueTexture(VulkanTextureStreamer* streamer, uint32_t size) {
+					Reference<VulkanStaticTexture> texture = Object::Instantiate<VulkanStaticTexture>(
+						streamer->Device(), Texture::TextureType::TEXTURE_2D, Texture::PixelFormat::R8G8B8A8_UNORM, Size3(size, size, 1), 1, true
+						, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, Texture::Multisampling::SAMPLE_COUNT_1);
+					const VulkanUploadRing::Range staging = streamer->UploadRing()->Allocate(static_cast<VkDeviceSize>(size) * size * sizeof(uint32_t), sizeof(uint32_t));
+					memset(staging.data, 0, static_cast<size_t>(staging.size));
+					return streamer->Enqueue(texture, staging);
+				}
+
+				// Color of the texture i for the given revision:
+				inline static uint32_t TextureColor(size_t textureId, uint32_t revision, size_t textureCount) {
+					return static_cast<uint32_t>(revision * textureCount + textureId) | 0xff000000u;
+				}
+
+				// Fills each texture with TextureColor:
+				inline static void WriteTextures(const std::vector<Reference<VulkanDynamicTexture>>& textures, uint32_t revision) {
+					for (size_t i = 0; i < textures.size(); i++) {
+						uint32_t* data = static_cast<uint32_t*>(textures[i]->Map());
+						ASSERT_NE(data, nullptr);
+						const Size3 size = textures[i]->Size();
+						const uint32_t color = TextureColor(i, revision, textures.size());
+						for (size_t j = 0; j < (static_cast<size_t>(size.x) * size.y); j++) data[j] = color;
+						textures[i]->Unmap(true);
+					}
+				}
+
+				// Renders with the textures (copies a texel from the base and the last mip levels of each one to a readback buffer) and checks the values:
+				inline static void CheckTextureContent(VulkanDevice* device, const std::vector<Reference<VulkanDynamicTexture>>& textures, uint32_t revision) {
+					Reference<VulkanStaticBuffer> readback = Object::Instantiate<VulkanStaticBuffer>(
+						device, sizeof(uint32_t), textures.size() * 2, false
+						, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+					Reference<CommandPool> commandPool = device->GraphicsQueue()->CreateCommandPool();
+					ASSERT_NE(commandPool, nullptr);
+					Reference<PrimaryCommandBuffer> commandBuffer = commandPool->CreatePrimaryCommandBuffer();
+					VulkanPrimaryCommandBuffer* vulkanBuffer = dynamic_cast<VulkanPrimaryCommandBuffer*>(commandBuffer.operator->());
+					ASSERT_NE(vulkanBuffer, nullptr);
+					vulkanBuffer->BeginRecording();
+					for (size_t i = 0; i < textures.size(); i++) {
+						Reference<VulkanStaticImage> handle = textures[i]->GetStaticHandle(vulkanBuffer);
+						ASSERT_NE(handle, nullptr);
+						const uint32_t mipLevels = textures[i]->MipLevels();
+						handle->TransitionLayout(vulkanBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+							, VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1
+							, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+						for (uint32_t j = 0; j < 2; j++) {
+							VkBufferImageCopy region = {};
+							region.bufferOffset = static_cast<VkDeviceSize>((i * 2 + j) * sizeof(uint32_t));
+							region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+							region.imageSubresource.mipLevel = (j == 0) ? 0 : (mipLevels - 1);
+							region.imageSubresource.baseArrayLayer = 0;
+							region.imageSubresource.layerCount = 1;
+							region.imageOffset = { 0, 0, 0 };
+							region.imageExtent = { 1, 1, 1 };
+							vkCmdCopyImageToBuffer(*vulkanBuffer, *handle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, *readback, 1, &region);
+						}
+						handle->TransitionLayout(vulkanBuffer, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+							, VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1
+							, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+					}
+					vulkanBuffer->RecordBufferDependency(readback);
+					vulkanBuffer->EndRecording();
+					VulkanUploadRing::Instance(device)->Flush();
+					device->GraphicsQueue()->ExecuteCommandBuffer(vulkanBuffer);
+					vulkanBuffer->Wait();
+
+					const uint32_t* result = static_cast<const uint32_t*>(readback->Map());
+					size_t mismatchCount = 0;
+					for (size_t i = 0; i < textures.size(); i++)
+						for (size_t j = 0; j < 2; j++)
+							if (result[i * 2 + j] != TextureColor(i, revision, textures.size())) mismatchCount++;
+					readback->Unmap(false);
+					EXPECT_EQ(mismatchCount, 0u);
+				}
+			}
+
+			// Queues a bunch of uploads and makes sure Flush() spreads them over the frames according to the budget
+			TEST(VulkanTextureStreamerTest, FrameBudget) {
+				Reference<OS::Logger> logger = Object::Instantiate<OS::StreamLogger>();
+				Reference<Application::AppInformation> appInfo = Object::Instantiate<Application::AppInformation>("VulkanTextureStreamerTest", Application::AppVersion(1, 0, 0));
+				Reference<GraphicsInstance> instance = GraphicsInstance::Create(logger, appInfo, GraphicsInstance::Backend::VULKAN);
+				ASSERT_NE(instance, nullptr);
+
+				static const uint32_t TEXTURE_SIZE = 64;
+				static const size_t TEXTURE_BYTES = TEXTURE_SIZE * TEXTURE_SIZE * sizeof(uint32_t);
+				static const size_t TEXTURES_PER_FRAME = 4;
+				static const size_t TEXTURE_COUNT = 16;
+
+				for (size_t deviceId = 0; deviceId < instance->PhysicalDeviceCount(); deviceId++) {
+					PhysicalDevice* physicalDevice = instance->GetPhysicalDevice(deviceId);
+					if (!physicalDevice->HasFeature(PhysicalDevice::DeviceFeature::GRAPHICS)) continue;
+					Reference<VulkanDevice> device = physicalDevice->CreateLogicalDevice();
+					ASSERT_NE(device, nullptr);
+					EXPECT_EQ(VulkanTextureStreamer::Instance(device), VulkanTextureStreamer::Instance(device));
+
+					Reference<VulkanTextureStreamer> streamer = Object::Instantiate<VulkanTextureStreamer>(device, TEXTURE_BYTES * TEXTURES_PER_FRAME);
+					EXPECT_EQ(streamer->UploadRing(), VulkanUploadRing::Instance(device));
+
+					std::vector<Reference<VulkanTextureStreamer::Request>> requests;
+					for (size_t i = 0; i < TEXTURE_COUNT; i++) {
+						requests.push_back(EnqueueTexture(streamer, TEXTURE_SIZE));
+						ASSERT_NE(requests.back(), nullptr);
+						EXPECT_FALSE(requests.back()->Recorded());
+					}
+					EXPECT_EQ(streamer->PendingCount(), TEXTURE_COUNT);
+					EXPECT_EQ(streamer->PendingBytes(), TEXTURE_COUNT * TEXTURE_BYTES);
+
+					// Each frame records as many uploads, as the budget allows, in a single group and in the order of submission:
+					for (size_t frame = 0; frame < (TEXTURE_COUNT / TEXTURES_PER_FRAME); frame++) {
+						const size_t groupCount = streamer->RecordedGroupCount();
+						streamer->Flush();
+						EXPECT_EQ(streamer->RecordedGroupCount(), groupCount + 1);
+						EXPECT_EQ(streamer->PendingCount(), TEXTURE_COUNT - (frame + 1) * TEXTURES_PER_FRAME);
+						for (size_t i = 0; i < TEXTURE_COUNT; i++)
+							EXPECT_EQ(requests[i]->Recorded(), i < ((frame + 1) * TEXTURES_PER_FRAME));
+						for (size_t i = 1; i < TEXTURES_PER_FRAME; i++)
+							EXPECT_EQ(requests[frame * TEXTURES_PER_FRAME + i]->BatchId(), requests[frame * TEXTURES_PER_FRAME]->BatchId());
+					}
+					EXPECT_EQ(streamer->PendingBytes(), 0u);
+
+					// Requested upload gets recorded right away, taking as many queued ones with it, as the budget allows:
+					requests.clear();
+					for (size_t i = 0; i < (TEXTURES_PER_FRAME * 2); i++)
+						requests.push_back(EnqueueTexture(streamer, TEXTURE_SIZE));
+					streamer->Flush();
+					EXPECT_EQ(streamer->PendingCount(), TEXTURES_PER_FRAME);
+					EXPECT_TRUE(streamer->Upload(requests.back(), false));
+					EXPECT_EQ(streamer->PendingCount(), 0u);
+					for (size_t i = 0; i < requests.size(); i++)
+						EXPECT_TRUE(requests[i]->Recorded());
+
+					// Once the budget is spent, only the forced uploads get recorded:
+					Reference<VulkanTextureStreamer::Request> request = EnqueueTexture(streamer, TEXTURE_SIZE);
+					EXPECT_FALSE(streamer->Upload(request, false));
+					EXPECT_FALSE(request->Recorded());
+					EXPECT_TRUE(streamer->Upload(request, true));
+					EXPECT_TRUE(request->Recorded());
+
+					// Replaced requests keep their place in the queue and canceled ones are dropped:
+					Reference<VulkanTextureStreamer::Request> first = EnqueueTexture(streamer, TEXTURE_SIZE);
+					Reference<VulkanTextureStreamer::Request> second = EnqueueTexture(streamer, TEXTURE_SIZE);
+					{
+						const VulkanUploadRing::Range staging = streamer->UploadRing()->Allocate(TEXTURE_BYTES, sizeof(uint32_t));
+						EXPECT_EQ(streamer->Enqueue(first->Texture(), staging, first), first);
+					}
+					EXPECT_EQ(streamer->PendingCount(), 2u);
+					streamer->Cancel(second);
+					EXPECT_EQ(streamer->PendingCount(), 1u);
+					EXPECT_FALSE(streamer->Upload(second, true));
+					streamer->Flush();
+					EXPECT_TRUE(first->Recorded());
+					EXPECT_FALSE(second->Recorded());
+					EXPECT_EQ(streamer->PendingCount(), 0u);
+
+					streamer->UploadRing()->Flush();
+					vkDeviceWaitIdle(*device);
+				}
+			}
+
+			// Makes sure the dynamic textures get correct content in every mip level and keep the old one while the new upload is queued
+			TEST(VulkanTextureStreamerTest, DynamicTextureContent) {
+				Reference<OS::Logger> logger = Object::Instantiate<OS::StreamLogger>();
+				Reference<Application::AppInformation> appInfo = Object::Instantiate<Application::AppInformation>("VulkanTextureStreamerTest", Application::AppVersion(1, 0, 0));
+				Reference<GraphicsInstance> instance = GraphicsInstance::Create(logger, appInfo, GraphicsInstance::Backend::VULKAN);
+				ASSERT_NE(instance, nullptr);
+
+				static const size_t TEXTURE_COUNT = 8;
+
+				for (size_t deviceId = 0; deviceId < instance->PhysicalDeviceCount(); deviceId++) {
+					PhysicalDevice* physicalDevice = instance->GetPhysicalDevice(deviceId);
+					if (!physicalDevice->HasFeature(PhysicalDevice::DeviceFeature::GRAPHICS)) continue;
+					Reference<VulkanDevice> device = physicalDevice->CreateLogicalDevice();
+					ASSERT_NE(device, nullptr);
+					Reference<VulkanTextureStreamer> streamer = VulkanTextureStreamer::Instance(device);
+					ASSERT_NE(streamer, nullptr);
+
+					// Textures of different sizes have mip chains of different lengths (the second update gets recorded as a single group on Flush()):
+					std::vector<Reference<VulkanDynamicTexture>> textures;
+					for (size_t i = 0; i < TEXTURE_COUNT; i++) {
+						const uint32_t size = (2u << i);
+						textures.push_back(Object::Instantiate<VulkanDynamicTexture>(
+							device, Texture::TextureType::TEXTURE_2D, Texture::PixelFormat::R8G8B8A8_UNORM, Size3(size, size, 1), 1, true));
+					}
+
+					// Textures without content get their uploads recorded regardless of the budget:
+					const size_t frameBudget = streamer->FrameBudget();
+					streamer->SetFrameBudget(1);
+					WriteTextures(textures, 1);
+					CheckTextureContent(device, textures, 1);
+
+					// With the budget spent on an upload, the device has not executed yet, the old content stays visible until the uploads get recorded on Flush():
+					EXPECT_TRUE(streamer->Upload(EnqueueTexture(streamer, 1), true));
+					WriteTextures(textures, 2);
+					CheckTextureContent(device, textures, 1);
+					streamer->SetFrameBudget(frameBudget);
+					streamer->Flush();
+					EXPECT_EQ(streamer->PendingCount(), 0u);
+					CheckTextureContent(device, textures, 2);
+				}
+			}
+
+			// Makes sure the budget gets restored without Flush() calls (offscreen users never make them), once the device executes the uploads, that spent it
+			TEST(VulkanTextureStreamerTest, BudgetWithoutFlush) {
+				Reference<OS::Logger> logger = Object::Instantiate<OS::StreamLogger>();
+				Reference<Application::AppInformation> appInfo = Object::Instantiate<Application::AppInformation>("VulkanTextureStreamerTest", Application::AppVersion(1, 0, 0));
+				Reference<GraphicsInstance> instance = GraphicsInstance::Create(logger, appInfo, GraphicsInstance::Backend::VULKAN);
+				ASSERT_NE(instance, nullptr);
+
+				for (size_t deviceId = 0; deviceId < instance->PhysicalDeviceCount(); deviceId++) {
+					PhysicalDevice* physicalDevice = instance->GetPhysicalDevice(deviceId);
+					if (!physicalDevice->HasFeature(PhysicalDevice::DeviceFeature::GRAPHICS)) continue;
+					Reference<VulkanDevice> device = physicalDevice->CreateLogicalDevice();
+					ASSERT_NE(device, nullptr);
+					Reference<VulkanTextureStreamer> streamer = VulkanTextureStreamer::Instance(device);
+					ASSERT_NE(streamer, nullptr);
+
+					const std::vector<Reference<VulkanDynamicTexture>> textures = {
+						Object::Instantiate<VulkanDynamicTexture>(device, Texture::TextureType::TEXTURE_2D, Texture::PixelFormat::R8G8B8A8_UNORM, Size3(16, 16, 1), 1, true)
+					};
+
+					// Each update alone exceeds the budget, but the previous one is always executed by the time the texture gets used again:
+					const size_t frameBudget = streamer->FrameBudget();
+					streamer->SetFrameBudget(1);
+					for (uint32_t revision = 1; revision <= 4; revision++) {
+						WriteTextures(textures, revision);
+						CheckTextureContent(device, textures, revision);
+					}
+					EXPECT_EQ(streamer->PendingCount(), 0u);
+					streamer->SetFrameBudget(frameBudget);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,197 @@
+#include "../../GtestHeaders.h"
+#include "Graphics/GraphicsInstance.h"
+#include "Graphics/Vulkan/Memory/VulkanUploadRing.h"
+#include "Graphics/Vulkan/Memory/Buffers/VulkanDynamicBuffer.h"
+#include "Graphics/Vulkan/Pipeline/VulkanDeviceQueue.h"
+#include "OS/Logging/StreamLogger.h"
+#include <sstream>
+
+
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			// Makes sure the uploads get a transfer queue and fall back to the graphics one without a transfer-only family
+			TEST(VulkanUploadRingTest, TransferQueueSelection) {
+				Reference<OS::Logger> logger = Object::Instantiate<OS::StreamLogger>();
+				Reference<Application::AppInformation> appInfo = Object::Instantiate<Application::AppInformation>("VulkanUploadRingTest", Application::AppVersion(1, 0, 0));
+				Reference<GraphicsInstance> instance = GraphicsInstance::Create(logger, appInfo, GraphicsInstance::Backend::VULKAN);
+				ASSERT_NE(instance, nullptr);
+
+				for (size_t deviceId = 0; deviceId < instance->PhysicalDeviceCount(); deviceId++) {
+					PhysicalDevice* physicalDevice = instance->GetPhysicalDevice(deviceId);
+					if (!physicalDevice->HasFeature(PhysicalDevice::DeviceFeature::GRAPHICS)) continue;
+					Reference<VulkanDevice> device = physicalDevice->CreateLogicalDevice();
+					ASSERT_NE(device, nullptr);
+					ASSERT_NE(device->TransferQueue(), nullptr);
+					EXPECT_TRUE((device->TransferQueue()->Features() & static_cast<DeviceQueue::FeatureBits>(DeviceQueue::FeatureBit::TRANSFER)) != 0);
+
+					const std::optional<uint32_t> transferFamily = device->PhysicalDeviceInfo()->TransferQueueId();
+					EXPECT_EQ(device->HasDedicatedTransferQueue(), transferFamily.has_value());
+					if (device->HasDedicatedTransferQueue())
+						EXPECT_EQ(dynamic_cast<VulkanDeviceQueue*>(device->TransferQueue())->FamilyId(), transferFamily.value());
+					else EXPECT_EQ(device->TransferQueue(), device->GraphicsQueue());
+
+					Reference<VulkanUploadRing> ring = VulkanUploadRing::Instance(device);
+					ASSERT_NE(ring, nullptr);
+					EXPECT_EQ(ring->OwnershipTransferRequired(), device->HasDedicatedTransferQueue());
+				}
+			}
+
+			// Updates a thousand small buffers and makes sure their uploads end up in a single submission with correct content
+			TEST(VulkanUploadRingTest, BatchedUploads) {
+				Reference<OS::Logger> logger = Object::Instantiate<OS::StreamLogger>();
+				Reference<Application::AppInformation> appInfo = Object::Instantiate<Application::AppInformation>("VulkanUploadRingTest", Application::AppVersion(1, 0, 0));
+				Reference<GraphicsInstance> instance = GraphicsInstance::Create(logger, appInfo, GraphicsInstance::Backend::VULKAN);
+				ASSERT_NE(instance, nullptr);
+
+				static const size_t BUFFER_COUNT = 1000;
+				static const size_t ELEMENT_COUNT = 64;
+				static const size_t FRAME_COUNT = 8;
+
+				for (size_t deviceId = 0; deviceId < instance->PhysicalDeviceCount(); deviceId++) {
+					PhysicalDevice* physicalDevice = instance->GetPhysicalDevice(deviceId);
+					if (!physicalDevice->HasFeature(PhysicalDevice::DeviceFeature::GRAPHICS)) continue;
+					Reference<VulkanDevice> device = physicalDevice->CreateLogicalDevice();
+					ASSERT_NE(device, nullptr);
+					Reference<VulkanUploadRing> ring = VulkanUploadRing::Instance(device);
+					ASSERT_NE(ring, nullptr);
+					EXPECT_EQ(ring, VulkanUploadRing::Instance(device));
+
+					std::vector<Reference<VulkanDynamicBuffer>> buffers;
+					for (size_t i = 0; i < BUFFER_COUNT; i++)
+						buffers.push_back(Object::Instantiate<VulkanDynamicBuffer>(device, sizeof(uint32_t), ELEMENT_COUNT));
+
+					Reference<VulkanStaticBuffer> readback = Object::Instantiate<VulkanStaticBuffer>(
+						device, sizeof(uint32_t), ELEMENT_COUNT * BUFFER_COUNT, false
+						, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+					Reference<CommandPool> commandPool = device->GraphicsQueue()->CreateCommandPool();
+					ASSERT_NE(commandPool, nullptr);
+
+					size_t totalSubmissions = 0;
+					for (size_t frame = 0; frame < FRAME_COUNT; frame++) {
+						// Every frame rewrites all the buffers (large enough number of frames makes the ring wrap around):
+						for (size_t i = 0; i < buffers.size(); i++) {
+							uint32_t* data = static_cast<uint32_t*>(buffers[i]->Map());
+							for (size_t j = 0; j < ELEMENT_COUNT; j++)
+								data[j] = static_cast<uint32_t>((frame * BUFFER_COUNT + i) * ELEMENT_COUNT + j);
+							buffers[i]->Unmap(true);
+						}
+
+						// All the uploads from the frame should be submitted at once, when the first buffer is requested:
+						const size_t submissionsBefore = ring->SubmissionCount();
+						Reference<PrimaryCommandBuffer> commandBuffer = commandPool->CreatePrimaryCommandBuffer();
+						VulkanPrimaryCommandBuffer* vulkanBuffer = dynamic_cast<VulkanPrimaryCommandBuffer*>(commandBuffer.operator->());
+						ASSERT_NE(vulkanBuffer, nullptr);
+						vulkanBuffer->BeginRecording();
+						for (size_t i = 0; i < buffers.size(); i++) {
+							Reference<VulkanStaticBuffer> handle = buffers[i]->GetStaticHandle(vulkanBuffer);
+							ASSERT_NE(handle, nullptr);
+							VkBufferCopy copy = {};
+							copy.srcOffset = 0;
+							copy.dstOffset = static_cast<VkDeviceSize>(i * ELEMENT_COUNT * sizeof(uint32_t));
+							copy.size = static_cast<VkDeviceSize>(ELEMENT_COUNT * sizeof(uint32_t));
+							vkCmdCopyBuffer(*vulkanBuffer, *handle, *readback, 1, &copy);
+						}
+						vulkanBuffer->RecordBufferDependency(readback);
+						vulkanBuffer->EndRecording();
+						const size_t batchSubmissions = (ring->SubmissionCount() - submissionsBefore);
+						EXPECT_EQ(batchSubmissions, 1);
+						totalSubmissions += batchSubmissions;
+						device->GraphicsQueue()->ExecuteCommandBuffer(vulkanBuffer);
+						vulkanBuffer->Wait();
+
+						const uint32_t* result = static_cast<const uint32_t*>(readback->Map());
+						size_t mismatchCount = 0;
+						for (size_t i = 0; i < (BUFFER_COUNT * ELEMENT_COUNT); i++)
+							if (result[i] != static_cast<uint32_t>(frame * BUFFER_COUNT * ELEMENT_COUNT + i)) mismatchCount++;
+						readback->Unmap(false);
+						EXPECT_EQ(mismatchCount, 0);
+					}
+
+					std::stringstream stream;
+					stream << "VulkanUploadRingTest::BatchedUploads - " << physicalDevice->Name() << ": "
+						<< (BUFFER_COUNT * FRAME_COUNT) << " buffer updates in " << totalSubmissions << " submissions";
+					logger->Info(stream.str());
+				}
+			}
+
+			// Writes random ranges of a buffer with MapRange() and makes sure the rest of the content survives
+			TEST(VulkanUploadRingTest, PartialUpdates) {
+				Reference<OS::Logger> logger = Object::Instantiate<OS::StreamLogger>();
+				Reference<Application::AppInformation> appInfo = Object::Instantiate<Application::AppInformation>("VulkanUploadRingTest", Application::AppVersion(1, 0, 0));
+				Reference<GraphicsInstance> instance = GraphicsInstance::Create(logger, appInfo, GraphicsInstance::Backend::VULKAN);
+				ASSERT_NE(instance, nullptr);
+
+				static const size_t ELEMENT_COUNT = 4096;
+				static const size_t FRAME_COUNT = 16;
+				static const size_t RANGES_PER_FRAME = 8;
+
+				for (size_t deviceId = 0; deviceId < instance->PhysicalDeviceCount(); deviceId++) {
+					PhysicalDevice* physicalDevice = instance->GetPhysicalDevice(deviceId);
+					if (!physicalDevice->HasFeature(PhysicalDevice::DeviceFeature::GRAPHICS)) continue;
+					Reference<VulkanDevice> device = physicalDevice->CreateLogicalDevice();
+					ASSERT_NE(device, nullptr);
+
+					Reference<VulkanDynamicBuffer> buffer = Object::Instantiate<VulkanDynamicBuffer>(device, sizeof(uint32_t), ELEMENT_COUNT);
+					EXPECT_EQ(buffer->MapRange(0, 0), nullptr);
+					EXPECT_EQ(buffer->MapRange(ELEMENT_COUNT, 1), nullptr);
+					EXPECT_EQ(buffer->MapRange(ELEMENT_COUNT - 1, 2), nullptr);
+
+					std::vector<uint32_t> expected(ELEMENT_COUNT);
+					{
+						uint32_t* data = static_cast<uint32_t*>(buffer->Map());
+						for (size_t i = 0; i < ELEMENT_COUNT; i++) data[i] = expected[i] = static_cast<uint32_t>(i);
+						buffer->Unmap(true);
+					}
+
+					Reference<VulkanStaticBuffer> readback = Object::Instantiate<VulkanStaticBuffer>(
+						device, sizeof(uint32_t), ELEMENT_COUNT, false
+						, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+					Reference<CommandPool> commandPool = device->GraphicsQueue()->CreateCommandPool();
+					ASSERT_NE(commandPool, nullptr);
+
+					Reference<VulkanStaticBuffer> lastHandle;
+					uint32_t seed = 7;
+					auto random = [&]() { seed = (seed * 1103515245u + 12345u); return static_cast<size_t>((seed >> 8) & 0xFFFF); };
+					for (size_t frame = 0; frame < FRAME_COUNT; frame++) {
+						// Ranges get patched in place and recorded together (on even frames they overlap near the start of the buffer):
+						for (size_t r = 0; r < RANGES_PER_FRAME; r++) {
+							const size_t count = 1 + (random() % 64);
+							const size_t offset = (((frame & 1) == 0 && r > 0) ? (random() % 16) : random()) % (ELEMENT_COUNT - count);
+							uint32_t* data = static_cast<uint32_t*>(buffer->MapRange(offset, count));
+							ASSERT_NE(data, nullptr);
+							for (size_t i = 0; i < count; i++)
+								data[i] = expected[offset + i] = static_cast<uint32_t>((frame + 1) * ELEMENT_COUNT * 16 + r * ELEMENT_COUNT + offset + i);
+							buffer->UnmapRange(true);
+						}
+
+						Reference<PrimaryCommandBuffer> commandBuffer = commandPool->CreatePrimaryCommandBuffer();
+						VulkanPrimaryCommandBuffer* vulkanBuffer = dynamic_cast<VulkanPrimaryCommandBuffer*>(commandBuffer.operator->());
+						ASSERT_NE(vulkanBuffer, nullptr);
+						vulkanBuffer->BeginRecording();
+						Reference<VulkanStaticBuffer> handle = buffer->GetStaticHandle(vulkanBuffer);
+						ASSERT_NE(handle, nullptr);
+						// Partial writes should not reallocate the data buffer (unless the memory pool relocated it):
+						if (lastHandle != nullptr && (!lastHandle->Memory()->RelocationRequested()))
+							EXPECT_EQ(handle, lastHandle);
+						lastHandle = handle;
+						VkBufferCopy copy = {};
+						copy.size = static_cast<VkDeviceSize>(ELEMENT_COUNT * sizeof(uint32_t));
+						vkCmdCopyBuffer(*vulkanBuffer, *handle, *readback, 1, &copy);
+						vulkanBuffer->RecordBufferDependency(readback);
+						vulkanBuffer->EndRecording();
+						device->GraphicsQueue()->ExecuteCommandBuffer(vulkanBuffer);
+						vulkanBuffer->Wait();
+
+						const uint32_t* result = static_cast<const uint32_t*>(readback->Map());
+						size_t mismatchCount = 0;
+						for (size_t i = 0; i < ELEMENT_COUNT; i++)
+							if (result[i] != expected[i]) mismatchCount++;
+						readback->Unmap(false);
+						EXPECT_EQ(mismatchCount, 0);
+					}
+				}
+			}
+		}
+	}
+}
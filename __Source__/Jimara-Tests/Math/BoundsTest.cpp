@@ -0,0 +1,185 @@
+#include "../GtestHeaders.h"
+#include "Math/Bounds.h"
+#include "Core/Stopwatch.h"
+#include "OS/Logging/StreamLogger.h"
+#include <random>
+#include <vector>
+
+
+namespace Jimara {
+	namespace {
+		// Perspective projection, looking towards +Z (same convention the renderer tests use):
+		inline static Matrix4 TestProjection(float nearPlane, float farPlane) {
+			Matrix4 projection = glm::perspective(glm::radians(64.0f), 16.0f / 9.0f, nearPlane, farPlane);
+			projection[2] *= -1.0f;
+			return projection;
+		}
+
+		inline static Vector3 RandomVector(std::mt19937& rng, float range) {
+			std::uniform_real_distribution<float> distribution(-range, range);
+			const float x = distribution(rng);
+			const float y = distribution(rng);
+			const float z = distribution(rng);
+			return Vector3(x, y, z);
+		}
+
+		inline static std::vector<AABB> RandomBoxes(size_t count, float range, float maxSize, unsigned seed) {
+			std::mt19937 rng(seed);
+			std::uniform_real_distribution<float> sizeDistribution(0.0f, maxSize);
+			std::vector<AABB> boxes(count);
+			for (size_t i = 0; i < count; i++) {
+				const Vector3 start = RandomVector(rng, range);
+				const float sizeX = sizeDistribution(rng);
+				const float sizeY = sizeDistribution(rng);
+				const float sizeZ = sizeDistribution(rng);
+				boxes[i] = AABB{ start, start + Vector3(sizeX, sizeY, sizeZ) };
+			}
+			return boxes;
+		}
+
+		inline static bool AlmostEqual(const Vector3& a, const Vector3& b) {
+			const float epsilon = 0.0001f * std::max(1.0f, std::max(std::abs(a.x), std::max(std::abs(a.y), std::abs(a.z))));
+			return std::abs(a.x - b.x) <= epsilon && std::abs(a.y - b.y) <= epsilon && std::abs(a.z - b.z) <= epsilon;
+		}
+	}
+
+	// Basic scalar checks against a known frustum
+	TEST(BoundsTest, FrustumFromMatrix) {
+		const Frustum frustum = Math::FrustumFromMatrix(TestProjection(0.1f, 100.0f));
+		auto box = [](const Vector3& center, float extents) { return AABB{ center - Vector3(extents), center + Vector3(extents) }; };
+		EXPECT_TRUE(Math::Intersects(box(Vector3(0.0f, 0.0f, 5.0f), 0.5f), frustum));
+		EXPECT_TRUE(Math::Intersects(box(Vector3(0.0f, 0.0f, 0.0f), 0.5f), frustum));
+		EXPECT_FALSE(Math::Intersects(box(Vector3(0.0f, 0.0f, -5.0f), 0.5f), frustum));
+		EXPECT_FALSE(Math::Intersects(box(Vector3(100.0f, 0.0f, 5.0f), 0.5f), frustum));
+		EXPECT_FALSE(Math::Intersects(box(Vector3(0.0f, -100.0f, 5.0f), 0.5f), frustum));
+		EXPECT_FALSE(Math::Intersects(box(Vector3(0.0f, 0.0f, 200.0f), 0.5f), frustum));
+		EXPECT_TRUE(Math::Intersects(box(Vector3(0.0f, 0.0f, 100.0f), 0.5f), frustum));
+
+		EXPECT_TRUE(Math::Intersects(Sphere{ Vector3(0.0f, 0.0f, 5.0f), 1.0f }, frustum));
+		EXPECT_TRUE(Math::Intersects(Sphere{ Vector3(0.0f, 0.0f, -0.5f), 1.0f }, frustum));
+		EXPECT_FALSE(Math::Intersects(Sphere{ Vector3(0.0f, 0.0f, -5.0f), 1.0f }, frustum));
+	}
+
+	// Basic scalar sphere/box checks
+	TEST(BoundsTest, SphereVsBox) {
+		const AABB box = { Vector3(-1.0f), Vector3(1.0f) };
+		EXPECT_TRUE(Math::Intersects(Sphere{ Vector3(0.0f), 0.1f }, box));
+		EXPECT_TRUE(Math::Intersects(Sphere{ Vector3(2.0f, 0.0f, 0.0f), 1.0f }, box));
+		EXPECT_FALSE(Math::Intersects(Sphere{ Vector3(2.5f, 0.0f, 0.0f), 1.0f }, box));
+		EXPECT_TRUE(Math::Intersects(Sphere{ Vector3(1.5f, 1.5f, 0.0f), 0.75f }, box));
+		EXPECT_FALSE(Math::Intersects(Sphere{ Vector3(1.5f, 1.5f, 1.5f), 0.75f }, box));
+		EXPECT_TRUE(Math::Intersects(Math::BoundingBox(Sphere{ Vector3(1.5f, 1.5f, 1.5f), 0.75f }), box));
+	}
+
+	// Transformed boxes should contain transformed corners
+	TEST(BoundsTest, Transform) {
+		const AABB box = { Vector3(-1.0f, 0.0f, 2.0f), Vector3(3.0f, 1.0f, 4.0f) };
+		const Matrix4 transform = glm::translate(Matrix4(1.0f), Vector3(5.0f, -2.0f, 1.0f)) * Math::MatrixFromEulerAngles(Vector3(30.0f, 45.0f, 10.0f));
+		const AABB transformed = Math::Transform(transform, box);
+		for (size_t i = 0; i < 8; i++) {
+			const Vector3 corner = Vector3(transform * Vector4(
+				((i & 1) != 0) ? box.end.x : box.start.x,
+				((i & 2) != 0) ? box.end.y : box.start.y,
+				((i & 4) != 0) ? box.end.z : box.start.z, 1.0f));
+			EXPECT_GE(corner.x, transformed.start.x - 0.0001f);
+			EXPECT_GE(corner.y, transformed.start.y - 0.0001f);
+			EXPECT_GE(corner.z, transformed.start.z - 0.0001f);
+			EXPECT_LE(corner.x, transformed.end.x + 0.0001f);
+			EXPECT_LE(corner.y, transformed.end.y + 0.0001f);
+			EXPECT_LE(corner.z, transformed.end.z + 0.0001f);
+		}
+		const AABB identity = Math::Transform(Matrix4(1.0f), box);
+		EXPECT_TRUE(AlmostEqual(identity.start, box.start));
+		EXPECT_TRUE(AlmostEqual(identity.end, box.end));
+	}
+
+	// Batch functions should produce the same results as the scalar ones (counts are intentionally not multiples of 4)
+	TEST(BoundsTest, BatchMatchesScalar) {
+		const std::vector<AABB> boxes = RandomBoxes(4099, 64.0f, 8.0f, 7);
+		std::vector<uint8_t> results(boxes.size());
+
+		const Frustum frustum = Math::FrustumFromMatrix(
+			TestProjection(0.1f, 48.0f) * Math::Inverse(Math::LookAt(Vector3(2.0f, 3.0f, -4.0f), Vector3(0.0f))));
+		size_t expectedCount = 0;
+		const size_t frustumCount = Math::Intersects(frustum, boxes.data(), boxes.size(), results.data());
+		for (size_t i = 0; i < boxes.size(); i++) {
+			const bool expected = Math::Intersects(boxes[i], frustum);
+			EXPECT_EQ(results[i] != 0, expected);
+			if (expected) expectedCount++;
+		}
+		EXPECT_EQ(frustumCount, expectedCount);
+		EXPECT_GT(frustumCount, 0u);
+		EXPECT_LT(frustumCount, boxes.size());
+
+		std::mt19937 rng(11);
+		std::uniform_real_distribution<float> radiusDistribution(0.0f, 4.0f);
+		std::vector<Sphere> spheres(2051);
+		for (size_t i = 0; i < spheres.size(); i++) {
+			const Vector3 center = RandomVector(rng, 16.0f);
+			spheres[i] = Sphere{ center, radiusDistribution(rng) };
+		}
+		const AABB box = { Vector3(-4.0f, -2.0f, -3.0f), Vector3(5.0f, 1.0f, 2.0f) };
+		expectedCount = 0;
+		const size_t sphereCount = Math::Intersects(box, spheres.data(), spheres.size(), results.data());
+		for (size_t i = 0; i < spheres.size(); i++) {
+			const bool expected = Math::Intersects(spheres[i], box);
+			EXPECT_EQ(results[i] != 0, expected);
+			if (expected) expectedCount++;
+		}
+		EXPECT_EQ(sphereCount, expectedCount);
+		EXPECT_GT(sphereCount, 0u);
+		EXPECT_LT(sphereCount, spheres.size());
+
+		const Matrix4 transform = glm::translate(Matrix4(1.0f), Vector3(-3.0f, 8.0f, 1.0f)) * Math::MatrixFromEulerAngles(Vector3(15.0f, -60.0f, 120.0f));
+		std::vector<AABB> transformed(boxes.size());
+		Math::Transform(transform, boxes.data(), boxes.size(), transformed.data());
+		for (size_t i = 0; i < boxes.size(); i++) {
+			const AABB expected = Math::Transform(transform, boxes[i]);
+			EXPECT_TRUE(AlmostEqual(transformed[i].start, expected.start));
+			EXPECT_TRUE(AlmostEqual(transformed[i].end, expected.end));
+		}
+
+		// In-place transformation is allowed:
+		transformed = boxes;
+		Math::Transform(transform, transformed.data(), transformed.size(), transformed.data());
+		for (size_t i = 0; i < boxes.size(); i++) {
+			const AABB expected = Math::Transform(transform, boxes[i]);
+			EXPECT_TRUE(AlmostEqual(transformed[i].start, expected.start));
+			EXPECT_TRUE(AlmostEqual(transformed[i].end, expected.end));
+		}
+	}
+
+	// Measures culling throughput for a million boxes (batch vs scalar)
+	TEST(BoundsTest, Performance) {
+		Reference<OS::StreamLogger> logger(Object::Instantiate<OS::StreamLogger>());
+		const std::vector<AABB> boxes = RandomBoxes(1000000, 256.0f, 4.0f, 13);
+		std::vector<uint8_t> results(boxes.size());
+		std::vector<AABB> transformed(boxes.size());
+		const Frustum frustum = Math::FrustumFromMatrix(TestProjection(0.1f, 128.0f));
+		const Matrix4 transform = Math::MatrixFromEulerAngles(Vector3(10.0f, 20.0f, 30.0f));
+
+		Stopwatch stopwatch;
+		size_t scalarCount = 0;
+		for (size_t i = 0; i < boxes.size(); i++) {
+			const bool intersects = Math::Intersects(boxes[i], frustum);
+			results[i] = intersects ? 1 : 0;
+			if (intersects) scalarCount++;
+		}
+		const float scalarFrustumTime = stopwatch.Reset();
+
+		const size_t batchCount = Math::Intersects(frustum, boxes.data(), boxes.size(), results.data());
+		const float batchFrustumTime = stopwatch.Reset();
+		EXPECT_EQ(scalarCount, batchCount);
+
+		for (size_t i = 0; i < boxes.size(); i++)
+			transformed[i] = Math::Transform(transform, boxes[i]);
+		const float scalarTransformTime = stopwatch.Reset();
+
+		Math::Transform(transform, boxes.data(), boxes.size(), transformed.data());
+		const float batchTransformTime = stopwatch.Reset();
+
+		logger->Info("BoundsTest::Performance - ", boxes.size(), " boxes; ", batchCount, " visible\n"
+			"    AABB vs frustum: scalar - ", scalarFrustumTime * 1000.0f, "ms; batch - ", batchFrustumTime * 1000.0f, "ms\n"
+			"    AABB transform:  scalar - ", scalarTransformTime * 1000.0f, "ms; batch - ", batchTransformTime * 1000.0f, "ms");
+	}
+}
@@ -1,10 +1,30 @@
 #include "AppInformation.h"
+#include <cstdlib>
 
 
 namespace Jimara {
 	namespace Application {
+		namespace {
+			inline static std::string ReadEnvironmentVariable(const char* name) {
+#ifdef _WIN32
+				char* value = nullptr;
+				size_t length = 0;
+				if (_dupenv_s(&value, &length, name) != 0 || value == nullptr) return "";
+				const std::string result(value);
+				free(value);
+				return result;
+#else
+				const char* value = std::getenv(name);
+				return (value == nullptr) ? "" : std::string(value);
+#endif
+			}
+		}
+
 		AppInformation::AppInformation(const std::string& appName, const AppVersion& appVersion) 
-			: m_appName(appName), m_appVersion(appVersion) {}
+			: AppInformation(appName, appVersion, DefaultCacheDirectory(appName)) {}
+
+		AppInformation::AppInformation(const std::string& appName, const AppVersion& appVersion, const std::string& cacheDirectory)
+			: m_appName(appName), m_appVersion(appVersion), m_cacheDirectory(cacheDirectory) {}
 
 		const char* AppInformation::ApplicationName()const {
 			return m_appName.c_str();
@@ -14,6 +34,24 @@ namespace Jimara {
 			return m_appVersion;
 		}
 
+		const std::string& AppInformation::CacheDirectory()const {
+			return m_cacheDirectory;
+		}
+
+		std::string AppInformation::DefaultCacheDirectory(const std::string& appName) {
+#ifdef _WIN32
+			std::string root = ReadEnvironmentVariable("LOCALAPPDATA");
+#else
+			std::string root = ReadEnvironmentVariable("XDG_CACHE_HOME");
+			if (root.size() <= 0) {
+				const std::string home = ReadEnvironmentVariable("HOME");
+				if (home.size() > 0) root = home + "/.cache";
+			}
+#endif
+			if (root.size() <= 0) return "";
+			return root + "/" + EngineName() + "/" + appName;
+		}
+
 		const char* AppInformation::EngineName() {
 			static const char ENGINE_NAME[] = "Jimara";
 			return ENGINE_NAME;
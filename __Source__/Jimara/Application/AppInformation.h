@@ -11,18 +11,37 @@ namespace Jimara {
 		class AppInformation : public virtual Object {
 		public:
 			/// <summary>
-			/// Constructor
+			/// Constructor (on-disk caches go to DefaultCacheDirectory(appName))
 			/// </summary>
 			/// <param name="appName"> Application name </param>
 			/// <param name="appVersion"> Application version </param>
 			AppInformation(const std::string& appName, const AppVersion& appVersion);
 
+			/// <summary>
+			/// Constructor
+			/// </summary>
+			/// <param name="appName"> Application name </param>
+			/// <param name="appVersion"> Application version </param>
+			/// <param name="cacheDirectory"> Directory for the engine's on-disk caches, like the pipeline cache (empty string disables those) </param>
+			AppInformation(const std::string& appName, const AppVersion& appVersion, const std::string& cacheDirectory);
+
 			/// <summary> Application name </summary>
 			const char* ApplicationName()const;
 
 			/// <summary> Application version </summary>
 			const AppVersion ApplicationVersion()const;
 
+			/// <summary> Directory for the engine's on-disk caches (empty, if those are disabled) </summary>
+			const std::string& CacheDirectory()const;
+
+			/// <summary>
+			/// Default cache directory for an application 
+			/// (per-user cache location: %LOCALAPPDATA% on Windows, $XDG_CACHE_HOME or ~/.cache elsewhere; empty, if none of those is known)
+			/// </summary>
+			/// <param name="appName"> Application name </param>
+			/// <returns> Cache directory </returns>
+			static std::string DefaultCacheDirectory(const std::string& appName);
+
 			/// <summary> Engine name </summary>
 			static const char* EngineName();
 
@@ -35,6 +54,9 @@ namespace Jimara {
 
 			// Application version
 			const AppVersion m_appVersion;
+
+			// Directory for on-disk caches
+			const std::string m_cacheDirectory;
 		};
 	}
 }
@@ -1,10 +1,68 @@
 #include "DirectionalLight.h"
 #include "../Transform.h"
+#include "../../Environment/GraphicsContext/Lights/ShadowAtlas.h"
+#include <algorithm>
 #include <limits>
 
 
 namespace Jimara {
 	namespace {
+		// Number of shadow cascades per light:
+		static const uint32_t CASCADE_COUNT = 3;
+
+		// Blend factor between logarithmic and uniform cascade splits (1 is fully logarithmic):
+		static const float CASCADE_SPLIT_LAMBDA = 0.5f;
+
+		// Shadow casters behind the cascade bounding sphere are captured up to this many radii away:
+		static const float CASCADE_DEPTH_EXTENSION = 4.0f;
+
+		// Orthographic view-projection along the light direction, that covers the sphere (snapped to texels, so that the maps do not shimmer when the viewer moves)
+		inline static Matrix4 CascadeTransform(const Vector3& direction, const Vector3& center, float radius) {
+			const Vector3 forward = Math::Normalize(direction);
+			const Vector3 right = Math::Normalize(Math::Cross((std::abs(forward.y) < 0.99f) ? Vector3(0.0f, 1.0f, 0.0f) : Vector3(1.0f, 0.0f, 0.0f), forward));
+			const Vector3 up = Math::Cross(forward, right);
+
+			const float texelSize = (2.0f * radius) / static_cast<float>(ShadowAtlas::RESOLUTION);
+			const float x = std::floor(Math::Dot(right, center) / texelSize) * texelSize;
+			const float y = std::floor(Math::Dot(up, center) / texelSize) * texelSize;
+			const float z = Math::Dot(forward, center);
+
+			const float depthStart = -(CASCADE_DEPTH_EXTENSION * radius);
+			const float depthRange = (radius - depthStart);
+			Matrix4 transform(1.0f);
+			for (int i = 0; i < 3; i++) {
+				transform[i][0] = (right[i] / radius);
+				transform[i][1] = (up[i] / radius);
+				transform[i][2] = (forward[i] / depthRange);
+			}
+			transform[3][0] = (-x / radius);
+			transform[3][1] = (-y / radius);
+			transform[3][2] = ((-z - depthStart) / depthRange);
+			return transform;
+		}
+
+		// Bounding sphere of the viewer frustum slice between the given view distances
+		inline static void ViewerSlice(const Vector3* nearCorners, const Vector3* farCorners, float nearPlane, float farPlane, float start, float end, Vector3& center, float& radius) {
+			Vector3 corners[8];
+			const float startT = (start - nearPlane) / (farPlane - nearPlane);
+			const float endT = (end - nearPlane) / (farPlane - nearPlane);
+			center = Vector3(0.0f);
+			for (size_t i = 0; i < 4; i++) {
+				const Vector3 delta = (farCorners[i] - nearCorners[i]);
+				corners[i] = nearCorners[i] + (delta * startT);
+				corners[i + 4] = nearCorners[i] + (delta * endT);
+				center += corners[i] + corners[i + 4];
+			}
+			center /= 8.0f;
+			radius = 0.0f;
+			for (size_t i = 0; i < 8; i++) {
+				const Vector3 delta = (corners[i] - center);
+				radius = std::max(radius, std::sqrt(Math::Dot(delta, delta)));
+			}
+			// Radius is rounded up to keep the texel size stable:
+			radius = std::ceil(radius * 16.0f) / 16.0f;
+		}
+
 		class DirectionalLightDescriptor : public virtual LightDescriptor, public virtual GraphicsContext::GraphicsObjectSynchronizer {
 		public:
 			const DirectionalLight* m_owner;
@@ -12,27 +70,95 @@ namespace Jimara {
 		private:
 			struct Data {
 				alignas(16) Vector3 direction;
+				uint32_t shadowViewId;
 				alignas(16) Vector3 color;
+				uint32_t shadowViewCount;
 			} m_data;
 
+			const Reference<ShadowAtlas> m_shadowAtlas;
+
 			LightInfo m_info;
 
+			uint64_t m_revision;
+
+			void UpdateShadows() {
+				// Views get allocated and freed as the owner toggles the shadows:
+				const bool castsShadows = (m_owner != nullptr) && m_owner->CastsShadows();
+				if (castsShadows != (m_data.shadowViewId != ShadowAtlas::NO_VIEW)) {
+					if (castsShadows) {
+						m_data.shadowViewId = m_shadowAtlas->AllocateViews(CASCADE_COUNT);
+						m_data.shadowViewCount = (m_data.shadowViewId == ShadowAtlas::NO_VIEW) ? 0 : CASCADE_COUNT;
+					}
+					else {
+						m_shadowAtlas->FreeViews(m_data.shadowViewId, CASCADE_COUNT);
+						m_data.shadowViewId = ShadowAtlas::NO_VIEW;
+						m_data.shadowViewCount = 0;
+					}
+					m_revision++;
+				}
+				if (m_data.shadowViewId == ShadowAtlas::NO_VIEW) return;
+
+				// Cascades split the viewer frustum (or a sphere around the origin, if there's no viewer):
+				const float shadowDistance = std::max(m_owner->ShadowDistance(), std::numeric_limits<float>::epsilon());
+				const ShadowAtlas::Viewer viewer = m_shadowAtlas->GetViewer();
+				const bool hasViewer = (viewer.farPlane > viewer.nearPlane) && (viewer.nearPlane > 0.0f);
+				const float nearPlane = hasViewer ? viewer.nearPlane : 0.0f;
+				const float farPlane = hasViewer ? std::min(viewer.farPlane, viewer.nearPlane + shadowDistance) : shadowDistance;
+				Vector3 nearCorners[4];
+				Vector3 farCorners[4];
+				if (hasViewer) {
+					const Matrix4 inverseViewProjection = Math::Inverse(viewer.viewProjection);
+					for (size_t i = 0; i < 4; i++) {
+						const Vector2 ndc(((i & 1) != 0) ? 1.0f : -1.0f, ((i & 2) != 0) ? 1.0f : -1.0f);
+						const Vector4 nearCorner = inverseViewProjection * Vector4(ndc.x, ndc.y, 0.0f, 1.0f);
+						const Vector4 farCorner = inverseViewProjection * Vector4(ndc.x, ndc.y, 1.0f, 1.0f);
+						nearCorners[i] = Vector3(nearCorner) / nearCorner.w;
+						farCorners[i] = Vector3(farCorner) / farCorner.w;
+					}
+				}
+
+				float sliceStart = nearPlane;
+				for (uint32_t i = 0; i < CASCADE_COUNT; i++) {
+					const float fraction = static_cast<float>(i + 1) / static_cast<float>(CASCADE_COUNT);
+					const float uniformSplit = nearPlane + ((farPlane - nearPlane) * fraction);
+					const float logSplit = (nearPlane > 0.0f) ? (nearPlane * std::pow(farPlane / nearPlane, fraction)) : uniformSplit;
+					const float sliceEnd = (CASCADE_SPLIT_LAMBDA * logSplit) + ((1.0f - CASCADE_SPLIT_LAMBDA) * uniformSplit);
+					Vector3 center(0.0f);
+					float radius = sliceEnd;
+					if (hasViewer) ViewerSlice(nearCorners, farCorners, viewer.nearPlane, viewer.farPlane, sliceStart, sliceEnd, center, radius);
+					if (radius > 0.0f)
+						m_shadowAtlas->SetViewTransform(m_data.shadowViewId + i, CascadeTransform(m_data.direction, center, radius));
+					sliceStart = sliceEnd;
+				}
+			}
+
 			void UpdateData() {
 				if (m_owner == nullptr) return;
 				const Transform* transform = m_owner->GetTransfrom();
-				if (transform == nullptr) m_data.direction = Vector3(0.0f, -1.0f, 0.0f);
-				else m_data.direction = transform->Forward();
-				m_data.color = m_owner->Color();
+				const Vector3 direction = (transform == nullptr) ? Vector3(0.0f, -1.0f, 0.0f) : transform->Forward();
+				const Vector3 color = m_owner->Color();
+				if (m_data.direction != direction || m_data.color != color) {
+					m_data.direction = direction;
+					m_data.color = color;
+					m_revision++;
+				}
+				UpdateShadows();
 			}
 
 		public:
-			inline DirectionalLightDescriptor(const DirectionalLight* owner, uint32_t typeId) : m_owner(owner), m_info{} {
+			inline DirectionalLightDescriptor(const DirectionalLight* owner, uint32_t typeId)
+				: m_owner(owner), m_data{}, m_shadowAtlas(ShadowAtlas::Instance(owner->Context()->Graphics())), m_info{}, m_revision(0) {
+				m_data.shadowViewId = ShadowAtlas::NO_VIEW;
 				UpdateData();
 				m_info.typeId = typeId;
 				m_info.data = &m_data;
 				m_info.dataSize = sizeof(Data);
 			}
 
+			inline virtual ~DirectionalLightDescriptor() {
+				m_shadowAtlas->FreeViews(m_data.shadowViewId, CASCADE_COUNT);
+			}
+
 			virtual LightInfo GetLightInfo()const override { return m_info; }
 
 			virtual AABB GetLightBounds()const override {
@@ -46,12 +172,16 @@ namespace Jimara {
 				return BOUNDS;
 			}
 
+			virtual float GetLightIntensity()const override { return std::max(m_data.color.x, std::max(m_data.color.y, m_data.color.z)); }
+
+			virtual uint64_t Revision()const override { return m_revision; }
+
 			virtual void OnGraphicsSynch() override { UpdateData(); }
 		};
 	}
 
 	DirectionalLight::DirectionalLight(Component* parent, const std::string& name, Vector3 color)
-		: Component(parent, name), m_color(color) {
+		: Component(parent, name), m_color(color), m_castsShadows(false), m_shadowDistance(64.0f) {
 		uint32_t typeId;
 		if (Context()->Graphics()->GetLightTypeId("Jimara_DirectionalLight", typeId))
 			m_lightDescriptor = Object::Instantiate<DirectionalLightDescriptor>(this, typeId);
@@ -61,7 +191,7 @@ namespace Jimara {
 
 	DirectionalLight::~DirectionalLight() {
 		OnDestroyed() -= Callback<Component*>(&DirectionalLight::RemoveWhenDestroyed, this);
-		RemoveWhenDestroyed(this); 
+		RemoveWhenDestroyed(this);
 	}
 
 
@@ -69,6 +199,16 @@ namespace Jimara {
 
 	void DirectionalLight::SetColor(Vector3 color) { m_color = color; }
 
+
+	bool DirectionalLight::CastsShadows()const { return m_castsShadows; }
+
+	void DirectionalLight::CastShadows(bool castShadows) { m_castsShadows = castShadows; }
+
+	float DirectionalLight::ShadowDistance()const { return m_shadowDistance; }
+
+	void DirectionalLight::SetShadowDistance(float distance) { m_shadowDistance = distance <= 0.0f ? 0.0f : distance; }
+
+
 	void DirectionalLight::RemoveWhenDestroyed(Component*) {
 		if (m_lightDescriptor != nullptr) {
 			Context()->Graphics()->RemoveSceneLightDescriptor(m_lightDescriptor);
@@ -29,11 +29,35 @@ namespace Jimara {
 		/// <param name="color"> New color </param>
 		void SetColor(Vector3 color);
 
+		/// <summary> True, if the light casts shadows (shadow maps are rendered by ShadowAtlas as cascades, fit to the ShadowAtlas viewer) </summary>
+		bool CastsShadows()const;
+
+		/// <summary>
+		/// Enables or disables shadows
+		/// </summary>
+		/// <param name="castShadows"> If true, the light will cast shadows </param>
+		void CastShadows(bool castShadows);
+
+		/// <summary> Distance from the viewer, the shadow cascades reach up to </summary>
+		float ShadowDistance()const;
+
+		/// <summary>
+		/// Sets the distance from the viewer, the shadow cascades reach up to
+		/// </summary>
+		/// <param name="distance"> Shadow distance </param>
+		void SetShadowDistance(float distance);
+
 
 	private:
 		// Light color
 		Vector3 m_color;
 
+		// True, if the light casts shadows
+		bool m_castsShadows;
+
+		// Distance, the shadow cascades reach up to
+		float m_shadowDistance;
+
 		// Underlying graphics descriptor
 		Reference<LightDescriptor> m_lightDescriptor;
 
@@ -1,9 +1,43 @@
 #include "PointLight.h"
 #include "../Transform.h"
+#include "../../Environment/GraphicsContext/Lights/ShadowAtlas.h"
+#include <algorithm>
 
 
 namespace Jimara {
 	namespace {
+		// Number of shadow views per light (cube faces):
+		static const uint32_t FACE_COUNT = 6;
+
+		// Near plane of the shadow views, relative to the light radius:
+		static const float SHADOW_NEAR_PLANE_SCALE = 0.05f;
+
+		// 90 degree perspective view-projection from the light position towards the cube face (+X, -X, +Y, -Y, +Z, -Z; clip space depth range is [0; 1])
+		inline static Matrix4 FaceTransform(uint32_t face, const Vector3& position, float nearPlane, float farPlane) {
+			static const Vector3 FORWARD[FACE_COUNT] = {
+				Vector3(1.0f, 0.0f, 0.0f), Vector3(-1.0f, 0.0f, 0.0f),
+				Vector3(0.0f, 1.0f, 0.0f), Vector3(0.0f, -1.0f, 0.0f),
+				Vector3(0.0f, 0.0f, 1.0f), Vector3(0.0f, 0.0f, -1.0f)
+			};
+			const Vector3 forward = FORWARD[face];
+			const Vector3 up = (face == 2 || face == 3) ? Vector3(0.0f, 0.0f, 1.0f) : Vector3(0.0f, 1.0f, 0.0f);
+			const Vector3 right = Math::Cross(up, forward);
+			const float depthScale = farPlane / (farPlane - nearPlane);
+			const float depthOffset = -(farPlane * nearPlane) / (farPlane - nearPlane);
+			Matrix4 transform(0.0f);
+			for (int i = 0; i < 3; i++) {
+				transform[i][0] = right[i];
+				transform[i][1] = up[i];
+				transform[i][2] = (forward[i] * depthScale);
+				transform[i][3] = forward[i];
+			}
+			transform[3][0] = -Math::Dot(right, position);
+			transform[3][1] = -Math::Dot(up, position);
+			transform[3][2] = (-Math::Dot(forward, position) * depthScale) + depthOffset;
+			transform[3][3] = -Math::Dot(forward, position);
+			return transform;
+		}
+
 		class PointLightDescriptor : public virtual LightDescriptor, public virtual GraphicsContext::GraphicsObjectSynchronizer {
 		public:
 			const PointLight* m_owner;
@@ -11,30 +45,64 @@ namespace Jimara {
 		private:
 			struct Data {
 				alignas(16) Vector3 position;
+				uint32_t shadowViewId;
 				alignas(16) Vector3 color;
 			} m_data;
 
 			float m_radius;
 
+			const Reference<ShadowAtlas> m_shadowAtlas;
+
 			LightInfo m_info;
 
+			uint64_t m_revision;
+
 			void UpdateData() {
 				if (m_owner == nullptr) return;
 				const Transform* transform = m_owner->GetTransfrom();
-				if (transform == nullptr) m_data.position = Vector3(0.0f, 0.0f, 0.0f);
-				else m_data.position = transform->WorldPosition();
-				m_data.color = m_owner->Color();
-				m_radius = m_owner->Radius();
+				const Vector3 position = (transform == nullptr) ? Vector3(0.0f, 0.0f, 0.0f) : transform->WorldPosition();
+				const Vector3 color = m_owner->Color();
+				const float radius = m_owner->Radius();
+				if (m_data.position != position || m_data.color != color || m_radius != radius) {
+					m_data.position = position;
+					m_data.color = color;
+					m_radius = radius;
+					m_revision++;
+				}
+				UpdateShadows();
+			}
+
+			void UpdateShadows() {
+				// Views get allocated and freed as the owner toggles the shadows:
+				const bool castsShadows = (m_owner != nullptr) && m_owner->CastsShadows();
+				if (castsShadows != (m_data.shadowViewId != ShadowAtlas::NO_VIEW)) {
+					if (castsShadows) m_data.shadowViewId = m_shadowAtlas->AllocateViews(FACE_COUNT);
+					else {
+						m_shadowAtlas->FreeViews(m_data.shadowViewId, FACE_COUNT);
+						m_data.shadowViewId = ShadowAtlas::NO_VIEW;
+					}
+					m_revision++;
+				}
+				if (m_data.shadowViewId == ShadowAtlas::NO_VIEW || m_radius <= 0.0f) return;
+				const float nearPlane = (m_radius * SHADOW_NEAR_PLANE_SCALE);
+				for (uint32_t i = 0; i < FACE_COUNT; i++)
+					m_shadowAtlas->SetViewTransform(m_data.shadowViewId + i, FaceTransform(i, m_data.position, nearPlane, m_radius));
 			}
 
 		public:
-			inline PointLightDescriptor(const PointLight* owner, uint32_t typeId) : m_owner(owner), m_info{} {
+			inline PointLightDescriptor(const PointLight* owner, uint32_t typeId) 
+				: m_owner(owner), m_data{}, m_radius(0.0f), m_shadowAtlas(ShadowAtlas::Instance(owner->Context()->Graphics())), m_info{}, m_revision(0) {
+				m_data.shadowViewId = ShadowAtlas::NO_VIEW;
 				UpdateData();
 				m_info.typeId = typeId;
 				m_info.data = &m_data;
 				m_info.dataSize = sizeof(Data);
 			}
 
+			inline virtual ~PointLightDescriptor() {
+				m_shadowAtlas->FreeViews(m_data.shadowViewId, FACE_COUNT);
+			}
+
 			virtual LightInfo GetLightInfo()const override { return m_info; }
 
 			virtual AABB GetLightBounds()const override {
@@ -44,12 +112,16 @@ namespace Jimara {
 				return bounds;
 			}
 
+			virtual float GetLightIntensity()const override { return std::max(m_data.color.x, std::max(m_data.color.y, m_data.color.z)); }
+
+			virtual uint64_t Revision()const override { return m_revision; }
+
 			virtual void OnGraphicsSynch() override { UpdateData(); }
 		};
 	}
 
 	PointLight::PointLight(Component* parent, const std::string& name, Vector3 color, float radius)
-		: Component(parent, name), m_color(color), m_radius(radius) {
+		: Component(parent, name), m_color(color), m_radius(radius), m_castsShadows(false) {
 		uint32_t typeId;
 		if (Context()->Graphics()->GetLightTypeId("Jimara_PointLight", typeId))
 			m_lightDescriptor = Object::Instantiate<PointLightDescriptor>(this, typeId);
@@ -73,6 +145,11 @@ namespace Jimara {
 	void PointLight::SetRadius(float radius) { m_radius = radius <= 0.0f ? 0.0f : radius; }
 
 
+	bool PointLight::CastsShadows()const { return m_castsShadows; }
+
+	void PointLight::CastShadows(bool castShadows) { m_castsShadows = castShadows; }
+
+
 	void PointLight::RemoveWhenDestroyed(Component*) {
 		if (m_lightDescriptor != nullptr) {
 			Context()->Graphics()->RemoveSceneLightDescriptor(m_lightDescriptor);
@@ -39,6 +39,15 @@ namespace Jimara {
 		/// <param name="radius"> New radius </param>
 		void SetRadius(float radius);
 
+		/// <summary> True, if the light casts shadows (shadow maps are rendered by ShadowAtlas as 6 cube faces) </summary>
+		bool CastsShadows()const;
+
+		/// <summary>
+		/// Enables or disables shadows
+		/// </summary>
+		/// <param name="castShadows"> If true, the light will cast shadows </param>
+		void CastShadows(bool castShadows);
+
 
 	private:
 		// Light color
@@ -47,6 +56,9 @@ namespace Jimara {
 		// Light area radius
 		float m_radius;
 
+		// True, if the light casts shadows
+		bool m_castsShadows;
+
 		// Underlying graphics descriptor
 		Reference<LightDescriptor> m_lightDescriptor;
 
@@ -1,5 +1,8 @@
 #include "MeshRenderer.h"
 #include "../Graphics/Data/GraphicsPipelineSet.h"
+#include "../Environment/GraphicsContext/Lights/ShadowCasterDescriptor.h"
+#include "../Environment/GraphicsContext/Lights/ObjectLightSelector.h"
+#include <limits>
 
 namespace Jimara {
 	namespace {
@@ -51,6 +54,8 @@ namespace Jimara {
 		class MeshRenderPipelineDescriptor 
 			: public virtual ObjectCache<InstancedBatchDesc>::StoredObject
 			, public virtual Graphics::GraphicsPipeline::Descriptor
+			, public virtual ShadowCasterDescriptor
+			, public virtual ObjectLightSelector::Client
 			, public virtual GraphicsContext::GraphicsObjectSynchronizer {
 		private:
 			const InstancedBatchDesc m_desc;
@@ -61,24 +66,39 @@ namespace Jimara {
 				const Reference<const Material> m_material;
 				Reference<Graphics::Shader> m_vertexShader;
 				Reference<Graphics::Shader> m_fragmentShader;
+				Reference<Graphics::Shader> m_shadowCasterVertexShader;
+				Reference<Graphics::Shader> m_shadowCasterFragmentShader;
 				std::vector<Reference<Graphics::Buffer>> m_constantBuffers;
 				std::vector<Reference<Graphics::ArrayBuffer>> m_structuredBuffers;
 				std::vector<Reference<Graphics::TextureSampler>> m_textureSamplers;
+				size_t m_revision;
+
+				template<typename ResourceType, typename GetResource>
+				inline static bool Capture(std::vector<Reference<ResourceType>>& resources, const GetResource& getResource) {
+					bool changed = false;
+					for (size_t i = 0; i < resources.size(); i++) {
+						Reference<ResourceType> resource = getResource(i);
+						if (resources[i] == resource) continue;
+						resources[i] = resource;
+						changed = true;
+					}
+					return changed;
+				}
 
 			public:
 				inline void Update() {
 					m_vertexShader = m_material->VertexShader();
 					m_fragmentShader = m_material->FragmentShader();
-					for (size_t i = 0; i < m_constantBuffers.size(); i++)
-						m_constantBuffers[i] = m_material->ConstantBuffer(i);
-					for (size_t i = 0; i < m_structuredBuffers.size(); i++)
-						m_structuredBuffers[i] = m_material->StructuredBuffer(i);
-					for (size_t i = 0; i < m_textureSamplers.size(); i++)
-						m_textureSamplers[i] = m_material->Sampler(i);
+					m_shadowCasterVertexShader = m_material->ShadowCasterVertexShader();
+					m_shadowCasterFragmentShader = m_material->ShadowCasterFragmentShader();
+					bool changed = Capture(m_constantBuffers, [&](size_t i) { return m_material->ConstantBuffer(i); });
+					changed |= Capture(m_structuredBuffers, [&](size_t i) { return m_material->StructuredBuffer(i); });
+					changed |= Capture(m_textureSamplers, [&](size_t i) { return m_material->Sampler(i); });
+					if (changed) m_revision++;
 				}
 
 				inline CapturedMaterial(const Material* material)
-					: m_material(material) {
+					: m_material(material), m_revision(1) {
 					m_constantBuffers.resize(m_material->ConstantBufferCount());
 					m_structuredBuffers.resize(m_material->StructuredBufferCount());
 					m_textureSamplers.resize(m_material->TextureSamplerCount());
@@ -87,6 +107,8 @@ namespace Jimara {
 
 				inline Graphics::Shader* VertexShader()const { return m_vertexShader; }
 				inline Graphics::Shader* FragmentShader()const { return m_fragmentShader; }
+				inline Graphics::Shader* ShadowCasterVertexShader()const { return m_shadowCasterVertexShader; }
+				inline Graphics::Shader* ShadowCasterFragmentShader()const { return m_shadowCasterFragmentShader; }
 
 				inline virtual bool SetByEnvironment()const override { return m_material->SetByEnvironment(); }
 
@@ -101,27 +123,43 @@ namespace Jimara {
 				inline virtual size_t TextureSamplerCount()const override { return m_textureSamplers.size(); }
 				inline virtual BindingInfo TextureSamplerInfo(size_t index)const override { return m_material->TextureSamplerInfo(index); }
 				inline virtual Reference<Graphics::TextureSampler> Sampler(size_t index)const override { return m_textureSamplers[index]; }
+
+				inline virtual size_t Revision()const override { return m_revision; }
 			} m_capturedMaterial;
 
 			// Mesh data:
 			class MeshBuffers : public virtual Graphics::VertexBuffer {
 			private:
+				const Reference<const TriMesh> m_mesh;
 				const Reference<Graphics::GraphicsMesh> m_graphicsMesh;
 				Graphics::ArrayBufferReference<MeshVertex> m_vertices;
 				Graphics::ArrayBufferReference<uint32_t> m_indices;
+				AABB m_bounds;
 				std::atomic<bool> m_dirty;
 
 				inline void OnMeshDirty(Graphics::GraphicsMesh*) { m_dirty = true; }
 
 			public:
-				inline void Update() {
-					if (!m_dirty) return;
+				inline bool Update() {
+					if (!m_dirty) return false;
 					m_graphicsMesh->GetBuffers(m_vertices, m_indices);
+					{
+						static const float inf = std::numeric_limits<float>::infinity();
+						m_bounds.start = Vector3(inf, inf, inf);
+						m_bounds.end = Vector3(-inf, -inf, -inf);
+						TriMesh::Reader reader(m_mesh);
+						for (size_t i = 0; i < reader.VertCount(); i++) {
+							const Vector3 position = reader.Vert(i).position;
+							m_bounds.start = Vector3(std::min(m_bounds.start.x, position.x), std::min(m_bounds.start.y, position.y), std::min(m_bounds.start.z, position.z));
+							m_bounds.end = Vector3(std::max(m_bounds.end.x, position.x), std::max(m_bounds.end.y, position.y), std::max(m_bounds.end.z, position.z));
+						}
+					}
 					m_dirty = false;
+					return true;
 				}
 
 				inline MeshBuffers(PipelineDescriptor* pipeline, const InstancedBatchDesc& desc)
-					: m_graphicsMesh(desc.context->MeshCache()->GetMesh(desc.mesh, false)), m_dirty(true) {
+					: m_mesh(desc.mesh), m_graphicsMesh(desc.context->MeshCache()->GetMesh(desc.mesh, false)), m_bounds{}, m_dirty(true) {
 					m_graphicsMesh->GetBuffers(m_vertices, m_indices);
 					m_graphicsMesh->OnInvalidate() += Callback<Graphics::GraphicsMesh*>(&MeshBuffers::OnMeshDirty, this);
 					Update();
@@ -147,6 +185,8 @@ namespace Jimara {
 				inline virtual Reference<Graphics::ArrayBuffer> Buffer() override { return m_vertices; }
 
 				inline Graphics::ArrayBufferReference<uint32_t> IndexBuffer()const { return m_indices; }
+
+				inline const AABB& Bounds()const { return m_bounds; }
 			} m_meshBuffers;
 
 			// Instancing data:
@@ -164,35 +204,45 @@ namespace Jimara {
 
 
 			public:
-				inline void Update() {
-					if ((!m_dirty) && m_isStatic) return;
+				inline bool Update() {
+					if ((!m_dirty) && m_isStatic) return false;
 					std::unique_lock<std::mutex> lock(m_transformLock);
+					bool changed = (m_instanceCount != m_transforms.size());
 					m_instanceCount = m_transforms.size();
 
-					bool bufferDirty = (m_buffer == nullptr || m_buffer->ObjectCount() < m_instanceCount);
-					size_t i = 0;
-					if (bufferDirty) {
+					if (m_buffer == nullptr || m_buffer->ObjectCount() < m_instanceCount) {
 						size_t count = m_instanceCount;
 						if (count <= 0) count = 1;
 						m_buffer = m_device->CreateArrayBuffer<Matrix4>(count);
-					}
-					else while (i < m_instanceCount) {
-						if (m_transforms[i]->WorldMatrix() != m_transformBufferData[i]) {
-							bufferDirty = true;
-							break;
-						}
-						else i++;
-					}
-					if (bufferDirty) {
-						while (i < m_transforms.size()) {
+						for (size_t i = 0; i < m_transforms.size(); i++)
 							m_transformBufferData[i] = m_transforms[i]->WorldMatrix();
-							i++;
-						}
 						memcpy(m_buffer.Map(), m_transformBufferData.data(), m_transforms.size() * sizeof(Matrix4));
 						m_buffer->Unmap(true);
+						changed = true;
+					}
+					else {
+						// Only the runs of changed transforms get uploaded:
+						size_t i = 0;
+						while (i < m_instanceCount) {
+							if (m_transforms[i]->WorldMatrix() == m_transformBufferData[i]) {
+								i++;
+								continue;
+							}
+							const size_t start = i;
+							changed = true;
+							while (i < m_instanceCount && m_transforms[i]->WorldMatrix() != m_transformBufferData[i]) {
+								m_transformBufferData[i] = m_transforms[i]->WorldMatrix();
+								i++;
+							}
+							Matrix4* data = m_buffer.MapRange(start, i - start);
+							if (data == nullptr) continue;
+							memcpy(data, m_transformBufferData.data() + start, (i - start) * sizeof(Matrix4));
+							m_buffer->UnmapRange(true);
+						}
 					}
 
 					m_dirty = false;
+					return changed;
 				}
 
 				inline InstanceBuffer(Graphics::GraphicsDevice* device, bool isStatic) : m_device(device), m_isStatic(isStatic), m_dirty(true), m_instanceCount(0) { Update(); }
@@ -209,6 +259,8 @@ namespace Jimara {
 
 				inline size_t InstanceCount() { return m_instanceCount; }
 
+				inline const Matrix4* Transforms()const { return m_transformBufferData.data(); }
+
 				inline size_t AddTransform(const Transform* transform) {
 					std::unique_lock<std::mutex> lock(m_transformLock);
 					if (m_transformIndices.find(transform) != m_transformIndices.end()) return m_transforms.size();
@@ -238,13 +290,111 @@ namespace Jimara {
 				}
 			} m_instanceBuffer;
 
+			// Per-instance light lists (location 7; only used, if the material's lighting model reads them):
+			class LightListBuffer : public virtual Graphics::InstanceBuffer {
+			private:
+				Graphics::GraphicsDevice* const m_device;
+				std::vector<ObjectLightSelector::LightList> m_lightLists;
+				std::vector<ObjectLightSelector::LightList> m_bufferData;
+				Graphics::ArrayBufferReference<ObjectLightSelector::LightList> m_buffer;
+
+			public:
+				inline LightListBuffer(Graphics::GraphicsDevice* device) : m_device(device) {}
+
+				inline void Update(const ObjectLightSelector* selector, const AABB* instanceBounds, size_t count) {
+					if (m_lightLists.size() < count) m_lightLists.resize(count);
+					selector->SelectLights(instanceBounds, count, m_lightLists.data());
+
+					if (m_buffer == nullptr || m_buffer->ObjectCount() < count) {
+						ObjectLightSelector::LightList emptyList;
+						for (size_t i = 0; i < ObjectLightSelector::MAX_LIGHTS_PER_OBJECT; i++)
+							emptyList.lightIds[i] = ObjectLightSelector::NO_LIGHT;
+						m_bufferData.resize(std::max(count, static_cast<size_t>(1)), emptyList);
+						for (size_t i = 0; i < count; i++)
+							m_bufferData[i] = m_lightLists[i];
+						m_buffer = m_device->CreateArrayBuffer<ObjectLightSelector::LightList>(m_bufferData.size());
+						memcpy(m_buffer.Map(), m_bufferData.data(), m_bufferData.size() * sizeof(ObjectLightSelector::LightList));
+						m_buffer->Unmap(true);
+						return;
+					}
+
+					// Just like the transforms, only the runs of changed light lists get uploaded:
+					auto listChanged = [&](size_t index) {
+						return memcmp(&m_lightLists[index], &m_bufferData[index], sizeof(ObjectLightSelector::LightList)) != 0;
+					};
+					size_t i = 0;
+					while (i < count) {
+						if (!listChanged(i)) {
+							i++;
+							continue;
+						}
+						const size_t start = i;
+						while (i < count && listChanged(i)) {
+							m_bufferData[i] = m_lightLists[i];
+							i++;
+						}
+						ObjectLightSelector::LightList* data = m_buffer.MapRange(start, i - start);
+						if (data == nullptr) continue;
+						memcpy(data, m_bufferData.data() + start, (i - start) * sizeof(ObjectLightSelector::LightList));
+						m_buffer->UnmapRange(true);
+					}
+				}
+
+				inline virtual size_t AttributeCount()const override { return 1; }
+
+				inline virtual Graphics::InstanceBuffer::AttributeInfo Attribute(size_t)const {
+					return { Graphics::InstanceBuffer::AttributeInfo::Type::UINT4, 7, 0 };
+				}
+
+				inline virtual size_t BufferElemSize()const override { return sizeof(ObjectLightSelector::LightList); }
+
+				inline virtual Reference<Graphics::ArrayBuffer> Buffer() override { return m_buffer; }
+			} m_lightListBuffer;
+
+			// Shadow caster and light selection data (m_lightSelector is nullptr, unless the material uses per-object light lists):
+			const Reference<ObjectLightSelector> m_lightSelector;
+			std::vector<AABB> m_instanceBounds;
+			AABB m_bounds;
+			uint64_t m_boundsRevision;
+
+			inline void UpdateBounds() {
+				static const float inf = std::numeric_limits<float>::infinity();
+				AABB bounds = { Vector3(inf, inf, inf), Vector3(-inf, -inf, -inf) };
+				const size_t instanceCount = m_instanceBuffer.InstanceCount();
+				const Matrix4* transforms = m_instanceBuffer.Transforms();
+				const AABB& meshBounds = m_meshBuffers.Bounds();
+				m_instanceBounds.resize(instanceCount, bounds);
+				if (meshBounds.start.x <= meshBounds.end.x)
+					for (size_t i = 0; i < instanceCount; i++) {
+						const AABB instanceBounds = Math::Transform(transforms[i], meshBounds);
+						m_instanceBounds[i] = instanceBounds;
+						bounds.start = Vector3(
+							std::min(bounds.start.x, instanceBounds.start.x), std::min(bounds.start.y, instanceBounds.start.y), std::min(bounds.start.z, instanceBounds.start.z));
+						bounds.end = Vector3(
+							std::max(bounds.end.x, instanceBounds.end.x), std::max(bounds.end.y, instanceBounds.end.y), std::max(bounds.end.z, instanceBounds.end.z));
+					}
+				m_bounds = bounds;
+				m_boundsRevision++;
+			}
+
+			inline void UpdateLights(const ObjectLightSelector* selector) {
+				if (selector == nullptr) return;
+				m_lightListBuffer.Update(selector, m_instanceBounds.data(), std::min(m_instanceBuffer.InstanceCount(), m_instanceBounds.size()));
+			}
+
 
 		public:
 			inline MeshRenderPipelineDescriptor(const InstancedBatchDesc& desc)
 				: m_desc(desc), m_environmentBinding(desc.material->EnvironmentDescriptor())
 				, m_capturedMaterial(desc.material)
 				, m_meshBuffers(this, desc)
-				, m_instanceBuffer(desc.context->Device(), desc.isStatic) {}
+				, m_instanceBuffer(desc.context->Device(), desc.isStatic)
+				, m_lightListBuffer(desc.context->Device())
+				, m_lightSelector(desc.material->UsesPerObjectLights() ? ObjectLightSelector::Instance(desc.context) : nullptr)
+				, m_bounds{}, m_boundsRevision(0) {
+				UpdateBounds();
+				UpdateLights(m_lightSelector);
+			}
 
 			/** PipelineDescriptor: */
 
@@ -264,9 +414,11 @@ namespace Jimara {
 
 			inline virtual Reference<Graphics::VertexBuffer> VertexBuffer(size_t index) override { return &m_meshBuffers; }
 
-			inline virtual size_t InstanceBufferCount() override { return 1; }
+			inline virtual size_t InstanceBufferCount() override { return (m_lightSelector != nullptr) ? 2 : 1; }
 
-			inline virtual Reference<Graphics::InstanceBuffer> InstanceBuffer(size_t index) override { return &m_instanceBuffer; }
+			inline virtual Reference<Graphics::InstanceBuffer> InstanceBuffer(size_t index) override {
+				return (index > 0) ? static_cast<Graphics::InstanceBuffer*>(&m_lightListBuffer) : static_cast<Graphics::InstanceBuffer*>(&m_instanceBuffer);
+			}
 
 			inline virtual Graphics::ArrayBufferReference<uint32_t> IndexBuffer() override { return m_meshBuffers.IndexBuffer(); }
 
@@ -275,13 +427,35 @@ namespace Jimara {
 			inline virtual size_t InstanceCount() override { return m_instanceBuffer.InstanceCount(); }
 
 
+			/** ShadowCasterDescriptor: */
+
+			inline virtual Reference<Graphics::Shader> ShadowCasterVertexShader() override { return m_capturedMaterial.ShadowCasterVertexShader(); }
+
+			inline virtual Reference<Graphics::Shader> ShadowCasterFragmentShader() override { return m_capturedMaterial.ShadowCasterFragmentShader(); }
+
+			inline virtual AABB ShadowCasterBounds() override { return m_bounds; }
+
+			inline virtual uint64_t ShadowCasterRevision() override { return m_boundsRevision; }
+
+
 			/** GraphicsContext::GraphicsObjectSynchronizer: */
 
 			virtual inline void OnGraphicsSynch() override {
 				WriteLock lock(this);
 				m_capturedMaterial.Update();
-				m_meshBuffers.Update();
-				m_instanceBuffer.Update();
+				const bool meshChanged = m_meshBuffers.Update();
+				const bool instancesChanged = m_instanceBuffer.Update();
+				if (meshChanged || instancesChanged) {
+					UpdateBounds();
+					UpdateLights(m_lightSelector);
+				}
+			}
+
+			/** ObjectLightSelector::Client: */
+
+			virtual inline void OnLightsChanged(const ObjectLightSelector* selector) override {
+				WriteLock lock(this);
+				UpdateLights(selector);
 			}
 
 			/** Writer */
@@ -294,14 +468,18 @@ namespace Jimara {
 
 				void AddTransform(const Transform* transform) {
 					if (transform == nullptr) return;
-					if (m_desc->m_instanceBuffer.AddTransform(transform) == 1)
+					if (m_desc->m_instanceBuffer.AddTransform(transform) == 1) {
 						m_desc->m_desc.context->AddSceneObjectPipeline(m_desc);
+						if (m_desc->m_lightSelector != nullptr) m_desc->m_lightSelector->AddClient(m_desc);
+					}
 				}
 
 				void RemoveTransform(const Transform* transform) {
 					if (transform == nullptr) return;
-					if (m_desc->m_instanceBuffer.RemoveTransform(transform) <= 0)
+					if (m_desc->m_instanceBuffer.RemoveTransform(transform) <= 0) {
 						m_desc->m_desc.context->RemoveSceneObjectPipeline(m_desc);
+						if (m_desc->m_lightSelector != nullptr) m_desc->m_lightSelector->RemoveClient(m_desc);
+					}
 				}
 			};
 
@@ -10,5 +10,14 @@ namespace Jimara {
 		virtual Reference<Graphics::Shader> VertexShader()const = 0;
 
 		virtual Reference<Graphics::Shader> FragmentShader()const = 0;
+
+		/// <summary> Vertex shader for rendering into the shadow maps (lit shader, generated for Jimara_ShadowCasterModel; nullptr means, the material does not cast shadows) </summary>
+		inline virtual Reference<Graphics::Shader> ShadowCasterVertexShader()const { return nullptr; }
+
+		/// <summary> Fragment shader for rendering into the shadow maps </summary>
+		inline virtual Reference<Graphics::Shader> ShadowCasterFragmentShader()const { return nullptr; }
+
+		/// <summary> True, if the lighting model reads the per-object light lists (uvec4 of light slots at vertex input location 7; renderers skip light selection otherwise) </summary>
+		inline virtual bool UsesPerObjectLights()const { return false; }
 	};
 }
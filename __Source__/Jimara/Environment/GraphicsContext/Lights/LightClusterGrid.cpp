@@ -0,0 +1,203 @@
+#include "LightClusterGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+namespace Jimara {
+	const Size3 LightClusterGrid::DEFAULT_CLUSTER_COUNT = Size3(16u, 9u, 24u);
+
+	namespace {
+		inline static uint32_t ClusterCell(float ndc, uint32_t count) {
+			const float cell = (ndc * 0.5f + 0.5f) * static_cast<float>(count);
+			if (cell <= 0.0f) return 0u;
+			else if (cell >= static_cast<float>(count)) return (count - 1u);
+			else return static_cast<uint32_t>(cell);
+		}
+
+		inline static uint32_t DepthSlice(float w, const LightClusterGrid::Settings& settings) {
+			if (w <= settings.nearPlane) return 0u;
+			const float slice = std::log(w / settings.nearPlane) * settings.depthSliceScale;
+			if (slice >= static_cast<float>(settings.clusterCount.z)) return (settings.clusterCount.z - 1u);
+			else return static_cast<uint32_t>(slice);
+		}
+
+		inline static void ExecuteJob(ThreadBlock& block, size_t threadCount, void* data, void(*job)(ThreadBlock::ThreadInfo, void*)) {
+			if (threadCount <= 1) {
+				ThreadBlock::ThreadInfo info;
+				{
+					info.threadCount = 1;
+					info.threadId = 0;
+				}
+				job(info, data);
+			}
+			else block.Execute(threadCount, data, Callback<ThreadBlock::ThreadInfo, void*>(job));
+		}
+	}
+
+	LightClusterGrid::LightClusterGrid(GraphicsContext* context, Size3 clusterCount)
+		: m_info(SceneLightInfo::Instance(context))
+		, m_clusterCount(std::max(clusterCount.x, 1u), std::max(clusterCount.y, 1u), std::max(clusterCount.z, 1u))
+		, m_threadCount(std::max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1)))
+		, m_currentSettings{}, m_farPlane(0.0f)
+		, m_settings(context->Device()->CreateConstantBuffer<Settings>())
+		, m_lightIndexCount(0) {
+		const size_t clusterCountTotal = (static_cast<size_t>(m_clusterCount.x) * m_clusterCount.y * m_clusterCount.z);
+		m_clusters.resize(clusterCountTotal, Cluster{ 0u, 0u });
+		m_clusterLights.resize(clusterCountTotal);
+		m_clusterBuffer = context->Device()->CreateArrayBuffer<Cluster>(clusterCountTotal);
+		m_lightIndexBuffer = context->Device()->CreateArrayBuffer<uint32_t>(1);
+		Update(Matrix4(1.0f), 0.001f, 1000.0f);
+	}
+
+	LightClusterGrid::~LightClusterGrid() {}
+
+	Size3 LightClusterGrid::ClusterCount()const { return m_clusterCount; }
+
+	void LightClusterGrid::Update(const Matrix4& viewProjection, float nearPlane, float farPlane) {
+		std::unique_lock<std::mutex> lock(m_lock);
+
+		if (nearPlane <= std::numeric_limits<float>::epsilon()) nearPlane = std::numeric_limits<float>::epsilon();
+		if (farPlane <= nearPlane) farPlane = (nearPlane * 2.0f);
+		m_currentSettings.viewProjection = viewProjection;
+		m_currentSettings.clusterCount = m_clusterCount;
+		m_currentSettings.nearPlane = nearPlane;
+		m_currentSettings.depthSliceScale = (static_cast<float>(m_clusterCount.z) / std::log(farPlane / nearPlane));
+		m_farPlane = farPlane;
+
+		m_info->ProcessLightBounds(Callback<const AABB*, size_t>(&LightClusterGrid::BinLights, this));
+
+		m_settings.Map() = m_currentSettings;
+		m_settings->Unmap(true);
+
+		memcpy(m_clusterBuffer->Map(), m_clusters.data(), sizeof(Cluster) * m_clusters.size());
+		m_clusterBuffer->Unmap(true);
+
+		// Index buffer only grows, so that it does not get reallocated each time the light count fluctuates:
+		if (m_lightIndexBuffer->ObjectCount() < m_lightIndices.size())
+			m_lightIndexBuffer = m_info->Context()->Device()->CreateArrayBuffer<uint32_t>(
+				std::max(m_lightIndices.size(), m_lightIndexBuffer->ObjectCount() << 1));
+		if (m_lightIndices.size() > 0) {
+			void* data = m_lightIndexBuffer->MapRange(0, m_lightIndices.size());
+			if (data != nullptr) {
+				memcpy(data, m_lightIndices.data(), sizeof(uint32_t) * m_lightIndices.size());
+				m_lightIndexBuffer->UnmapRange(true);
+			}
+		}
+		m_lightIndexCount = m_lightIndices.size();
+	}
+
+	Graphics::BufferReference<LightClusterGrid::Settings> LightClusterGrid::SettingsBuffer()const { return m_settings; }
+
+	Graphics::ArrayBufferReference<LightClusterGrid::Cluster> LightClusterGrid::ClusterBuffer()const { return m_clusterBuffer; }
+
+	Graphics::ArrayBufferReference<uint32_t> LightClusterGrid::LightIndexBuffer()const { return m_lightIndexBuffer; }
+
+	size_t LightClusterGrid::LightIndexCount()const { return m_lightIndexCount; }
+
+	void LightClusterGrid::ProcessClusters(const Callback<const Cluster*, size_t, const uint32_t*, size_t>& processCallback) {
+		std::unique_lock<std::mutex> lock(m_lock);
+		processCallback(m_clusters.data(), m_clusters.size(), m_lightIndices.data(), m_lightIndices.size());
+	}
+
+	LightClusterGrid::ClusterRange LightClusterGrid::ComputeRange(const AABB& bounds)const {
+		ClusterRange range = { Size3(0u), Size3(0u) };
+
+		// Empty bounds (empty light slots, for example) do not affect anything:
+		if (Math::IsEmpty(bounds)) return range;
+
+		// Lights without finite bounds (and the ones with NaN-s) affect everything:
+		if (!Math::IsFinite(bounds)) {
+			range.end = m_clusterCount;
+			return range;
+		}
+
+		// Clip space bounds of the box corners:
+		const float nearPlane = m_currentSettings.nearPlane;
+		float minW = std::numeric_limits<float>::infinity();
+		float maxW = -std::numeric_limits<float>::infinity();
+		Vector2 minNdc(std::numeric_limits<float>::infinity());
+		Vector2 maxNdc(-std::numeric_limits<float>::infinity());
+		for (size_t i = 0; i < 8; i++) {
+			const Vector4 corner = m_currentSettings.viewProjection * Vector4(
+				((i & 1) != 0) ? bounds.end.x : bounds.start.x,
+				((i & 2) != 0) ? bounds.end.y : bounds.start.y,
+				((i & 4) != 0) ? bounds.end.z : bounds.start.z, 1.0f);
+			minW = std::min(minW, corner.w);
+			maxW = std::max(maxW, corner.w);
+			if (corner.w <= nearPlane) continue;
+			const Vector2 ndc = Vector2(corner.x, corner.y) / corner.w;
+			minNdc = Vector2(std::min(minNdc.x, ndc.x), std::min(minNdc.y, ndc.y));
+			maxNdc = Vector2(std::max(maxNdc.x, ndc.x), std::max(maxNdc.y, ndc.y));
+		}
+
+		// Boxes fully in front of the near plane or behind the far one are culled:
+		if (maxW <= nearPlane || minW >= m_farPlane) return range;
+		range.start.z = DepthSlice(minW, m_currentSettings);
+		range.end.z = DepthSlice(maxW, m_currentSettings) + 1u;
+
+		// Boxes, crossing the near plane, can not be projected reliably, so they cover every cluster within the depth range:
+		if (minW <= nearPlane) {
+			range.end.x = m_clusterCount.x;
+			range.end.y = m_clusterCount.y;
+		}
+		else if (maxNdc.x < -1.0f || minNdc.x > 1.0f || maxNdc.y < -1.0f || minNdc.y > 1.0f) return ClusterRange{ Size3(0u), Size3(0u) };
+		else {
+			range.start.x = ClusterCell(minNdc.x, m_clusterCount.x);
+			range.start.y = ClusterCell(minNdc.y, m_clusterCount.y);
+			range.end.x = ClusterCell(maxNdc.x, m_clusterCount.x) + 1u;
+			range.end.y = ClusterCell(maxNdc.y, m_clusterCount.y) + 1u;
+		}
+		return range;
+	}
+
+	void LightClusterGrid::BinLights(const AABB* bounds, size_t count) {
+		if (m_lightRanges.size() < count) m_lightRanges.resize(count);
+
+		struct {
+			LightClusterGrid* self;
+			const AABB* bounds;
+			size_t count;
+		} binning = { this, bounds, count };
+
+		// Cluster ranges of the lights are calculated in parallel:
+		ExecuteJob(m_block, std::min((count + 127) / 128, m_threadCount), &binning, [](ThreadBlock::ThreadInfo threadInfo, void* dataAddr) {
+			const decltype(binning)& job = *((decltype(binning)*)dataAddr);
+			for (size_t i = threadInfo.threadId; i < job.count; i += threadInfo.threadCount)
+				job.self->m_lightRanges[i] = job.self->ComputeRange(job.bounds[i]);
+			});
+
+		// Depth slices are filled in parallel, each one by a single thread, so that no locking is required:
+		ExecuteJob(m_block, (count < 128) ? 1 : std::min(static_cast<size_t>(m_clusterCount.z), m_threadCount), &binning, [](ThreadBlock::ThreadInfo threadInfo, void* dataAddr) {
+			const decltype(binning)& job = *((decltype(binning)*)dataAddr);
+			const Size3 clusterCount = job.self->m_clusterCount;
+			for (uint32_t z = static_cast<uint32_t>(threadInfo.threadId); z < clusterCount.z; z += static_cast<uint32_t>(threadInfo.threadCount)) {
+				std::vector<uint32_t>* slice = job.self->m_clusterLights.data() + (static_cast<size_t>(clusterCount.x) * clusterCount.y * z);
+				for (size_t i = 0; i < (static_cast<size_t>(clusterCount.x) * clusterCount.y); i++) slice[i].clear();
+				for (size_t lightId = 0; lightId < job.count; lightId++) {
+					const ClusterRange& range = job.self->m_lightRanges[lightId];
+					if (z < range.start.z || z >= range.end.z) continue;
+					for (uint32_t y = range.start.y; y < range.end.y; y++) {
+						std::vector<uint32_t>* row = slice + (static_cast<size_t>(clusterCount.x) * y);
+						for (uint32_t x = range.start.x; x < range.end.x; x++)
+							row[x].push_back(static_cast<uint32_t>(lightId));
+					}
+				}
+			}
+			});
+
+		// Cluster lists get flattened into a single index list:
+		uint32_t indexCount = 0;
+		for (size_t i = 0; i < m_clusterLights.size(); i++) {
+			const uint32_t lightCount = static_cast<uint32_t>(m_clusterLights[i].size());
+			m_clusters[i] = Cluster{ indexCount, lightCount };
+			indexCount += lightCount;
+		}
+		m_lightIndices.resize(indexCount);
+		for (size_t i = 0; i < m_clusterLights.size(); i++) {
+			const std::vector<uint32_t>& lights = m_clusterLights[i];
+			if (lights.size() > 0)
+				memcpy(m_lightIndices.data() + m_clusters[i].firstIndex, lights.data(), sizeof(uint32_t) * lights.size());
+		}
+	}
+}
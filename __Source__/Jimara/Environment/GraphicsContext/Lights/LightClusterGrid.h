@@ -0,0 +1,154 @@
+#pragma once
+#include "SceneLightInfo.h"
+#include <atomic>
+
+
+namespace Jimara {
+	/// <summary>
+	/// Divides the view frustum into a 3D grid of clusters and bins the scene lights into per-cluster index lists based on their bounds,
+	/// so that the lighting models can iterate over only the lights, relevant to the fragment's cluster.
+	/// Notes:
+	///		0. Clusters are uniform in normalized device coordinates along X and Y and exponential along the view depth (clip space W),
+	///			so the grid expects a perspective projection;
+	///		1. Light indices refer to the same light slots as the LightDataBuffer and LightTypeIdBuffer entries (empty slots are never referenced);
+	///		2. Lights with non-finite bounds (directional lights, for example) end up in every cluster;
+	///		3. Shader-side counterpart:
+	///			layout(...) uniform LightClusterSettings { mat4 viewProjection; uvec3 clusterCount; float nearPlane; float depthSliceScale; };
+	///			layout(std430, ...) buffer LightClusters { uvec2 clusters[]; }; // (first index, light count)
+	///			layout(std430, ...) buffer LightClusterIndices { uint indices[]; };
+	///			with cluster index calculated as: (x + clusterCount.x * (y + clusterCount.y * z)).
+	/// </summary>
+	class LightClusterGrid : public virtual Object {
+	public:
+		/// <summary> Default cluster grid dimensions </summary>
+		static const Size3 DEFAULT_CLUSTER_COUNT;
+
+		/// <summary>
+		/// Grid settings (std140 layout, matching LightClusterSettings)
+		/// </summary>
+		struct Settings {
+			/// <summary> World space to clip space transformation </summary>
+			alignas(16) Matrix4 viewProjection;
+
+			/// <summary> Cluster grid dimensions </summary>
+			alignas(16) Size3 clusterCount;
+
+			/// <summary> Near plane distance (clip space W) </summary>
+			alignas(4) float nearPlane;
+
+			/// <summary> Depth slice index is calculated as log(w / nearPlane) * depthSliceScale </summary>
+			alignas(4) float depthSliceScale;
+		};
+
+		/// <summary>
+		/// Cluster light list (matches uvec2 within LightClusters)
+		/// </summary>
+		struct Cluster {
+			/// <summary> Index of the first light index within LightIndexBuffer() </summary>
+			uint32_t firstIndex;
+
+			/// <summary> Number of lights within the cluster </summary>
+			uint32_t lightCount;
+		};
+
+		/// <summary>
+		/// Constructor
+		/// </summary>
+		/// <param name="context"> "Owner" graphics context </param>
+		/// <param name="clusterCount"> Cluster grid dimensions </param>
+		LightClusterGrid(GraphicsContext* context, Size3 clusterCount = DEFAULT_CLUSTER_COUNT);
+
+		/// <summary> Virtual destructor </summary>
+		virtual ~LightClusterGrid();
+
+		/// <summary> Cluster grid dimensions </summary>
+		Size3 ClusterCount()const;
+
+		/// <summary>
+		/// Rebins the scene lights for the given viewpoint and uploads the results
+		/// Note: Expected to be invoked once per frame by the renderer, before recording the commands.
+		/// </summary>
+		/// <param name="viewProjection"> World space to clip space transformation (the same, the vertex shaders use) </param>
+		/// <param name="nearPlane"> Near plane distance </param>
+		/// <param name="farPlane"> Far plane distance </param>
+		void Update(const Matrix4& viewProjection, float nearPlane, float farPlane);
+
+		/// <summary> Constant buffer with grid settings </summary>
+		Graphics::BufferReference<Settings> SettingsBuffer()const;
+
+		/// <summary> Buffer of per-cluster light lists </summary>
+		Graphics::ArrayBufferReference<Cluster> ClusterBuffer()const;
+
+		/// <summary> Buffer of light indices, the cluster light lists point to </summary>
+		Graphics::ArrayBufferReference<uint32_t> LightIndexBuffer()const;
+
+		/// <summary> Number of light indices, generated by the last Update() call </summary>
+		size_t LightIndexCount()const;
+
+		/// <summary>
+		/// Safetly invokes given callback with CPU-side copies of the cluster buffer and the light index buffer, generated by the last Update() call
+		/// Note: Arguments are (per-cluster light lists, cluster count, light indices, light index count).
+		/// </summary>
+		/// <param name="processCallback"> Callback to invoke </param>
+		void ProcessClusters(const Callback<const Cluster*, size_t, const uint32_t*, size_t>& processCallback);
+
+
+	private:
+		// Scene light info
+		const Reference<SceneLightInfo> m_info;
+
+		// Cluster grid dimensions
+		const Size3 m_clusterCount;
+
+		// Number of worker threads for updates
+		const size_t m_threadCount;
+
+		// Update lock
+		std::mutex m_lock;
+
+		// Thread block for workers
+		ThreadBlock m_block;
+
+		// Cluster range, covered by a light ([start; end), empty if the light is not visible)
+		struct ClusterRange {
+			Size3 start;
+			Size3 end;
+		};
+
+		// Settings for the ongoing update
+		Settings m_currentSettings;
+
+		// Far plane distance for the ongoing update
+		float m_farPlane;
+
+		// Per-light cluster ranges
+		std::vector<ClusterRange> m_lightRanges;
+
+		// Per-cluster light lists
+		std::vector<std::vector<uint32_t>> m_clusterLights;
+
+		// CPU-side copy of the cluster buffer
+		std::vector<Cluster> m_clusters;
+
+		// CPU-side copy of the light index buffer
+		std::vector<uint32_t> m_lightIndices;
+
+		// Grid settings
+		const Graphics::BufferReference<Settings> m_settings;
+
+		// Buffer of per-cluster light lists
+		Graphics::ArrayBufferReference<Cluster> m_clusterBuffer;
+
+		// Buffer of light indices (grows as needed)
+		Graphics::ArrayBufferReference<uint32_t> m_lightIndexBuffer;
+
+		// Number of light indices from the last update
+		std::atomic<size_t> m_lightIndexCount;
+
+		// Calculates the cluster range, covered by the light bounds (based on m_currentSettings)
+		ClusterRange ComputeRange(const AABB& bounds)const;
+
+		// Bins the lights
+		void BinLights(const AABB* bounds, size_t count);
+	};
+}
@@ -1,16 +1,18 @@
 #include "LightDataBuffer.h"
+#include "../../../Core/Stopwatch.h"
+#include <algorithm>
 
 
 namespace Jimara {
 	LightDataBuffer::LightDataBuffer(GraphicsContext* context) 
-		: m_info(SceneLightInfo::Instance(context)), m_threadCount(std::thread::hardware_concurrency()), m_dataBackBufferId(0) {
-		Callback<const LightDescriptor::LightInfo*, size_t> callback(&LightDataBuffer::OnUpdateLights, this);
+		: m_info(SceneLightInfo::Instance(context)), m_lastUpdateDuration(0.0f) {
+		Callback<const LightDescriptor::LightInfo*, size_t, const size_t*, size_t> callback(&LightDataBuffer::OnUpdateLights, this);
 		m_info->ProcessLightInfo(callback);
-		m_info->OnUpdateLightInfo() += callback;
+		m_info->OnLightInfoChanged() += callback;
 	}
 
 	LightDataBuffer::~LightDataBuffer() {
-		m_info->OnUpdateLightInfo() -= Callback<const LightDescriptor::LightInfo*, size_t>(&LightDataBuffer::OnUpdateLights, this);
+		m_info->OnLightInfoChanged() -= Callback<const LightDescriptor::LightInfo*, size_t, const size_t*, size_t>(&LightDataBuffer::OnUpdateLights, this);
 	}
 
 	namespace {
@@ -29,90 +31,62 @@ namespace Jimara {
 	Reference<Graphics::ArrayBuffer> LightDataBuffer::Buffer()const { return m_buffer; }
 
 	namespace {
-		struct Updater {
-			const LightDescriptor::LightInfo* info;
-			size_t count;
-			size_t elemSize;
-			uint8_t* cpuBackBuffer;
-			uint8_t* cpuFrontBuffer;
-			mutable std::atomic<bool> bufferDirty;
-		};
+		// Changed lights, separated by fewer unchanged ones, get uploaded within a single range:
+		static const size_t MAX_MERGED_GAP = 16;
 
-		struct ThreadRange {
-			size_t start, end;
+		// Minimal number of light slots, the buffer is allocated with:
+		static const size_t MIN_CAPACITY = 16;
 
-			inline ThreadRange(size_t totalCount, size_t threadId, size_t threadCount) {
-				size_t workPerThread = (totalCount + threadCount - 1) / threadCount;
-				start = (workPerThread * threadId);
-				end = start + workPerThread;
-				if (end > totalCount) end = totalCount;
-			}
-		};
+		inline static void CopyLightData(uint8_t* destination, const LightDescriptor::LightInfo& light, size_t elemSize) {
+			size_t copySize = light.dataSize;
+			if (copySize > elemSize) copySize = elemSize;
+			if (copySize > 0) memcpy(destination, light.data, copySize);
+			if (copySize < elemSize) memset(destination + copySize, 0, elemSize - copySize);
+		}
 	}
 
-	void LightDataBuffer::OnUpdateLights(const LightDescriptor::LightInfo* info, size_t count) {
+	float LightDataBuffer::LastUpdateDuration()const { return m_lastUpdateDuration; }
+
+	void LightDataBuffer::OnUpdateLights(const LightDescriptor::LightInfo* info, size_t count, const size_t* dirtyIndices, size_t dirtyCount) {
 		std::unique_lock<std::mutex> lock(m_lock);
+		Stopwatch stopwatch;
+		UpdateBuffer(info, count, dirtyIndices, dirtyCount);
+		m_lastUpdateDuration = stopwatch.Elapsed();
+	}
 
-		std::vector<uint8_t>& dataBackBuffer = m_data[m_dataBackBufferId];
-		m_dataBackBufferId = ((m_dataBackBufferId + 1) & 1);
-		std::vector<uint8_t>& dataFrontBuffer = m_data[m_dataBackBufferId];
+	void LightDataBuffer::UpdateBuffer(const LightDescriptor::LightInfo* info, size_t count, const size_t* dirtyIndices, size_t dirtyCount) {
+		size_t elemSize = m_info->Context()->PerLightDataSize();
+		if (elemSize < 1) elemSize = 1;
 
-		Updater updater = {};
-		updater.info = info;
-		updater.count = count;
-		updater.elemSize = m_info->Context()->PerLightDataSize();
-		if (updater.elemSize < 1) updater.elemSize = 1;
-		
-		size_t bytesNeeded = (updater.elemSize * updater.count);
-		if (dataBackBuffer.size() < bytesNeeded) {
-			dataBackBuffer.resize(bytesNeeded);
-			memset(dataBackBuffer.data(), 0, dataBackBuffer.size());
-			dataFrontBuffer.resize(bytesNeeded);
-			memset(dataFrontBuffer.data(), 0, dataFrontBuffer.size());
-			updater.bufferDirty = true;
+		// Buffer gets recreated only if the slot count exceeds the capacity (which grows geometrically) or the element size changes:
+		if ((m_buffer == nullptr) || (m_buffer->ObjectSize() != elemSize) || (m_buffer->ObjectCount() < count)) {
+			size_t capacity = (m_buffer == nullptr || m_buffer->ObjectSize() != elemSize) ? MIN_CAPACITY : std::max(m_buffer->ObjectCount(), MIN_CAPACITY);
+			while (capacity < count) capacity <<= 1;
+			Reference<Graphics::ArrayBuffer> buffer = m_info->Context()->Device()->CreateArrayBuffer(elemSize, capacity);
+			uint8_t* data = (uint8_t*)buffer->Map();
+			for (size_t i = 0; i < count; i++)
+				CopyLightData(data + (elemSize * i), info[i], elemSize);
+			memset(data + (elemSize * count), 0, elemSize * (capacity - count));
+			buffer->Unmap(true);
+			m_buffer = buffer;
+			return;
 		}
-		else updater.bufferDirty = ((m_buffer == nullptr) || (m_buffer->ObjectSize() != updater.elemSize) || (m_buffer->ObjectCount() != updater.count));
-		updater.cpuBackBuffer = dataBackBuffer.data();
-		updater.cpuFrontBuffer = dataFrontBuffer.data();
 
-		auto updateCpuBuffer = [](ThreadBlock::ThreadInfo threadInfo, void* dataAddr) {
-			const Updater& info = *((Updater*)dataAddr);
-			ThreadRange range(info.count, threadInfo.threadId, threadInfo.threadCount);
-			size_t bufferStart = (range.start * info.elemSize);
-			uint8_t* cpuDataStart = info.cpuBackBuffer + bufferStart;
-			uint8_t* cpuData = cpuDataStart;
-			for (size_t i = range.start; i < range.end; i++) {
-				const LightDescriptor::LightInfo& light = info.info[i];
-				size_t copySize = light.dataSize;
-				if (copySize > info.elemSize) copySize = info.elemSize;
-				memcpy(cpuData, light.data, copySize);
-				cpuData += info.elemSize;
+		// Otherwise, only the changed ranges get uploaded:
+		size_t i = 0;
+		while (i < dirtyCount) {
+			const size_t first = dirtyIndices[i];
+			size_t end = (first + 1);
+			i++;
+			while (i < dirtyCount && dirtyIndices[i] <= (end + MAX_MERGED_GAP)) {
+				end = (dirtyIndices[i] + 1);
+				i++;
 			}
-			if ((!info.bufferDirty) && (cpuData != cpuDataStart))
-				if (memcmp(cpuDataStart, info.cpuFrontBuffer + bufferStart, cpuData - cpuDataStart) != 0)
-					info.bufferDirty = true;
-		};
-
-		if (updater.count < 128) {
-			ThreadBlock::ThreadInfo info;
-			{
-				info.threadCount = 1;
-				info.threadId = 0;
-			}
-			updateCpuBuffer(info, &updater);
-		}
-		else {
-			size_t threadCount = (updater.count + 127) / 128;
-			if (threadCount > m_threadCount) threadCount = m_threadCount;
-			m_block.Execute(threadCount, &updater, Callback<ThreadBlock::ThreadInfo, void*>(updateCpuBuffer));
-		}
-		if (updater.bufferDirty) {
-			Reference<Graphics::ArrayBuffer> buffer = m_info->Context()->Device()->CreateArrayBuffer(updater.elemSize, updater.count);
-			if (updater.count > 0) {
-				memcpy(buffer->Map(), dataBackBuffer.data(), updater.elemSize * updater.count);
-				buffer->Unmap(true);
-			}
-			m_buffer = buffer;
+			uint8_t* data = (uint8_t*)m_buffer->MapRange(first, end - first);
+			if (data == nullptr) continue;
+			for (size_t index = first; index < end; index++)
+				CopyLightData(data + (elemSize * (index - first)), info[index], elemSize);
+			m_buffer->UnmapRange(true);
 		}
 	}
 }
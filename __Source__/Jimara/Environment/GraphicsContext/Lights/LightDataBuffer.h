@@ -5,6 +5,10 @@
 namespace Jimara {
 	/// <summary>
 	/// Wrapper around a buffer that is updated with current light data each update cycle
+	/// Notes:
+	///		0. Light data is stored per SceneLightInfo slot; empty slots (including the ones beyond the slot count) are filled with zeroes;
+	///		1. The buffer has a geometrically growing capacity and gets recreated only when the slot count exceeds it; 
+	///			otherwise, only the data of the changed slots gets uploaded.
 	/// </summary>
 	class LightDataBuffer : public virtual ObjectCache<GraphicsContext*>::StoredObject {
 	public:
@@ -24,33 +28,30 @@ namespace Jimara {
 		/// <returns> Instance, tied to the context </returns>
 		static Reference<LightDataBuffer> Instance(GraphicsContext* context);
 
-		/// <summary> Buffer, containing light data </summary>
+		/// <summary> Buffer, containing light data (buffer instance only changes when the capacity grows) </summary>
 		Reference<Graphics::ArrayBuffer> Buffer()const;
 
+		/// <summary> Time (in seconds), the last buffer update took (mostly for diagnostics and benchmarks) </summary>
+		float LastUpdateDuration()const;
+
 
 	private:
 		// Scene light info
 		const Reference<SceneLightInfo> m_info;
 
-		// Number of worker threads for updates
-		const size_t m_threadCount;
-
 		// Update lock
 		std::mutex m_lock;
 
-		// Thread block for workers
-		ThreadBlock m_block;
-
-		// Data back and front buffers to keep track of the changes
-		std::vector<uint8_t> m_data[2];
-
-		// Current back buffer index (flipped on each update)
-		size_t m_dataBackBufferId;
-
 		// Underlying buffer
 		Reference<Graphics::ArrayBuffer> m_buffer;
 
+		// Duration of the last update
+		std::atomic<float> m_lastUpdateDuration;
+
 		// Update function
-		void OnUpdateLights(const LightDescriptor::LightInfo* info, size_t count);
+		void OnUpdateLights(const LightDescriptor::LightInfo* info, size_t count, const size_t* dirtyIndices, size_t dirtyCount);
+
+		// Refreshes the buffer (expects the lock to be held)
+		void UpdateBuffer(const LightDescriptor::LightInfo* info, size_t count, const size_t* dirtyIndices, size_t dirtyCount);
 	};
 }
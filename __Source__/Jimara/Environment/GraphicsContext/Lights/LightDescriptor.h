@@ -1,6 +1,6 @@
 #pragma once
 #include "../../../Core/Object.h"
-#include "../../../Math/Math.h"
+#include "../../../Math/Bounds.h"
 
 namespace Jimara {
 	/// <summary>
@@ -27,5 +27,20 @@ namespace Jimara {
 
 		/// <summary> Axis aligned bounding box, within which the light is relevant </summary>
 		virtual AABB GetLightBounds()const = 0;
+
+		/// <summary> Rough estimate of the light's brightness, used for ranking the lights by importance (maximal color channel, for example) </summary>
+		virtual float GetLightIntensity()const { return 1.0f; }
+
+		/// <summary> Revision, reported by the lights that do not keep track of their changes </summary>
+		static const uint64_t UNTRACKED_REVISION = ~static_cast<uint64_t>(0);
+
+		/// <summary>
+		/// Light revision
+		/// Notes:
+		///		0. Expected to change each time GetLightInfo() data, GetLightBounds() or GetLightIntensity() changes; 
+		///			SceneLightInfo only re-fetches the information for the lights, whose revision changed since the previous update;
+		///		1. Default implementation returns UNTRACKED_REVISION, which causes the light to be refreshed on each update.
+		/// </summary>
+		virtual uint64_t Revision()const { return UNTRACKED_REVISION; }
 	};
 }
@@ -1,17 +1,24 @@
 #include "LightTypeIdBuffer.h"
+#include "../../../Core/Stopwatch.h"
+#include <algorithm>
 
 
 namespace Jimara {
 	LightTypeIdBuffer::LightTypeIdBuffer(GraphicsContext* context) 
-		: m_info(SceneLightInfo::Instance(context)), m_dataBackBufferId(0) {
-		Callback<const LightDescriptor::LightInfo*, size_t> callback(&LightTypeIdBuffer::OnUpdateLights, this);
+		: m_info(SceneLightInfo::Instance(context))
+		, m_countBuffer(context->Device()->CreateConstantBuffer<LightCount>())
+		, m_count{ 0u, 0u }
+		, m_typeGroupRevision(~static_cast<uint64_t>(0))
+		, m_lastUpdateDuration(0.0f) {
+		m_countBuffer.Map() = m_count;
+		m_countBuffer->Unmap(true);
+		Callback<const LightDescriptor::LightInfo*, size_t, const size_t*, size_t> callback(&LightTypeIdBuffer::OnUpdateLights, this);
 		m_info->ProcessLightInfo(callback);
-		m_info->OnUpdateLightInfo() += callback;
-
+		m_info->OnLightInfoChanged() += callback;
 	}
 
 	LightTypeIdBuffer::~LightTypeIdBuffer() {
-		m_info->OnUpdateLightInfo() -= Callback<const LightDescriptor::LightInfo*, size_t>(&LightTypeIdBuffer::OnUpdateLights, this);
+		m_info->OnLightInfoChanged() -= Callback<const LightDescriptor::LightInfo*, size_t, const size_t*, size_t>(&LightTypeIdBuffer::OnUpdateLights, this);
 	}
 
 	namespace {
@@ -29,35 +36,102 @@ namespace Jimara {
 
 	Graphics::ArrayBufferReference<uint32_t> LightTypeIdBuffer::Buffer()const { return m_buffer; }
 
-	void LightTypeIdBuffer::OnUpdateLights(const LightDescriptor::LightInfo* info, size_t count) {
-		std::unique_lock<std::mutex> lock(m_lock);
+	Graphics::BufferReference<LightTypeIdBuffer::LightCount> LightTypeIdBuffer::CountBuffer()const { return m_countBuffer; }
 
-		std::vector<uint32_t>& dataBackBuffer = m_data[m_dataBackBufferId];
-		m_dataBackBufferId = ((m_dataBackBufferId + 1) & 1);
-		std::vector<uint32_t>& dataFrontBuffer = m_data[m_dataBackBufferId];
+	Graphics::ArrayBufferReference<SceneLightInfo::LightTypeRange> LightTypeIdBuffer::TypeRangeBuffer()const { return m_typeRangeBuffer; }
 
-		bool bufferDirty = ((m_buffer == nullptr) || (m_buffer->ObjectCount() != count));
+	Graphics::ArrayBufferReference<uint32_t> LightTypeIdBuffer::GroupedSlotBuffer()const { return m_groupedSlotBuffer; }
 
-		if (dataBackBuffer.size() < count) {
-			dataBackBuffer.resize(count);
-			dataFrontBuffer.resize(count);
-		}
+	float LightTypeIdBuffer::LastUpdateDuration()const { return m_lastUpdateDuration; }
 
-		for (size_t i = 0; i < count; i++)
-			dataBackBuffer[i] = info[i].typeId;
+	namespace {
+		// Minimal number of light slots, the buffer is allocated with:
+		static const size_t MIN_CAPACITY = 16;
+
+		// Minimal number of light types, the range buffer is allocated with:
+		static const size_t MIN_TYPE_CAPACITY = 4;
 
-		const size_t bufferSize = (sizeof(uint32_t) * count);
-		if (!bufferDirty)
-			if (memcmp(dataBackBuffer.data(), dataFrontBuffer.data(), bufferSize) != 0)
-				bufferDirty = true;
+		// Changed type identifiers, separated by fewer unchanged ones, get uploaded within a single range:
+		static const size_t MAX_MERGED_GAP = 16;
 
-		if (bufferDirty) {
-			Graphics::ArrayBufferReference<uint32_t> buffer = m_info->Context()->Device()->CreateArrayBuffer<uint32_t>(count);
-			if (count > 0) {
-				memcpy(buffer->Map(), dataBackBuffer.data(), bufferSize);
-				buffer->Unmap(true);
+		template<typename Type>
+		inline static void UploadGrowing(Graphics::GraphicsDevice* device, Graphics::ArrayBufferReference<Type>& buffer, const Type* data, size_t count, size_t minCapacity, const Type& emptyValue) {
+			if ((buffer == nullptr) || (buffer->ObjectCount() < count)) {
+				size_t capacity = (buffer == nullptr) ? minCapacity : std::max(buffer->ObjectCount(), minCapacity);
+				while (capacity < count) capacity <<= 1;
+				buffer = device->CreateArrayBuffer<Type>(capacity);
 			}
+			Type* mapped = buffer.Map();
+			for (size_t i = 0; i < count; i++) mapped[i] = data[i];
+			for (size_t i = count; i < buffer->ObjectCount(); i++) mapped[i] = emptyValue;
+			buffer->Unmap(true);
+		}
+	}
+
+	void LightTypeIdBuffer::UpdateTypeGroups(const SceneLightInfo::LightTypeRange* ranges, size_t rangeCount, const uint32_t* slots, size_t slotCount) {
+		Graphics::GraphicsDevice* device = m_info->Context()->Device();
+		UploadGrowing(device, m_typeRangeBuffer, ranges, rangeCount, MIN_TYPE_CAPACITY, SceneLightInfo::LightTypeRange{ 0u, 0u });
+		UploadGrowing(device, m_groupedSlotBuffer, slots, slotCount, MIN_CAPACITY, SceneLightInfo::EMPTY_SLOT_TYPE_ID);
+	}
+
+	void LightTypeIdBuffer::OnUpdateLights(const LightDescriptor::LightInfo* info, size_t count, const size_t* dirtyIndices, size_t dirtyCount) {
+		std::unique_lock<std::mutex> lock(m_lock);
+		Stopwatch stopwatch;
+		UpdateBuffers(info, count, dirtyIndices, dirtyCount);
+		m_lastUpdateDuration = stopwatch.Elapsed();
+	}
+
+	void LightTypeIdBuffer::UpdateBuffers(const LightDescriptor::LightInfo* info, size_t count, const size_t* dirtyIndices, size_t dirtyCount) {
+
+		const LightCount lightCount = { static_cast<uint32_t>(m_info->LightCount()), static_cast<uint32_t>(m_info->ActiveSlotCount()) };
+		if (lightCount.lightCount != m_count.lightCount || lightCount.slotCount != m_count.slotCount) {
+			m_count = lightCount;
+			m_countBuffer.Map() = m_count;
+			m_countBuffer->Unmap(true);
+		}
+
+		// Type groups get re-uploaded as a whole, but only when the lights come and go or change their type:
+		const uint64_t typeGroupRevision = m_info->LightTypeGroupRevision();
+		if (m_typeGroupRevision != typeGroupRevision || m_typeRangeBuffer == nullptr) {
+			m_typeGroupRevision = typeGroupRevision;
+			m_info->ProcessLightTypeGroups(Callback<const SceneLightInfo::LightTypeRange*, size_t, const uint32_t*, size_t>(&LightTypeIdBuffer::UpdateTypeGroups, this));
+		}
+
+		// Buffer gets recreated only if the slot count exceeds the capacity (which grows geometrically):
+		if ((m_buffer == nullptr) || (m_buffer->ObjectCount() < count)) {
+			size_t capacity = (m_buffer == nullptr) ? MIN_CAPACITY : std::max(m_buffer->ObjectCount(), MIN_CAPACITY);
+			while (capacity < count) capacity <<= 1;
+			m_data.resize(capacity);
+			for (size_t i = 0; i < count; i++)
+				m_data[i] = info[i].typeId;
+			for (size_t i = count; i < capacity; i++)
+				m_data[i] = SceneLightInfo::EMPTY_SLOT_TYPE_ID;
+			Graphics::ArrayBufferReference<uint32_t> buffer = m_info->Context()->Device()->CreateArrayBuffer<uint32_t>(capacity);
+			memcpy(buffer.Map(), m_data.data(), sizeof(uint32_t) * capacity);
+			buffer->Unmap(true);
 			m_buffer = buffer;
+			return;
+		}
+
+		// Type identifiers rarely change, so only the ranges of the actually modified ones get uploaded:
+		size_t i = 0;
+		while (i < dirtyCount) {
+			const size_t first = dirtyIndices[i];
+			i++;
+			if (m_data[first] == info[first].typeId) continue;
+			m_data[first] = info[first].typeId;
+			size_t end = (first + 1);
+			while (i < dirtyCount && dirtyIndices[i] <= (end + MAX_MERGED_GAP)) {
+				const size_t index = dirtyIndices[i];
+				i++;
+				if (m_data[index] == info[index].typeId) continue;
+				m_data[index] = info[index].typeId;
+				end = (index + 1);
+			}
+			uint32_t* data = (uint32_t*)m_buffer->MapRange(first, end - first);
+			if (data == nullptr) continue;
+			memcpy(data, m_data.data() + first, sizeof(uint32_t) * (end - first));
+			m_buffer->UnmapRange(true);
 		}
 	}
 }
@@ -5,9 +5,27 @@
 namespace Jimara {
 	/// <summary>
 	/// Wrapper around a buffer that is updated with current light type identifiers each update cycle
+	/// Notes:
+	///		0. Type identifiers are stored per SceneLightInfo slot; empty slots (including the ones beyond the slot count) hold SceneLightInfo::EMPTY_SLOT_TYPE_ID;
+	///		1. The buffer has a geometrically growing capacity and gets recreated only when the slot count exceeds it;
+	///		2. Shader-side counterpart of the light count buffer: layout(...) uniform LightCount { uint lightCount; uint slotCount; };
+	///		3. Type ranges and type-grouped slots (see SceneLightInfo::ProcessLightTypeGroups) are kept in separate buffers, that get re-uploaded only when the groups change;
+	///			ranges of the types, that are not present in the scene (including the ones beyond the range count), are empty;
+	///			shader-side counterparts: buffer LightTypeRanges { uvec2 ranges[]; } and buffer GroupedLightSlots { uint slots[]; }.
 	/// </summary>
 	class LightTypeIdBuffer : public virtual ObjectCache<GraphicsContext*>::StoredObject {
 	public:
+		/// <summary>
+		/// Light count information (std140 layout, matching LightCount)
+		/// </summary>
+		struct LightCount {
+			/// <summary> Number of lights in the scene </summary>
+			alignas(4) uint32_t lightCount;
+
+			/// <summary> Number of slots, lighting models have to iterate over (last occupied slot index + 1) </summary>
+			alignas(4) uint32_t slotCount;
+		};
+
 		/// <summary>
 		/// Constructor
 		/// </summary>
@@ -24,9 +42,21 @@ namespace Jimara {
 		/// <returns> Instance, tied to the context </returns>
 		static Reference<LightTypeIdBuffer> Instance(GraphicsContext* context);
 
-		/// <summary> Buffer, containing light type identifiers </summary>
+		/// <summary> Buffer, containing light type identifiers (buffer instance only changes when the capacity grows) </summary>
 		Graphics::ArrayBufferReference<uint32_t> Buffer()const;
 
+		/// <summary> Constant buffer with light and slot counts </summary>
+		Graphics::BufferReference<LightCount> CountBuffer()const;
+
+		/// <summary> Buffer, containing SceneLightInfo::LightTypeRange per light type identifier (buffer instance only changes when the capacity grows) </summary>
+		Graphics::ArrayBufferReference<SceneLightInfo::LightTypeRange> TypeRangeBuffer()const;
+
+		/// <summary> Buffer, containing type-grouped slot indices (buffer instance only changes when the capacity grows) </summary>
+		Graphics::ArrayBufferReference<uint32_t> GroupedSlotBuffer()const;
+
+		/// <summary> Time (in seconds), the last buffer update took (mostly for diagnostics and benchmarks) </summary>
+		float LastUpdateDuration()const;
+
 
 	private:
 		// Scene light info
@@ -35,16 +65,35 @@ namespace Jimara {
 		// Update lock
 		std::mutex m_lock;
 
-		// Data back and front buffers to keep track of the changes
-		std::vector<uint32_t> m_data[2];
-
-		// Current back buffer index (flipped on each update)
-		size_t m_dataBackBufferId;
+		// CPU-side copy of the buffer content
+		std::vector<uint32_t> m_data;
 
 		// Underlying buffer
 		Graphics::ArrayBufferReference<uint32_t> m_buffer;
 
+		// Light count buffer
+		const Graphics::BufferReference<LightCount> m_countBuffer;
+
+		// Last light count info, uploaded to m_countBuffer
+		LightCount m_count;
+
+		// Type range and type-grouped slot buffers
+		Graphics::ArrayBufferReference<SceneLightInfo::LightTypeRange> m_typeRangeBuffer;
+		Graphics::ArrayBufferReference<uint32_t> m_groupedSlotBuffer;
+
+		// SceneLightInfo::LightTypeGroupRevision(), the type group buffers were last updated with
+		uint64_t m_typeGroupRevision;
+
+		// Duration of the last update
+		std::atomic<float> m_lastUpdateDuration;
+
+		// Uploads type groups
+		void UpdateTypeGroups(const SceneLightInfo::LightTypeRange* ranges, size_t rangeCount, const uint32_t* slots, size_t slotCount);
+
 		// Update function
-		void OnUpdateLights(const LightDescriptor::LightInfo* info, size_t count);
+		void OnUpdateLights(const LightDescriptor::LightInfo* info, size_t count, const size_t* dirtyIndices, size_t dirtyCount);
+
+		// Refreshes the buffers (expects the lock to be held)
+		void UpdateBuffers(const LightDescriptor::LightInfo* info, size_t count, const size_t* dirtyIndices, size_t dirtyCount);
 	};
 }
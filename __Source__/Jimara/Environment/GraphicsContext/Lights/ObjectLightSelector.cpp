@@ -0,0 +1,186 @@
+#include "ObjectLightSelector.h"
+#include <algorithm>
+#include <limits>
+
+
+namespace Jimara {
+	namespace {
+		// Fixed-size list of the lights with the highest scores:
+		class TopLights {
+		private:
+			float m_scores[ObjectLightSelector::MAX_LIGHTS_PER_OBJECT];
+			ObjectLightSelector::LightList m_list;
+			size_t m_size;
+
+		public:
+			inline TopLights() : m_size(0) {
+				for (size_t i = 0; i < ObjectLightSelector::MAX_LIGHTS_PER_OBJECT; i++) {
+					m_scores[i] = 0.0f;
+					m_list.lightIds[i] = ObjectLightSelector::NO_LIGHT;
+				}
+			}
+
+			inline void Insert(uint32_t lightId, float score) {
+				if (score <= 0.0f) return;
+				size_t position = m_size;
+				while (position > 0 && m_scores[position - 1] < score) position--;
+				if (position >= ObjectLightSelector::MAX_LIGHTS_PER_OBJECT) return;
+				if (m_size < ObjectLightSelector::MAX_LIGHTS_PER_OBJECT) m_size++;
+				for (size_t i = (m_size - 1); i > position; i--) {
+					m_scores[i] = m_scores[i - 1];
+					m_list.lightIds[i] = m_list.lightIds[i - 1];
+				}
+				m_scores[position] = score;
+				m_list.lightIds[position] = lightId;
+			}
+
+			inline const ObjectLightSelector::LightList& List()const { return m_list; }
+		};
+	}
+
+	ObjectLightSelector::ObjectLightSelector(GraphicsContext* context)
+		: m_info(SceneLightInfo::Instance(context))
+		, m_threadCount(std::max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1))) {
+		m_info->OnLightInfoChanged() += Callback<const LightDescriptor::LightInfo*, size_t, const size_t*, size_t>(&ObjectLightSelector::OnLightInfoChanged, this);
+		m_info->ProcessLightBounds(Callback<const AABB*, const float*, size_t>(&ObjectLightSelector::UpdateLights, this));
+	}
+
+	ObjectLightSelector::~ObjectLightSelector() {
+		m_info->OnLightInfoChanged() -= Callback<const LightDescriptor::LightInfo*, size_t, const size_t*, size_t>(&ObjectLightSelector::OnLightInfoChanged, this);
+	}
+
+	namespace {
+		class Cache : public virtual ObjectCache<GraphicsContext*> {
+		public:
+			inline static Reference<ObjectLightSelector> Instance(GraphicsContext* context) {
+				static Cache cache;
+				return cache.GetCachedOrCreate(context, false,
+					[&]() -> Reference<ObjectLightSelector> { return Object::Instantiate<ObjectLightSelector>(context); });
+			}
+		};
+	}
+
+	Reference<ObjectLightSelector> ObjectLightSelector::Instance(GraphicsContext* context) { return Cache::Instance(context); }
+
+	GraphicsContext* ObjectLightSelector::Context()const { return m_info->Context(); }
+
+	void ObjectLightSelector::AddClient(Client* client) {
+		if (client == nullptr) return;
+		std::unique_lock<std::mutex> lock(m_clientLock);
+		m_clients.insert(client);
+	}
+
+	void ObjectLightSelector::RemoveClient(Client* client) {
+		if (client == nullptr) return;
+		std::unique_lock<std::mutex> lock(m_clientLock);
+		m_clients.erase(client);
+	}
+
+	void ObjectLightSelector::SelectLights(const AABB* bounds, size_t count, LightList* lists)const {
+		if (count <= 0) return;
+
+		// Lights, that do not reach the combined bounds, can not affect any of the objects:
+		static thread_local std::vector<uint8_t> overlaps;
+		static thread_local std::vector<uint32_t> candidates;
+		static thread_local std::vector<Sphere> candidateSpheres;
+		{
+			static const float inf = std::numeric_limits<float>::infinity();
+			AABB combined = { Vector3(inf, inf, inf), Vector3(-inf, -inf, -inf) };
+			for (size_t i = 0; i < count; i++) {
+				const AABB& box = bounds[i];
+				if (Math::IsEmpty(box)) continue;
+				combined.start = Vector3(std::min(combined.start.x, box.start.x), std::min(combined.start.y, box.start.y), std::min(combined.start.z, box.start.z));
+				combined.end = Vector3(std::max(combined.end.x, box.end.x), std::max(combined.end.y, box.end.y), std::max(combined.end.z, box.end.z));
+			}
+			overlaps.resize(m_spheres.size());
+			candidates.clear();
+			candidateSpheres.clear();
+			if (!Math::IsEmpty(combined)) {
+				Math::Intersects(combined, m_spheres.data(), m_spheres.size(), overlaps.data());
+				for (size_t i = 0; i < overlaps.size(); i++)
+					if (overlaps[i] != 0) {
+						candidates.push_back(static_cast<uint32_t>(i));
+						candidateSpheres.push_back(m_spheres[i]);
+					}
+			}
+			overlaps.resize(candidates.size());
+		}
+
+		// Each object tests the candidates as a batch and only scores the ones that touch it:
+		for (size_t i = 0; i < count; i++) {
+			const AABB& box = bounds[i];
+			TopLights lights;
+			if (!Math::IsEmpty(box)) {
+				for (size_t j = 0; j < m_globalLights.size(); j++)
+					lights.Insert(m_globalLights[j].first, m_globalLights[j].second);
+				Math::Intersects(box, candidateSpheres.data(), candidateSpheres.size(), overlaps.data());
+				for (size_t j = 0; j < candidates.size(); j++) {
+					if (overlaps[j] == 0) continue;
+					const uint32_t index = candidates[j];
+					const Sphere& sphere = candidateSpheres[j];
+					const float distance = Math::Distance(sphere.center, box);
+					if (distance >= sphere.radius) continue;
+					const float falloff = (1.0f - (distance / sphere.radius));
+					lights.Insert(m_sphereSlots[index], m_sphereIntensities[index] * falloff * falloff);
+				}
+			}
+			lists[i] = lights.List();
+		}
+	}
+
+	void ObjectLightSelector::OnLightInfoChanged(const LightDescriptor::LightInfo*, size_t, const size_t*, size_t) {
+		m_info->ProcessLightBounds(Callback<const AABB*, const float*, size_t>(&ObjectLightSelector::UpdateLights, this));
+		{
+			std::unique_lock<std::mutex> lock(m_clientLock);
+			m_clientList.assign(m_clients.begin(), m_clients.end());
+		}
+
+		// Each thread handles a contiguous range of the clients:
+		struct Job {
+			const ObjectLightSelector* selector;
+			const Reference<Client>* clients;
+			size_t count;
+		} job = { this, m_clientList.data(), m_clientList.size() };
+		auto update = [](ThreadBlock::ThreadInfo threadInfo, void* dataAddr) {
+			const Job& data = *((Job*)dataAddr);
+			const size_t workPerThread = (data.count + threadInfo.threadCount - 1) / threadInfo.threadCount;
+			const size_t start = (workPerThread * threadInfo.threadId);
+			const size_t end = std::min(start + workPerThread, data.count);
+			for (size_t i = start; i < end; i++)
+				data.clients[i]->OnLightsChanged(data.selector);
+		};
+		const size_t threadCount = std::min(m_threadCount, m_clientList.size());
+		if (threadCount <= 1) {
+			ThreadBlock::ThreadInfo info;
+			{
+				info.threadCount = 1;
+				info.threadId = 0;
+			}
+			update(info, &job);
+		}
+		else m_block.Execute(threadCount, &job, Callback<ThreadBlock::ThreadInfo, void*>(update));
+		m_clientList.clear();
+	}
+
+	void ObjectLightSelector::UpdateLights(const AABB* bounds, const float* intensities, size_t count) {
+		m_spheres.clear();
+		m_sphereSlots.clear();
+		m_sphereIntensities.clear();
+		m_globalLights.clear();
+		for (size_t i = 0; i < count; i++) {
+			const AABB& box = bounds[i];
+			const float intensity = intensities[i];
+			if (Math::IsEmpty(box) || intensity <= 0.0f) continue;
+			else if (!Math::IsFinite(box)) {
+				m_globalLights.push_back(std::make_pair(static_cast<uint32_t>(i), intensity));
+				continue;
+			}
+			const Vector3 extents = (box.end - box.start) * 0.5f;
+			const float radius = std::max(extents.x, std::max(extents.y, extents.z));
+			if (radius <= 0.0f) continue;
+			m_spheres.push_back(Sphere{ (box.start + box.end) * 0.5f, radius });
+			m_sphereSlots.push_back(static_cast<uint32_t>(i));
+			m_sphereIntensities.push_back(intensity);
+		}
+	}
+}
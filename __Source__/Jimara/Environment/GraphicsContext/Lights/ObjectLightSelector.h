@@ -0,0 +1,120 @@
+#pragma once
+#include "SceneLightInfo.h"
+#include <unordered_set>
+
+
+namespace Jimara {
+	/// <summary>
+	/// Picks the most influential scene lights per object, so that the lighting models can iterate over a short, fixed-size light list per instance instead of every light in the scene
+	/// Notes:
+	///		0. Lights with finite bounds are treated as spheres with the radius of the largest half-extent of the bounds and quadratic falloff from the center to the radius
+	///			(distance is measured to the closest point of the object's bounds); lights with non-finite bounds (directional lights, for example) have no falloff;
+	///			falloff gets multiplied by LightDescriptor::GetLightIntensity() and the lights with the highest results win;
+	///		1. Light indices refer to the same light slots as the LightDataBuffer and LightTypeIdBuffer entries; unused list entries are filled with NO_LIGHT;
+	///		2. Light data gets refreshed each time SceneLightInfo reports a change and every Client gets a chance to redo it's selection right away,
+	///			so that the lists never reference the slots, the light buffers no longer agree with;
+	///		3. Shader-side counterpart is a 'uvec4' instance attribute (see MeshRenderer and the lit shader variants that reference Jimara_LitShaderVertexMain).
+	/// </summary>
+	class ObjectLightSelector : public virtual ObjectCache<GraphicsContext*>::StoredObject {
+	public:
+		/// <summary> Maximal number of lights per object </summary>
+		static const size_t MAX_LIGHTS_PER_OBJECT = 4;
+
+		/// <summary> Light index, used for the unused list entries </summary>
+		static const uint32_t NO_LIGHT = ~static_cast<uint32_t>(0);
+
+		/// <summary>
+		/// Per-object light list (matches uvec4)
+		/// </summary>
+		struct LightList {
+			/// <summary> Light indices, ordered by importance </summary>
+			uint32_t lightIds[MAX_LIGHTS_PER_OBJECT];
+		};
+
+		/// <summary>
+		/// Object, that keeps light lists (MeshRenderer batches, for example)
+		/// </summary>
+		class Client : public virtual Object {
+		public:
+			/// <summary>
+			/// Invoked each time the scene lights change (from worker threads, while the graphics context is being synchronized)
+			/// </summary>
+			/// <param name="selector"> Light selector, the client is registered with </param>
+			virtual void OnLightsChanged(const ObjectLightSelector* selector) = 0;
+		};
+
+		/// <summary>
+		/// Constructor
+		/// </summary>
+		/// <param name="context"> "Owner" graphics context </param>
+		ObjectLightSelector(GraphicsContext* context);
+
+		/// <summary> Virtual destructor </summary>
+		virtual ~ObjectLightSelector();
+
+		/// <summary>
+		/// Singleton instance per graphics context
+		/// </summary>
+		/// <param name="context"> "Owner" graphics context </param>
+		/// <returns> Instance, tied to the context </returns>
+		static Reference<ObjectLightSelector> Instance(GraphicsContext* context);
+
+		/// <summary> "Owner" graphics contex </summary>
+		GraphicsContext* Context()const;
+
+		/// <summary>
+		/// Registers a client
+		/// </summary>
+		/// <param name="client"> Client to notify about the light changes </param>
+		void AddClient(Client* client);
+
+		/// <summary>
+		/// Unregisters a client
+		/// </summary>
+		/// <param name="client"> Client, previously added with AddClient() </param>
+		void RemoveClient(Client* client);
+
+		/// <summary>
+		/// Selects the most influential lights for a batch of objects
+		/// Note: Safe to call from the GraphicsObjectSynchronizer-s, Client callbacks or under GraphicsContext::ReadLock (light data only changes after the synchronizers are done).
+		/// </summary>
+		/// <param name="bounds"> World space object bounds </param>
+		/// <param name="count"> Number of objects </param>
+		/// <param name="lists"> Per-object light lists (result) </param>
+		void SelectLights(const AABB* bounds, size_t count, LightList* lists)const;
+
+
+	private:
+		// Scene light info
+		const Reference<SceneLightInfo> m_info;
+
+		// Number of worker threads for client updates
+		const size_t m_threadCount;
+
+		// Lock for the client collection
+		std::mutex m_clientLock;
+
+		// Registered clients
+		std::unordered_set<Reference<Client>> m_clients;
+
+		// Client list for the ongoing update
+		std::vector<Reference<Client>> m_clientList;
+
+		// Thread block for client updates
+		ThreadBlock m_block;
+
+		// Lights with finite bounds and their slots/intensities
+		std::vector<Sphere> m_spheres;
+		std::vector<uint32_t> m_sphereSlots;
+		std::vector<float> m_sphereIntensities;
+
+		// Lights with non-finite bounds (slot and intensity)
+		std::vector<std::pair<uint32_t, float>> m_globalLights;
+
+		// Invoked by SceneLightInfo when the lights change
+		void OnLightInfoChanged(const LightDescriptor::LightInfo* info, size_t count, const size_t* dirtyIndices, size_t dirtyCount);
+
+		// Rebuilds the light data
+		void UpdateLights(const AABB* bounds, const float* intensities, size_t count);
+	};
+}
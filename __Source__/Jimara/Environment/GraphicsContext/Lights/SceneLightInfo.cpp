@@ -1,11 +1,21 @@
 #include "SceneLightInfo.h"
+#include "../../../Core/Stopwatch.h"
+#include <algorithm>
+#include <limits>
 
 
 namespace Jimara {
 	SceneLightInfo::SceneLightInfo(GraphicsContext* context) 
-		: m_context(context), m_threadCount(std::thread::hardware_concurrency()) {
+		: m_context(context), m_threadCount(std::thread::hardware_concurrency()), m_activeSlotCount(0), m_lightCount(0), m_lastUpdateDuration(0.0f), m_typeGroupRevision(0) {
 		{
+			// Descriptor set change events are fired under the write lock, so nothing can slip between the subscription and the initial fetch:
 			GraphicsContext::ReadLock lock(m_context);
+			m_context->OnSceneLightDescriptorsAdded() += Callback<const Reference<LightDescriptor>*, size_t>(&SceneLightInfo::OnLightsAdded, this);
+			m_context->OnSceneLightDescriptorsRemoved() += Callback<const Reference<LightDescriptor>*, size_t>(&SceneLightInfo::OnLightsRemoved, this);
+			const Reference<LightDescriptor>* lights;
+			size_t count;
+			m_context->GetSceneLightDescriptors(lights, count);
+			OnLightsAdded(lights, count);
 			OnGraphicsSynched();
 		}
 		m_context->OnPostGraphicsSynch() += Callback<>(&SceneLightInfo::OnGraphicsSynched, this);
@@ -13,6 +23,8 @@ namespace Jimara {
 
 	SceneLightInfo::~SceneLightInfo() {
 		m_context->OnPostGraphicsSynch() -= Callback<>(&SceneLightInfo::OnGraphicsSynched, this);
+		m_context->OnSceneLightDescriptorsAdded() -= Callback<const Reference<LightDescriptor>*, size_t>(&SceneLightInfo::OnLightsAdded, this);
+		m_context->OnSceneLightDescriptorsRemoved() -= Callback<const Reference<LightDescriptor>*, size_t>(&SceneLightInfo::OnLightsRemoved, this);
 	}
 
 	namespace {
@@ -30,32 +42,209 @@ namespace Jimara {
 
 	GraphicsContext* SceneLightInfo::Context()const { return m_context; }
 
+	size_t SceneLightInfo::LightCount()const { return m_lightCount; }
+
+	size_t SceneLightInfo::ActiveSlotCount()const { return m_activeSlotCount; }
+
+	float SceneLightInfo::LastUpdateDuration()const { return m_lastUpdateDuration; }
+
+	uint64_t SceneLightInfo::LightTypeGroupRevision()const { return m_typeGroupRevision; }
+
 	Event<const LightDescriptor::LightInfo*, size_t>& SceneLightInfo::OnUpdateLightInfo() { return m_onUpdateLightInfo; }
 
+	Event<const LightDescriptor::LightInfo*, size_t, const size_t*, size_t>& SceneLightInfo::OnLightInfoChanged() { return m_onLightInfoChanged; }
+
 	void SceneLightInfo::ProcessLightInfo(const Callback<const LightDescriptor::LightInfo*, size_t>& processCallback) {
-		std::unique_lock<std::mutex> lock(m_lock);
+		std::unique_lock<std::recursive_mutex> lock(m_lock);
 		processCallback(m_info.data(), m_info.size());
 	}
 
+	void SceneLightInfo::ProcessLightInfo(const Callback<const LightDescriptor::LightInfo*, size_t, const size_t*, size_t>& processCallback) {
+		std::unique_lock<std::recursive_mutex> lock(m_lock);
+		while (m_allIndices.size() < m_info.size()) m_allIndices.push_back(m_allIndices.size());
+		processCallback(m_info.data(), m_info.size(), m_allIndices.data(), m_info.size());
+	}
+
+	void SceneLightInfo::ProcessLightBounds(const Callback<const AABB*, size_t>& processCallback) {
+		std::unique_lock<std::recursive_mutex> lock(m_lock);
+		processCallback(m_bounds.data(), m_bounds.size());
+	}
+
+	void SceneLightInfo::ProcessLightBounds(const Callback<const AABB*, const float*, size_t>& processCallback) {
+		std::unique_lock<std::recursive_mutex> lock(m_lock);
+		processCallback(m_bounds.data(), m_intensities.data(), m_bounds.size());
+	}
+
+	void SceneLightInfo::ProcessLightTypeGroups(const Callback<const LightTypeRange*, size_t, const uint32_t*, size_t>& processCallback) {
+		std::unique_lock<std::recursive_mutex> lock(m_lock);
+		processCallback(m_typeRanges.data(), m_typeRanges.size(), m_groupedSlots.data(), m_groupedSlots.size());
+	}
+
+	void SceneLightInfo::OnLightsAdded(const Reference<LightDescriptor>* lights, size_t count) {
+		std::unique_lock<std::recursive_mutex> lock(m_lock);
+		for (size_t i = 0; i < count; i++)
+			if (lights[i] != nullptr) m_addedLights.push_back(lights[i]);
+	}
+
+	void SceneLightInfo::OnLightsRemoved(const Reference<LightDescriptor>* lights, size_t count) {
+		std::unique_lock<std::recursive_mutex> lock(m_lock);
+		for (size_t i = 0; i < count; i++)
+			if (lights[i] != nullptr) m_removedLights.push_back(lights[i]);
+	}
+
+	namespace {
+		inline static AABB EmptyBounds() {
+			static const float inf = std::numeric_limits<float>::infinity();
+			AABB bounds = {};
+			bounds.start = Vector3(inf, inf, inf);
+			bounds.end = Vector3(-inf, -inf, -inf);
+			return bounds;
+		}
+	}
+
+	void SceneLightInfo::AssignSlots() {
+		m_reassignedSlots.clear();
+
+		// Slots of the removed lights get freed:
+		for (size_t i = 0; i < m_removedLights.size(); i++) {
+			std::unordered_map<LightDescriptor*, size_t>::iterator it = m_slots.find(m_removedLights[i]);
+			if (it == m_slots.end()) continue;
+			const size_t slot = it->second;
+			m_slots.erase(it);
+			m_descriptors[slot] = nullptr;
+			m_revisions[slot] = 0;
+			m_info[slot] = LightDescriptor::LightInfo{ EMPTY_SLOT_TYPE_ID, nullptr, 0 };
+			m_bounds[slot] = EmptyBounds();
+			m_intensities[slot] = 0.0f;
+			m_freeSlots.push(slot);
+			m_reassignedSlots.push_back(slot);
+		}
+		m_removedLights.clear();
+
+		// Added lights take the lowest free slots or extend the slot list:
+		for (size_t i = 0; i < m_addedLights.size(); i++) {
+			LightDescriptor* light = m_addedLights[i];
+			if (m_slots.find(light) != m_slots.end()) continue;
+			size_t slot;
+			if (m_freeSlots.empty()) {
+				slot = m_info.size();
+				m_info.push_back(LightDescriptor::LightInfo{ EMPTY_SLOT_TYPE_ID, nullptr, 0 });
+				m_bounds.push_back(EmptyBounds());
+				m_intensities.push_back(0.0f);
+				m_descriptors.push_back(nullptr);
+				m_revisions.push_back(0);
+			}
+			else {
+				slot = m_freeSlots.top();
+				m_freeSlots.pop();
+			}
+			m_slots[light] = slot;
+			m_descriptors[slot] = light;
+			m_revisions[slot] = light->Revision();
+			m_info[slot] = light->GetLightInfo();
+			m_bounds[slot] = light->GetLightBounds();
+			m_intensities[slot] = light->GetLightIntensity();
+			m_reassignedSlots.push_back(slot);
+		}
+		m_addedLights.clear();
+
+		size_t activeSlotCount = m_activeSlotCount;
+		for (size_t i = 0; i < m_reassignedSlots.size(); i++)
+			if (m_descriptors[m_reassignedSlots[i]] != nullptr && activeSlotCount <= m_reassignedSlots[i])
+				activeSlotCount = m_reassignedSlots[i] + 1;
+		while (activeSlotCount > 0 && m_descriptors[activeSlotCount - 1] == nullptr) activeSlotCount--;
+		m_activeSlotCount = activeSlotCount;
+		m_lightCount = m_slots.size();
+	}
+
+	void SceneLightInfo::UpdateTypeGroups() {
+		// Groups only change when the lights come and go or change their type:
+		bool changed = (m_reassignedSlots.size() > 0) || (m_groupedTypeIds.size() != m_info.size());
+		for (size_t i = 0; (!changed) && i < m_dirtyIndices.size(); i++)
+			changed = (m_groupedTypeIds[m_dirtyIndices[i]] != m_info[m_dirtyIndices[i]].typeId);
+		if (!changed) return;
+
+		// Counting sort by type identifier keeps the slots within each range in ascending order:
+		m_groupedTypeIds.resize(m_info.size());
+		size_t typeCount = 0;
+		size_t groupedCount = 0;
+		for (size_t i = 0; i < m_info.size(); i++) {
+			const uint32_t typeId = (m_descriptors[i] == nullptr) ? EMPTY_SLOT_TYPE_ID : m_info[i].typeId;
+			m_groupedTypeIds[i] = m_info[i].typeId;
+			if (typeId == EMPTY_SLOT_TYPE_ID) continue;
+			if (typeCount <= typeId) typeCount = static_cast<size_t>(typeId) + 1;
+			groupedCount++;
+		}
+		m_typeRanges.assign(typeCount, LightTypeRange{ 0u, 0u });
+		for (size_t i = 0; i < m_info.size(); i++)
+			if (m_descriptors[i] != nullptr && m_info[i].typeId != EMPTY_SLOT_TYPE_ID)
+				m_typeRanges[m_info[i].typeId].count++;
+		uint32_t start = 0;
+		for (size_t i = 0; i < typeCount; i++) {
+			m_typeRanges[i].start = start;
+			start += m_typeRanges[i].count;
+			m_typeRanges[i].count = 0;
+		}
+		m_groupedSlots.resize(groupedCount);
+		for (size_t i = 0; i < m_info.size(); i++) {
+			if (m_descriptors[i] == nullptr || m_info[i].typeId == EMPTY_SLOT_TYPE_ID) continue;
+			LightTypeRange& range = m_typeRanges[m_info[i].typeId];
+			m_groupedSlots[static_cast<size_t>(range.start) + range.count] = static_cast<uint32_t>(i);
+			range.count++;
+		}
+		m_typeGroupRevision++;
+	}
+
 	namespace {
 		struct Updater {
-			std::vector<LightDescriptor::LightInfo>* info;
-			const Reference<LightDescriptor>* lights;
+			LightDescriptor::LightInfo* info;
+			AABB* bounds;
+			float* intensities;
+			const Reference<LightDescriptor>* descriptors;
+			uint64_t* revisions;
+			std::vector<size_t>* dirtyIndices;
 			size_t count;
 		};
 	}
 
 	void SceneLightInfo::OnGraphicsSynched() {
-		std::unique_lock<std::mutex> lock(m_lock);
+		std::unique_lock<std::recursive_mutex> lock(m_lock);
+		Stopwatch stopwatch;
+		const size_t lastCount = m_info.size();
+		AssignSlots();
+
 		Updater updater = {};
-		updater.info = &m_info;
-		m_context->GetSceneLightDescriptors(updater.lights, updater.count);
-		if (m_info.size() != updater.count) m_info.resize(updater.count);
+		if (m_threadDirtyIndices.size() < m_threadCount) m_threadDirtyIndices.resize(m_threadCount);
+		if (m_threadDirtyIndices.size() < 1) m_threadDirtyIndices.resize(1);
+		updater.info = m_info.data();
+		updater.bounds = m_bounds.data();
+		updater.intensities = m_intensities.data();
+		updater.descriptors = m_descriptors.data();
+		updater.revisions = m_revisions.data();
+		updater.dirtyIndices = m_threadDirtyIndices.data();
+		updater.count = m_activeSlotCount;
+
+		// Each thread handles a contiguous range of the slots, so that the per-thread index lists can simply be concatenated:
 		auto job = [](ThreadBlock::ThreadInfo threadInfo, void* dataAddr) {
-			Updater info = *((Updater*)dataAddr);
-			for (size_t i = threadInfo.threadId; i < info.count; i += threadInfo.threadCount)
-				info.info->operator[](i) = info.lights[i]->GetLightInfo();
+			const Updater& info = *((Updater*)dataAddr);
+			const size_t workPerThread = (info.count + threadInfo.threadCount - 1) / threadInfo.threadCount;
+			const size_t start = (workPerThread * threadInfo.threadId);
+			const size_t end = std::min(start + workPerThread, info.count);
+			std::vector<size_t>& dirtyIndices = info.dirtyIndices[threadInfo.threadId];
+			dirtyIndices.clear();
+			for (size_t i = start; i < end; i++) {
+				LightDescriptor* light = info.descriptors[i];
+				if (light == nullptr) continue;
+				const uint64_t revision = light->Revision();
+				if (info.revisions[i] == revision && revision != LightDescriptor::UNTRACKED_REVISION) continue;
+				info.revisions[i] = revision;
+				info.info[i] = light->GetLightInfo();
+				info.bounds[i] = light->GetLightBounds();
+				info.intensities[i] = light->GetLightIntensity();
+				dirtyIndices.push_back(i);
+			}
 		};
+		size_t threadCount = 1;
 		if (updater.count < 128) {
 			ThreadBlock::ThreadInfo info;
 			info.threadCount = 1;
@@ -63,10 +252,27 @@ namespace Jimara {
 			job(info, &updater);
 		}
 		else {
-			size_t threadCount = (updater.count + 127) / 128;
+			threadCount = (updater.count + 127) / 128;
 			if (threadCount > m_threadCount) threadCount = m_threadCount;
 			m_block.Execute(threadCount, &updater, Callback<ThreadBlock::ThreadInfo, void*>(job));
 		}
+
+		m_dirtyIndices.clear();
+		for (size_t i = 0; i < threadCount; i++) {
+			const std::vector<size_t>& indices = m_threadDirtyIndices[i];
+			m_dirtyIndices.insert(m_dirtyIndices.end(), indices.begin(), indices.end());
+		}
+		if (m_reassignedSlots.size() > 0) {
+			m_dirtyIndices.insert(m_dirtyIndices.end(), m_reassignedSlots.begin(), m_reassignedSlots.end());
+			std::sort(m_dirtyIndices.begin(), m_dirtyIndices.end());
+			m_dirtyIndices.erase(std::unique(m_dirtyIndices.begin(), m_dirtyIndices.end()), m_dirtyIndices.end());
+		}
+
+		UpdateTypeGroups();
+		m_lastUpdateDuration = stopwatch.Elapsed();
+
 		m_onUpdateLightInfo(m_info.data(), m_info.size());
+		if (m_dirtyIndices.size() > 0 || lastCount != m_info.size())
+			m_onLightInfoChanged(m_info.data(), m_info.size(), m_dirtyIndices.data(), m_dirtyIndices.size());
 	}
 }
@@ -2,16 +2,41 @@
 #include "../GraphicsContext.h"
 #include "../../../Core/ObjectCache.h"
 #include "../../../Core/Collections/ThreadBlock.h"
+#include <unordered_map>
+#include <functional>
 #include <vector>
+#include <queue>
 #include <mutex>
+#include <atomic>
 
 
 namespace Jimara {
 	/// <summary>
 	/// Fetches scene graphics information on each update cycle
+	/// Notes:
+	///		0. Each light occupies a stable slot for it's entire lifetime; light info, bounds and every buffer derived from them are indexed by slot;
+	///		1. Slots of the removed lights are reused (lowest first) and are reported with EMPTY_SLOT_TYPE_ID, no data and empty bounds (start > end);
+	///		2. Only the lights, whose LightDescriptor::Revision() changed, get refreshed on each update;
+	///		3. Process calls are safe to make from within OnUpdateLightInfo() and OnLightInfoChanged() callbacks;
+	///		4. Occupied slots are also grouped by LightInfo::typeId into a single index list (ascending type identifier first, slot index second) with a per-type range table,
+	///			so that the lighting models can evaluate each light type in a dedicated loop instead of branching on the type per light.
 	/// </summary>
 	class SceneLightInfo : public virtual ObjectCache<GraphicsContext*>::StoredObject {
 	public:
+		/// <summary> Light type identifier, reported for empty slots </summary>
+		static const uint32_t EMPTY_SLOT_TYPE_ID = ~static_cast<uint32_t>(0);
+
+		/// <summary>
+		/// Range of the type-grouped slot list, occupied by a single light type (matches uvec2)
+		/// </summary>
+		struct LightTypeRange {
+			/// <summary> Index of the first entry within the type-grouped slot list </summary>
+			alignas(4) uint32_t start;
+
+			/// <summary> Number of lights of the type </summary>
+			alignas(4) uint32_t count;
+		};
+
 		/// <summary>
 		/// Constructor
 		/// </summary>
@@ -31,15 +56,58 @@ namespace Jimara {
 		/// <summary> "Owner" graphics contex </summary>
 		GraphicsContext* Context()const;
 
-		/// <summary> Invoked each time the data is refreshed </summary>
+		/// <summary> Number of lights in the scene (as of the last update) </summary>
+		size_t LightCount()const;
+
+		/// <summary> Number of slots, up to which the lights are stored (last occupied slot index + 1; as of the last update) </summary>
+		size_t ActiveSlotCount()const;
+
+		/// <summary> Time (in seconds), the last update took (excluding the event listeners; mostly for diagnostics and benchmarks) </summary>
+		float LastUpdateDuration()const;
+
+		/// <summary> Incremented each time the type ranges or the type-grouped slot list change </summary>
+		uint64_t LightTypeGroupRevision()const;
+
+		/// <summary> Invoked each time the data is refreshed (arguments are per-slot light info and slot count) </summary>
 		Event<const LightDescriptor::LightInfo*, size_t>& OnUpdateLightInfo();
 
+		/// <summary>
+		/// Invoked after the data gets refreshed, if any of the slots changed or the slot count is different
+		/// Note: Arguments are (per-slot light info, slot count, sorted indices of the changed slots, number of changed slots).
+		/// </summary>
+		Event<const LightDescriptor::LightInfo*, size_t, const size_t*, size_t>& OnLightInfoChanged();
+
 		/// <summary>
 		/// Safetly invokes given callback with current lighting information
 		/// </summary>
 		/// <param name="processCallback"> Callback to invoke </param>
 		void ProcessLightInfo(const Callback<const LightDescriptor::LightInfo*, size_t>& processCallback);
 
+		/// <summary>
+		/// Safetly invokes given callback with current lighting information (same arguments as OnLightInfoChanged, but with all of the slots reported as changed)
+		/// </summary>
+		/// <param name="processCallback"> Callback to invoke </param>
+		void ProcessLightInfo(const Callback<const LightDescriptor::LightInfo*, size_t, const size_t*, size_t>& processCallback);
+
+		/// <summary>
+		/// Safetly invokes given callback with current light bounds (same order as the lighting information)
+		/// </summary>
+		/// <param name="processCallback"> Callback to invoke </param>
+		void ProcessLightBounds(const Callback<const AABB*, size_t>& processCallback);
+
+		/// <summary>
+		/// Safetly invokes given callback with current light bounds and intensities (same order as the lighting information; empty slots have zero intensity)
+		/// </summary>
+		/// <param name="processCallback"> Callback to invoke </param>
+		void ProcessLightBounds(const Callback<const AABB*, const float*, size_t>& processCallback);
+
+		/// <summary>
+		/// Safetly invokes given callback with current light type groups
+		/// Note: Arguments are (per-type ranges, indexed by type identifier, number of ranges, type-grouped slot indices, number of grouped slots).
+		/// </summary>
+		/// <param name="processCallback"> Callback to invoke </param>
+		void ProcessLightTypeGroups(const Callback<const LightTypeRange*, size_t, const uint32_t*, size_t>& processCallback);
+
 
 	private:
 		// "Owner" graphics contex
@@ -48,18 +116,84 @@ namespace Jimara {
 		// Number of update threads
 		const size_t m_threadCount;
 
-		// Update lock
-		std::mutex m_lock;
+		// Update lock (recursive, so that the event listeners can access the data)
+		std::recursive_mutex m_lock;
 
 		// Worker thread block for updates
 		ThreadBlock m_block;
 
-		// Current light info
+		// Current per-slot light info
 		std::vector<LightDescriptor::LightInfo> m_info;
 
+		// Current per-slot light bounds
+		std::vector<AABB> m_bounds;
+
+		// Current per-slot light intensities
+		std::vector<float> m_intensities;
+
+		// Per-slot descriptors and their revisions, the current info was fetched from (nullptr for empty slots)
+		std::vector<Reference<LightDescriptor>> m_descriptors;
+		std::vector<uint64_t> m_revisions;
+
+		// Descriptor to slot index mapping
+		std::unordered_map<LightDescriptor*, size_t> m_slots;
+
+		// Free slots (lowest index first)
+		std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> m_freeSlots;
+
+		// Last occupied slot index + 1
+		std::atomic<size_t> m_activeSlotCount;
+
+		// Number of occupied slots
+		std::atomic<size_t> m_lightCount;
+
+		// Duration of the last update
+		std::atomic<float> m_lastUpdateDuration;
+
+		// Lights, added and removed since the last update
+		std::vector<Reference<LightDescriptor>> m_addedLights;
+		std::vector<Reference<LightDescriptor>> m_removedLights;
+
+		// Slots, that got occupied or freed during the ongoing update
+		std::vector<size_t> m_reassignedSlots;
+
+		// Per-thread changed slot indices from the last update
+		std::vector<std::vector<size_t>> m_threadDirtyIndices;
+
+		// Changed slot indices from the last update
+		std::vector<size_t> m_dirtyIndices;
+
+		// Per-slot type identifiers, the current groups were built with
+		std::vector<uint32_t> m_groupedTypeIds;
+
+		// Per-type ranges within m_groupedSlots
+		std::vector<LightTypeRange> m_typeRanges;
+
+		// Occupied slot indices, grouped by type
+		std::vector<uint32_t> m_groupedSlots;
+
+		// Revision of the type groups
+		std::atomic<uint64_t> m_typeGroupRevision;
+
+		// Index list, covering every slot (used by ProcessLightInfo)
+		std::vector<size_t> m_allIndices;
+
 		// Invoked each time the data is refreshed
 		EventInstance<const LightDescriptor::LightInfo*, size_t> m_onUpdateLightInfo;
 
+		// Invoked when the data changes
+		EventInstance<const LightDescriptor::LightInfo*, size_t, const size_t*, size_t> m_onLightInfoChanged;
+
+		// Scene light descriptor set change callbacks
+		void OnLightsAdded(const Reference<LightDescriptor>* lights, size_t count);
+		void OnLightsRemoved(const Reference<LightDescriptor>* lights, size_t count);
+
+		// Slot allocation (expects the lock to be held)
+		void AssignSlots();
+
+		// Rebuilds type ranges and the type-grouped slot list, if any of the slots got reassigned or changed type (expects the lock to be held)
+		void UpdateTypeGroups();
+
 		// Update function
 		void OnGraphicsSynched();
 	};
@@ -0,0 +1,404 @@
+#include "ShadowAtlas.h"
+#include <algorithm>
+#include <limits>
+
+
+namespace Jimara {
+	namespace {
+		// Minimal number of views, the atlas is allocated with:
+		static const size_t MIN_VIEW_CAPACITY = 8;
+
+		// Shape of the environment binding set (matches Jimara_ShadowCasterModel: light data at binding 0, view transform at MODEL_BINDING_START_ID):
+		class EnvironmentShape : public virtual Graphics::PipelineDescriptor::BindingSetDescriptor {
+		public:
+			inline virtual bool SetByEnvironment()const override { return true; }
+
+			inline virtual size_t ConstantBufferCount()const override { return 1; }
+			inline virtual BindingInfo ConstantBufferInfo(size_t)const override { return BindingInfo{ Graphics::StageMask(Graphics::PipelineStage::VERTEX), 1u }; }
+			inline virtual Reference<Graphics::Buffer> ConstantBuffer(size_t)const override { return nullptr; }
+
+			inline virtual size_t StructuredBufferCount()const override { return 1; }
+			inline virtual BindingInfo StructuredBufferInfo(size_t)const override {
+				return BindingInfo{ Graphics::StageMask(Graphics::PipelineStage::VERTEX, Graphics::PipelineStage::FRAGMENT), 0u };
+			}
+			inline virtual Reference<Graphics::ArrayBuffer> StructuredBuffer(size_t)const override { return nullptr; }
+
+			inline virtual size_t TextureSamplerCount()const override { return 0; }
+			inline virtual BindingInfo TextureSamplerInfo(size_t)const override { return BindingInfo(); }
+			inline virtual Reference<Graphics::TextureSampler> Sampler(size_t)const override { return nullptr; }
+
+			inline static const EnvironmentShape* Instance() {
+				static const EnvironmentShape shape;
+				return &shape;
+			}
+		};
+	}
+
+#pragma warning(disable: 4250)
+	class ShadowAtlas::EnvironmentDescriptor : public virtual Graphics::PipelineDescriptor, public virtual EnvironmentShape {
+	private:
+		const Reference<LightDataBuffer> m_lightDataBuffer;
+		const Graphics::BufferReference<Matrix4> m_viewTransform;
+
+	public:
+		inline EnvironmentDescriptor(GraphicsContext* context, LightDataBuffer* lightDataBuffer)
+			: m_lightDataBuffer(lightDataBuffer), m_viewTransform(context->Device()->CreateConstantBuffer<Matrix4>()) {}
+
+		inline void SetViewTransform(const Matrix4& viewProjection) {
+			m_viewTransform.Map() = viewProjection;
+			m_viewTransform->Unmap(true);
+		}
+
+		inline virtual bool SetByEnvironment()const override { return false; }
+		inline virtual Reference<Graphics::Buffer> ConstantBuffer(size_t)const override { return Reference<Graphics::Buffer>(m_viewTransform); }
+		inline virtual Reference<Graphics::ArrayBuffer> StructuredBuffer(size_t)const override { return m_lightDataBuffer->Buffer(); }
+
+		inline virtual size_t BindingSetCount()const override { return 1; }
+		inline virtual const Graphics::PipelineDescriptor::BindingSetDescriptor* BindingSet(size_t)const override {
+			return static_cast<const Graphics::PipelineDescriptor::BindingSetDescriptor*>(this);
+		}
+	};
+
+	// Renders the source pipeline geometry with the shadow caster shaders (environment set gets replaced, the rest are shared with the source)
+	class ShadowAtlas::CasterPipeline : public virtual Graphics::GraphicsPipeline::Descriptor {
+	private:
+		const Reference<Graphics::GraphicsPipeline::Descriptor> m_source;
+		ShadowCasterDescriptor* const m_caster;
+
+	public:
+		inline CasterPipeline(Graphics::GraphicsPipeline::Descriptor* source, ShadowCasterDescriptor* caster) : m_source(source), m_caster(caster) {}
+
+		inline virtual size_t BindingSetCount()const override { return std::max(m_source->BindingSetCount(), static_cast<size_t>(1)); }
+		inline virtual const Graphics::PipelineDescriptor::BindingSetDescriptor* BindingSet(size_t index)const override {
+			return (index > 0) ? m_source->BindingSet(index) : EnvironmentShape::Instance();
+		}
+
+		inline virtual Reference<Graphics::Shader> VertexShader() override { return m_caster->ShadowCasterVertexShader(); }
+		inline virtual Reference<Graphics::Shader> FragmentShader() override { return m_caster->ShadowCasterFragmentShader(); }
+
+		inline virtual size_t VertexBufferCount() override { return m_source->VertexBufferCount(); }
+		inline virtual Reference<Graphics::VertexBuffer> VertexBuffer(size_t index) override { return m_source->VertexBuffer(index); }
+
+		inline virtual size_t InstanceBufferCount() override { return m_source->InstanceBufferCount(); }
+		inline virtual Reference<Graphics::InstanceBuffer> InstanceBuffer(size_t index) override { return m_source->InstanceBuffer(index); }
+
+		inline virtual Graphics::ArrayBufferReference<uint32_t> IndexBuffer() override { return m_source->IndexBuffer(); }
+		inline virtual size_t IndexCount() override { return m_source->IndexCount(); }
+		inline virtual size_t InstanceCount() override { return m_source->InstanceCount(); }
+	};
+#pragma warning(default: 4250)
+
+	ShadowAtlas::ShadowAtlas(GraphicsContext* context)
+		: m_context(context), m_lightDataBuffer(LightDataBuffer::Instance(context))
+		, m_viewer{ Matrix4(1.0f), 0.0f, 0.0f }, m_renderCursor(0), m_renderedViewCount(0)
+		, m_environmentDescriptor(Object::Instantiate<EnvironmentDescriptor>(context, m_lightDataBuffer))
+		, m_inFlightBufferCount(0) {
+		{
+			// Pipeline set change events are fired under the write lock, so nothing can slip between the subscription and the initial fetch:
+			GraphicsContext::ReadLock lock(m_context);
+			m_context->OnSceneObjectPipelinesAdded() += Callback<const Reference<Graphics::GraphicsPipeline::Descriptor>*, size_t>(&ShadowAtlas::OnPipelinesAdded, this);
+			m_context->OnSceneObjectPipelinesRemoved() += Callback<const Reference<Graphics::GraphicsPipeline::Descriptor>*, size_t>(&ShadowAtlas::OnPipelinesRemoved, this);
+			const Reference<Graphics::GraphicsPipeline::Descriptor>* pipelines;
+			size_t count;
+			m_context->GetSceneObjectPipelines(pipelines, count);
+			OnPipelinesAdded(pipelines, count);
+			OnGraphicsSynched();
+		}
+		m_context->OnPostGraphicsSynch() += Callback<>(&ShadowAtlas::OnGraphicsSynched, this);
+	}
+
+	ShadowAtlas::~ShadowAtlas() {
+		m_context->OnPostGraphicsSynch() -= Callback<>(&ShadowAtlas::OnGraphicsSynched, this);
+		m_context->OnSceneObjectPipelinesAdded() -= Callback<const Reference<Graphics::GraphicsPipeline::Descriptor>*, size_t>(&ShadowAtlas::OnPipelinesAdded, this);
+		m_context->OnSceneObjectPipelinesRemoved() -= Callback<const Reference<Graphics::GraphicsPipeline::Descriptor>*, size_t>(&ShadowAtlas::OnPipelinesRemoved, this);
+	}
+
+	namespace {
+		class Cache : public virtual ObjectCache<GraphicsContext*> {
+		public:
+			inline static Reference<ShadowAtlas> Instance(GraphicsContext* context) {
+				static Cache cache;
+				return cache.GetCachedOrCreate(context, false,
+					[&]() ->Reference<ShadowAtlas> { return Object::Instantiate<ShadowAtlas>(context); });
+			}
+		};
+	}
+
+	Reference<ShadowAtlas> ShadowAtlas::Instance(GraphicsContext* context) { return Cache::Instance(context); }
+
+	GraphicsContext* ShadowAtlas::Context()const { return m_context; }
+
+	uint32_t ShadowAtlas::AllocateViews(uint32_t count) {
+		if (count <= 0) return NO_VIEW;
+		std::unique_lock<std::mutex> lock(m_lock);
+
+		// First fit; if no free run is long enough, the capacity grows geometrically and the run gets placed at the end:
+		size_t first = 0;
+		while (true) {
+			while (first < m_views.size() && m_views[first].allocated) first++;
+			size_t end = first;
+			while (end < m_views.size() && (end - first) < count && (!m_views[end].allocated)) end++;
+			if ((end - first) >= count) break;
+			else if (end >= m_views.size()) {
+				size_t capacity = std::max(m_views.size(), MIN_VIEW_CAPACITY);
+				while (capacity < (first + count)) capacity <<= 1;
+				m_views.resize(capacity);
+				break;
+			}
+			first = end;
+		}
+
+		for (size_t i = first; i < (first + count); i++) {
+			ViewData& view = m_views[i];
+			view = ViewData();
+			view.allocated = true;
+		}
+		return static_cast<uint32_t>(first);
+	}
+
+	void ShadowAtlas::FreeViews(uint32_t firstView, uint32_t count) {
+		if (firstView == NO_VIEW) return;
+		std::unique_lock<std::mutex> lock(m_lock);
+		const size_t end = std::min(static_cast<size_t>(firstView) + count, m_views.size());
+		for (size_t i = firstView; i < end; i++) {
+			// Freed views get their matrices cleared during the next Render() call:
+			ViewData& view = m_views[i];
+			view = ViewData();
+		}
+	}
+
+	void ShadowAtlas::SetViewTransform(uint32_t viewId, const Matrix4& viewProjection) {
+		std::unique_lock<std::mutex> lock(m_lock);
+		if (viewId >= m_views.size()) {
+			m_context->Log()->Error("ShadowAtlas::SetViewTransform - viewId out of bounds!");
+			return;
+		}
+		ViewData& view = m_views[viewId];
+		if (!view.allocated) {
+			m_context->Log()->Error("ShadowAtlas::SetViewTransform - View not allocated!");
+			return;
+		}
+		if (view.viewProjection == viewProjection) return;
+		view.viewProjection = viewProjection;
+		view.frustum = Math::FrustumFromMatrix(viewProjection);
+		view.dirty = true;
+	}
+
+	ShadowAtlas::Viewer ShadowAtlas::GetViewer()const {
+		std::unique_lock<std::mutex> lock(m_lock);
+		return m_viewer;
+	}
+
+	void ShadowAtlas::SetViewer(const Viewer& viewer) {
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_viewer = viewer;
+	}
+
+	size_t ShadowAtlas::ViewCapacity()const {
+		std::unique_lock<std::mutex> lock(m_lock);
+		return (m_viewBuffer == nullptr) ? 0 : m_viewBuffer->ObjectCount();
+	}
+
+	Graphics::ArrayBufferReference<Matrix4> ShadowAtlas::ViewBuffer()const {
+		std::unique_lock<std::mutex> lock(m_lock);
+		return m_viewBuffer;
+	}
+
+	Reference<Graphics::TextureSampler> ShadowAtlas::Sampler()const {
+		std::unique_lock<std::mutex> lock(m_lock);
+		return m_sampler;
+	}
+
+	size_t ShadowAtlas::RenderedViewCount()const { return m_renderedViewCount; }
+
+	bool ShadowAtlas::UpdateRenderResources(size_t inFlightBufferCount) {
+		Graphics::GraphicsDevice* const device = m_context->Device();
+		const Graphics::Texture::PixelFormat depthFormat = device->GetDepthFormat();
+
+		if (m_renderPass == nullptr) {
+			m_renderPass = device->CreateRenderPass(Graphics::Texture::Multisampling::SAMPLE_COUNT_1, 0, nullptr, depthFormat, false);
+			if (m_renderPass == nullptr) {
+				m_context->Log()->Error("ShadowAtlas::UpdateRenderResources - Failed to create a depth-only render pass!");
+				return false;
+			}
+		}
+
+		// Texture array, view buffer and the frame buffers get recreated when the capacity grows:
+		const size_t capacity = std::max(m_views.size(), MIN_VIEW_CAPACITY);
+		if (m_texture == nullptr || m_texture->ArraySize() < capacity) {
+			const Reference<Graphics::Texture> texture = device->CreateMultisampledTexture(
+				Graphics::Texture::TextureType::TEXTURE_2D, depthFormat, Size3(RESOLUTION, RESOLUTION, 1),
+				static_cast<uint32_t>(capacity), Graphics::Texture::Multisampling::SAMPLE_COUNT_1);
+			if (texture == nullptr) {
+				m_context->Log()->Error("ShadowAtlas::UpdateRenderResources - Failed to create the shadow map array!");
+				return false;
+			}
+			m_texture = texture;
+			m_sampler = m_texture->CreateView(Graphics::TextureView::ViewType::VIEW_2D_ARRAY)->CreateSampler(
+				Graphics::TextureSampler::FilteringMode::NEAREST, Graphics::TextureSampler::WrappingMode::CLAMP_TO_EDGE);
+			m_frameBuffers.clear();
+			for (size_t i = 0; i < capacity; i++)
+				m_frameBuffers.push_back(m_renderPass->CreateFrameBuffer(nullptr,
+					m_texture->CreateView(Graphics::TextureView::ViewType::VIEW_2D, 0, 1, static_cast<uint32_t>(i), 1), nullptr));
+			m_clearedLayers.assign(capacity, false);
+
+			m_viewBuffer = device->CreateArrayBuffer<Matrix4>(capacity);
+			m_viewMatrices.assign(capacity, Matrix4(0.0f));
+			memcpy(m_viewBuffer.Map(), m_viewMatrices.data(), capacity * sizeof(Matrix4));
+			m_viewBuffer->Unmap(true);
+
+			for (size_t i = 0; i < m_views.size(); i++) m_views[i].dirty = true;
+		}
+
+		// Pipeline set and the environment are tied to the in-flight buffer count:
+		if (m_pipelineSet == nullptr || m_inFlightBufferCount != inFlightBufferCount) {
+			const size_t maxInFlightCommandBuffers = (MAX_VIEWS_PER_FRAME * inFlightBufferCount);
+			m_environmentPipeline = device->CreateEnvironmentPipeline(m_environmentDescriptor, maxInFlightCommandBuffers);
+			m_pipelineSet = Object::Instantiate<Graphics::GraphicsPipelineSet>(device->GraphicsQueue(), m_renderPass, maxInFlightCommandBuffers);
+			for (std::unordered_map<Graphics::GraphicsPipeline::Descriptor*, CasterData>::const_iterator it = m_casters.begin(); it != m_casters.end(); ++it)
+				m_pipelineSet->AddPipelines(&it->second.pipeline, 1);
+			m_inFlightBufferCount = inFlightBufferCount;
+		}
+		return (m_environmentPipeline != nullptr);
+	}
+
+	void ShadowAtlas::Render(Graphics::PrimaryCommandBuffer* commandBuffer, size_t inFlightBufferId, size_t inFlightBufferCount) {
+		if (commandBuffer == nullptr || inFlightBufferCount <= 0) return;
+		else if (inFlightBufferId >= inFlightBufferCount) {
+			m_context->Log()->Error("ShadowAtlas::Render - inFlightBufferId out of bounds!");
+			return;
+		}
+		std::unique_lock<std::mutex> lock(m_lock);
+		if (!UpdateRenderResources(inFlightBufferCount)) return;
+
+		// Layers, that have never been rendered to, get cleared, so that the whole array ends up in a readable layout:
+		for (size_t i = 0; i < m_clearedLayers.size(); i++) {
+			if (m_clearedLayers[i]) continue;
+			m_renderPass->BeginPass(commandBuffer, m_frameBuffers[i], nullptr, false);
+			m_renderPass->EndPass(commandBuffer);
+			m_clearedLayers[i] = true;
+		}
+
+		// Matrices are collected and uploaded with a single map after all the views are recorded:
+		size_t firstChangedMatrix = m_viewMatrices.size();
+		size_t lastChangedMatrix = 0;
+		auto uploadMatrix = [&](size_t viewId, const Matrix4& matrix) {
+			m_viewMatrices[viewId] = matrix;
+			firstChangedMatrix = std::min(firstChangedMatrix, viewId);
+			lastChangedMatrix = std::max(lastChangedMatrix, viewId);
+		};
+
+		size_t renderedCount = 0;
+		const size_t viewCount = m_views.size();
+		if (m_renderCursor >= viewCount) m_renderCursor = 0;
+		for (size_t i = 0; i < viewCount && renderedCount < MAX_VIEWS_PER_FRAME; i++) {
+			const size_t viewId = (m_renderCursor + i) % viewCount;
+			ViewData& view = m_views[viewId];
+			if (!view.dirty) continue;
+
+			// Freed views only need their matrices cleared:
+			if (!view.allocated) {
+				uploadMatrix(viewId, Matrix4(0.0f));
+				view.dirty = false;
+				continue;
+			}
+
+			// Views without transforms have nothing to render yet:
+			if (view.viewProjection == Matrix4(0.0f)) continue;
+
+			m_environmentDescriptor->SetViewTransform(view.viewProjection);
+			Graphics::FrameBuffer* const frameBuffer = m_frameBuffers[viewId];
+			m_renderPass->BeginPass(commandBuffer, frameBuffer, nullptr, true);
+			m_pipelineSet->ExecutePipelines(commandBuffer, (renderedCount * inFlightBufferCount) + inFlightBufferId, frameBuffer, m_environmentPipeline);
+			m_renderPass->EndPass(commandBuffer);
+			uploadMatrix(viewId, view.viewProjection);
+
+			// Pipelines, that are still being created, are skipped, so the view has to be re-rendered once they are ready:
+			view.dirty = (m_pipelineSet->PendingPipelineCount() > 0);
+			renderedCount++;
+			m_renderedViewCount++;
+			m_renderCursor = (viewId + 1);
+		}
+
+		if (firstChangedMatrix <= lastChangedMatrix) {
+			const size_t count = (lastChangedMatrix - firstChangedMatrix + 1);
+			Matrix4* data = m_viewBuffer.MapRange(firstChangedMatrix, count);
+			if (data != nullptr) {
+				memcpy(data, m_viewMatrices.data() + firstChangedMatrix, count * sizeof(Matrix4));
+				m_viewBuffer->UnmapRange(true);
+			}
+		}
+	}
+
+	void ShadowAtlas::OnPipelinesAdded(const Reference<Graphics::GraphicsPipeline::Descriptor>* pipelines, size_t count) {
+		std::unique_lock<std::mutex> lock(m_lock);
+		for (size_t i = 0; i < count; i++)
+			if (dynamic_cast<ShadowCasterDescriptor*>(pipelines[i].operator->()) != nullptr)
+				m_addedPipelines.push_back(pipelines[i]);
+	}
+
+	void ShadowAtlas::OnPipelinesRemoved(const Reference<Graphics::GraphicsPipeline::Descriptor>* pipelines, size_t count) {
+		std::unique_lock<std::mutex> lock(m_lock);
+		for (size_t i = 0; i < count; i++)
+			if (dynamic_cast<ShadowCasterDescriptor*>(pipelines[i].operator->()) != nullptr)
+				m_removedPipelines.push_back(pipelines[i]);
+	}
+
+	void ShadowAtlas::InvalidateChangedBounds() {
+		if (m_changedBounds.empty()) return;
+		if (m_changedBoundResults.size() < m_changedBounds.size()) m_changedBoundResults.resize(m_changedBounds.size());
+		for (size_t i = 0; i < m_views.size(); i++) {
+			ViewData& view = m_views[i];
+			if (view.dirty || (!view.allocated)) continue;
+			if (Math::Intersects(view.frustum, m_changedBounds.data(), m_changedBounds.size(), m_changedBoundResults.data()) > 0)
+				view.dirty = true;
+		}
+		m_changedBounds.clear();
+	}
+
+	void ShadowAtlas::OnGraphicsSynched() {
+		std::unique_lock<std::mutex> lock(m_lock);
+		auto addBounds = [&](const AABB& bounds) {
+			if (!Math::IsEmpty(bounds)) m_changedBounds.push_back(bounds);
+		};
+
+		// Removed casters leave holes in the maps they were in:
+		for (size_t i = 0; i < m_removedPipelines.size(); i++) {
+			std::unordered_map<Graphics::GraphicsPipeline::Descriptor*, CasterData>::iterator it = m_casters.find(m_removedPipelines[i]);
+			if (it == m_casters.end()) continue;
+			addBounds(it->second.bounds);
+			if (m_pipelineSet != nullptr) m_pipelineSet->RemovePipelines(&it->second.pipeline, 1);
+			m_casters.erase(it);
+		}
+		m_removedPipelines.clear();
+
+		// Existing casters are checked for movement (bounds are per pipeline, so a single moving instance invalidates every view, the whole batch overlaps):
+		for (std::unordered_map<Graphics::GraphicsPipeline::Descriptor*, CasterData>::iterator it = m_casters.begin(); it != m_casters.end(); ++it) {
+			CasterData& data = it->second;
+			const uint64_t revision = data.caster->ShadowCasterRevision();
+			if (revision == data.revision) continue;
+			addBounds(data.bounds);
+			data.bounds = data.caster->ShadowCasterBounds();
+			data.revision = revision;
+			addBounds(data.bounds);
+		}
+
+		// New casters show up in the views, they overlap with:
+		for (size_t i = 0; i < m_addedPipelines.size(); i++) {
+			Graphics::GraphicsPipeline::Descriptor* pipeline = m_addedPipelines[i];
+			if (m_casters.find(pipeline) != m_casters.end()) continue;
+			ShadowCasterDescriptor* caster = dynamic_cast<ShadowCasterDescriptor*>(pipeline);
+			if (caster->ShadowCasterVertexShader() == nullptr) continue;
+			CasterData& data = m_casters[pipeline];
+			data.caster = caster;
+			data.pipeline = Object::Instantiate<CasterPipeline>(pipeline, caster);
+			data.bounds = caster->ShadowCasterBounds();
+			data.revision = caster->ShadowCasterRevision();
+			addBounds(data.bounds);
+			if (m_pipelineSet != nullptr) m_pipelineSet->AddPipelines(&data.pipeline, 1);
+		}
+		m_addedPipelines.clear();
+
+		InvalidateChangedBounds();
+	}
+}
@@ -0,0 +1,214 @@
+#pragma once
+#include "ShadowCasterDescriptor.h"
+#include "LightDataBuffer.h"
+#include "../../../Graphics/Data/GraphicsPipelineSet.h"
+
+
+namespace Jimara {
+	/// <summary>
+	/// Depth-only shadow maps for the lights within the graphics context
+	/// Notes:
+	///		0. Shadow maps are stored as layers of a single depth texture array; each layer is a 'view', defined by a view-projection matrix;
+	///		1. Lights allocate consecutive views (cascades for the directional lights, cube faces for the point lights and so on) and keep their transforms up to date;
+	///		2. A view gets re-rendered only if it's transform changes or any of the ShadowCasterDescriptor-s within it's frustum moves, appears or disappears;
+	///		3. View matrices become visible through ViewBuffer() only after the corresponding views get rendered,
+	///			so that the lighting models never sample the maps with the transforms they were not rendered with;
+	///		4. Views, that have never been rendered, have zero matrices.
+	/// </summary>
+	class ShadowAtlas : public virtual ObjectCache<GraphicsContext*>::StoredObject {
+	public:
+		/// <summary> View identifier, reported when there's no view (failed allocation, lights that do not cast shadows and alike) </summary>
+		static const uint32_t NO_VIEW = ~static_cast<uint32_t>(0);
+
+		/// <summary> Width and height of each shadow map </summary>
+		static const uint32_t RESOLUTION = 1024;
+
+		/// <summary> Maximal number of views, that get rendered during a single Render() call (the rest of the stale views wait for the subsequent calls) </summary>
+		static const size_t MAX_VIEWS_PER_FRAME = 16;
+
+		/// <summary>
+		/// Viewer information, the directional light cascades are fit to
+		/// </summary>
+		struct Viewer {
+			/// <summary> Viewer's view-projection matrix (world space to clip space) </summary>
+			Matrix4 viewProjection;
+
+			/// <summary> Near plane distance </summary>
+			float nearPlane;
+
+			/// <summary> Far plane distance (viewer is considered invalid, if this is not greater than the nearPlane) </summary>
+			float farPlane;
+		};
+
+		/// <summary>
+		/// Constructor
+		/// </summary>
+		/// <param name="context"> "Owner" graphics context </param>
+		ShadowAtlas(GraphicsContext* context);
+
+		/// <summary> Virtual destructor </summary>
+		virtual ~ShadowAtlas();
+
+		/// <summary>
+		/// Singleton instance per graphics context
+		/// </summary>
+		/// <param name="context"> "Owner" graphics context </param>
+		/// <returns> Instance, tied to the context </returns>
+		static Reference<ShadowAtlas> Instance(GraphicsContext* context);
+
+		/// <summary> "Owner" graphics contex </summary>
+		GraphicsContext* Context()const;
+
+		/// <summary>
+		/// Allocates consecutive views
+		/// </summary>
+		/// <param name="count"> Number of views </param>
+		/// <returns> First view identifier (NO_VIEW, if count is 0) </returns>
+		uint32_t AllocateViews(uint32_t count);
+
+		/// <summary>
+		/// Releases views, previously allocated with AllocateViews()
+		/// </summary>
+		/// <param name="firstView"> First view identifier (value, returned by AllocateViews()) </param>
+		/// <param name="count"> Number of views (same as the one, AllocateViews() was invoked with) </param>
+		void FreeViews(uint32_t firstView, uint32_t count);
+
+		/// <summary>
+		/// Sets view transform (the view gets marked stale only if the transform actually changes)
+		/// </summary>
+		/// <param name="viewId"> View identifier </param>
+		/// <param name="viewProjection"> World space to clip space transformation (clip space depth range is expected to be [0; 1]) </param>
+		void SetViewTransform(uint32_t viewId, const Matrix4& viewProjection);
+
+		/// <summary> Viewer, the directional light cascades are fit to </summary>
+		Viewer GetViewer()const;
+
+		/// <summary>
+		/// Sets viewer, the directional light cascades should be fit to
+		/// </summary>
+		/// <param name="viewer"> Viewer information </param>
+		void SetViewer(const Viewer& viewer);
+
+		/// <summary> Number of views, the atlas has space for (ViewBuffer() and Sampler() have the same number of elements/layers) </summary>
+		size_t ViewCapacity()const;
+
+		/// <summary> Per-view view-projection matrices (buffer instance changes when the capacity grows) </summary>
+		Graphics::ArrayBufferReference<Matrix4> ViewBuffer()const;
+
+		/// <summary> Sampler of the shadow map array (instance changes when the capacity grows) </summary>
+		Reference<Graphics::TextureSampler> Sampler()const;
+
+		/// <summary>
+		/// Renders stale shadow maps
+		/// Notes:
+		///		0. Should be invoked outside any render pass, before the passes, that sample the atlas, while holding GraphicsContext::ReadLock;
+		///		1. Each map is rendered with GraphicsPipelineSet, so the casters get recorded on secondary command buffers in parallel.
+		/// </summary>
+		/// <param name="commandBuffer"> Command buffer to record the shadow passes on </param>
+		/// <param name="inFlightBufferId"> In-flight command buffer index </param>
+		/// <param name="inFlightBufferCount"> Number of in-flight command buffers, the renderer uses </param>
+		void Render(Graphics::PrimaryCommandBuffer* commandBuffer, size_t inFlightBufferId, size_t inFlightBufferCount);
+
+		/// <summary> Number of times, any view has been rendered so far (mostly for diagnostics and tests) </summary>
+		size_t RenderedViewCount()const;
+
+
+	private:
+		// "Owner" graphics contex
+		const Reference<GraphicsContext> m_context;
+
+		// Light data buffer (part of the environment binding set)
+		const Reference<LightDataBuffer> m_lightDataBuffer;
+
+		// Lock for the view and caster data
+		mutable std::mutex m_lock;
+
+		// Viewer
+		Viewer m_viewer;
+
+		// Data per view
+		struct ViewData {
+			// Requested view-projection matrix
+			Matrix4 viewProjection;
+
+			// View frustum
+			Frustum frustum;
+
+			// True, if the view is allocated
+			bool allocated;
+
+			// True, if the view has to be re-rendered
+			bool dirty;
+
+			// Constructor
+			inline ViewData() : viewProjection(0.0f), frustum{}, allocated(false), dirty(true) {}
+		};
+
+		// Data per view (size of the list is the same as the view capacity)
+		std::vector<ViewData> m_views;
+
+		// Index of the view, the next Render() call starts looking for the stale views from (keeps the views from starving)
+		size_t m_renderCursor;
+
+		// Number of times, any view has been rendered so far
+		std::atomic<size_t> m_renderedViewCount;
+
+		// Shadow caster information
+		class CasterPipeline;
+		struct CasterData {
+			// Source descriptor
+			Reference<ShadowCasterDescriptor> caster;
+
+			// Shadow pipeline descriptor, used during rendering
+			Reference<Graphics::GraphicsPipeline::Descriptor> pipeline;
+
+			// Caster bounds, as of the last update
+			AABB bounds;
+
+			// Caster revision, as of the last update
+			uint64_t revision;
+		};
+
+		// Shadow casters within the scene
+		std::unordered_map<Graphics::GraphicsPipeline::Descriptor*, CasterData> m_casters;
+
+		// Bounds of the casters that moved, appeared or disappeared during the last update (used for view invalidation)
+		std::vector<AABB> m_changedBounds;
+
+		// Invalidation results per changed bound
+		std::vector<uint8_t> m_changedBoundResults;
+
+		// Shadow caster pipelines, added and removed since the last render
+		std::vector<Reference<Graphics::GraphicsPipeline::Descriptor>> m_addedPipelines;
+		std::vector<Reference<Graphics::GraphicsPipeline::Descriptor>> m_removedPipelines;
+
+		// Environment pipeline descriptor (binds the light data and the transform of the view, that is being recorded)
+		class EnvironmentDescriptor;
+		const Reference<EnvironmentDescriptor> m_environmentDescriptor;
+
+		// Rendering resources (created lazily, during Render() calls):
+		Reference<Graphics::RenderPass> m_renderPass;
+		Reference<Graphics::Texture> m_texture;
+		Reference<Graphics::TextureSampler> m_sampler;
+		std::vector<Reference<Graphics::FrameBuffer>> m_frameBuffers;
+		std::vector<bool> m_clearedLayers;
+		Graphics::ArrayBufferReference<Matrix4> m_viewBuffer;
+		std::vector<Matrix4> m_viewMatrices;
+		Reference<Graphics::Pipeline> m_environmentPipeline;
+		Reference<Graphics::GraphicsPipelineSet> m_pipelineSet;
+		size_t m_inFlightBufferCount;
+
+		// Scene object pipeline change callbacks
+		void OnPipelinesAdded(const Reference<Graphics::GraphicsPipeline::Descriptor>* pipelines, size_t count);
+		void OnPipelinesRemoved(const Reference<Graphics::GraphicsPipeline::Descriptor>* pipelines, size_t count);
+
+		// Marks the views, that overlap with m_changedBounds, stale (expects the lock to be held)
+		void InvalidateChangedBounds();
+
+		// (Re)creates the rendering resources, if the capacity or the in-flight buffer count changes (expects the lock to be held)
+		bool UpdateRenderResources(size_t inFlightBufferCount);
+
+		// Update function (refreshes caster bounds)
+		void OnGraphicsSynched();
+	};
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "../../../Graphics/GraphicsDevice.h"
+#include "../../../Math/Bounds.h"
+
+namespace Jimara {
+	/// <summary>
+	/// Interface, implemented by the scene object pipeline descriptors, that can be drawn into the shadow maps
+	/// Notes:
+	///		0. ShadowAtlas looks for this interface among the GraphicsContext's scene object pipelines and renders them with their vertex/instance/index buffers,
+	///			binding sets (except for the environment, that gets replaced) and the shaders, provided here;
+	///		1. Shadow caster shaders are expected to be the lit shaders, generated for Jimara_ShadowCasterModel lighting model.
+	/// </summary>
+	class ShadowCasterDescriptor : public virtual Object {
+	public:
+		/// <summary> Vertex shader for depth-only rendering (nullptr means, the object does not cast shadows) </summary>
+		virtual Reference<Graphics::Shader> ShadowCasterVertexShader() = 0;
+
+		/// <summary> Fragment shader for depth-only rendering </summary>
+		virtual Reference<Graphics::Shader> ShadowCasterFragmentShader() = 0;
+
+		/// <summary> World space bounding box, that contains all of the rendered geometry </summary>
+		virtual AABB ShadowCasterBounds() = 0;
+
+		/// <summary> Revision of the geometry (expected to change each time anything moves, appears or disappears) </summary>
+		virtual uint64_t ShadowCasterRevision() = 0;
+	};
+}
@@ -1,28 +1,182 @@
 #include "GraphicsPipelineSet.h"
+#include <chrono>
+#include <condition_variable>
+#include <queue>
+#include <string>
 
 namespace Jimara {
 	namespace Graphics {
+		namespace {
+			// Number of times the creation worker tries to create a pipeline before giving up on it
+			static const size_t MAX_PIPELINE_CREATION_ATTEMPTS = 3;
+		}
+
+		class GraphicsPipelineSet::PipelineCreationWorker : public virtual ObjectCache<GraphicsDevice*>::StoredObject {
+		public:
+			// Worker, shared by all the sets of the device
+			inline static Reference<PipelineCreationWorker> Instance(GraphicsDevice* device) {
+				class Cache : public virtual ObjectCache<GraphicsDevice*> {
+				public:
+					inline Reference<PipelineCreationWorker> Get(GraphicsDevice* device) {
+						return GetCachedOrCreate(device, false,
+							[&]() -> Reference<PipelineCreationWorker> { return Object::Instantiate<PipelineCreationWorker>(device); });
+					}
+				};
+				static Cache cache;
+				return cache.Get(device);
+			}
+
+			// Constructor
+			inline PipelineCreationWorker(GraphicsDevice* device) : m_device(device), m_stopped(false) {
+				m_thread = std::thread([](PipelineCreationWorker* self) { self->Run(); }, this);
+			}
+
+			// Virtual destructor
+			inline virtual ~PipelineCreationWorker() {
+				{
+					std::unique_lock<std::mutex> lock(m_lock);
+					m_stopped = true;
+					m_condition.notify_all();
+				}
+				m_thread.join();
+			}
+
+			// Schedules pipeline creation
+			inline void Enqueue(CreationContext* context, const DescriptorData* added, size_t count) {
+				std::unique_lock<std::mutex> lock(m_lock);
+				for (size_t i = 0; i < count; i++) {
+					Request request;
+					request.context = context;
+					request.instance = added[i].instance;
+					request.attempts = 0;
+					m_queue.push(request);
+				}
+				m_condition.notify_one();
+			}
+
+		private:
+			// Pipeline creation request
+			struct Request {
+				// Set-wide data
+				Reference<CreationContext> context;
+
+				// Pipeline to create
+				Reference<PipelineInstance> instance;
+
+				// Number of failed creation attempts so far
+				size_t attempts;
+			};
+
+			// "Owner" device
+			const Reference<GraphicsDevice> m_device;
+
+			// Lock for the queue
+			std::mutex m_lock;
+
+			// Notifies the worker thread about new requests
+			std::condition_variable m_condition;
+
+			// Pipelines, waiting to be created (from all the sets of the device)
+			std::queue<Request> m_queue;
+
+			// Set on destruction to stop the thread
+			bool m_stopped;
+
+			// Worker thread
+			std::thread m_thread;
+
+			// Worker thread function
+			inline void Run() {
+				while (true) {
+					Request request;
+					{
+						std::unique_lock<std::mutex> lock(m_lock);
+						while (m_queue.empty() && (!m_stopped))
+							m_condition.wait(lock);
+						if (m_stopped) return;
+						request = m_queue.front();
+						m_queue.pop();
+					}
+					PipelineInstance* instance = request.instance;
+					if (instance->abandoned) continue;
+
+					Reference<GraphicsPipeline> pipeline = request.context->renderPass->CreateGraphicsPipeline(instance->descriptor, request.context->maxInFlightCommandBuffers);
+					if (pipeline != nullptr) {
+						instance->pipeline = pipeline;
+						{
+							std::unique_lock<std::mutex> stateLock(request.context->stateLock);
+							instance->state = PipelineState::READY;
+							if (!instance->abandoned) request.context->pendingPipelineCount--;
+						}
+						request.context->createdPipelineCount++;
+						continue;
+					}
+
+					// Failures go to the back of the queue, so that the other pipelines do not have to wait for the retries:
+					request.attempts++;
+					if (request.attempts < MAX_PIPELINE_CREATION_ATTEMPTS) {
+						m_device->Log()->Warning("GraphicsPipelineSet - Failed to create a pipeline (attempt "
+							+ std::to_string(request.attempts) + "/" + std::to_string(MAX_PIPELINE_CREATION_ATTEMPTS) + "); retrying...");
+						std::unique_lock<std::mutex> lock(m_lock);
+						m_queue.push(request);
+					}
+					else {
+						m_device->Log()->Error("GraphicsPipelineSet - Failed to create a pipeline after "
+							+ std::to_string(MAX_PIPELINE_CREATION_ATTEMPTS) + " attempts; it will not be drawn!");
+						std::unique_lock<std::mutex> stateLock(request.context->stateLock);
+						instance->state = PipelineState::FAILED;
+						if (!instance->abandoned) {
+							request.context->pendingPipelineCount--;
+							request.context->failedPipelineCount++;
+						}
+					}
+				}
+			}
+		};
+
 		GraphicsPipelineSet::GraphicsPipelineSet(DeviceQueue* queue, RenderPass* renderPass, size_t maxInFlightCommandBuffers, size_t threadCount)
 			: m_queue(queue), m_renderPass(renderPass), m_maxInFlightCommandBuffers(maxInFlightCommandBuffers)
+			, m_creationContext(Object::Instantiate<CreationContext>(renderPass, maxInFlightCommandBuffers))
+			, m_creationWorker(PipelineCreationWorker::Instance(renderPass->Device()))
 			, m_workerCommand(WorkerCommand::NO_OP), m_workerData(threadCount)
-			, m_inFlightBufferId(0)
-			, m_activeFrameBuffer(nullptr), m_environmentPipeline(nullptr) {}
+			, m_inFlightBufferId(0), m_chunkCursor(0), m_chunkBuffers(maxInFlightCommandBuffers)
+			, m_activeFrameBuffer(nullptr), m_environmentPipeline(nullptr)
+			, m_revision(0), m_recordedStates(maxInFlightCommandBuffers), m_environmentRefreshed(false), m_environmentValid(false) {}
 
-		GraphicsPipelineSet::~GraphicsPipelineSet() {}
+		GraphicsPipelineSet::~GraphicsPipelineSet() {
+			// Requests, still queued on the shared worker, get skipped:
+			for (size_t i = 0; i < m_data.Size(); i++)
+				m_data[i].instance->abandoned = true;
+		}
 
 		void GraphicsPipelineSet::AddPipelines(const Reference<GraphicsPipeline::Descriptor>* descriptors, size_t count) {
 			if (descriptors == nullptr || count <= 0) return;
 			std::unique_lock<std::mutex> lock(m_dataLock);
-			m_data.Add(descriptors, count, [&](const DescriptorData*, size_t numAdded) {
-				if (numAdded > 0) m_pipelineOrder.clear();
+			m_data.Add(descriptors, count, [&](const DescriptorData* added, size_t numAdded) {
+				if (numAdded <= 0) return;
+				m_pipelineOrder.clear();
+				m_revision++;
+				m_creationContext->pendingPipelineCount += numAdded;
+				// Pipelines get created in the background, so that the recording threads never have to wait for shader/pipeline compilation:
+				m_creationWorker->Enqueue(m_creationContext, added, numAdded);
 				});
 		}
 
 		void GraphicsPipelineSet::RemovePipelines(const Reference<GraphicsPipeline::Descriptor>* descriptors, size_t count) {
 			if (descriptors == nullptr || count <= 0) return;
 			std::unique_lock<std::mutex> lock(m_dataLock);
-			m_data.Remove(descriptors, count, [&](const DescriptorData*, size_t numRemoved) {
-				if (numRemoved > 0) m_pipelineOrder.clear();
+			m_data.Remove(descriptors, count, [&](const DescriptorData* removed, size_t numRemoved) {
+				if (numRemoved <= 0) return;
+				m_pipelineOrder.clear();
+				m_revision++;
+				// Removed pipelines stop counting as pending or failed (the worker does not update the counters for abandoned ones):
+				std::unique_lock<std::mutex> stateLock(m_creationContext->stateLock);
+				for (size_t i = 0; i < numRemoved; i++) {
+					PipelineInstance* instance = removed[i].instance;
+					instance->abandoned = true;
+					if (instance->state == PipelineState::PENDING) m_creationContext->pendingPipelineCount--;
+					else if (instance->state == PipelineState::FAILED) m_creationContext->failedPipelineCount--;
+				}
 				});
 		}
 
@@ -41,16 +195,94 @@ namespace Jimara {
 				m_pipelineOrder.resize(m_data.Size());
 				ExecuteJob(WorkerCommand::RESET_PIPELINE_ORDER);
 			}
+
 			m_inFlightBufferId = commandBufferId;
 			m_activeFrameBuffer = targetFrameBuffer;
 			m_environmentPipeline = environmentPipeline;
-			ExecuteJob(WorkerCommand::RECORD_PIPELINES);
-			for (size_t i = 0; i < m_workerData.size(); i++)
-				secondaryBuffers.push_back(m_workerData[i].commandBuffers[commandBufferId]);
+
+			// If the pipeline collection and the render target did not change since the last time this in-flight buffer was recorded, we only need to refresh:
+			// (Pipelines that got created after the last recording also need a full record to be included)
+			const size_t createdPipelineCount = m_creationContext->createdPipelineCount;
+			RecordedState& recordedState = m_recordedStates[commandBufferId];
+			if (recordedState.valid && recordedState.revision == m_revision && recordedState.createdPipelineCount == createdPipelineCount
+				&& recordedState.frameBuffer == targetFrameBuffer && recordedState.environmentPipeline == environmentPipeline) {
+				m_environmentRefreshed = false;
+				m_environmentValid = false;
+				ExecuteJob(WorkerCommand::REFRESH_PIPELINES);
+			}
+			else {
+				// Costs only decide, where the chunks are split; the order of the pipelines stays the same:
+				ExecuteJob(WorkerCommand::UPDATE_PIPELINE_COSTS);
+				SplitIntoChunks();
+				m_chunkBuffers[commandBufferId].resize(m_chunkEnds.size());
+				m_chunkCursor = 0;
+				ExecuteJob(WorkerCommand::RECORD_PIPELINES);
+
+				recordedState.revision = m_revision;
+				recordedState.frameBuffer = targetFrameBuffer;
+				recordedState.environmentPipeline = environmentPipeline;
+				recordedState.createdPipelineCount = createdPipelineCount;
+				recordedState.valid = true;
+			}
+
+			// Refresh buffers contain no draw calls, so they can go first; chunks are submitted in order:
+			for (size_t i = 0; i < m_workerData.size(); i++) {
+				const WorkerData& worker = m_workerData[i];
+				if (worker.refreshBufferUsed) secondaryBuffers.push_back(worker.refreshBuffers[commandBufferId]);
+			}
+			const std::vector<Reference<SecondaryCommandBuffer>>& chunkBuffers = m_chunkBuffers[commandBufferId];
+			for (size_t i = 0; i < chunkBuffers.size(); i++)
+				if (chunkBuffers[i] != nullptr) secondaryBuffers.push_back(chunkBuffers[i]);
 		}
 
+		size_t GraphicsPipelineSet::PendingPipelineCount() { return m_creationContext->pendingPipelineCount; }
+
+		size_t GraphicsPipelineSet::FailedPipelineCount() { return m_creationContext->failedPipelineCount; }
+
 		namespace {
 			typedef void(*JobFn)(GraphicsPipelineSet* self, size_t threadId);
+
+			// Recording time, assumed for the pipelines that have not been recorded yet (in seconds; 10us is about what a descriptor refresh, bind and a single draw take to record)
+			static const float DEFAULT_PIPELINE_RECORD_TIME = 0.00001f;
+
+			// Estimated cost per drawn index (index count * instance count; in seconds);
+			// Recording time barely depends on the draw size, but heavy draws still take longer to refresh (instance buffers, for example),
+			// so a draw of 10000 indices weighs as much as a never-measured pipeline.
+			static const float PIPELINE_COST_PER_DRAWN_INDEX = (DEFAULT_PIPELINE_RECORD_TIME / 10000.0f);
+
+			// Weight of the last measurement when smoothing pipeline recording times (about 4 frames to settle on a new value)
+			static const float PIPELINE_RECORD_TIME_SMOOTHING = 0.25f;
+
+			// Number of chunks per worker the pipelines are split into;
+			// More chunks let the workers, that are done early, take over more of the remaining work,
+			// but each chunk is a separate secondary command buffer with it's own environment pipeline bind.
+			static const size_t CHUNKS_PER_WORKER = 4;
+		}
+
+		void GraphicsPipelineSet::SplitIntoChunks() {
+			const size_t pipelineCount = m_pipelineOrder.size();
+			size_t chunkCount = m_workerData.size() * CHUNKS_PER_WORKER;
+			if (chunkCount > pipelineCount) chunkCount = pipelineCount;
+			m_chunkEnds.clear();
+			if (chunkCount <= 0) return;
+
+			float totalCost = 0.0f;
+			for (size_t i = 0; i < pipelineCount; i++)
+				totalCost += m_data[m_pipelineOrder[i]].cost;
+
+			// Contiguous ranges with (roughly) equal cost; each chunk gets at least one pipeline:
+			float accumulatedCost = 0.0f;
+			size_t pipelineId = 0;
+			for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+				const float targetCost = (totalCost * static_cast<float>(chunk)) / static_cast<float>(chunkCount);
+				const size_t maxEnd = pipelineCount - (chunkCount - chunk);
+				do {
+					accumulatedCost += m_data[m_pipelineOrder[pipelineId]].cost;
+					pipelineId++;
+				} while (pipelineId < maxEnd && accumulatedCost < targetCost);
+				m_chunkEnds.push_back(pipelineId);
+			}
+			m_chunkEnds.push_back(pipelineCount);
 		}
 
 		void GraphicsPipelineSet::ExecuteJob(WorkerCommand command) {
@@ -72,6 +304,50 @@ namespace Jimara {
 					return std::make_pair(first, (last < pipelineCount) ? last : pipelineCount);
 				};
 
+				// <Used by recording jobs; makes sure the worker has it's command buffers>
+				static auto prepareWorker = [](GraphicsPipelineSet* self, size_t threadId) -> WorkerData& {
+					WorkerData& worker = self->m_workerData[threadId];
+					if (worker.commandBuffers.size() < self->m_maxInFlightCommandBuffers) {
+						if (worker.pool == nullptr) worker.pool = self->m_queue->CreateCommandPool();
+						worker.commandBuffers.resize(self->m_maxInFlightCommandBuffers);
+						worker.refreshBuffers = worker.pool->CreateSecondaryCommandBuffers(self->m_maxInFlightCommandBuffers);
+						worker.recordedChunks.resize(self->m_maxInFlightCommandBuffers);
+					}
+					worker.refreshBufferUsed = false;
+					return worker;
+				};
+
+				// <Used by recording jobs; resets worker's command buffer for the recorded chunk, begins recording and executes the environment pipeline>
+				static auto beginRecording = [](GraphicsPipelineSet* self, WorkerData& worker, size_t recordedChunkId) -> Pipeline::CommandBufferInfo {
+					std::vector<Reference<SecondaryCommandBuffer>>& commandBuffers = worker.commandBuffers[self->m_inFlightBufferId];
+					while (commandBuffers.size() <= recordedChunkId)
+						commandBuffers.push_back(worker.pool->CreateSecondaryCommandBuffer());
+					SecondaryCommandBuffer* commandBuffer = commandBuffers[recordedChunkId];
+					self->m_chunkBuffers[self->m_inFlightBufferId][worker.recordedChunks[self->m_inFlightBufferId][recordedChunkId].chunk] = commandBuffer;
+					Pipeline::CommandBufferInfo info(commandBuffer, self->m_inFlightBufferId);
+					info.commandBuffer->Reset();
+					commandBuffer->BeginRecording(self->m_renderPass, (FrameBuffer*)self->m_activeFrameBuffer);
+					Pipeline* environment = ((Pipeline*)self->m_environmentPipeline);
+					if (environment != nullptr) {
+						std::unique_lock<std::mutex> lock(self->m_sharedPipelineAccessLock);
+						environment->Execute(info);
+					}
+					return info;
+				};
+
+				// <Used by recording jobs; records a single pipeline and measures the time it took (returns false, if the pipeline is not ready)>
+				static auto recordPipeline = [](GraphicsPipelineSet* self, const DescriptorData& data, const Pipeline::CommandBufferInfo& info) -> bool {
+					// Pipelines, that are still being created (or failed to be created) are skipped:
+					if (data.instance->state != PipelineState::READY) return false;
+					GraphicsPipeline* pipeline = data.instance->pipeline;
+					const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+					pipeline->Execute(info);
+					const float elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+					data.recordTime = (data.recordTime < 0.0f) ? elapsed
+						: (data.recordTime + (elapsed - data.recordTime) * PIPELINE_RECORD_TIME_SMOOTHING);
+					return true;
+				};
+
 				// RESET_PIPELINE_ORDER Job: Sets pipeline order the same as the data array
 				jobs[static_cast<uint8_t>(WorkerCommand::RESET_PIPELINE_ORDER)] = [](GraphicsPipelineSet* self, size_t threadId) {
 					std::pair<size_t, size_t> range = extractRange(self, threadId);
@@ -79,37 +355,88 @@ namespace Jimara {
 						self->m_pipelineOrder[i] = i;
 				};
 
+				// UPDATE_PIPELINE_COSTS Job: Estimates recording cost from the draw size and the measured recording time from previous frames
+				jobs[static_cast<uint8_t>(WorkerCommand::UPDATE_PIPELINE_COSTS)] = [](GraphicsPipelineSet* self, size_t threadId) {
+					std::pair<size_t, size_t> range = extractRange(self, threadId);
+					for (size_t i = range.first; i < range.second; i++) {
+						const DescriptorData& data = self->m_data[i];
+						const float drawnIndices = static_cast<float>(data.descriptor->IndexCount()) * static_cast<float>(data.descriptor->InstanceCount());
+						data.cost = ((data.recordTime >= 0.0f) ? data.recordTime : DEFAULT_PIPELINE_RECORD_TIME) + (drawnIndices * PIPELINE_COST_PER_DRAWN_INDEX);
+					}
+				};
+
 				// RECORD_PIPELINES Job: Records pipeline execution on secondary command buffers
 				jobs[static_cast<uint8_t>(WorkerCommand::RECORD_PIPELINES)] = [](GraphicsPipelineSet* self, size_t threadId) {
-					WorkerData& worker = self->m_workerData[threadId];
-					if (worker.commandBuffers.size() < self->m_maxInFlightCommandBuffers) {
-						if (worker.pool == nullptr) worker.pool = self->m_queue->CreateCommandPool();
-						worker.commandBuffers = worker.pool->CreateSecondaryCommandBuffers(self->m_maxInFlightCommandBuffers);
+					WorkerData& worker = prepareWorker(self, threadId);
+					std::vector<RecordedChunk>& recordedChunks = worker.recordedChunks[self->m_inFlightBufferId];
+					recordedChunks.clear();
+					const size_t chunkCount = self->m_chunkEnds.size();
+					while (true) {
+						// Workers take chunks from the shared cursor till there's nothing left, so the ones done early steal the remaining work:
+						const size_t chunk = self->m_chunkCursor.fetch_add(1);
+						if (chunk >= chunkCount) break;
+						recordedChunks.push_back(RecordedChunk());
+						RecordedChunk& recordedChunk = recordedChunks.back();
+						recordedChunk.chunk = chunk;
+						Pipeline::CommandBufferInfo info = beginRecording(self, worker, recordedChunks.size() - 1);
+						const size_t first = (chunk > 0) ? self->m_chunkEnds[chunk - 1] : 0;
+						const size_t last = self->m_chunkEnds[chunk];
+						for (size_t i = first; i < last; i++) {
+							const size_t pipelineIndex = self->m_pipelineOrder[i];
+							if (recordPipeline(self, self->m_data[pipelineIndex], info))
+								recordedChunk.pipelines.push_back(pipelineIndex);
+						}
+						info.commandBuffer->EndRecording();
 					}
-					SecondaryCommandBuffer* commandBuffer = worker.commandBuffers[self->m_inFlightBufferId];
-					Pipeline::CommandBufferInfo info(commandBuffer, self->m_inFlightBufferId);
-					info.commandBuffer->Reset();
-					commandBuffer->BeginRecording(self->m_renderPass, (FrameBuffer*)self->m_activeFrameBuffer);
-					std::pair<size_t, size_t> range = extractRange(self, threadId);
+				};
+
+				// REFRESH_PIPELINES Job: Refreshes pipelines without recording and re-records worker's chunks only if some of their pipelines turn out to be stale
+				jobs[static_cast<uint8_t>(WorkerCommand::REFRESH_PIPELINES)] = [](GraphicsPipelineSet* self, size_t threadId) {
+					WorkerData& worker = prepareWorker(self, threadId);
+					const std::vector<RecordedChunk>& recordedChunks = worker.recordedChunks[self->m_inFlightBufferId];
+					if (recordedChunks.empty()) return;
+
+					// Dependencies, collected during the refresh, end up in an empty command buffer, executed alongside the reused one:
+					SecondaryCommandBuffer* refreshBuffer = worker.refreshBuffers[self->m_inFlightBufferId];
+					refreshBuffer->Reset();
+					refreshBuffer->BeginRecording(self->m_renderPass, (FrameBuffer*)self->m_activeFrameBuffer);
+					worker.refreshBufferUsed = true;
+					const Pipeline::CommandBufferInfo refreshInfo(refreshBuffer, self->m_inFlightBufferId);
+
+					bool environmentUpToDate = true;
 					{
 						Pipeline* environment = ((Pipeline*)self->m_environmentPipeline);
 						if (environment != nullptr) {
 							std::unique_lock<std::mutex> lock(self->m_sharedPipelineAccessLock);
-							environment->Execute(info);
+							if (!self->m_environmentRefreshed) {
+								self->m_environmentValid = environment->Refresh(refreshInfo);
+								self->m_environmentRefreshed = true;
+							}
+							environmentUpToDate = self->m_environmentValid;
 						}
 					}
-					for (size_t i = range.first; i < range.second; i++) {
-						const DescriptorData& data = self->m_data[self->m_pipelineOrder[i]];
-						if (data.pipeline == nullptr) {
-							data.pipeline = self->m_renderPass->CreateGraphicsPipeline(data.descriptor, self->m_maxInFlightCommandBuffers);
-							if (data.pipeline == nullptr) {
-								self->m_renderPass->Device()->Log()->Error("GraphicsPipelineSet::RECORD_PIPELINES - Failed to create a pipeline");
-								continue;
-							}
+					static thread_local std::vector<size_t> staleChunks;
+					staleChunks.clear();
+					for (size_t chunkId = 0; chunkId < recordedChunks.size(); chunkId++) {
+						const std::vector<size_t>& pipelines = recordedChunks[chunkId].pipelines;
+						bool upToDate = environmentUpToDate;
+						for (size_t i = 0; upToDate && i < pipelines.size(); i++) {
+							GraphicsPipeline* pipeline = self->m_data[pipelines[i]].instance->pipeline;
+							if (pipeline == nullptr || (!pipeline->Refresh(refreshInfo))) upToDate = false;
 						}
-						data.pipeline->Execute(info);
+						if (!upToDate) staleChunks.push_back(chunkId);
+					}
+					refreshBuffer->EndRecording();
+
+					// Stale chunks have to be recorded from scratch (with the same set of pipelines):
+					for (size_t i = 0; i < staleChunks.size(); i++) {
+						const size_t chunkId = staleChunks[i];
+						const std::vector<size_t>& pipelines = recordedChunks[chunkId].pipelines;
+						Pipeline::CommandBufferInfo info = beginRecording(self, worker, chunkId);
+						for (size_t j = 0; j < pipelines.size(); j++)
+							recordPipeline(self, self->m_data[pipelines[j]], info);
+						info.commandBuffer->EndRecording();
 					}
-					info.commandBuffer->EndRecording();
 				};
 
 				return jobs;
@@ -127,6 +454,7 @@ namespace Jimara {
 
 
 
+
 		GraphicsObjectSet::~GraphicsObjectSet() {
 			m_onPipelinesRemoved(m_data.Data(), m_data.Size(), this);
 		}
@@ -3,6 +3,7 @@
 #include "../../Core/Collections/ThreadBlock.h"
 #include "../../Core/Collections/ObjectSet.h"
 #include <unordered_map>
+#include <thread>
 
 namespace Jimara {
 	namespace Graphics {
@@ -53,6 +54,18 @@ namespace Jimara {
 			/// <param name="environmentPipeline"> Shared environment pipeline </param>
 			void RecordPipelines(std::vector<Reference<SecondaryCommandBuffer>>& secondaryBuffers, size_t commandBufferId, FrameBuffer* targetFrameBuffer, Pipeline* environmentPipeline);
 
+			/// <summary>
+			/// Number of pipelines, that are still waiting to be created asynchronously
+			/// Note: Those are skipped during recording, so the callers that need complete results (cached render targets, for example) may want to check this.
+			/// </summary>
+			size_t PendingPipelineCount();
+
+			/// <summary>
+			/// Number of pipelines, the creation of which has failed even after retries
+			/// Note: Those never get drawn; the errors are reported through the device logger.
+			/// </summary>
+			size_t FailedPipelineCount();
+
 
 		private:
 			/* ENVIRONMENT INFO: */
@@ -69,16 +82,55 @@ namespace Jimara {
 
 			/* STORED PIPELINES: */
 
+			// State of an asynchronously created pipeline
+			enum class PipelineState : uint8_t {
+				// Pipeline creation has not been attempted yet (or is being retried)
+				PENDING = 0,
+
+				// Pipeline is created and can be recorded
+				READY = 1,
+
+				// Pipeline creation has failed and will not be retried
+				FAILED = 2
+			};
+
+			// Pipeline, that gets created asynchronously by the pipeline creation worker
+			class PipelineInstance : public virtual Object {
+			public:
+				// Descriptor
+				const Reference<GraphicsPipeline::Descriptor> descriptor;
+
+				// Pipeline (only valid once the state is READY)
+				Reference<GraphicsPipeline> pipeline;
+
+				// Set by the creation worker, once the pipeline is created or all creation attempts have failed
+				std::atomic<PipelineState> state;
+
+				// Set when the descriptor gets removed from the set before the pipeline gets created
+				std::atomic<bool> abandoned;
+
+				// Constructor
+				inline PipelineInstance(GraphicsPipeline::Descriptor* desc) : descriptor(desc), state(PipelineState::PENDING), abandoned(false) {}
+			};
+
 			// Data about a pipeline descriptor
 			struct DescriptorData {
 				// Descriptor
 				Reference<GraphicsPipeline::Descriptor> descriptor;
 				
-				// Pipeline
-				mutable Reference<GraphicsPipeline> pipeline;
+				// Pipeline instance
+				Reference<PipelineInstance> instance;
+
+				// Smoothed recording time from previous frames (in seconds; negative, if never measured)
+				mutable float recordTime;
+
+				// Estimated recording cost (used for load balancing)
+				mutable float cost;
 
 				// Constructor
-				inline DescriptorData(GraphicsPipeline::Descriptor* desc = nullptr) : descriptor(desc) {}
+				inline DescriptorData(GraphicsPipeline::Descriptor* desc = nullptr) 
+					: descriptor(desc), instance((desc == nullptr) ? Reference<PipelineInstance>() : Object::Instantiate<PipelineInstance>(desc))
+					, recordTime(-1.0f), cost(0.0f) {}
 			};
 
 			// Lock for stored pipelines
@@ -88,6 +140,44 @@ namespace Jimara {
 			ObjectSet<GraphicsPipeline::Descriptor, DescriptorData> m_data;
 
 
+			/* ASYNCHRONOUS PIPELINE CREATION: */
+
+			// Set-wide data, the creation worker needs (shared with the worker, since it may still have the set's pipelines queued after the set goes out of scope)
+			class CreationContext : public virtual Object {
+			public:
+				// Render pass, the pipelines are created for
+				const Reference<RenderPass> renderPass;
+
+				// Maximal number of in-flight command buffers
+				const size_t maxInFlightCommandBuffers;
+
+				// Number of pipelines, successfully created so far
+				std::atomic<size_t> createdPipelineCount;
+
+				// Lock for the state changes of the pipelines, that are (or were) within the set (keeps the counters below consistent with the removals)
+				std::mutex stateLock;
+
+				// Number of pipelines within the set, that are still waiting to be created
+				std::atomic<size_t> pendingPipelineCount;
+
+				// Number of pipelines within the set, the creation of which has failed
+				std::atomic<size_t> failedPipelineCount;
+
+				// Constructor
+				inline CreationContext(RenderPass* pass, size_t maxInFlight) 
+					: renderPass(pass), maxInFlightCommandBuffers(maxInFlight), createdPipelineCount(0), pendingPipelineCount(0), failedPipelineCount(0) {}
+			};
+
+			// Background worker, shared by all the sets of the same device (defined in the source file)
+			class PipelineCreationWorker;
+
+			// Set-wide data for the creation worker
+			const Reference<CreationContext> m_creationContext;
+
+			// Pipeline creation worker
+			const Reference<PipelineCreationWorker> m_creationWorker;
+
+
 			/* WORKERS: */
 
 			// Commands, available to workers
@@ -95,26 +185,53 @@ namespace Jimara {
 				// Workers do nothing
 				NO_OP = 0,
 
+				// Workers refresh the estimated recording cost per pipeline
+				UPDATE_PIPELINE_COSTS = 1,
+
 				// Worker threads fill in the default execution order
 				RESET_PIPELINE_ORDER = 2,
 
 				// Workers record pipelines in secondary command buffers
 				RECORD_PIPELINES = 3,
 
+				// Workers refresh the pipelines, previously recorded in secondary command buffers and re-record only the chunks that became stale
+				REFRESH_PIPELINES = 4,
+
 				// Not a command; denotes how many different commands there are
-				JOB_TYPE_COUNT = 4
+				JOB_TYPE_COUNT = 5
 			};
 
 			// Current command, broadcast to the workers
 			volatile WorkerCommand m_workerCommand;
 
+			// Chunk of m_pipelineOrder, recorded by a worker
+			struct RecordedChunk {
+				// Index of the chunk
+				size_t chunk;
+
+				// Pipelines (indices within m_data), recorded in the chunk's command buffer
+				std::vector<size_t> pipelines;
+			};
+
 			// Data per worker
 			struct WorkerData {
 				// Command pool
 				Reference<CommandPool> pool;
-				
-				// Secondary command buffers per in-flight command buffers
-				std::vector<Reference<SecondaryCommandBuffer>> commandBuffers;
+
+				// Secondary command buffers per in-flight command buffers (one per chunk the worker has recorded; allocated on demand and reused)
+				std::vector<std::vector<Reference<SecondaryCommandBuffer>>> commandBuffers;
+
+				// Empty secondary command buffers per in-flight command buffers, collecting dependencies, when the recorded commands are reused
+				std::vector<Reference<SecondaryCommandBuffer>> refreshBuffers;
+
+				// Chunks, recorded per in-flight command buffer (i-th entry is recorded in commandBuffers[inFlightBufferId][i])
+				std::vector<std::vector<RecordedChunk>> recordedChunks;
+
+				// True, if refreshBuffers were used during the last job
+				bool refreshBufferUsed;
+
+				// Constructor
+				inline WorkerData() : refreshBufferUsed(false) {}
 			};
 
 			// Data per worker thread
@@ -132,9 +249,21 @@ namespace Jimara {
 			// In-flight buffer id for the command buffers, that are currently being recorded
 			volatile size_t m_inFlightBufferId;
 
-			// Order of pipeline execution (by index)
+			// Order of pipeline execution (by index; never reordered by cost, so that the submission order does not depend on timing)
 			std::vector<size_t> m_pipelineOrder;
 
+			// End of each contiguous chunk of m_pipelineOrder (chunks have roughly the same estimated cost and get recorded in separate command buffers)
+			std::vector<size_t> m_chunkEnds;
+
+			// Index of the next chunk, that is not yet taken by any of the recording workers
+			std::atomic<size_t> m_chunkCursor;
+
+			// Command buffers, the chunks were recorded in (per in-flight command buffer; submitted in chunk order, regardless of which worker recorded them)
+			std::vector<std::vector<Reference<SecondaryCommandBuffer>>> m_chunkBuffers;
+
+			// Splits m_pipelineOrder into m_chunkEnds, based on the estimated pipeline costs
+			void SplitIntoChunks();
+
 			// m_environmentPipeline needs to be accessed by one thread at a time, so this is for synchronisation here
 			std::mutex m_sharedPipelineAccessLock;
 
@@ -143,6 +272,39 @@ namespace Jimara {
 
 			// Environment pipeline needed during pipeline recording
 			volatile Pipeline* m_environmentPipeline;
+
+			// Revision of the pipeline collection (incremented each time pipelines get added or removed)
+			size_t m_revision;
+
+			// State of the set, the secondary command buffers were last recorded with (per in-flight command buffer)
+			struct RecordedState {
+				// Revision of the pipeline collection
+				size_t revision;
+
+				// Target frame buffer
+				Reference<FrameBuffer> frameBuffer;
+
+				// Environment pipeline
+				Reference<Pipeline> environmentPipeline;
+
+				// Value of m_creationContext->createdPipelineCount at the time of recording
+				size_t createdPipelineCount;
+
+				// False, if nothing has been recorded yet
+				bool valid;
+
+				// Constructor
+				inline RecordedState() : revision(0), createdPipelineCount(0), valid(false) {}
+			};
+
+			// State of the set, the secondary command buffers were last recorded with (per in-flight command buffer)
+			std::vector<RecordedState> m_recordedStates;
+
+			// True, once any of the workers has refreshed the environment pipeline during REFRESH_PIPELINES job
+			bool m_environmentRefreshed;
+
+			// Result of the environment pipeline refresh (false means every worker has to re-record)
+			bool m_environmentValid;
 		};
 
 
@@ -5,6 +5,8 @@ namespace Jimara { namespace Graphics { class GraphicsDevice; } }
 #include "Pipeline/RenderPass.h"
 #include "Pipeline/DeviceQueue.h"
 #include "Pipeline/GraphicsPipeline.h"
+#include "Pipeline/BindlessSet.h"
+#include "Pipeline/TimestampQuery.h"
 #include "Rendering/RenderEngine.h"
 #include "Rendering/RenderSurface.h"
 
@@ -120,10 +122,11 @@ namespace Jimara {
 			/// <param name="colorAttachmentFormats"> Pixel format per color attachment </param>
 			/// <param name="depthFormat"> Depth format (if value is outside [FIRST_DEPTH_FORMAT; LAST_DEPTH_FORMAT] range, the render pass will not have a depth format) </param>
 			/// <param name="includeResolveAttachments"> If true, the render pass will include a resolve attachment for each of the multisampled color attachment </param>
+			/// <param name="loadDepthAttachment"> If true, the depth attachment keeps the content, an earlier pass has left in it (depth prepass), instead of getting cleared </param>
 			/// <returns> New instance of a render pass </returns>
 			virtual Reference<RenderPass> CreateRenderPass(Texture::Multisampling sampleCount
 				, size_t numColorAttachments, Texture::PixelFormat* colorAttachmentFormats
-				, Texture::PixelFormat depthFormat, bool includeResolveAttachments) = 0;
+				, Texture::PixelFormat depthFormat, bool includeResolveAttachments, bool loadDepthAttachment = false) = 0;
 
 			/// <summary>
 			/// Creates an environment pipeline
@@ -133,6 +136,16 @@ namespace Jimara {
 			/// <returns> New instance of an environment pipeline object </returns>
 			virtual Reference<Pipeline> CreateEnvironmentPipeline(PipelineDescriptor* descriptor, size_t maxInFlightCommandBuffers) = 0;
 
+			/// <summary> Device-wide bindless resource set (nullptr, if the device does not have PhysicalDevice::DeviceFeature::BINDLESS_DESCRIPTORS) </summary>
+			virtual BindlessSet* BindlessResources()const = 0;
+
+			/// <summary>
+			/// Creates a set of GPU timestamps, that can be written from the command buffers, executed on GraphicsQueue()
+			/// </summary>
+			/// <param name="count"> Number of timestamps </param>
+			/// <returns> New instance of a timestamp query </returns>
+			virtual Reference<TimestampQuery> CreateTimestampQuery(size_t count) = 0;
+
 
 		protected:
 			/// <summary>
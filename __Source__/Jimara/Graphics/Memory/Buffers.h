@@ -111,6 +111,28 @@ namespace Jimara {
 
 			/// <summary> Number of objects within the buffer </summary>
 			virtual size_t ObjectCount()const = 0;
+
+			/// <summary>
+			/// Maps a range of the buffer memory to CPU
+			/// Notes:
+			///		0. Each MapRange call should be accompanied by corresponding UnmapRange() and it's a bad idea to call additional Map()s or MapRange()s in between;
+			///		1. The content outside the range stays intact and, depending on the implementation, only the range itself gets uploaded on UnmapRange(true);
+			///		2. Default implementation simply maps the entire buffer, which is only correct if the mapped memory holds the actual content (CPU_READ_WRITE).
+			/// </summary>
+			/// <param name="offset"> Index of the first object within the range </param>
+			/// <param name="count"> Number of objects within the range </param>
+			/// <returns> Mapped memory of the first object within the range (nullptr, if the range is empty or out of bounds) </returns>
+			inline virtual void* MapRange(size_t offset, size_t count) {
+				if (count <= 0 || offset >= ObjectCount() || (ObjectCount() - offset) < count) return nullptr;
+				uint8_t* data = static_cast<uint8_t*>(Map());
+				return (data == nullptr) ? nullptr : static_cast<void*>(data + (offset * ObjectSize()));
+			}
+
+			/// <summary>
+			/// Unmaps memory previously mapped via MapRange() call
+			/// </summary>
+			/// <param name="write"> If true, the system will understand that the user modified mapped range and update the content on GPU </param>
+			inline virtual void UnmapRange(bool write) { Unmap(write); }
 		};
 
 
@@ -159,6 +181,16 @@ namespace Jimara {
 			inline ObjectType* Map()const {
 				return static_cast<ObjectType*>(operator->()->Map());
 			}
+
+			/// <summary>
+			/// Maps a range of the buffer memory to CPU (has to be followed by UnmapRange() call on the buffer)
+			/// </summary>
+			/// <param name="offset"> Index of the first object within the range </param>
+			/// <param name="count"> Number of objects within the range </param>
+			/// <returns> Mapped memory of the first object within the range (nullptr, if the range is empty or out of bounds) </returns>
+			inline ObjectType* MapRange(size_t offset, size_t count)const {
+				return static_cast<ObjectType*>(operator->()->MapRange(offset, count));
+			}
 		};
 
 
@@ -51,6 +51,9 @@ namespace Jimara {
 				/// <summary> Unisotropic filtering support (needed for mipmaps) </summary>
 				SAMPLER_ANISOTROPY = (1 << 5),
 
+				/// <summary> Descriptor indexing support (needed for GraphicsDevice::BindlessResources()) </summary>
+				BINDLESS_DESCRIPTORS = (1 << 6),
+
 				/// <summary> All capabilities </summary>
 				ALL = (~((uint64_t)0))
 			};
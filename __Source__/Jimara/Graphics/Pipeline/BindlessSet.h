@@ -0,0 +1,53 @@
+#pragma once
+namespace Jimara {
+	namespace Graphics {
+		class BindlessSet;
+	}
+}
+#include "../Memory/Buffers.h"
+#include "../Memory/Texture.h"
+
+
+namespace Jimara {
+	namespace Graphics {
+		/// <summary>
+		/// Device-wide bindless resource set (descriptor indexing).
+		/// Notes:
+		///		0. Binding sets with PipelineDescriptor::BindingSetDescriptor::IsBindlessSet() == true get this set bound in place of their own resources,
+		///			so any number of materials can share a single pipeline and a single descriptor bind, referring to their resources by index;
+		///		1. Shader-side, the set is expected to be declared as 'sampler2D[]' at SAMPLER_BINDING and 'buffer[]' (storage buffer array) at STRUCTURED_BUFFER_BINDING;
+		///		2. The same resource always maps to the same index for as long as somebody holds a reference to it's binding.
+		/// </summary>
+		class BindlessSet : public virtual Object {
+		public:
+			/// <summary> Binding of the texture sampler array within the set </summary>
+			static const uint32_t SAMPLER_BINDING = 0;
+
+			/// <summary> Binding of the structured buffer array within the set </summary>
+			static const uint32_t STRUCTURED_BUFFER_BINDING = 1;
+
+			/// <summary>
+			/// Resource, registered within the bindless set (the slot is freed once the binding goes out of scope)
+			/// </summary>
+			class Binding : public virtual Object {
+			public:
+				/// <summary> Index of the resource within the bindless array </summary>
+				virtual uint32_t Index()const = 0;
+			};
+
+			/// <summary>
+			/// Registers a texture sampler within the set (or returns the existing binding)
+			/// </summary>
+			/// <param name="sampler"> Texture sampler </param>
+			/// <returns> Sampler binding (nullptr, if the sampler is null or the set ran out of free slots) </returns>
+			virtual Reference<Binding> GetBinding(TextureSampler* sampler) = 0;
+
+			/// <summary>
+			/// Registers a structured buffer within the set (or returns the existing binding)
+			/// </summary>
+			/// <param name="buffer"> Structured buffer </param>
+			/// <returns> Buffer binding (nullptr, if the buffer is null or the set ran out of free slots) </returns>
+			virtual Reference<Binding> GetBinding(ArrayBuffer* buffer) = 0;
+		};
+	}
+}
@@ -14,6 +14,23 @@ namespace Jimara {
 		/// </summary>
 		class GraphicsPipeline : public virtual Pipeline {
 		public:
+			/// <summary>
+			/// Depth test, the fragments go through (ignored, if the render pass has no depth attachment)
+			/// </summary>
+			enum class DepthTest : uint8_t {
+				/// <summary> Fragments, closer than the stored depth, pass and overwrite it </summary>
+				LESS = 0,
+
+				/// <summary> Only the fragments with exactly the stored depth pass and the depth is not written (color pass after a depth prepass) </summary>
+				EQUAL = 1,
+
+				/// <summary> 
+				/// Fragments, that are not farther than the stored depth, pass and overwrite it 
+				/// (color pass after a depth prepass, that may not have drawn every object; acts as EQUAL for the objects, the prepass has drawn, and as LESS for the rest)
+				/// </summary>
+				LESS_OR_EQUAL = 2
+			};
+
 			/// <summary>
 			/// Graphics pipeline descriptor
 			/// </summary>
@@ -56,6 +73,9 @@ namespace Jimara {
 
 				/// <summary> Number of instances to draw (by ignoring some of the instance buffer members, we can mostly vary instance count without any reallocation) </summary>
 				virtual size_t InstanceCount() = 0;
+
+				/// <summary> Depth test [Should stay the same throught the Object's lifecycle] </summary>
+				inline virtual DepthTest DepthTestMode() { return DepthTest::LESS; }
 			};
 		};
 	}
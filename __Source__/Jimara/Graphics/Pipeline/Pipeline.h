@@ -172,6 +172,24 @@ namespace Jimara {
 				/// <param name="index"> Texture sampler binding index </param>
 				/// <returns> Index'th texture sampler </returns>
 				virtual Reference<TextureSampler> Sampler(size_t index)const = 0;
+
+
+				/// <summary>
+				/// Revision of the bound resources.
+				/// Notes:
+				///		0. Implementations that track their bindings should return a non-zero value and increment it each time
+				///			ConstantBuffer(), StructuredBuffer() or Sampler() start returning a different object for any index;
+				///		1. While the revision stays the same, the pipelines are free to reuse the resources from the previous query without invoking the getters;
+				///		2. 0 (default) means 'not tracked' and the resources will be queried each time the pipeline gets executed.
+				/// </summary>
+				inline virtual size_t Revision()const { return 0; }
+
+				/// <summary>
+				/// If true, the set will be bound to GraphicsDevice::BindlessResources() instead of the resources, provided by the descriptor
+				/// (resource counts are expected to be 0; ignored for the sets, that are SetByEnvironment()).
+				/// Note: Should stay the same throught the Object's lifecycle
+				/// </summary>
+				inline virtual bool IsBindlessSet()const { return false; }
 			};
 
 			/// <summary>  Number of binding sets, available to the pipeline </summary>
@@ -222,6 +240,17 @@ namespace Jimara {
 			/// <param name="commandBuffer"> Command buffer </param>
 			/// <param name="inFlightBufferId"> Index of the command buffer (when we have something like double/triple/quadrouple/whatever buffering; otherwise should be 0) </param>
 			inline void Execute(CommandBuffer* commandBuffer, size_t inFlightBufferId) { Execute(CommandBufferInfo(commandBuffer, inFlightBufferId)); }
+
+			/// <summary>
+			/// Refreshes the resources, used by the commands previously recorded with Execute() for the same inFlightBufferId, without recording anything new.
+			/// Notes:
+			///		0. Lets the callers reuse previously recorded command buffers, when nothing changes;
+			///		1. bufferInfo.commandBuffer will only receive the dependencies, so it does not have to be the one Execute() was invoked with;
+			///		2. Default implementation does nothing and always requests re-recording.
+			/// </summary>
+			/// <param name="bufferInfo"> Command buffer to record dependencies on and in-flight buffer index </param>
+			/// <returns> True, if the commands, previously recorded with Execute() are still valid; false, if Execute() has to be invoked once again </returns>
+			inline virtual bool Refresh(const CommandBufferInfo& bufferInfo) { return false; }
 		};
 	}
 }
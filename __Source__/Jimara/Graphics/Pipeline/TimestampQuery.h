@@ -0,0 +1,49 @@
+#pragma once
+namespace Jimara {
+	namespace Graphics {
+		class TimestampQuery;
+	}
+}
+#include "CommandBuffer.h"
+
+
+namespace Jimara {
+	namespace Graphics {
+		/// <summary>
+		/// Set of GPU timestamps, that can be written from command buffers and read back once they get executed (for GPU-side profiling)
+		/// Notes:
+		///		0. Timestamps have to be reset outside the render passes before they can be written again;
+		///		1. Values are only meaningful relative to one another (ei. the difference between two timestamps from the same queue is the elapsed GPU time).
+		/// </summary>
+		class TimestampQuery : public virtual Object {
+		public:
+			/// <summary> Number of timestamps within the set </summary>
+			virtual size_t Count()const = 0;
+
+			/// <summary> True, if the graphics queue supports timestamps (if false, Read() will always fail) </summary>
+			virtual bool Supported()const = 0;
+
+			/// <summary>
+			/// Records a reset of all timestamps
+			/// </summary>
+			/// <param name="commandBuffer"> Command buffer to record the reset on (should not be inside a render pass) </param>
+			virtual void Reset(CommandBuffer* commandBuffer) = 0;
+
+			/// <summary>
+			/// Records a timestamp write, that happens once all the commands, recorded before it, are complete
+			/// </summary>
+			/// <param name="commandBuffer"> Command buffer to record the write on </param>
+			/// <param name="index"> Timestamp index (has to be less than Count()) </param>
+			virtual void Write(CommandBuffer* commandBuffer, size_t index) = 0;
+
+			/// <summary>
+			/// Reads timestamps back (should be invoked after the command buffer that writes them is done executing)
+			/// </summary>
+			/// <param name="first"> Index of the first timestamp to read </param>
+			/// <param name="count"> Number of timestamps to read </param>
+			/// <param name="seconds"> Timestamp values in seconds (result) </param>
+			/// <returns> True, if all of the requested timestamps were available </returns>
+			virtual bool Read(size_t first, size_t count, double* seconds) = 0;
+		};
+	}
+}
@@ -1,4 +1,5 @@
 #include "VulkanConstantBuffer.h"
+#include <algorithm>
 
 
 #pragma warning(disable: 26812)
@@ -9,18 +10,15 @@ namespace Jimara {
 			VulkanConstantBuffer::VulkanConstantBuffer(size_t size) 
 				: m_size(size)
 				, m_data(size > 0 ? new uint8_t[size] : nullptr)
-				, m_mappedData(size > 0 ? new uint8_t[size] : nullptr)
-				, m_revision(~((uint64_t)0)) {}
+				, m_revision(~((uint64_t)0)) {
+				if (m_data != nullptr) memset(m_data, 0, m_size);
+			}
 
 			VulkanConstantBuffer::~VulkanConstantBuffer() {
 				if (m_data != nullptr) {
 					delete[] m_data;
 					m_data = nullptr;
 				}
-				if (m_mappedData != nullptr) {
-					delete[] m_mappedData;
-					m_mappedData = nullptr;
-				}
 			}
 
 			size_t VulkanConstantBuffer::ObjectSize()const {
@@ -33,69 +31,44 @@ namespace Jimara {
 
 			void* VulkanConstantBuffer::Map() {
 				m_lock.lock();
-				return static_cast<void*>(m_mappedData);
+				return static_cast<void*>(m_data);
 			}
 
 			void VulkanConstantBuffer::Unmap(bool write) {
-				if (write) {
-					memcpy(m_data, m_mappedData, m_size);
-					m_revision++;
-				}
-				else memcpy(m_mappedData, m_data, m_size);
+				if (write) m_revision++;
 				m_lock.unlock();
 			}
 
 
 			VulkanPipelineConstantBuffer::VulkanPipelineConstantBuffer(VulkanDevice* device, VulkanConstantBuffer* buffer, size_t commandBufferCount) 
-				: m_device(device), m_constantBuffer(buffer), m_buffer(VK_NULL_HANDLE) {
+				: m_constantBuffer(buffer), m_slotSize(0) {
 				if (commandBufferCount <= 0 || m_constantBuffer == nullptr) return;
+				Reference<VulkanConstantBufferHeap> heap = VulkanConstantBufferHeap::Instance(device);
+				if (heap == nullptr) return;
 
-				VkDeviceSize offsetAlignment = device->PhysicalDeviceInfo()->DeviceProperties().limits.minUniformBufferOffsetAlignment;
-				VkDeviceSize bufferStep = (offsetAlignment * ((static_cast<VkDeviceSize>(m_constantBuffer->m_size) + offsetAlignment - 1) / offsetAlignment));
-				VkBufferCreateInfo bufferInfo = {};
-				{
-					bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-					bufferInfo.flags = 0;
-					bufferInfo.size = static_cast<VkDeviceSize>(bufferStep * commandBufferCount);
-					bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-					bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE; // We may want to change this down the line...
-				}
-				if (vkCreateBuffer(*m_device, &bufferInfo, nullptr, &m_buffer) != VK_SUCCESS)
-					m_device->Log()->Fatal("VulkanPipelineConstantBuffer - Failed to create a buffer!");
-				
-				VkMemoryRequirements memRequirements;
-				vkGetBufferMemoryRequirements(*m_device, m_buffer, &memRequirements);
-				m_memory = m_device->MemoryPool()->Allocate(memRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-				vkBindBufferMemory(*m_device, m_buffer, m_memory->Memory(), m_memory->Offset());
-
-				for (VkDeviceSize i = 0; i < commandBufferCount; i++)
-					m_buffers.push_back(Attachment(bufferStep * i));				
+				const VkDeviceSize offsetAlignment = heap->OffsetAlignment();
+				m_slotSize = (offsetAlignment * ((std::max(static_cast<VkDeviceSize>(m_constantBuffer->m_size), static_cast<VkDeviceSize>(1)) + offsetAlignment - 1) / offsetAlignment));
+				m_slice = heap->Allocate(m_slotSize * commandBufferCount);
+				if (m_slice == nullptr)
+					device->Log()->Fatal("VulkanPipelineConstantBuffer - Failed to allocate a constant buffer heap slice!");
+				else m_revisions.resize(commandBufferCount);
 			}
 
-			VulkanPipelineConstantBuffer::~VulkanPipelineConstantBuffer() {
-				if (m_buffer != VK_NULL_HANDLE) {
-					vkDestroyBuffer(*m_device, m_buffer, nullptr);
-					m_buffer = VK_NULL_HANDLE;
-				}
-				m_buffers.clear();
-			}
+			VulkanPipelineConstantBuffer::~VulkanPipelineConstantBuffer() {}
 
 			VulkanConstantBuffer* VulkanPipelineConstantBuffer::TargetBuffer()const {
 				return m_constantBuffer;
 			}
 
 			std::pair<VkBuffer, VkDeviceSize> VulkanPipelineConstantBuffer::GetBuffer(size_t commandBufferIndex) {
-				Attachment& attachment = m_buffers[commandBufferIndex];
-				if ((!attachment.resvison.has_value()) || attachment.resvison.value() != m_constantBuffer->m_revision) {
+				std::optional<uint64_t>& revision = m_revisions[commandBufferIndex];
+				const VkDeviceSize offset = (m_slotSize * commandBufferIndex);
+				if ((!revision.has_value()) || revision.value() != m_constantBuffer->m_revision) {
 					std::unique_lock<std::mutex> lock(m_constantBuffer->m_lock);
-					if ((!attachment.resvison.has_value()) || attachment.resvison.value() != m_constantBuffer->m_revision) {
-						uint8_t* data = static_cast<uint8_t*>(m_memory->Map(false)) + attachment.memoryOffset;
-						memcpy(data, m_constantBuffer->m_data, m_constantBuffer->m_size);
-						m_memory->Unmap(true);
-						attachment.resvison = m_constantBuffer->m_revision;
-					}
+					memcpy(m_slice->Data() + offset, m_constantBuffer->m_data, m_constantBuffer->m_size);
+					revision = m_constantBuffer->m_revision;
 				}
-				return std::make_pair(m_buffer, attachment.memoryOffset);
+				return std::make_pair((VkBuffer)(*m_slice->Buffer()), m_slice->Offset() + offset);
 			}
 		}
 	}
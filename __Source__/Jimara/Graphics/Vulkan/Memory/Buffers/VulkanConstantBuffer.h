@@ -7,6 +7,7 @@ namespace Jimara {
 		}
 	}
 }
+#include "VulkanConstantBufferHeap.h"
 #include "../../Pipeline/VulkanCommandBuffer.h"
 #include <optional>
 #include <vector>
@@ -18,6 +19,8 @@ namespace Jimara {
 		namespace Vulkan {
 			/// <summary>
 			/// Vulkan-backed cbuffer
+			/// Note: Map() hands out the CPU-side content directly; pipelines copy it into their persistently mapped 
+			///		VulkanConstantBufferHeap slots once per revision, so nothing gets copied on Unmap().
 			/// </summary>
 			class VulkanConstantBuffer : public virtual Buffer {
 			public:
@@ -60,9 +63,6 @@ namespace Jimara {
 				// Data
 				uint8_t* m_data;
 
-				// Data
-				uint8_t* m_mappedData;
-
 				// Data map lock
 				std::mutex m_lock;
 
@@ -76,9 +76,16 @@ namespace Jimara {
 
 			/// <summary>
 			/// GPU-side constant buffer copy, managed by pipelines
+			/// (one slot per command buffer index; all slots reside in a single slice of the device's VulkanConstantBufferHeap)
 			/// </summary>
 			class VulkanPipelineConstantBuffer : public virtual Object {
 			public:
+				/// <summary>
+				/// Constructor
+				/// </summary>
+				/// <param name="device"> Graphics device </param>
+				/// <param name="buffer"> Constant buffer to copy </param>
+				/// <param name="commandBufferCount"> Number of command buffers (slots) </param>
 				VulkanPipelineConstantBuffer(VulkanDevice* device, VulkanConstantBuffer* buffer, size_t commandBufferCount);
 
 				/// <summary> Virtual desrtructor </summary>
@@ -89,6 +96,7 @@ namespace Jimara {
 
 				/// <summary>
 				/// Gets appropriate buffer based on the recorder
+				/// Note: The buffer and offset for a given index stay the same for the lifetime of the object, so the descriptors only have to be written once.
 				/// </summary>
 				/// <param name="commandBufferIndex"> Command buffer index </param>
 				/// <returns> Attachment buffer and offset </returns>
@@ -97,32 +105,17 @@ namespace Jimara {
 
 
 			private:
-				// "Owner" device
-				const Reference<VulkanDevice> m_device;
-
 				// Data buffer
 				const Reference<VulkanConstantBuffer> m_constantBuffer;
 
-				// Actual buffer that is read by the shaders
-				struct Attachment {
-					// Memory offset
-					VkDeviceSize memoryOffset;
-
-					// Last revision
-					std::optional<uint64_t> resvison;
-
-					// Constructor
-					inline Attachment(VkDeviceSize off = 0) : memoryOffset(off) {}
-				};
-
-				// Buffer
-				VkBuffer m_buffer;
+				// Heap slice, holding all the slots
+				Reference<VulkanConstantBufferHeap::Slice> m_slice;
 
-				// Syb-buffers
-				std::vector<Attachment> m_buffers;
+				// Distance between the slots
+				VkDeviceSize m_slotSize;
 
-				// Buffer memory allocation
-				Reference<VulkanMemoryAllocation> m_memory;
+				// Last revisions copied to each of the slots
+				std::vector<std::optional<uint64_t>> m_revisions;
 			};
 		}
 	}
@@ -0,0 +1,131 @@
+#include "VulkanConstantBufferHeap.h"
+#include <algorithm>
+
+
+#pragma warning(disable: 26812)
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			namespace {
+				class ConstantBufferHeapCache : public virtual ObjectCache<VulkanDevice*> {
+				public:
+					inline static Reference<VulkanConstantBufferHeap> Instance(VulkanDevice* device) {
+						static ConstantBufferHeapCache cache;
+						return cache.GetCachedOrCreate(device, false,
+							[&]() -> Reference<VulkanConstantBufferHeap> { return Object::Instantiate<VulkanConstantBufferHeap>(device); });
+					}
+				};
+			}
+
+			VulkanConstantBufferHeap::Slice::Slice(VulkanConstantBufferHeap* heap, Chunk* chunk, const VulkanMemoryTLSF::Allocation& allocation)
+				: m_heap(heap), m_chunk(chunk), m_allocation(allocation) {}
+
+			VulkanConstantBufferHeap::Slice::~Slice() {
+				m_heap->Free(m_chunk, m_allocation.handle);
+			}
+
+			VulkanStaticBuffer* VulkanConstantBufferHeap::Slice::Buffer()const { return m_chunk->buffer; }
+
+			VkDeviceSize VulkanConstantBufferHeap::Slice::Offset()const { return m_allocation.offset; }
+
+			VkDeviceSize VulkanConstantBufferHeap::Slice::Size()const { return m_allocation.size; }
+
+			uint8_t* VulkanConstantBufferHeap::Slice::Data()const { return m_chunk->data + m_allocation.offset; }
+
+
+			Reference<VulkanConstantBufferHeap> VulkanConstantBufferHeap::Instance(VulkanDevice* device) {
+				if (device == nullptr) return nullptr;
+				else return ConstantBufferHeapCache::Instance(device);
+			}
+
+			VulkanConstantBufferHeap::VulkanConstantBufferHeap(VulkanDevice* device, VkDeviceSize chunkSize)
+				: m_device(device)
+				, m_chunkSize(std::max(chunkSize, static_cast<VkDeviceSize>(VulkanMemoryTLSF::GRANULARITY)))
+				, m_offsetAlignment(std::max(
+					device->PhysicalDeviceInfo()->DeviceProperties().limits.minUniformBufferOffsetAlignment,
+					static_cast<VkDeviceSize>(VulkanMemoryTLSF::GRANULARITY))) {}
+
+			VulkanConstantBufferHeap::~VulkanConstantBufferHeap() {
+				std::unique_lock<std::mutex> lock(m_lock);
+				for (size_t i = 0; i < m_chunks.size(); i++)
+					m_chunks[i]->buffer->Unmap(false);
+				m_chunks.clear();
+			}
+
+			VulkanDevice* VulkanConstantBufferHeap::Device()const { return m_device; }
+
+			VkDeviceSize VulkanConstantBufferHeap::ChunkSize()const { return m_chunkSize; }
+
+			VkDeviceSize VulkanConstantBufferHeap::OffsetAlignment()const { return m_offsetAlignment; }
+
+			Reference<VulkanConstantBufferHeap::Slice> VulkanConstantBufferHeap::Allocate(VkDeviceSize size) {
+				if (size <= 0) return nullptr;
+				std::unique_lock<std::mutex> lock(m_lock);
+
+				// Try the existing chunks first (the newer ones are more likely to have free space):
+				Chunk* chunk = nullptr;
+				VulkanMemoryTLSF::Allocation allocation;
+				for (size_t i = m_chunks.size(); i-- > 0;) {
+					if (m_chunks[i]->allocator->LargestFreeRange() < size) continue;
+					allocation = m_chunks[i]->allocator->Allocate(size, m_offsetAlignment);
+					if (allocation.handle != VulkanMemoryTLSF::NO_ALLOCATION) {
+						chunk = m_chunks[i].get();
+						break;
+					}
+				}
+
+				// Create a new chunk if there was no space:
+				if (chunk == nullptr) {
+					chunk = CreateChunk(std::max(m_chunkSize, size + m_offsetAlignment));
+					if (chunk == nullptr) return nullptr;
+					allocation = chunk->allocator->Allocate(size, m_offsetAlignment);
+					if (allocation.handle == VulkanMemoryTLSF::NO_ALLOCATION) {
+						m_device->Log()->Error("VulkanConstantBufferHeap::Allocate - Failed to allocate a slice from a new chunk!");
+						return nullptr;
+					}
+				}
+
+				Slice* slice = new Slice(this, chunk, allocation);
+				Reference<Slice> reference(slice);
+				slice->ReleaseRef();
+				return reference;
+			}
+
+			size_t VulkanConstantBufferHeap::ChunkCount()const {
+				std::unique_lock<std::mutex> lock(m_lock);
+				return m_chunks.size();
+			}
+
+			VulkanConstantBufferHeap::Chunk* VulkanConstantBufferHeap::CreateChunk(VkDeviceSize size) {
+				std::unique_ptr<Chunk> chunk = std::make_unique<Chunk>();
+				chunk->buffer = Object::Instantiate<VulkanStaticBuffer>(m_device, static_cast<size_t>(size), 1, true
+					, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+					, VulkanMemoryPool::AllocationStrategy::DEDICATED);
+				chunk->data = static_cast<uint8_t*>(chunk->buffer->Map());
+				if (chunk->data == nullptr) {
+					m_device->Log()->Error("VulkanConstantBufferHeap::CreateChunk - Failed to map chunk memory!");
+					return nullptr;
+				}
+				chunk->allocator = std::make_unique<VulkanMemoryTLSF>(size);
+				m_chunks.push_back(std::move(chunk));
+				return m_chunks.back().get();
+			}
+
+			void VulkanConstantBufferHeap::Free(Chunk* chunk, uint32_t handle) {
+				std::unique_lock<std::mutex> lock(m_lock);
+				chunk->allocator->Free(handle);
+
+				// Slices keep the chunk in use while the GPU may read from it, so empty chunks can go right away (keeping one around to avoid churn):
+				if ((!chunk->allocator->Empty()) || m_chunks.size() <= 1) return;
+				for (size_t i = 0; i < m_chunks.size(); i++) {
+					if (m_chunks[i].get() != chunk) continue;
+					chunk->buffer->Unmap(false);
+					m_chunks[i] = std::move(m_chunks.back());
+					m_chunks.pop_back();
+					break;
+				}
+			}
+		}
+	}
+}
+#pragma warning(default: 26812)
@@ -0,0 +1,148 @@
+#pragma once
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			class VulkanConstantBufferHeap;
+		}
+	}
+}
+#include "VulkanStaticBuffer.h"
+#include "../VulkanMemoryTLSF.h"
+#include "../../../../Core/ObjectCache.h"
+#include <memory>
+#include <mutex>
+
+
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			/// <summary>
+			/// Device-wide heap of persistently mapped uniform buffer memory, shared by the pipeline constant buffer copies.
+			/// Notes:
+			///		0. Memory comes in large host-visible & coherent chunks that are mapped once and sub-allocated with VulkanMemoryTLSF,
+			///			so the users neither create buffers of their own, nor map/unmap anything when writing;
+			///		1. Slice offsets are aligned to minUniformBufferOffsetAlignment, so they can be bound directly;
+			///		2. A slice returns it's range to the heap on destruction, so it should be kept alive while the GPU uses it (RecordBufferDependency);
+			///		3. All calls are thread-safe.
+			/// </summary>
+			class VulkanConstantBufferHeap : public virtual ObjectCache<VulkanDevice*>::StoredObject {
+			private:
+				// Heap chunk (defined below)
+				struct Chunk;
+
+			public:
+				/// <summary> Default size of a heap chunk (slices larger than this get chunks of their own) </summary>
+				static const VkDeviceSize DEFAULT_CHUNK_SIZE = (static_cast<VkDeviceSize>(1) << 20);
+
+				/// <summary>
+				/// Range of uniform buffer memory
+				/// </summary>
+				class Slice : public virtual Object {
+				public:
+					/// <summary> Virtual destructor (returns the range to the heap) </summary>
+					virtual ~Slice();
+
+					/// <summary> Buffer, the slice resides in </summary>
+					VulkanStaticBuffer* Buffer()const;
+
+					/// <summary> Offset of the slice within the Buffer() </summary>
+					VkDeviceSize Offset()const;
+
+					/// <summary> Slice size </summary>
+					VkDeviceSize Size()const;
+
+					/// <summary> Persistently mapped memory of the slice </summary>
+					uint8_t* Data()const;
+
+
+				private:
+					// Heap, the slice belongs to
+					const Reference<VulkanConstantBufferHeap> m_heap;
+
+					// Chunk, the slice resides in
+					Chunk* const m_chunk;
+
+					// Chunk allocation
+					const VulkanMemoryTLSF::Allocation m_allocation;
+
+					// Constructor
+					Slice(VulkanConstantBufferHeap* heap, Chunk* chunk, const VulkanMemoryTLSF::Allocation& allocation);
+
+					// Heap creates the slices
+					friend class VulkanConstantBufferHeap;
+				};
+
+				/// <summary>
+				/// Constant buffer heap, shared by the users of the device
+				/// </summary>
+				/// <param name="device"> Graphics device </param>
+				/// <returns> Shared instance </returns>
+				static Reference<VulkanConstantBufferHeap> Instance(VulkanDevice* device);
+
+				/// <summary>
+				/// Constructor
+				/// </summary>
+				/// <param name="device"> Graphics device </param>
+				/// <param name="chunkSize"> Size of an individual chunk </param>
+				VulkanConstantBufferHeap(VulkanDevice* device, VkDeviceSize chunkSize = DEFAULT_CHUNK_SIZE);
+
+				/// <summary> Virtual destructor </summary>
+				virtual ~VulkanConstantBufferHeap();
+
+				/// <summary> Graphics device </summary>
+				VulkanDevice* Device()const;
+
+				/// <summary> Size of an individual chunk </summary>
+				VkDeviceSize ChunkSize()const;
+
+				/// <summary> Alignment of the slice offsets (minUniformBufferOffsetAlignment) </summary>
+				VkDeviceSize OffsetAlignment()const;
+
+				/// <summary>
+				/// Allocates a slice
+				/// </summary>
+				/// <param name="size"> Slice size </param>
+				/// <returns> New slice (nullptr if size is 0) </returns>
+				Reference<Slice> Allocate(VkDeviceSize size);
+
+				/// <summary> Number of chunks, currently allocated </summary>
+				size_t ChunkCount()const;
+
+
+			private:
+				// Heap chunk
+				struct Chunk {
+					// Chunk buffer
+					Reference<VulkanStaticBuffer> buffer;
+
+					// Persistent mapping of the buffer
+					uint8_t* data = nullptr;
+
+					// Range allocator
+					std::unique_ptr<VulkanMemoryTLSF> allocator;
+				};
+
+				// "Owner" device
+				const Reference<VulkanDevice> m_device;
+
+				// Size of an individual chunk
+				const VkDeviceSize m_chunkSize;
+
+				// Alignment of the slice offsets
+				const VkDeviceSize m_offsetAlignment;
+
+				// Lock for the chunk collection
+				mutable std::mutex m_lock;
+
+				// Chunks
+				std::vector<std::unique_ptr<Chunk>> m_chunks;
+
+				// Creates a chunk and adds it to m_chunks
+				Chunk* CreateChunk(VkDeviceSize size);
+
+				// Returns a slice range to it's chunk
+				void Free(Chunk* chunk, uint32_t handle);
+			};
+		}
+	}
+}
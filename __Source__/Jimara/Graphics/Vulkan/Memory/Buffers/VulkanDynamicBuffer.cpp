@@ -6,10 +6,19 @@
 namespace Jimara {
 	namespace Graphics {
 		namespace Vulkan {
+			namespace {
+				// Number of pending partial writes, after which those get recorded without waiting for GetStaticHandle() (keeps the staging ring from being pinned indefinitely)
+				static const size_t MAX_PENDING_WRITES = 256;
+			}
+
 			VulkanDynamicBuffer::VulkanDynamicBuffer(VulkanDevice* device, size_t objectSize, size_t objectCount)
-				: m_device(device), m_objectSize(objectSize), m_objectCount(objectCount), m_cpuMappedData(nullptr), m_updater(*device) {}
+				: m_device(device), m_objectSize(objectSize), m_objectCount(objectCount)
+				, m_mappedOffset(0), m_mappedSize(0), m_hasPendingWrites(false), m_cpuMappedData(nullptr), m_updater(device) {}
 
-			VulkanDynamicBuffer::~VulkanDynamicBuffer() {}
+			VulkanDynamicBuffer::~VulkanDynamicBuffer() {
+				std::unique_lock<std::mutex> lock(m_bufferLock);
+				DiscardPendingWrites();
+			}
 
 			size_t VulkanDynamicBuffer::ObjectSize()const {
 				return m_objectSize;
@@ -28,61 +37,205 @@ namespace Jimara {
 
 				m_bufferLock.lock();
 
-				if (m_stagingBuffer == nullptr)
-					m_stagingBuffer = Object::Instantiate<VulkanStaticBuffer>(m_device, m_objectSize, m_objectCount, true
-						, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-				m_cpuMappedData = m_stagingBuffer->Map();
+				m_mappedOffset = 0;
+				m_mappedSize = static_cast<VkDeviceSize>(m_objectSize * m_objectCount);
+				m_stagingRange = m_updater.UploadRing()->Allocate(m_mappedSize, 16);
+				m_cpuMappedData = m_stagingRange.data;
 
 				return m_cpuMappedData;
 			}
 
 			void VulkanDynamicBuffer::Unmap(bool write) {
 				if (m_cpuMappedData == nullptr) return;
-				m_stagingBuffer->Unmap(write);
+				bool releaseStagingRange = true;
+				if (write) {
+					// Full upload gets recorded right away, so that all the updates from the frame end up in a single batch (pending partial writes become irrelevant):
+					if (m_mappedOffset <= 0 && m_mappedSize >= static_cast<VkDeviceSize>(m_objectSize * m_objectCount)) {
+						DiscardPendingWrites();
+						m_dataBuffer = CreateDataBuffer();
+						m_updater.Update(Callback<VulkanCommandBuffer*>(&VulkanDynamicBuffer::UpdateData, this));
+						if (m_updater.UploadRing()->OwnershipTransferRequired())
+							m_updater.Update(Callback<VulkanCommandBuffer*>(&VulkanDynamicBuffer::AcquireData, this), VulkanUploadRing::Stage::GRAPHICS);
+					}
+					// Partial writes patch the data buffer in place and get recorded together, once somebody needs the buffer:
+					else {
+						if (m_dataBuffer == nullptr) m_dataBuffer = CreateDataBuffer();
+						PendingWrite pendingWrite;
+						{
+							pendingWrite.staging = m_stagingRange;
+							pendingWrite.offset = m_mappedOffset;
+							pendingWrite.size = m_mappedSize;
+						}
+						m_pendingWrites.push_back(pendingWrite);
+						m_hasPendingWrites = true;
+						releaseStagingRange = false;
+						if (m_pendingWrites.size() >= MAX_PENDING_WRITES)
+							m_updater.Update(Callback<VulkanCommandBuffer*>(&VulkanDynamicBuffer::WriteRanges, this), VulkanUploadRing::Stage::GRAPHICS);
+					}
+				}
+				if (releaseStagingRange)
+					m_updater.UploadRing()->Release(m_stagingRange);
+				m_stagingRange = VulkanUploadRing::Range();
 				m_cpuMappedData = nullptr;
-				if (write) m_dataBuffer = nullptr;
-				else m_stagingBuffer = nullptr;
 				m_bufferLock.unlock();
 			}
 
+			void* VulkanDynamicBuffer::MapRange(size_t offset, size_t count) {
+				if (m_cpuMappedData != nullptr) return nullptr;
+				if (count <= 0 || offset >= m_objectCount || (m_objectCount - offset) < count) return nullptr;
+
+				m_bufferLock.lock();
+
+				m_mappedOffset = static_cast<VkDeviceSize>(m_objectSize * offset);
+				m_mappedSize = static_cast<VkDeviceSize>(m_objectSize * count);
+				m_stagingRange = m_updater.UploadRing()->Allocate(m_mappedSize, 16);
+				m_cpuMappedData = m_stagingRange.data;
+
+				return m_cpuMappedData;
+			}
+
+			void VulkanDynamicBuffer::UnmapRange(bool write) {
+				Unmap(write);
+			}
+
 			Reference<VulkanStaticBuffer> VulkanDynamicBuffer::GetStaticHandle(VulkanCommandBuffer* commandBuffer) {
 				Reference<VulkanStaticBuffer> dataBuffer = m_dataBuffer;
-				if (dataBuffer != nullptr) {
+				if (dataBuffer != nullptr && (!m_hasPendingWrites) && (!dataBuffer->Memory()->RelocationRequested())) {
 					m_updater.WaitForTimeline(commandBuffer);
 					commandBuffer->RecordBufferDependency(dataBuffer);
 					return dataBuffer;
 				}
 
 				std::unique_lock<std::mutex> lock(m_bufferLock);
-				if (m_dataBuffer == nullptr)
-					m_dataBuffer = Object::Instantiate<VulkanStaticBuffer>(m_device, m_objectSize, m_objectCount, true
-						, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
-						, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+				// If the memory pool is evacuating the block our data resides in, we move the content to a new buffer:
+				if (m_dataBuffer != nullptr && m_cpuMappedData == nullptr && m_dataBuffer->Memory()->ShouldRelocate())
+					m_relocationSource = m_dataBuffer;
+
+				if (m_dataBuffer == nullptr || m_relocationSource != nullptr)
+					m_dataBuffer = CreateDataBuffer();
 
 				commandBuffer->RecordBufferDependency(m_dataBuffer);
 
-				if (m_stagingBuffer == nullptr || m_cpuMappedData != nullptr) {
-					m_updater.WaitForTimeline(commandBuffer);
-					return m_dataBuffer;
+				// Relocation goes first, so that the pending writes land in the new buffer:
+				if (m_relocationSource != nullptr || (!m_pendingWrites.empty())) {
+					if (m_relocationSource != nullptr)
+						m_updater.Update(Callback<VulkanCommandBuffer*>(&VulkanDynamicBuffer::RelocateData, this), VulkanUploadRing::Stage::GRAPHICS);
+					m_updater.Update(commandBuffer, Callback<VulkanCommandBuffer*>(&VulkanDynamicBuffer::WriteRanges, this), VulkanUploadRing::Stage::GRAPHICS);
 				}
-
-				m_updater.Update(commandBuffer, Callback<VulkanCommandBuffer*>(&VulkanDynamicBuffer::UpdateData, this));
+				else m_updater.WaitForTimeline(commandBuffer);
 
 				return m_dataBuffer;
 			}
 
+			Reference<VulkanStaticBuffer> VulkanDynamicBuffer::CreateDataBuffer()const {
+				return Object::Instantiate<VulkanStaticBuffer>(m_device, m_objectSize, m_objectCount, true
+					, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT
+					| VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+					, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VulkanMemoryPool::AllocationStrategy::RELOCATABLE);
+			}
+
 			void VulkanDynamicBuffer::UpdateData(VulkanCommandBuffer* commandBuffer) {
+				VkBufferCopy copy = {};
+				{
+					copy.srcOffset = m_stagingRange.offset;
+					copy.dstOffset = 0;
+					copy.size = static_cast<VkDeviceSize>(m_objectSize * m_objectCount);
+				}
+				commandBuffer->RecordBufferDependency(m_stagingRange.buffer);
+				commandBuffer->RecordBufferDependency(m_dataBuffer);
+				vkCmdCopyBuffer(*commandBuffer, *m_stagingRange.buffer, *m_dataBuffer, 1, &copy);
+				m_updater.UploadRing()->ReleaseOwnership(commandBuffer, m_dataBuffer);
+			}
+
+			void VulkanDynamicBuffer::AcquireData(VulkanCommandBuffer* commandBuffer) {
+				m_updater.UploadRing()->AcquireOwnership(commandBuffer, m_dataBuffer);
+				commandBuffer->RecordBufferDependency(m_dataBuffer);
+			}
+
+			void VulkanDynamicBuffer::WriteRanges(VulkanCommandBuffer* commandBuffer) {
+				if (m_pendingWrites.empty()) return;
+				commandBuffer->RecordBufferDependency(m_dataBuffer);
+
+				// Previous submissions may still be reading from or writing to the buffer (single barrier for all the ranges):
+				VkBufferMemoryBarrier barrier = {};
+				{
+					barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+					barrier.srcAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+					barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+					barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					barrier.buffer = *m_dataBuffer;
+					barrier.offset = 0;
+					barrier.size = VK_WHOLE_SIZE;
+				}
+				vkCmdPipelineBarrier(*commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+				// Consecutive ranges from the same staging buffer go into a single copy command, as long as the destination regions do not overlap
+				// (regions within a single command are not ordered, so the later writes of the same data get a separate command behind a barrier):
+				std::vector<VkBufferCopy> regions;
+				VulkanStaticBuffer* source = nullptr;
+				auto copyRegions = [&]() {
+					if (regions.empty()) return;
+					vkCmdCopyBuffer(*commandBuffer, *source, *m_dataBuffer, static_cast<uint32_t>(regions.size()), regions.data());
+					regions.clear();
+				};
+				for (size_t i = 0; i < m_pendingWrites.size(); i++) {
+					const PendingWrite& write = m_pendingWrites[i];
+					bool overlaps = false;
+					for (size_t j = 0; j < regions.size(); j++)
+						if (regions[j].dstOffset < (write.offset + write.size) && write.offset < (regions[j].dstOffset + regions[j].size)) {
+							overlaps = true;
+							break;
+						}
+					if (source != write.staging.buffer || overlaps) {
+						copyRegions();
+						if (overlaps) {
+							barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+							vkCmdPipelineBarrier(*commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+						}
+						source = write.staging.buffer;
+						commandBuffer->RecordBufferDependency(source);
+					}
+					VkBufferCopy copy = {};
+					{
+						copy.srcOffset = write.staging.offset;
+						copy.dstOffset = write.offset;
+						copy.size = write.size;
+					}
+					regions.push_back(copy);
+				}
+				copyRegions();
+				DiscardPendingWrites();
+			}
+
+			void VulkanDynamicBuffer::DiscardPendingWrites() {
+				for (size_t i = 0; i < m_pendingWrites.size(); i++)
+					m_updater.UploadRing()->Release(m_pendingWrites[i].staging);
+				m_pendingWrites.clear();
+				m_hasPendingWrites = false;
+			}
+
+			void VulkanDynamicBuffer::RelocateData(VulkanCommandBuffer* commandBuffer) {
+				// Previous submissions may still be writing to the old buffer:
+				VkMemoryBarrier barrier = {};
+				{
+					barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+					barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+					barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+				}
+				vkCmdPipelineBarrier(*commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
 				VkBufferCopy copy = {};
 				{
 					copy.srcOffset = 0;
 					copy.dstOffset = 0;
 					copy.size = static_cast<VkDeviceSize>(m_objectSize * m_objectCount);
 				}
-				commandBuffer->RecordBufferDependency(m_stagingBuffer);
+				commandBuffer->RecordBufferDependency(m_relocationSource);
 				commandBuffer->RecordBufferDependency(m_dataBuffer);
-				vkCmdCopyBuffer(*commandBuffer, *m_stagingBuffer, *m_dataBuffer, 1, &copy);
-				m_stagingBuffer = nullptr;
+				vkCmdCopyBuffer(*commandBuffer, *m_relocationSource, *m_dataBuffer, 1, &copy);
+				m_relocationSource = nullptr;
 			}
 		}
 	}
@@ -2,13 +2,14 @@
 #include "VulkanStaticBuffer.h"
 #include "../VulkanDynamicDataUpdater.h"
 #include <mutex>
+#include <atomic>
 
 
 namespace Jimara {
 	namespace Graphics {
 		namespace Vulkan {
 			/// <summary>
-			/// Vulkan buffer that resides on GPU memory and maps to a staging buffer for writes
+			/// Vulkan buffer that resides on GPU memory and maps to a staging range of the shared VulkanUploadRing for writes
 			/// Note: CPU_READ_WRITE is implemented, but I would not call it fully functional just yet, since you can still map the memory while in use by GPU <_TODO_>
 			/// </summary>
 			class VulkanDynamicBuffer : public virtual VulkanArrayBuffer {
@@ -49,6 +50,24 @@ namespace Jimara {
 				/// <param name="write"> If true, the system will understand that the user modified mapped memory and update the content on GPU </param>
 				virtual void Unmap(bool write) override;
 
+				/// <summary>
+				/// Maps a range of the buffer memory to CPU
+				/// Notes:
+				///		0. Each MapRange call should be accompanied by corresponding UnmapRange() and it's a bad idea to call additional Map()s or MapRange()s in between;
+				///		1. Only the range gets staged; the data buffer is patched in place and the ranges, written in between two GetStaticHandle() calls, 
+				///			get uploaded together (single barrier and a multi-region copy per staging buffer).
+				/// </summary>
+				/// <param name="offset"> Index of the first object within the range </param>
+				/// <param name="count"> Number of objects within the range </param>
+				/// <returns> Mapped memory of the first object within the range (nullptr, if the range is empty or out of bounds) </returns>
+				virtual void* MapRange(size_t offset, size_t count) override;
+
+				/// <summary>
+				/// Unmaps memory previously mapped via MapRange() call
+				/// </summary>
+				/// <param name="write"> If true, the system will understand that the user modified mapped range and update the content on GPU </param>
+				virtual void UnmapRange(bool write) override;
+
 				/// <summary>
 				/// Access data buffer
 				/// </summary>
@@ -67,14 +86,41 @@ namespace Jimara {
 				// Count of objects within the buffer
 				const size_t m_objectCount;
 
-				// Lock for m_dataBuffer and m_stagingBuffer
+				// Lock for m_dataBuffer, m_stagingRange and m_pendingWrites
 				std::mutex m_bufferLock;
 
 				// GPU-side data buffer
 				Reference<VulkanStaticBuffer> m_dataBuffer;
 
-				// CPU-Mapped memory buffer
-				Reference<VulkanStaticBuffer> m_stagingBuffer;
+				// CPU-Mapped staging range
+				VulkanUploadRing::Range m_stagingRange;
+
+				// Offset of the mapped range within the data buffer (in bytes)
+				VkDeviceSize m_mappedOffset;
+
+				// Size of the mapped range (in bytes)
+				VkDeviceSize m_mappedSize;
+
+				// Partial write, that is not yet recorded
+				struct PendingWrite {
+					// Staging range with the data
+					VulkanUploadRing::Range staging;
+
+					// Offset within the data buffer (in bytes)
+					VkDeviceSize offset = 0;
+
+					// Size of the range (in bytes)
+					VkDeviceSize size = 0;
+				};
+
+				// Partial writes, waiting for the next GetStaticHandle() call
+				std::vector<PendingWrite> m_pendingWrites;
+
+				// True, if m_pendingWrites is not empty (lets GetStaticHandle() skip the lock otherwise)
+				std::atomic<bool> m_hasPendingWrites;
+
+				// Previous data buffer, the content is being moved from (defragmentation)
+				Reference<VulkanStaticBuffer> m_relocationSource;
 
 				// CPU-Mapped data
 				void* m_cpuMappedData;
@@ -82,8 +128,23 @@ namespace Jimara {
 				// Data updater
 				VulkanDynamicDataUpdater m_updater;
 
-				// Data update function
+				// Creates a new data buffer
+				Reference<VulkanStaticBuffer> CreateDataBuffer()const;
+
+				// Data update function (transfer queue)
 				void UpdateData(VulkanCommandBuffer* commandBuffer);
+
+				// Acquires m_dataBuffer on the graphics queue after UpdateData
+				void AcquireData(VulkanCommandBuffer* commandBuffer);
+
+				// Records all the pending partial writes (graphics queue)
+				void WriteRanges(VulkanCommandBuffer* commandBuffer);
+
+				// Releases the staging ranges of the pending writes without recording them (m_bufferLock has to be locked)
+				void DiscardPendingWrites();
+
+				// Copies the content of m_relocationSource to m_dataBuffer
+				void RelocateData(VulkanCommandBuffer* commandBuffer);
 			};
 		}
 	}
@@ -4,7 +4,8 @@
 namespace Jimara {
 	namespace Graphics {
 		namespace Vulkan {
-			VulkanStaticBuffer::VulkanStaticBuffer(VulkanDevice* device, size_t objectSize, size_t objectCount, bool writeOnly, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryFlags)
+			VulkanStaticBuffer::VulkanStaticBuffer(VulkanDevice* device, size_t objectSize, size_t objectCount, bool writeOnly, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryFlags
+				, VulkanMemoryPool::AllocationStrategy memoryStrategy)
 				: m_device(device), m_elemSize(objectSize), m_elemCount(objectCount), m_writeOnly(writeOnly), m_usage(usage), m_memoryFlags(memoryFlags), m_buffer(VK_NULL_HANDLE) {
 				size_t allocation = m_elemSize * m_elemCount;
 				if (allocation <= 0) allocation = 1;
@@ -21,7 +22,7 @@ namespace Jimara {
 
 				VkMemoryRequirements memRequirements;
 				vkGetBufferMemoryRequirements(*m_device, m_buffer, &memRequirements);
-				m_memory = m_device->MemoryPool()->Allocate(memRequirements, m_memoryFlags);
+				m_memory = m_device->MemoryPool()->Allocate(memRequirements, m_memoryFlags, memoryStrategy);
 
 				vkBindBufferMemory(*m_device, m_buffer, m_memory->Memory(), m_memory->Offset());
 			}
@@ -70,6 +71,10 @@ namespace Jimara {
 				return m_memory->Size();
 			}
 
+			VulkanMemoryAllocation* VulkanStaticBuffer::Memory()const {
+				return m_memory;
+			}
+
 			Reference<VulkanStaticBuffer> VulkanStaticBuffer::GetStaticHandle(VulkanCommandBuffer*) {
 				return this;
 			}
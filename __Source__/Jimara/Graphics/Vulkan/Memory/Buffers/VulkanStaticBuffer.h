@@ -39,7 +39,9 @@ namespace Jimara {
 				/// <param name="writeOnly"> If true, Map() call will not bother with invalidating any mapped memory ranges, potentially speeding up mapping process and ignoring GPU-data </param>
 				/// <param name="usage"> Buffer usage flags </param>
 				/// <param name="memoryFlags"> Buffer memory flags </param>
-				VulkanStaticBuffer(VulkanDevice* device, size_t objectSize, size_t objectCount, bool writeOnly, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryFlags);
+				/// <param name="memoryStrategy"> Memory allocation strategy (TRANSIENT is a good fit for staging buffers) </param>
+				VulkanStaticBuffer(VulkanDevice* device, size_t objectSize, size_t objectCount, bool writeOnly, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryFlags
+					, VulkanMemoryPool::AllocationStrategy memoryStrategy = VulkanMemoryPool::AllocationStrategy::DEFAULT);
 
 				/// <summary> Virtual destructor </summary>
 				virtual ~VulkanStaticBuffer();
@@ -81,6 +83,9 @@ namespace Jimara {
 				/// <summary> Memory allocation size </summary>
 				VkDeviceSize AllocationSize()const;
 
+				/// <summary> Underlying memory allocation </summary>
+				VulkanMemoryAllocation* Memory()const;
+
 				/// <summary>
 				/// Access data buffer (self, in this case)
 				/// </summary>
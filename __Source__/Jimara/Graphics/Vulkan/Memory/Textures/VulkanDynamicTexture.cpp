@@ -1,5 +1,7 @@
 #include "VulkanDynamicTexture.h"
 #include "../TextureViews/VulkanDynamicTextureView.h"
+#include <algorithm>
+#include <vector>
 
 
 #pragma warning(disable: 26812)
@@ -9,9 +11,12 @@ namespace Jimara {
 		namespace Vulkan {
 			VulkanDynamicTexture::VulkanDynamicTexture(VulkanDevice* device, TextureType type, PixelFormat format, Size3 size, uint32_t arraySize, bool generateMipmaps)
 				: m_device(device), m_textureType(type), m_pixelFormat(format), m_textureSize(size), m_arraySize(arraySize)
-				, m_mipLevels(generateMipmaps ? VulkanStaticTexture::CalculateSupportedMipLevels(device, format, size) : 1u), m_cpuMappedData(nullptr), m_updater(*device) {}
+				, m_mipLevels(generateMipmaps ? VulkanStaticTexture::CalculateSupportedMipLevels(device, format, size) : 1u), m_cpuMappedData(nullptr), m_updater(device)
+				, m_streamer(VulkanTextureStreamer::Instance(device)), m_uploadPending(false) {}
 
-			VulkanDynamicTexture::~VulkanDynamicTexture() {}
+			VulkanDynamicTexture::~VulkanDynamicTexture() {
+				m_streamer->Cancel(m_pendingUpload);
+			}
 
 			Texture::TextureType VulkanDynamicTexture::Type()const {
 				return m_textureType;
@@ -61,78 +66,105 @@ namespace Jimara {
 
 				m_bufferLock.lock();
 
-				if (m_stagingBuffer == nullptr)
-					m_stagingBuffer = Object::Instantiate<VulkanStaticBuffer>(m_device
-						, VulkanImage::BytesPerPixel(m_pixelFormat)
-						, m_textureSize.x * m_textureSize.y * m_textureSize.z * m_arraySize
-						, true
-						, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+				// Buffer offset of the copy has to be a multiple of both the texel size and 4:
+				const VkDeviceSize bytesPerPixel = static_cast<VkDeviceSize>(VulkanImage::BytesPerPixel(m_pixelFormat));
+				VkDeviceSize alignment = bytesPerPixel;
+				while ((alignment % 4) != 0) alignment += bytesPerPixel;
 
-				m_cpuMappedData = m_stagingBuffer->Map();
+				m_stagingRange = m_updater.UploadRing()->Allocate(
+					bytesPerPixel * m_textureSize.x * m_textureSize.y * m_textureSize.z * m_arraySize, alignment);
+				m_cpuMappedData = m_stagingRange.data;
 
 				return m_cpuMappedData;
 			}
 
 			void VulkanDynamicTexture::Unmap(bool write) {
 				if (m_cpuMappedData == nullptr) return;
-				m_stagingBuffer->Unmap(write);
+				if (write) {
+					// Upload gets queued with the streamer (that takes over the staging range); until it gets recorded, the old content stays visible:
+					m_pendingUpload = m_streamer->Enqueue(CreateTexture(VulkanMemoryPool::AllocationStrategy::RELOCATABLE), m_stagingRange, m_pendingUpload);
+					m_uploadPending = true;
+				}
+				else m_updater.UploadRing()->Release(m_stagingRange);
+				m_stagingRange = VulkanUploadRing::Range();
 				m_cpuMappedData = nullptr;
-				if (write) m_texture = nullptr;
-				else m_stagingBuffer = nullptr;
 				m_bufferLock.unlock();
 			}
 
 			Reference<VulkanStaticImage> VulkanDynamicTexture::GetStaticHandle(VulkanCommandBuffer* commandBuffer) {
 				Reference<VulkanStaticTexture> texture = m_texture;
-				if (texture != nullptr) {
+				if (texture != nullptr && (!m_uploadPending) && (!texture->Memory()->RelocationRequested())) {
 					m_updater.WaitForTimeline(commandBuffer);
 					commandBuffer->RecordBufferDependency(texture);
 					return texture;
 				}
 
 				std::unique_lock<std::mutex> lock(m_bufferLock);
-				if (m_texture == nullptr) {
-					m_texture = Object::Instantiate<VulkanStaticTexture>(m_device, m_textureType, m_pixelFormat, m_textureSize, m_arraySize, m_mipLevels > 1
-						, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT
-						| VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
-						, Multisampling::SAMPLE_COUNT_1);
+
+				// Queued upload gets recorded right away if the frame budget allows it (or if there's no older content to show):
+				if (m_uploadPending && m_streamer->Upload(m_pendingUpload, m_texture == nullptr)) {
+					m_texture = m_pendingUpload->Texture();
+					m_updater.Track(m_pendingUpload->BatchId());
+					m_pendingUpload = nullptr;
+					m_uploadPending = false;
 				}
 
-				commandBuffer->RecordBufferDependency(m_texture);
+				// If the memory pool is evacuating the block our image resides in, we move the content to a new texture:
+				if (m_texture != nullptr && m_cpuMappedData == nullptr && m_texture->Memory()->ShouldRelocate())
+					m_relocationSource = m_texture;
 
-				if (m_stagingBuffer == nullptr || m_cpuMappedData != nullptr) {
-					m_updater.WaitForTimeline(commandBuffer);
-					return m_texture;
-				}
+				// Only the images that get their content uploaded are known to be in SHADER_READ_ONLY_OPTIMAL layout and can be safely relocated later:
+				if (m_relocationSource != nullptr)
+					m_texture = CreateTexture(VulkanMemoryPool::AllocationStrategy::RELOCATABLE);
+				else if (m_texture == nullptr)
+					m_texture = CreateTexture(VulkanMemoryPool::AllocationStrategy::DEFAULT);
 
-				m_updater.Update(commandBuffer, Callback<VulkanCommandBuffer*>(&VulkanDynamicTexture::UpdateData, this));
+				commandBuffer->RecordBufferDependency(m_texture);
+
+				if (m_relocationSource != nullptr)
+					m_updater.Update(commandBuffer, Callback<VulkanCommandBuffer*>(&VulkanDynamicTexture::RelocateData, this), VulkanUploadRing::Stage::GRAPHICS);
+				else m_updater.WaitForTimeline(commandBuffer);
 
 				return m_texture;
 			}
 
-			void VulkanDynamicTexture::UpdateData(VulkanCommandBuffer* commandBuffer) {
-				m_texture->TransitionLayout(commandBuffer, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, m_mipLevels, 0, m_arraySize);
-
-				VkBufferImageCopy region = {};
-				{
-					region.bufferOffset = 0;
-					region.bufferRowLength = 0;
-					region.bufferImageHeight = 0;
+			Reference<VulkanStaticTexture> VulkanDynamicTexture::CreateTexture(VulkanMemoryPool::AllocationStrategy memoryStrategy)const {
+				return Object::Instantiate<VulkanStaticTexture>(m_device, m_textureType, m_pixelFormat, m_textureSize, m_arraySize, m_mipLevels > 1
+					, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+					| VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+					, Multisampling::SAMPLE_COUNT_1, memoryStrategy);
+			}
 
-					region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-					region.imageSubresource.mipLevel = 0;
-					region.imageSubresource.baseArrayLayer = 0;
-					region.imageSubresource.layerCount = m_arraySize;
+			void VulkanDynamicTexture::RelocateData(VulkanCommandBuffer* commandBuffer) {
+				m_relocationSource->TransitionLayout(commandBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, 0, m_mipLevels, 0, m_arraySize);
+				m_texture->TransitionLayout(commandBuffer, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, m_mipLevels, 0, m_arraySize);
 
-					region.imageOffset = { 0, 0, 0 };
-					region.imageExtent = { m_textureSize.x, m_textureSize.y, m_textureSize.z };
+				std::vector<VkImageCopy> regions(m_mipLevels);
+				for (uint32_t mipLevel = 0; mipLevel < m_mipLevels; mipLevel++) {
+					VkImageCopy& region = regions[mipLevel];
+					region = {};
+
+					region.srcSubresource.aspectMask = m_texture->VulkanImageAspectFlags();
+					region.srcSubresource.mipLevel = mipLevel;
+					region.srcSubresource.baseArrayLayer = 0;
+					region.srcSubresource.layerCount = m_arraySize;
+					region.dstSubresource = region.srcSubresource;
+
+					region.srcOffset = region.dstOffset = { 0, 0, 0 };
+					region.extent = {
+						std::max(m_textureSize.x >> mipLevel, 1u),
+						std::max(m_textureSize.y >> mipLevel, 1u),
+						std::max(m_textureSize.z >> mipLevel, 1u) };
 				}
-				vkCmdCopyBufferToImage(*commandBuffer, *m_stagingBuffer, *m_texture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+				vkCmdCopyImage(*commandBuffer
+					, *m_relocationSource, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+					, *m_texture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+					, static_cast<uint32_t>(regions.size()), regions.data());
 
-				m_texture->GenerateMipmaps(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+				m_texture->TransitionLayout(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, m_mipLevels, 0, m_arraySize);
 				commandBuffer->RecordBufferDependency(m_texture);
-				commandBuffer->RecordBufferDependency(m_stagingBuffer);
-				m_stagingBuffer = nullptr;
+				commandBuffer->RecordBufferDependency(m_relocationSource);
+				m_relocationSource = nullptr;
 			}
 		}
 	}
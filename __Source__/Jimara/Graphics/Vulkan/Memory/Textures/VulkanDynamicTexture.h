@@ -7,6 +7,7 @@ namespace Jimara {
 	}
 }
 #include "VulkanStaticTexture.h"
+#include "VulkanTextureStreamer.h"
 #include "../VulkanDynamicDataUpdater.h"
 #include "../Buffers/VulkanStaticBuffer.h"
 
@@ -117,14 +118,17 @@ namespace Jimara {
 				// Mipmap count
 				const uint32_t m_mipLevels;
 
-				// Lock for m_texture and m_stagingBuffer
+				// Lock for m_texture, m_stagingRange and m_pendingUpload
 				std::mutex m_bufferLock;
 
 				// Texture, holding the data
 				Reference<VulkanStaticTexture> m_texture;
 
-				// Staging buffer for temporarily holding CPU-mapped data
-				Reference<VulkanStaticBuffer> m_stagingBuffer;
+				// Staging range for temporarily holding CPU-mapped data
+				VulkanUploadRing::Range m_stagingRange;
+
+				// Previous texture, the content is being moved from (defragmentation)
+				Reference<VulkanStaticTexture> m_relocationSource;
 
 				// CPU mapping
 				void* m_cpuMappedData;
@@ -132,8 +136,20 @@ namespace Jimara {
 				// Data updater
 				VulkanDynamicDataUpdater m_updater;
 
-				// Data update function
-				void UpdateData(VulkanCommandBuffer* commandBuffer);
+				// Shared texture streamer
+				const Reference<VulkanTextureStreamer> m_streamer;
+
+				// Last upload request (m_texture gets replaced with the request's texture once the upload is recorded)
+				Reference<VulkanTextureStreamer::Request> m_pendingUpload;
+
+				// True, while m_pendingUpload is not yet adopted
+				std::atomic<bool> m_uploadPending;
+
+				// Creates a new texture
+				Reference<VulkanStaticTexture> CreateTexture(VulkanMemoryPool::AllocationStrategy memoryStrategy)const;
+
+				// Copies the content of m_relocationSource to m_texture
+				void RelocateData(VulkanCommandBuffer* commandBuffer);
 			};
 		}
 	}
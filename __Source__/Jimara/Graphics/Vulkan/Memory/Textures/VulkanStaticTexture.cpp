@@ -7,7 +7,7 @@ namespace Jimara {
 		namespace Vulkan {
 			VulkanStaticTexture::VulkanStaticTexture(
 				VulkanDevice* device, TextureType type, PixelFormat format, Size3 size, uint32_t arraySize, bool generateMipmaps,
-				VkImageUsageFlags usage, Multisampling sampleCount)
+				VkImageUsageFlags usage, Multisampling sampleCount, VulkanMemoryPool::AllocationStrategy memoryStrategy)
 				: m_device(device), m_textureType(type), m_pixelFormat(format), m_textureSize(size), m_arraySize(arraySize)
 				, m_mipLevels(generateMipmaps ? CalculateSupportedMipLevels(device, format, size) : 1u), m_sampleCount(sampleCount) {
 
@@ -46,7 +46,7 @@ namespace Jimara {
 				VkMemoryRequirements memRequirements;
 				vkGetImageMemoryRequirements(*m_device, m_image, &memRequirements);
 
-				m_memory = m_device->MemoryPool()->Allocate(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+				m_memory = m_device->MemoryPool()->Allocate(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memoryStrategy, true);
 				vkBindImageMemory(*m_device, m_image, m_memory->Memory(), m_memory->Offset());
 			}
 
@@ -92,6 +92,10 @@ namespace Jimara {
 			VulkanDevice* VulkanStaticTexture::Device()const {
 				return m_device;
 			}
+
+			VulkanMemoryAllocation* VulkanStaticTexture::Memory()const {
+				return m_memory;
+			}
 		}
 	}
 }
@@ -26,9 +26,10 @@ namespace Jimara {
 				/// <param name="generateMipmaps"> If true, mipmaps will be generated </param>
 				/// <param name="usage"> Usage flags </param>
 				/// <param name="sampleCount"> Vulkan sample count </param>
+				/// <param name="memoryStrategy"> Memory allocation strategy (RELOCATABLE, if the owner is able to move the content on request) </param>
 				VulkanStaticTexture(
 					VulkanDevice* device, TextureType type, PixelFormat format, Size3 size, uint32_t arraySize, bool generateMipmaps,
-					VkImageUsageFlags usage, Multisampling sampleCount);
+					VkImageUsageFlags usage, Multisampling sampleCount, VulkanMemoryPool::AllocationStrategy memoryStrategy = VulkanMemoryPool::AllocationStrategy::DEFAULT);
 
 				/// <summary> Virtual destructor </summary>
 				virtual ~VulkanStaticTexture();
@@ -60,6 +61,9 @@ namespace Jimara {
 				/// <summary> "Owner" device </summary>
 				virtual VulkanDevice* Device()const override;
 
+				/// <summary> Underlying memory allocation </summary>
+				VulkanMemoryAllocation* Memory()const;
+
 
 			private:
 				// "Owner" device
@@ -0,0 +1,288 @@
+#include "VulkanTextureStreamer.h"
+#include <algorithm>
+
+
+#pragma warning(disable: 26812)
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			namespace {
+				class TextureStreamerCache : public virtual ObjectCache<VulkanDevice*> {
+				public:
+					inline static Reference<VulkanTextureStreamer> Instance(VulkanDevice* device) {
+						static TextureStreamerCache cache;
+						return cache.GetCachedOrCreate(device, false,
+							[&]() -> Reference<VulkanTextureStreamer> { return Object::Instantiate<VulkanTextureStreamer>(device); });
+					}
+				};
+
+				inline static Size3 MipSize(const Size3& size, uint32_t mipLevel) {
+					return Size3(
+						std::max(size.x >> mipLevel, 1u),
+						std::max(size.y >> mipLevel, 1u),
+						std::max(size.z >> mipLevel, 1u));
+				}
+			}
+
+			VulkanTextureStreamer::Request::Request() : m_batchId(0), m_state(State::PENDING) {}
+
+			VulkanTextureStreamer::Request::~Request() {}
+
+			VulkanStaticTexture* VulkanTextureStreamer::Request::Texture()const { return m_texture; }
+
+			VkDeviceSize VulkanTextureStreamer::Request::Size()const { return m_staging.size; }
+
+			uint64_t VulkanTextureStreamer::Request::BatchId()const { return m_batchId; }
+
+			bool VulkanTextureStreamer::Request::Recorded()const { return m_state == State::RECORDED; }
+
+
+			Reference<VulkanTextureStreamer> VulkanTextureStreamer::Instance(VulkanDevice* device) {
+				if (device == nullptr) return nullptr;
+				else return TextureStreamerCache::Instance(device);
+			}
+
+			VulkanTextureStreamer::VulkanTextureStreamer(VulkanDevice* device, size_t frameBudget)
+				: m_device(device), m_uploadRing(VulkanUploadRing::Instance(device)), m_frameBudget(frameBudget)
+				, m_pendingCount(0), m_pendingBytes(0), m_frameBytes(0), m_frameBatch(0), m_recordedGroupCount(0) {}
+
+			VulkanTextureStreamer::~VulkanTextureStreamer() {
+				std::unique_lock<std::mutex> lock(m_lock);
+				for (size_t i = 0; i < m_queue.size(); i++) {
+					Request* request = m_queue[i];
+					if (request->m_state != Request::State::PENDING) continue;
+					request->m_state = Request::State::CANCELED;
+					m_uploadRing->Release(request->m_staging);
+					request->m_staging = VulkanUploadRing::Range();
+				}
+				m_queue.clear();
+			}
+
+			VulkanDevice* VulkanTextureStreamer::Device()const { return m_device; }
+
+			VulkanUploadRing* VulkanTextureStreamer::UploadRing()const { return m_uploadRing; }
+
+			size_t VulkanTextureStreamer::FrameBudget()const { return m_frameBudget; }
+
+			void VulkanTextureStreamer::SetFrameBudget(size_t budget) { m_frameBudget = budget; }
+
+			Reference<VulkanTextureStreamer::Request> VulkanTextureStreamer::Enqueue(VulkanStaticTexture* texture, const VulkanUploadRing::Range& staging, Request* previous) {
+				std::unique_lock<std::mutex> lock(m_lock);
+
+				// Still queued request just gets the new data:
+				if (previous != nullptr && previous->m_state == Request::State::PENDING) {
+					m_pendingBytes -= previous->m_staging.size;
+					m_uploadRing->Release(previous->m_staging);
+					previous->m_texture = texture;
+					previous->m_staging = staging;
+					m_pendingBytes += staging.size;
+					return previous;
+				}
+
+				Reference<Request> request = new Request();
+				request->ReleaseRef();
+				request->m_texture = texture;
+				request->m_staging = staging;
+				m_queue.push_back(request);
+				m_pendingCount++;
+				m_pendingBytes += staging.size;
+				return request;
+			}
+
+			void VulkanTextureStreamer::Cancel(Request* request) {
+				if (request == nullptr) return;
+				std::unique_lock<std::mutex> lock(m_lock);
+				if (request->m_state != Request::State::PENDING) return;
+				request->m_state = Request::State::CANCELED;
+				m_pendingCount--;
+				m_pendingBytes -= request->m_staging.size;
+				m_uploadRing->Release(request->m_staging);
+				request->m_staging = VulkanUploadRing::Range();
+				request->m_texture = nullptr;
+			}
+
+			bool VulkanTextureStreamer::Upload(Request* request, bool force) {
+				if (request == nullptr) return false;
+				else if (request->m_state == Request::State::RECORDED) return true;
+				std::unique_lock<std::mutex> lock(m_lock);
+				if (request->m_state != Request::State::PENDING) return (request->m_state == Request::State::RECORDED);
+				if ((!force) && m_frameBytes > 0 && (m_frameBytes + request->m_staging.size) > m_frameBudget) {
+					RefreshFrameBudget();
+					if (m_frameBytes > 0) return false;
+				}
+				AddToGroup(request);
+				CollectQueued();
+				RecordGroup();
+				return true;
+			}
+
+			void VulkanTextureStreamer::Flush() {
+				std::unique_lock<std::mutex> lock(m_lock);
+				CollectQueued();
+				RecordGroup();
+				m_frameBytes = 0;
+				m_frameBatch = 0;
+			}
+
+			size_t VulkanTextureStreamer::PendingCount()const {
+				std::unique_lock<std::mutex> lock(m_lock);
+				return m_pendingCount;
+			}
+
+			VkDeviceSize VulkanTextureStreamer::PendingBytes()const {
+				std::unique_lock<std::mutex> lock(m_lock);
+				return m_pendingBytes;
+			}
+
+			size_t VulkanTextureStreamer::RecordedGroupCount()const { return m_recordedGroupCount; }
+
+			void VulkanTextureStreamer::RefreshFrameBudget() {
+				// Without Flush() calls, the frame ends once the device is done with the uploads (waiting for them is what the renderers do anyway):
+				if (m_frameBatch <= 0 || m_uploadRing->CompletedBatch() < m_frameBatch) return;
+				m_frameBytes = 0;
+				m_frameBatch = 0;
+			}
+
+			void VulkanTextureStreamer::AddToGroup(Request* request) {
+				request->m_state = Request::State::RECORDED;
+				m_pendingCount--;
+				m_pendingBytes -= request->m_staging.size;
+				m_frameBytes += request->m_staging.size;
+				m_group.push_back(request);
+			}
+
+			void VulkanTextureStreamer::CollectQueued() {
+				const size_t budget = m_frameBudget;
+				while (!m_queue.empty()) {
+					Request* request = m_queue.front();
+					if (request->m_state != Request::State::PENDING) {
+						m_queue.pop_front();
+						continue;
+					}
+					// At least one request makes it in each group, even if the budget is already spent by the requested uploads:
+					if ((!m_group.empty()) && (m_frameBytes + request->m_staging.size) > budget) break;
+					AddToGroup(request);
+					m_queue.pop_front();
+				}
+			}
+
+			void VulkanTextureStreamer::RecordGroup() {
+				if (m_group.empty()) return;
+				m_uploadRing->Record(Callback<VulkanCommandBuffer*>(&VulkanTextureStreamer::RecordCopies, this));
+				const uint64_t batchId = m_uploadRing->Record(Callback<VulkanCommandBuffer*>(&VulkanTextureStreamer::RecordMipChains, this), VulkanUploadRing::Stage::GRAPHICS);
+				for (size_t i = 0; i < m_group.size(); i++) {
+					Request* request = m_group[i];
+					m_uploadRing->Release(request->m_staging);
+					request->m_staging = VulkanUploadRing::Range();
+					request->m_batchId = batchId;
+				}
+				m_frameBatch = batchId;
+				m_group.clear();
+				m_recordedGroupCount++;
+			}
+
+			void VulkanTextureStreamer::RecordCopies(VulkanCommandBuffer* commandBuffer) {
+				static thread_local std::vector<VkImageMemoryBarrier> barriers;
+
+				// All the textures go to TRANSFER_DST_OPTIMAL layout with a single barrier:
+				barriers.clear();
+				for (size_t i = 0; i < m_group.size(); i++) {
+					VulkanStaticTexture* texture = m_group[i]->m_texture;
+					barriers.push_back(texture->LayoutTransitionBarrier(commandBuffer
+						, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, texture->VulkanImageAspectFlags()
+						, 0, texture->MipLevels(), 0, texture->ArraySize(), 0, VK_ACCESS_TRANSFER_WRITE_BIT));
+				}
+				vkCmdPipelineBarrier(*commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT
+					, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+				for (size_t i = 0; i < m_group.size(); i++) {
+					const Request* request = m_group[i];
+					VulkanStaticTexture* texture = request->m_texture;
+					const Size3 size = texture->Size();
+					VkBufferImageCopy region = {};
+					{
+						region.bufferOffset = request->m_staging.offset;
+						region.bufferRowLength = 0;
+						region.bufferImageHeight = 0;
+
+						region.imageSubresource.aspectMask = texture->VulkanImageAspectFlags();
+						region.imageSubresource.mipLevel = 0;
+						region.imageSubresource.baseArrayLayer = 0;
+						region.imageSubresource.layerCount = texture->ArraySize();
+
+						region.imageOffset = { 0, 0, 0 };
+						region.imageExtent = { size.x, size.y, size.z };
+					}
+					vkCmdCopyBufferToImage(*commandBuffer, *request->m_staging.buffer, *texture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+					m_uploadRing->ReleaseOwnership(commandBuffer, texture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, texture->MipLevels(), texture->ArraySize());
+					commandBuffer->RecordBufferDependency(texture);
+					commandBuffer->RecordBufferDependency(request->m_staging.buffer);
+				}
+			}
+
+			void VulkanTextureStreamer::RecordMipChains(VulkanCommandBuffer* commandBuffer) {
+				static thread_local std::vector<VkImageMemoryBarrier> barriers;
+				static thread_local std::vector<VkImageBlit> blits;
+
+				// Blits are not available on transfer-only queues, so the mip chains get generated on the graphics side:
+				uint32_t maxMipLevels = 0;
+				for (size_t i = 0; i < m_group.size(); i++) {
+					VulkanStaticTexture* texture = m_group[i]->m_texture;
+					m_uploadRing->AcquireOwnership(commandBuffer, texture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, texture->MipLevels(), texture->ArraySize());
+					maxMipLevels = std::max(maxMipLevels, texture->MipLevels());
+					commandBuffer->RecordBufferDependency(texture);
+				}
+
+				// Level by level, all the textures get their previous level transitioned to TRANSFER_SRC_OPTIMAL with a single barrier and get blitted to the next one:
+				for (uint32_t mipLevel = 0; mipLevel < maxMipLevels; mipLevel++) {
+					barriers.clear();
+					for (size_t i = 0; i < m_group.size(); i++) {
+						VulkanStaticTexture* texture = m_group[i]->m_texture;
+						if (texture->MipLevels() <= mipLevel) continue;
+						barriers.push_back(texture->LayoutTransitionBarrier(commandBuffer
+							, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture->VulkanImageAspectFlags()
+							, mipLevel, 1, 0, texture->ArraySize(), VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT));
+					}
+					vkCmdPipelineBarrier(*commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT
+						, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+					for (size_t i = 0; i < m_group.size(); i++) {
+						VulkanStaticTexture* texture = m_group[i]->m_texture;
+						if (texture->MipLevels() <= (mipLevel + 1)) continue;
+						const Size3 srcSize = MipSize(texture->Size(), mipLevel);
+						const Size3 dstSize = MipSize(texture->Size(), mipLevel + 1);
+						VkImageBlit blit = {};
+						{
+							blit.srcOffsets[0] = { 0, 0, 0 };
+							blit.srcOffsets[1] = { static_cast<int32_t>(srcSize.x), static_cast<int32_t>(srcSize.y), static_cast<int32_t>(srcSize.z) };
+							blit.srcSubresource.aspectMask = texture->VulkanImageAspectFlags();
+							blit.srcSubresource.mipLevel = mipLevel;
+							blit.srcSubresource.baseArrayLayer = 0;
+							blit.srcSubresource.layerCount = texture->ArraySize();
+							blit.dstOffsets[0] = { 0, 0, 0 };
+							blit.dstOffsets[1] = { static_cast<int32_t>(dstSize.x), static_cast<int32_t>(dstSize.y), static_cast<int32_t>(dstSize.z) };
+							blit.dstSubresource = blit.srcSubresource;
+							blit.dstSubresource.mipLevel = mipLevel + 1;
+						}
+						vkCmdBlitImage(*commandBuffer
+							, *texture, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+							, *texture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+							, 1, &blit, VK_FILTER_LINEAR);
+					}
+				}
+
+				// Finally, everything goes to SHADER_READ_ONLY_OPTIMAL layout with a single barrier:
+				barriers.clear();
+				for (size_t i = 0; i < m_group.size(); i++) {
+					VulkanStaticTexture* texture = m_group[i]->m_texture;
+					barriers.push_back(texture->LayoutTransitionBarrier(commandBuffer
+						, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, texture->VulkanImageAspectFlags()
+						, 0, texture->MipLevels(), 0, texture->ArraySize(), VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT));
+				}
+				vkCmdPipelineBarrier(*commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT
+					, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+			}
+		}
+	}
+}
+#pragma warning(default: 26812)
@@ -0,0 +1,209 @@
+#pragma once
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			class VulkanTextureStreamer;
+		}
+	}
+}
+#include "VulkanStaticTexture.h"
+#include "../VulkanUploadRing.h"
+#include <deque>
+
+
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			/// <summary>
+			/// Device-wide texture upload scheduler, shared by the dynamic textures.
+			/// Notes:
+			///		0. Texture uploads are queued and recorded into the shared VulkanUploadRing batches in groups,
+			///			with the mip chains of the whole group generated together (single barrier per mip level for all the textures);
+			///		1. Each frame gets an upload byte budget; the textures, requested for rendering, get recorded right away if the budget allows (or if they have no content yet),
+			///			the rest stay queued and get recorded on Flush() (once per frame, by the render engine), at least one per frame;
+			///			the budget is restored on Flush() or once the device executes the upload batches that spent it, so that the users without a render engine
+			///			(offscreen rendering, that never calls Flush()) still see their updates a frame later;
+			///		2. All calls are thread-safe.
+			/// </summary>
+			class VulkanTextureStreamer : public virtual ObjectCache<VulkanDevice*>::StoredObject {
+			public:
+				/// <summary> Default per-frame upload budget (in bytes) </summary>
+				static const size_t DEFAULT_FRAME_BUDGET = (static_cast<size_t>(64) << 20);
+
+				/// <summary>
+				/// Queued texture upload
+				/// </summary>
+				class Request : public virtual Object {
+				public:
+					/// <summary> Virtual destructor </summary>
+					virtual ~Request();
+
+					/// <summary> Texture, the data gets uploaded to </summary>
+					VulkanStaticTexture* Texture()const;
+
+					/// <summary> Size of the staged data </summary>
+					VkDeviceSize Size()const;
+
+					/// <summary> Upload ring batch, the upload was recorded into (0, while the request is still queued) </summary>
+					uint64_t BatchId()const;
+
+					/// <summary> True, once the upload commands are recorded </summary>
+					bool Recorded()const;
+
+
+				private:
+					// Request state
+					enum class State : uint8_t {
+						// Request is queued
+						PENDING = 0,
+
+						// Request is recorded
+						RECORDED = 1,
+
+						// Request got canceled
+						CANCELED = 2
+					};
+
+					// Target texture
+					Reference<VulkanStaticTexture> m_texture;
+
+					// Staging range
+					VulkanUploadRing::Range m_staging;
+
+					// Batch, the upload was recorded into
+					std::atomic<uint64_t> m_batchId;
+
+					// Current state
+					std::atomic<State> m_state;
+
+					// Constructor
+					Request();
+
+					// Streamer manages the requests
+					friend class VulkanTextureStreamer;
+				};
+
+				/// <summary>
+				/// Texture streamer, shared by the users of the device
+				/// </summary>
+				/// <param name="device"> Graphics device </param>
+				/// <returns> Shared instance </returns>
+				static Reference<VulkanTextureStreamer> Instance(VulkanDevice* device);
+
+				/// <summary>
+				/// Constructor
+				/// </summary>
+				/// <param name="device"> Graphics device </param>
+				/// <param name="frameBudget"> Per-frame upload budget (in bytes) </param>
+				VulkanTextureStreamer(VulkanDevice* device, size_t frameBudget = DEFAULT_FRAME_BUDGET);
+
+				/// <summary> Virtual destructor (drops the queued uploads) </summary>
+				virtual ~VulkanTextureStreamer();
+
+				/// <summary> Graphics device </summary>
+				VulkanDevice* Device()const;
+
+				/// <summary> Shared upload ring </summary>
+				VulkanUploadRing* UploadRing()const;
+
+				/// <summary> Per-frame upload budget (in bytes) </summary>
+				size_t FrameBudget()const;
+
+				/// <summary>
+				/// Sets per-frame upload budget
+				/// </summary>
+				/// <param name="budget"> Budget (in bytes) </param>
+				void SetFrameBudget(size_t budget);
+
+				/// <summary>
+				/// Queues a texture upload
+				/// Note: The streamer takes over the staging range and releases it once the upload is recorded or canceled.
+				/// </summary>
+				/// <param name="texture"> Texture to upload the base mip level of all the array layers to (will be left in SHADER_READ_ONLY_OPTIMAL layout) </param>
+				/// <param name="staging"> Staging range with tightly packed texel data (from the same upload ring) </param>
+				/// <param name="previous"> Previous request from the same user (if it is still queued, it gets replaced by the new data, keeping it's place in the queue) </param>
+				/// <returns> Upload request </returns>
+				Reference<Request> Enqueue(VulkanStaticTexture* texture, const VulkanUploadRing::Range& staging, Request* previous = nullptr);
+
+				/// <summary>
+				/// Cancels a queued upload (does nothing if it's already recorded)
+				/// </summary>
+				/// <param name="request"> Request to cancel </param>
+				void Cancel(Request* request);
+
+				/// <summary>
+				/// Records a queued upload right away, alongside as many queued uploads, as the budget allows
+				/// </summary>
+				/// <param name="request"> Request to record </param>
+				/// <param name="force"> If true, the request will be recorded even if the frame budget is already spent </param>
+				/// <returns> True, if the request is recorded (now or earlier) </returns>
+				bool Upload(Request* request, bool force);
+
+				/// <summary> Records queued uploads within the remaining frame budget (at least one) and starts a new frame (restores the budget) </summary>
+				void Flush();
+
+				/// <summary> Number of queued uploads </summary>
+				size_t PendingCount()const;
+
+				/// <summary> Total size of the queued uploads </summary>
+				VkDeviceSize PendingBytes()const;
+
+				/// <summary> Number of upload groups, recorded so far </summary>
+				size_t RecordedGroupCount()const;
+
+
+			private:
+				// "Owner" device
+				const Reference<VulkanDevice> m_device;
+
+				// Shared upload ring
+				const Reference<VulkanUploadRing> m_uploadRing;
+
+				// Per-frame upload budget
+				std::atomic<size_t> m_frameBudget;
+
+				// Lock for everything below
+				mutable std::mutex m_lock;
+
+				// Queued requests (recorded and canceled ones are skipped)
+				std::deque<Reference<Request>> m_queue;
+
+				// Number of queued requests
+				size_t m_pendingCount;
+
+				// Total size of the queued requests
+				VkDeviceSize m_pendingBytes;
+
+				// Bytes, recorded since the last Flush() (or since the device has executed m_frameBatch)
+				VkDeviceSize m_frameBytes;
+
+				// Last upload ring batch, the frame budget was spent on
+				uint64_t m_frameBatch;
+
+				// Number of upload groups, recorded so far
+				std::atomic<size_t> m_recordedGroupCount;
+
+				// Group, currently being recorded
+				std::vector<Reference<Request>> m_group;
+
+				// Restores the frame budget, if the device has already executed all the uploads, it was spent on
+				void RefreshFrameBudget();
+
+				// Moves a pending request to m_group
+				void AddToGroup(Request* request);
+
+				// Collects queued requests to m_group while within the frame budget
+				void CollectQueued();
+
+				// Records m_group
+				void RecordGroup();
+
+				// Copies the staged data to the textures from m_group (transfer queue)
+				void RecordCopies(VulkanCommandBuffer* commandBuffer);
+
+				// Generates mip chains for m_group and transitions the textures to SHADER_READ_ONLY_OPTIMAL layout (graphics queue)
+				void RecordMipChains(VulkanCommandBuffer* commandBuffer);
+			};
+		}
+	}
+}
@@ -1,14 +1,13 @@
 #pragma once
-#include "../Pipeline/VulkanCommandBuffer.h"
-#include "../../../Core/Function.h"
-#include <queue>
-#include <mutex>
+#include "VulkanUploadRing.h"
+#include <atomic>
 
 namespace Jimara {
 	namespace Graphics {
 		namespace Vulkan {
 			/// <summary>
 			/// Helper for some dynamic storage types that need to execute a bounch of commands before being available to the main render logic
+			/// (commands are batched with everyone else's through the device's VulkanUploadRing)
 			/// </summary>
 			class VulkanDynamicDataUpdater {
 			public:
@@ -16,40 +15,49 @@ namespace Jimara {
 				/// Constructor
 				/// </summary>
 				/// <param name="device"> Device </param>
-				VulkanDynamicDataUpdater(VkDeviceHandle* device);
+				VulkanDynamicDataUpdater(VulkanDevice* device);
 
 				/// <summary> Virtual destructor </summary>
 				virtual ~VulkanDynamicDataUpdater();
 
+				/// <summary> Shared upload ring </summary>
+				VulkanUploadRing* UploadRing()const;
+
 				/// <summary>
-				/// In case the last submitted update commands are not yet complete, this function will add the correct execution dependency to givaen command buffer
+				/// In case the last recorded update commands are not yet complete, this function will add the correct execution dependency to givaen command buffer
 				/// </summary>
 				/// <param name="commandBuffer"> Command buffer to add dependency to </param>
 				void WaitForTimeline(VulkanCommandBuffer* commandBuffer);
 
 				/// <summary>
-				/// Creates and runs a command buffer, executing some updates and moving the object's personal timeline
+				/// Records some update commands into the current upload batch (submitted once someone waits for it or on the next frame)
+				/// </summary>
+				/// <param name="dataUpdateFn"> Callback for updating arbitrary data </param>
+				/// <param name="stage"> Part of the upload batch to record into </param>
+				/// <returns> Identifier of the batch, the commands were recorded into </returns>
+				uint64_t Update(const Callback<VulkanCommandBuffer*>& dataUpdateFn, VulkanUploadRing::Stage stage = VulkanUploadRing::Stage::TRANSFER);
+
+				/// <summary>
+				/// Records some update commands into the current upload batch and makes the command buffer wait for them
 				/// </summary>
 				/// <param name="commandBuffer"> Command buffer to record dependencies to </param>
 				/// <param name="dataUpdateFn"> Callback for updating arbitrary data </param>
-				void Update(VulkanCommandBuffer* commandBuffer, Callback<VulkanCommandBuffer*> dataUpdateFn);
+				/// <param name="stage"> Part of the upload batch to record into </param>
+				void Update(VulkanCommandBuffer* commandBuffer, const Callback<VulkanCommandBuffer*>& dataUpdateFn, VulkanUploadRing::Stage stage = VulkanUploadRing::Stage::TRANSFER);
+
+				/// <summary>
+				/// Makes WaitForTimeline() wait for a batch, the update commands were recorded into by someone else (ignored, if older than the last one)
+				/// </summary>
+				/// <param name="batchId"> Upload ring batch identifier </param>
+				void Track(uint64_t batchId);
 
 
 			private:
-				// Personal timeline
-				Reference<VulkanTimelineSemaphore> m_timeline;
+				// Shared upload ring
+				const Reference<VulkanUploadRing> m_uploadRing;
 
-				// Last submitted revision (timeline counter)
+				// Last batch, the update commands were recorded into
 				std::atomic<uint64_t> m_revision;
-
-				// Last synchronized revision (timeline counter)
-				std::atomic<uint64_t> m_lastKnownRevision;
-
-				// Submitted command buffers (We need these to avoid CPU-GPU synchronisations mid render)
-				std::queue<std::pair<Reference<VulkanPrimaryCommandBuffer>, uint64_t>> m_updateBuffers;
-
-				// Lock for the timeline and buffer queue
-				std::mutex m_lock;
 			};
 		}
 	}
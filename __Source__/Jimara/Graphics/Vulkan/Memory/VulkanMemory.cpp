@@ -1,201 +1,469 @@
 #include "VulkanMemory.h"
-#include <queue>
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 
+#pragma warning(disable: 26812)
 namespace Jimara {
 	namespace Graphics {
 		namespace Vulkan {
 			namespace {
-				inline static uint32_t FindMemoryType(VulkanDevice* device, uint32_t typeFilter, VkMemoryPropertyFlags& properties) {
-					const VkPhysicalDeviceMemoryProperties& memoryProperties = device->PhysicalDeviceInfo()->MemoryProperties();
-					for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
-						if ((typeFilter & (1 << i)) != 0 && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-							properties = memoryProperties.memoryTypes[i].propertyFlags;
-							return i;
-						}
-					device->Log()->Fatal("VulkanMemoryAllocation - Failed to find suitable memory type!");
+				inline static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment) {
+					if (alignment <= 1) return value;
+					const VkDeviceSize remainder = (value % alignment);
+					return (remainder == 0) ? value : (value + alignment - remainder);
 				}
+			}
 
-#define HEAP_POOL_MIN_BLOCK_SIZE_LOG 4
-#define HEAP_POOL_MAX_BLOCK_POOLS ((sizeof(VkDeviceSize) << 3) - HEAP_POOL_MIN_BLOCK_SIZE_LOG)
-#define BLOCK_POOL_MAX_ALLOCATIONS HEAP_POOL_MAX_BLOCK_POOLS
+			struct VulkanMemoryPool::MemoryBlock {
+				// Memory handle
+				VkDeviceMemory memory = VK_NULL_HANDLE;
 
-#define BLOCK_POOL_ALLOCATION_SIZE(blockPoolIndex) (static_cast<VkDeviceSize>(1) << static_cast<VkDeviceSize>(static_cast<VkDeviceSize>(blockPoolIndex) + HEAP_POOL_MIN_BLOCK_SIZE_LOG))
-#define BLOCK_ALLOCATION_COUNT(memoryBlockIndex) (static_cast<VkDeviceSize>(1) << static_cast<VkDeviceSize>(memoryBlockIndex))
-#define BLOCK_ALLOCATION_SIZE(blockPoolIndex, memoryBlockIndex) (BLOCK_POOL_ALLOCATION_SIZE(blockPoolIndex) * BLOCK_ALLOCATION_COUNT(memoryBlockIndex))
+				// Persistent mapping (nullptr for the memory invisible to host)
+				void* mapping = nullptr;
 
-				struct BlockAllocation {
-					VkDeviceMemory memoryBlock;
-					VulkanMemoryAllocation* allocations;
-					void* memoryMapping;
+				// Block size
+				VkDeviceSize size = 0;
 
-					BlockAllocation() : memoryBlock(VK_NULL_HANDLE), allocations(nullptr), memoryMapping(nullptr) {}
-				};
+				// DEFAULT for shared blocks, TRANSIENT for linear pages and DEDICATED for dedicated allocations
+				AllocationStrategy strategy = AllocationStrategy::DEFAULT;
 
-				struct BlockPool {
-					std::mutex lock;
-					BlockAllocation memoryBlocks[BLOCK_POOL_MAX_ALLOCATIONS];
-					std::queue<VulkanMemoryAllocation*> freeAllocations;
+				// Sub-allocator (shared blocks only)
+				std::unique_ptr<VulkanMemoryTLSF> subAllocator;
 
-					Reference<VulkanMemoryAllocation> Allocate(const VulkanMemoryPool* pool, uint32_t memoryTypeIndex, size_t blockPoolId
-						, VulkanMemoryAllocation* (*createMemoryAllocations)(const VulkanMemoryPool* device, uint32_t memoryTypeId, size_t blockPoolId, size_t blockId)) {
-						std::unique_lock<std::mutex> allocationLock(lock);
-						if (freeAllocations.size() > 0) {
-							Reference<VulkanMemoryAllocation> allocation = freeAllocations.front();
-							freeAllocations.pop();
-							return allocation;
-						}
-						for (size_t blockId = 0; blockId < BLOCK_POOL_MAX_ALLOCATIONS; blockId++) {
-							BlockAllocation& allocation = memoryBlocks[blockId];
-							if (allocation.memoryBlock == VK_NULL_HANDLE) {
-								VkMemoryAllocateInfo allocInfo = {};
-								{
-									allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-									allocInfo.allocationSize = BLOCK_ALLOCATION_SIZE(blockPoolId, blockId);
-									allocInfo.memoryTypeIndex = memoryTypeIndex;
-								}
-								if (vkAllocateMemory(*pool->GraphicsDevice(), &allocInfo, nullptr, &allocation.memoryBlock) != VK_SUCCESS)
-									pool->GraphicsDevice()->Log()->Fatal("VulkanMemoryPool - Failed to allocate memory!");
+				// Bump pointer (linear pages only)
+				VkDeviceSize linearOffset = 0;
 
-								allocation.allocations = createMemoryAllocations(pool, memoryTypeIndex, blockPoolId, blockId);
-								const size_t allocationCount = static_cast<size_t>(BLOCK_ALLOCATION_COUNT(blockId));
-								for (size_t i = 1; i < allocationCount; i++)
-									freeAllocations.push(allocation.allocations + i);
+				// Total size of the ranges, reserved by the live allocations (linear pages only)
+				VkDeviceSize reservedBytes = 0;
 
-								return allocation.allocations;
-							}
-						}
-						pool->GraphicsDevice()->Log()->Fatal("VulkanMemoryPool - Failed to find appropriate memory block");
-						return nullptr;
-					}
-				};
+				// Number of live allocations within the block
+				size_t allocationCount = 0;
 
-				struct MemoryTypePool {
-					VkMemoryPropertyFlags properties;
-					BlockPool blockPools[HEAP_POOL_MAX_BLOCK_POOLS];
+				// Number of live RELOCATABLE allocations within the block (shared blocks only)
+				size_t relocatableCount = 0;
 
-					MemoryTypePool() : properties(0) {}
+				// Defragment() tick, the block became empty on (shared blocks only)
+				uint64_t emptySinceTick = 0;
 
-					Reference<VulkanMemoryAllocation> Allocate(const VulkanMemoryPool* pool, const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex
-						, VulkanMemoryAllocation* (*createMemoryAllocations)(const VulkanMemoryPool* device, uint32_t memoryTypeId, size_t blockPoolId, size_t blockId)) {
+				// Defragment() tick, the last evacuation of the block started on (0, if never)
+				uint64_t evacuationTick = 0;
 
-						for (size_t blockPoolId = 0; blockPoolId < HEAP_POOL_MAX_BLOCK_POOLS; blockPoolId++) {
+				// True, while the block is being evacuated (no new allocations are made from it)
+				std::atomic<bool> evacuating = { false };
+			};
 
-							VkDeviceSize blockSize = BLOCK_POOL_ALLOCATION_SIZE(blockPoolId);
+			struct VulkanMemoryPool::MemoryTypePool {
+				// Lock for everything below
+				std::mutex lock;
 
-							if (blockSize < requirements.alignment || blockSize < requirements.size) continue;
-							else if ((blockSize % requirements.alignment) == 0 || (blockSize >= (requirements.alignment + requirements.size)))
-								return blockPools[blockPoolId].Allocate(pool, memoryTypeIndex, blockPoolId, createMemoryAllocations);
-						}
+				// Memory type index
+				uint32_t typeIndex = 0;
+
+				// Memory heap index
+				uint32_t heapIndex = 0;
+
+				// Memory type properties
+				VkMemoryPropertyFlags properties = 0;
+
+				// Size of a shared block
+				VkDeviceSize blockSize = 0;
+
+				// Minimal alignment of the allocations (nonCoherentAtomSize for host-visible non-coherent memory, so that flushes never touch the neighbours)
+				VkDeviceSize minAlignment = 1;
+
+				// If true, images with optimal tiling are sub-allocated from separate blocks (bufferImageGranularity > 1)
+				bool separateNonLinear = false;
 
-						pool->GraphicsDevice()->Log()->Fatal("VulkanMemoryPool - Failed to find approptiate block size");
-						return nullptr;
+				// Shared blocks for linear resources [0] and non-linear ones [1]
+				std::vector<MemoryBlock*> sharedBlocks[2];
+
+				// All linear pages (current, spare and the ones that still contain live allocations)
+				std::vector<MemoryBlock*> transientPages;
+
+				// Linear page, transient allocations are bumped from
+				MemoryBlock* transientPage = nullptr;
+
+				// Empty linear page, kept around to avoid reallocations
+				MemoryBlock* spareTransientPage = nullptr;
+
+				// Number of dedicated allocations
+				size_t dedicatedAllocationCount = 0;
+
+				// Number of live allocations
+				size_t allocationCount = 0;
+
+				// Total size of the live allocations
+				VkDeviceSize usedBytes = 0;
+
+				// Total size lost to rounding within the live allocations
+				VkDeviceSize wastedBytes = 0;
+			};
+
+			Reference<VulkanMemoryAllocation> VulkanMemoryPool::Allocate(
+				const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, AllocationStrategy strategy, bool nonLinearResource)const {
+				if (m_memoryTypePools == nullptr) {
+					GraphicsDevice()->Log()->Fatal("VulkanMemoryPool - Device has no memory");
+					return nullptr;
+				}
+				// First we try to stay within the heap budgets and only then fall back to whatever the driver lets us allocate:
+				for (size_t pass = 0; pass < 2; pass++) {
+					const bool respectBudget = (pass == 0);
+					for (uint32_t memoryTypeId = 0; memoryTypeId < m_memoryTypeCount; memoryTypeId++) {
+						MemoryTypePool& memoryTypePool = m_memoryTypePools[memoryTypeId];
+						if ((requirements.memoryTypeBits & (1 << memoryTypeId)) == 0 || (memoryTypePool.properties & properties) != properties) continue;
+						Reference<VulkanMemoryAllocation> allocation = AllocateFromType(memoryTypePool, requirements, strategy, nonLinearResource, respectBudget);
+						if (allocation != nullptr) {
+							if (!respectBudget)
+								GraphicsDevice()->Log()->Warning("VulkanMemoryPool - Memory heap " + std::to_string(memoryTypePool.heapIndex) + " is over budget!");
+							return allocation;
+						}
 					}
-				};
+				}
+				GraphicsDevice()->Log()->Fatal("VulkanMemoryPool - Failed to allocate memory!");
+				return nullptr;
 			}
 
-			Reference<VulkanMemoryAllocation> VulkanMemoryPool::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties)const {
-				MemoryTypePool* memoryTypePools = reinterpret_cast<MemoryTypePool*>(m_memoryTypePools);
-				if (memoryTypePools == nullptr)
-					GraphicsDevice()->Log()->Fatal("VulkanMemoryPool - Device has no memory");
-				else for (uint32_t memoryTypeId = 0; memoryTypeId < m_memoryTypeCount; memoryTypeId++) {
-					MemoryTypePool& memoryTypePool = memoryTypePools[memoryTypeId];
-					if ((requirements.memoryTypeBits & (1 << memoryTypeId)) != 0 && (memoryTypePool.properties & properties) == properties) {
-						Reference<VulkanMemoryAllocation> allocation = memoryTypePool.Allocate(this, requirements, memoryTypeId
-							, [](const VulkanMemoryPool* pool, uint32_t memoryTypeId, size_t blockPoolId, size_t blockId) {
-
-								MemoryTypePool& memoryTypePool = reinterpret_cast<MemoryTypePool*>(pool->m_memoryTypePools)[memoryTypeId];
-								BlockAllocation& blockAllocation = memoryTypePool.blockPools[blockPoolId].memoryBlocks[blockId];
-								VkDeviceMemory memory = blockAllocation.memoryBlock;
-
-								size_t allocationCount = BLOCK_ALLOCATION_COUNT(blockId);
-								VulkanMemoryAllocation* allocations = new VulkanMemoryAllocation[allocationCount];
-								for (size_t i = 0; i < allocationCount; i++) {
-									VulkanMemoryAllocation& allocation = allocations[i];
-									allocation.m_memoryTypeId = memoryTypeId;
-									allocation.m_blockPoolId = blockPoolId;
-									allocation.m_memoryBlockId = blockId;
-									allocation.m_blockAllocationId = i;
-
-									allocation.m_memoryPool = pool;
-									allocation.m_flags = memoryTypePool.properties;
-									allocation.m_memory = memory;
+			VulkanMemoryPool::DefragmentationReport VulkanMemoryPool::Defragment(VkDeviceSize relocationBudget)const {
+				const uint64_t tick = (++m_defragmentationTick);
+				DefragmentationReport report;
+				for (size_t memoryTypeId = 0; memoryTypeId < m_memoryTypeCount; memoryTypeId++) {
+					MemoryTypePool& memoryTypePool = m_memoryTypePools[memoryTypeId];
+					std::unique_lock<std::mutex> lock(memoryTypePool.lock);
+					for (size_t listId = 0; listId < 2; listId++) {
+						std::vector<MemoryBlock*>& blocks = memoryTypePool.sharedBlocks[listId];
+
+						// We keep the most recently emptied block around to avoid thrashing on alloc-free cycles:
+						MemoryBlock* keptBlock = nullptr;
+						for (size_t i = 0; i < blocks.size(); i++) {
+							MemoryBlock* block = blocks[i];
+							if (block->allocationCount > 0 || block->evacuating) continue;
+							else if (keptBlock == nullptr || keptBlock->emptySinceTick < block->emptySinceTick) keptBlock = block;
+						}
+
+						// Release empty blocks that stayed empty for long enough and the evacuated ones; abandon stale evacuations:
+						bool evacuationInProgress = false;
+						for (size_t i = 0; i < blocks.size(); i++) {
+							MemoryBlock* block = blocks[i];
+							if (block->allocationCount <= 0) {
+								if (block->evacuating || (block != keptBlock && (tick - block->emptySinceTick) >= EMPTY_BLOCK_RELEASE_DELAY)) {
+									m_reclaimedBytes += block->size;
+									FreeBlock(memoryTypePool, block);
+									i--;
 								}
-								if ((memoryTypePool.properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0)
-									if (vkMapMemory(*pool->GraphicsDevice(), memory, 0, BLOCK_ALLOCATION_SIZE(blockPoolId, blockId), 0, &blockAllocation.memoryMapping) != VK_SUCCESS)
-										pool->GraphicsDevice()->Log()->Fatal("VulkanMemoryPool - Failed to map memory");
-								return allocations;
-							});
-						m_device->AddRef();
-						VkDeviceSize allocationSize = BLOCK_POOL_ALLOCATION_SIZE(allocation->m_blockPoolId);
-						{
-							VkDeviceSize blockOffset = allocationSize * allocation->m_blockAllocationId;
-							VkDeviceSize remainder = (blockOffset % requirements.alignment);
-							VkDeviceSize sizeLoss;
-							if (remainder > 0) {
-								sizeLoss = (requirements.alignment - remainder);
-								blockOffset += sizeLoss;
 							}
-							else sizeLoss = 0;
-							allocation->m_offset = blockOffset;
-							allocation->m_size = (allocationSize - sizeLoss);
+							else if (block->evacuating) {
+								if ((tick - block->evacuationTick) >= EVACUATION_TIMEOUT) {
+									block->evacuating = false;
+									block->evacuationTick = tick;
+								}
+								else {
+									evacuationInProgress = true;
+									report.evacuatingBlockCount++;
+								}
+							}
+						}
+						if (evacuationInProgress) continue;
+
+						// Pick the sparsest block, whose content can be moved to the others:
+						VkDeviceSize freeBytes = 0;
+						for (size_t i = 0; i < blocks.size(); i++)
+							freeBytes += blocks[i]->subAllocator->FreeBytes();
+						MemoryBlock* candidate = nullptr;
+						for (size_t i = 0; i < blocks.size(); i++) {
+							MemoryBlock* block = blocks[i];
+							const VkDeviceSize allocatedBytes = block->subAllocator->AllocatedBytes();
+							if (block->allocationCount <= 0 || block->allocationCount != block->relocatableCount
+								|| (block->evacuationTick > 0 && (tick - block->evacuationTick) < EVACUATION_TIMEOUT)
+								|| (allocatedBytes * 100) >= (block->size * DEFRAGMENTATION_OCCUPANCY_PERCENT)
+								|| (freeBytes - block->subAllocator->FreeBytes()) < allocatedBytes) continue;
+							else if (candidate == nullptr || candidate->subAllocator->AllocatedBytes() > allocatedBytes) candidate = block;
+						}
+						if (candidate != nullptr) {
+							candidate->evacuating = true;
+							candidate->evacuationTick = tick;
+							report.evacuatingBlockCount++;
 						}
-						return allocation;
 					}
 				}
-				GraphicsDevice()->Log()->Fatal("VulkanMemoryPool - Failed to find suitable memory type!");
-				return nullptr;
+				m_relocationBudget = relocationBudget;
+				report.movedBytes = m_movedBytes.exchange(0);
+				report.reclaimedBytes = m_reclaimedBytes.exchange(0);
+				return report;
 			}
 
 			VulkanDevice* VulkanMemoryPool::GraphicsDevice()const { return m_device; }
 
+			size_t VulkanMemoryPool::HeapCount()const { return m_heapCount; }
+
+			VulkanMemoryPool::HeapStatistics VulkanMemoryPool::Statistics(size_t heapIndex)const {
+				HeapStatistics statistics;
+				if (heapIndex >= m_heapCount) return statistics;
+				statistics.heapSize = m_device->PhysicalDeviceInfo()->MemoryProperties().memoryHeaps[heapIndex].size;
+				VkDeviceSize usage;
+				QueryBudget(static_cast<uint32_t>(heapIndex), statistics.budget, usage);
+				statistics.allocatedBytes = m_heaps[heapIndex].allocatedBytes;
+				VkDeviceSize sharedFreeBytes = 0;
+				for (size_t memoryTypeId = 0; memoryTypeId < m_memoryTypeCount; memoryTypeId++) {
+					MemoryTypePool& memoryTypePool = m_memoryTypePools[memoryTypeId];
+					if (memoryTypePool.heapIndex != heapIndex) continue;
+					std::unique_lock<std::mutex> lock(memoryTypePool.lock);
+					statistics.usedBytes += memoryTypePool.usedBytes;
+					statistics.wastedBytes += memoryTypePool.wastedBytes;
+					statistics.dedicatedAllocationCount += memoryTypePool.dedicatedAllocationCount;
+					statistics.allocationCount += memoryTypePool.allocationCount;
+					for (size_t listId = 0; listId < 2; listId++) {
+						const std::vector<MemoryBlock*>& blocks = memoryTypePool.sharedBlocks[listId];
+						for (size_t i = 0; i < blocks.size(); i++) {
+							const VulkanMemoryTLSF* subAllocator = blocks[i]->subAllocator.get();
+							sharedFreeBytes += subAllocator->FreeBytes();
+							statistics.largestFreeRange = std::max(statistics.largestFreeRange, subAllocator->LargestFreeRange());
+						}
+						statistics.blockCount += blocks.size();
+					}
+					for (size_t i = 0; i < memoryTypePool.transientPages.size(); i++) {
+						const MemoryBlock* page = memoryTypePool.transientPages[i];
+						statistics.freeBytes += (page->size - page->reservedBytes);
+					}
+					statistics.blockCount += memoryTypePool.transientPages.size();
+				}
+				statistics.freeBytes += sharedFreeBytes;
+				if (sharedFreeBytes > 0)
+					statistics.fragmentation = 1.0f - static_cast<float>(static_cast<double>(statistics.largestFreeRange) / static_cast<double>(sharedFreeBytes));
+				return statistics;
+			}
+
 			VulkanMemoryPool::VulkanMemoryPool(VulkanDevice* device)
-				: m_device(device), m_memoryTypeCount(device->PhysicalDeviceInfo()->MemoryProperties().memoryTypeCount), m_memoryTypePools(nullptr) {
+				: m_device(device)
+				, m_memoryTypeCount(device->PhysicalDeviceInfo()->MemoryProperties().memoryTypeCount), m_memoryTypePools(nullptr)
+				, m_heapCount(device->PhysicalDeviceInfo()->MemoryProperties().memoryHeapCount), m_heaps(nullptr)
+				, m_budgetExtensionSupported(device->PhysicalDeviceInfo()->DeviceExtensionVerison(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME).has_value())
+				, m_defragmentationTick(0), m_relocationBudget(DEFAULT_RELOCATION_BUDGET), m_movedBytes(0), m_reclaimedBytes(0) {
+				const VkPhysicalDeviceMemoryProperties& memoryProperties = m_device->PhysicalDeviceInfo()->MemoryProperties();
+				const VkPhysicalDeviceLimits& limits = m_device->PhysicalDeviceInfo()->DeviceProperties().limits;
+				if (m_heapCount > 0)
+					m_heaps = new HeapState[m_heapCount];
 				if (m_memoryTypeCount > 0) {
-					MemoryTypePool* memoryTypePools = new MemoryTypePool[m_memoryTypeCount];
-					const VkPhysicalDeviceMemoryProperties& memoryProperties = m_device->PhysicalDeviceInfo()->MemoryProperties();
-					for (size_t memoryTypeId = 0; memoryTypeId < m_memoryTypeCount; memoryTypeId++)
-						memoryTypePools[memoryTypeId].properties = memoryProperties.memoryTypes[memoryTypeId].propertyFlags;
-					m_memoryTypePools = reinterpret_cast<void*>(memoryTypePools);
+					m_memoryTypePools = new MemoryTypePool[m_memoryTypeCount];
+					for (size_t memoryTypeId = 0; memoryTypeId < m_memoryTypeCount; memoryTypeId++) {
+						MemoryTypePool& memoryTypePool = m_memoryTypePools[memoryTypeId];
+						const VkMemoryType& memoryType = memoryProperties.memoryTypes[memoryTypeId];
+						memoryTypePool.typeIndex = static_cast<uint32_t>(memoryTypeId);
+						memoryTypePool.heapIndex = memoryType.heapIndex;
+						memoryTypePool.properties = memoryType.propertyFlags;
+						const VkDeviceSize heapBlockSize = (memoryProperties.memoryHeaps[memoryType.heapIndex].size / 8);
+						memoryTypePool.blockSize = (heapBlockSize < DEFAULT_BLOCK_SIZE) ? heapBlockSize : DEFAULT_BLOCK_SIZE;
+						if ((memoryType.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0 && (memoryType.propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0)
+							memoryTypePool.minAlignment = std::max(limits.nonCoherentAtomSize, static_cast<VkDeviceSize>(1));
+						memoryTypePool.separateNonLinear = (limits.bufferImageGranularity > 1);
+					}
 				}
 			}
 
 			VulkanMemoryPool::~VulkanMemoryPool() {
-				MemoryTypePool* memoryTypePools = reinterpret_cast<MemoryTypePool*>(m_memoryTypePools);
-				if (memoryTypePools != nullptr) {
+				if (m_memoryTypePools != nullptr) {
 					for (size_t memoryTypeId = 0; memoryTypeId < m_memoryTypeCount; memoryTypeId++) {
-						MemoryTypePool& memoryTypePool = memoryTypePools[memoryTypeId];
-						for (size_t blockPoolId = 0; blockPoolId < HEAP_POOL_MAX_BLOCK_POOLS; blockPoolId++) {
-							BlockPool& blockPool = memoryTypePool.blockPools[blockPoolId];
-							for (size_t allocationId = 0; allocationId < BLOCK_POOL_MAX_ALLOCATIONS; allocationId++) {
-								BlockAllocation& blockAllocation = blockPool.memoryBlocks[allocationId];
-								if (blockAllocation.memoryMapping != nullptr) {
-									vkUnmapMemory(*m_device, blockAllocation.memoryBlock);
-									blockAllocation.memoryMapping = nullptr;
-								}
-								if (blockAllocation.memoryBlock != VK_NULL_HANDLE) {
-									vkFreeMemory(*m_device, blockAllocation.memoryBlock, nullptr);
-									blockAllocation.memoryBlock = VK_NULL_HANDLE;
-								}
-								if (blockAllocation.allocations != nullptr) {
-									delete[] blockAllocation.allocations;
-									blockAllocation.allocations = nullptr;
-								}
-							}
+						MemoryTypePool& memoryTypePool = m_memoryTypePools[memoryTypeId];
+						for (size_t listId = 0; listId < 2; listId++) {
+							std::vector<MemoryBlock*>& blocks = memoryTypePool.sharedBlocks[listId];
+							while (blocks.size() > 0) FreeBlock(memoryTypePool, blocks.back());
 						}
+						while (memoryTypePool.transientPages.size() > 0)
+							FreeBlock(memoryTypePool, memoryTypePool.transientPages.back());
 					}
-					delete[] memoryTypePools;
+					delete[] m_memoryTypePools;
 					m_memoryTypePools = nullptr;
 				}
+				if (m_heaps != nullptr) {
+					delete[] m_heaps;
+					m_heaps = nullptr;
+				}
 			}
 
-			VulkanMemoryAllocation::VulkanMemoryAllocation()
-				: m_memoryPool(nullptr)
-				, m_memoryTypeId(0), m_blockPoolId(0), m_memoryBlockId(0), m_blockAllocationId(0)
-				, m_flags(0), m_memory(0), m_size(0), m_offset(0) {
-				ReleaseRef();
+			void VulkanMemoryPool::QueryBudget(uint32_t heapIndex, VkDeviceSize& budget, VkDeviceSize& usage)const {
+				if (m_budgetExtensionSupported) {
+					VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+					budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+					VkPhysicalDeviceMemoryProperties2 properties = {};
+					properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+					properties.pNext = &budgetProperties;
+					vkGetPhysicalDeviceMemoryProperties2(*m_device->PhysicalDeviceInfo(), &properties);
+					budget = budgetProperties.heapBudget[heapIndex];
+					usage = budgetProperties.heapUsage[heapIndex];
+				}
+				else {
+					budget = (m_device->PhysicalDeviceInfo()->MemoryProperties().memoryHeaps[heapIndex].size / 100) * BUDGET_FALLBACK_PERCENT;
+					usage = m_heaps[heapIndex].allocatedBytes;
+				}
+			}
+
+			bool VulkanMemoryPool::ClaimRelocationBudget(VkDeviceSize size)const {
+				// Budget may be overshot by a single allocation, so that the ones larger than the budget get to move too:
+				VkDeviceSize budget = m_relocationBudget;
+				while (budget > 0)
+					if (m_relocationBudget.compare_exchange_weak(budget, (budget > size) ? (budget - size) : 0)) {
+						m_movedBytes += size;
+						return true;
+					}
+				return false;
+			}
+
+			VulkanMemoryPool::MemoryBlock* VulkanMemoryPool::AllocateBlock(MemoryTypePool& typePool, VkDeviceSize size, AllocationStrategy strategy, bool respectBudget)const {
+				if (respectBudget) {
+					VkDeviceSize budget, usage;
+					QueryBudget(typePool.heapIndex, budget, usage);
+					if (budget < usage || (budget - usage) < size) return nullptr;
+				}
+
+				VkMemoryAllocateInfo allocInfo = {};
+				{
+					allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+					allocInfo.allocationSize = size;
+					allocInfo.memoryTypeIndex = typePool.typeIndex;
+				}
+				VkDeviceMemory memory;
+				if (vkAllocateMemory(*m_device, &allocInfo, nullptr, &memory) != VK_SUCCESS) return nullptr;
+
+				MemoryBlock* block = new MemoryBlock();
+				block->memory = memory;
+				block->size = size;
+				block->strategy = strategy;
+				if ((typePool.properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0)
+					if (vkMapMemory(*m_device, memory, 0, size, 0, &block->mapping) != VK_SUCCESS) {
+						block->mapping = nullptr;
+						m_device->Log()->Fatal("VulkanMemoryPool - Failed to map memory");
+					}
+				if (strategy == AllocationStrategy::DEFAULT)
+					block->subAllocator = std::make_unique<VulkanMemoryTLSF>(size);
+				else if (strategy == AllocationStrategy::TRANSIENT)
+					typePool.transientPages.push_back(block);
+				m_heaps[typePool.heapIndex].allocatedBytes += size;
+				return block;
 			}
 
+			void VulkanMemoryPool::FreeBlock(MemoryTypePool& typePool, MemoryBlock* block)const {
+				if (block->strategy == AllocationStrategy::DEFAULT) {
+					for (size_t listId = 0; listId < 2; listId++) {
+						std::vector<MemoryBlock*>& blocks = typePool.sharedBlocks[listId];
+						std::vector<MemoryBlock*>::iterator it = std::find(blocks.begin(), blocks.end(), block);
+						if (it != blocks.end()) blocks.erase(it);
+					}
+				}
+				else if (block->strategy == AllocationStrategy::TRANSIENT) {
+					std::vector<MemoryBlock*>::iterator it = std::find(typePool.transientPages.begin(), typePool.transientPages.end(), block);
+					if (it != typePool.transientPages.end()) typePool.transientPages.erase(it);
+					if (typePool.transientPage == block) typePool.transientPage = nullptr;
+					if (typePool.spareTransientPage == block) typePool.spareTransientPage = nullptr;
+				}
+				if (block->mapping != nullptr) {
+					vkUnmapMemory(*m_device, block->memory);
+					block->mapping = nullptr;
+				}
+				vkFreeMemory(*m_device, block->memory, nullptr);
+				m_heaps[typePool.heapIndex].allocatedBytes -= block->size;
+				delete block;
+			}
+
+			Reference<VulkanMemoryAllocation> VulkanMemoryPool::AllocateFromType(
+				MemoryTypePool& typePool, const VkMemoryRequirements& requirements, AllocationStrategy strategy, bool nonLinearResource, bool respectBudget)const {
+				std::unique_lock<std::mutex> lock(typePool.lock);
+				const bool relocatable = (strategy == AllocationStrategy::RELOCATABLE);
+				if (relocatable) strategy = AllocationStrategy::DEFAULT;
+				const VkDeviceSize alignment = std::max(std::max(requirements.alignment, typePool.minAlignment), static_cast<VkDeviceSize>(1));
+				const VkDeviceSize size = std::max(requirements.size, static_cast<VkDeviceSize>(1));
+
+				// Large requests are not worth sub-allocating and the non-linear transient ones are not worth keeping apart:
+				if (strategy == AllocationStrategy::DEFAULT && size > (typePool.blockSize / 2))
+					strategy = AllocationStrategy::DEDICATED;
+				else if (strategy == AllocationStrategy::TRANSIENT) {
+					if (size > (TRANSIENT_PAGE_SIZE / 2)) strategy = AllocationStrategy::DEDICATED;
+					else if (nonLinearResource && typePool.separateNonLinear) strategy = AllocationStrategy::DEFAULT;
+				}
+
+				MemoryBlock* block = nullptr;
+				VkDeviceSize offset = 0;
+				VkDeviceSize reservedSize = size;
+				uint32_t blockAllocationId = VulkanMemoryTLSF::NO_ALLOCATION;
+
+				if (strategy == AllocationStrategy::DEDICATED) {
+					block = AllocateBlock(typePool, size, AllocationStrategy::DEDICATED, respectBudget);
+					if (block == nullptr) return nullptr;
+					typePool.dedicatedAllocationCount++;
+				}
+				else if (strategy == AllocationStrategy::TRANSIENT) {
+					block = typePool.transientPage;
+					if (block != nullptr && block->allocationCount <= 0) block->linearOffset = 0;
+					if (block == nullptr || (AlignUp(block->linearOffset, alignment) + size) > block->size) {
+						// Current page is retired; it gets recycled once the last allocation within it goes out of scope:
+						if (typePool.spareTransientPage != nullptr) {
+							block = typePool.spareTransientPage;
+							typePool.spareTransientPage = nullptr;
+						}
+						else block = AllocateBlock(typePool, TRANSIENT_PAGE_SIZE, AllocationStrategy::TRANSIENT, respectBudget);
+						if (block == nullptr) return nullptr;
+						block->linearOffset = 0;
+						typePool.transientPage = block;
+					}
+					offset = AlignUp(block->linearOffset, alignment);
+					reservedSize = (offset + size) - block->linearOffset;
+					block->linearOffset = offset + size;
+					block->reservedBytes += reservedSize;
+				}
+				else {
+					std::vector<MemoryBlock*>& blocks = typePool.sharedBlocks[(nonLinearResource && typePool.separateNonLinear) ? 1 : 0];
+					VulkanMemoryTLSF::Allocation range;
+					for (size_t i = 0; i < blocks.size(); i++) {
+						if (blocks[i]->evacuating) continue;
+						range = blocks[i]->subAllocator->Allocate(size, alignment);
+						if (range.handle != VulkanMemoryTLSF::NO_ALLOCATION) {
+							block = blocks[i];
+							break;
+						}
+					}
+					if (block == nullptr) {
+						block = AllocateBlock(typePool, typePool.blockSize, AllocationStrategy::DEFAULT, respectBudget);
+						if (block == nullptr) return nullptr;
+						blocks.push_back(block);
+						range = block->subAllocator->Allocate(size, alignment);
+						if (range.handle == VulkanMemoryTLSF::NO_ALLOCATION) {
+							m_device->Log()->Error("VulkanMemoryPool - Failed to sub-allocate from a fresh memory block!");
+							return nullptr;
+						}
+					}
+					offset = range.offset;
+					reservedSize = range.size;
+					blockAllocationId = range.handle;
+					if (relocatable) block->relocatableCount++;
+				}
+
+				block->allocationCount++;
+				typePool.allocationCount++;
+				typePool.usedBytes += requirements.size;
+				typePool.wastedBytes += (reservedSize - requirements.size);
+
+				VulkanMemoryAllocation* allocation = new VulkanMemoryAllocation();
+				allocation->m_memoryPool = this;
+				allocation->m_memoryTypeId = typePool.typeIndex;
+				allocation->m_block = block;
+				allocation->m_blockAllocationId = blockAllocationId;
+				allocation->m_flags = typePool.properties;
+				allocation->m_memory = block->memory;
+				allocation->m_offset = offset;
+				allocation->m_size = requirements.size;
+				allocation->m_reservedSize = reservedSize;
+				allocation->m_relocatable = (relocatable && strategy == AllocationStrategy::DEFAULT);
+				m_device->AddRef();
+
+				Reference<VulkanMemoryAllocation> reference(allocation);
+				allocation->ReleaseRef();
+				return reference;
+			}
+
+			VulkanMemoryAllocation::VulkanMemoryAllocation()
+				: m_memoryPool(nullptr), m_memoryTypeId(0), m_block(nullptr), m_blockAllocationId(VulkanMemoryTLSF::NO_ALLOCATION)
+				, m_flags(0), m_memory(VK_NULL_HANDLE), m_offset(0), m_size(0), m_reservedSize(0), m_relocatable(false) {}
+
 			VkDeviceSize VulkanMemoryAllocation::Size()const { return m_size; }
 
 			VkMemoryPropertyFlags VulkanMemoryAllocation::Flags()const { return m_flags; }
@@ -204,18 +472,31 @@ namespace Jimara {
 
 			VkDeviceSize VulkanMemoryAllocation::Offset()const { return m_offset; }
 
+			bool VulkanMemoryAllocation::RelocationRequested()const { return m_relocatable && m_block->evacuating; }
+
+			bool VulkanMemoryAllocation::ShouldRelocate()const { return RelocationRequested() && m_memoryPool->ClaimRelocationBudget(m_reservedSize); }
+
+			namespace {
+				inline static VkMappedMemoryRange MappedRange(VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize size, VkDeviceSize blockSize, VkDeviceSize atomSize) {
+					// Non-coherent allocations are aligned to nonCoherentAtomSize, so all we need is to round up the size without crossing the block end:
+					VkMappedMemoryRange range = {};
+					range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+					range.memory = memory;
+					range.offset = offset;
+					range.size = AlignUp(size, atomSize);
+					if ((range.offset + range.size) >= blockSize) range.size = VK_WHOLE_SIZE;
+					return range;
+				}
+			}
+
 			void* VulkanMemoryAllocation::Map(bool read)const {
-				void* data = reinterpret_cast<MemoryTypePool*>(m_memoryPool->m_memoryTypePools)[m_memoryTypeId].blockPools[m_blockPoolId].memoryBlocks[m_memoryBlockId].memoryMapping;
+				void* data = m_block->mapping;
 				if (data == nullptr) {
 					m_memoryPool->GraphicsDevice()->Log()->Fatal("VulkanMemoryAllocation - Attempting to map memory invisible to host!");
 					return nullptr;
 				}
 				else if (read && ((m_flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0)) {
-					VkMappedMemoryRange range = {};
-					range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-					range.memory = Memory();
-					range.offset = Offset();
-					range.size = Size();
+					const VkMappedMemoryRange range = MappedRange(Memory(), Offset(), Size(), m_block->size, m_memoryPool->m_memoryTypePools[m_memoryTypeId].minAlignment);
 					if (vkInvalidateMappedMemoryRanges(*m_memoryPool->GraphicsDevice(), 1, &range) != VK_SUCCESS)
 						m_memoryPool->GraphicsDevice()->Log()->Fatal("VulkanMemoryAllocation - Failed to invalidate memory ranges");
 				}
@@ -223,29 +504,57 @@ namespace Jimara {
 			}
 
 			void VulkanMemoryAllocation::Unmap(bool write)const {
-				void* data = reinterpret_cast<MemoryTypePool*>(m_memoryPool->m_memoryTypePools)[m_memoryTypeId].blockPools[m_blockPoolId].memoryBlocks[m_memoryBlockId].memoryMapping;
+				void* data = m_block->mapping;
 				if (data == nullptr) {
 					m_memoryPool->GraphicsDevice()->Log()->Fatal("VulkanMemoryAllocation - Attempting to unmap memory invisible to host!");
 					return;
 				}
 				else if (write && ((m_flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0)) {
-					VkMappedMemoryRange range = {};
-					range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-					range.memory = Memory();
-					range.offset = Offset();
-					range.size = Size();
+					const VkMappedMemoryRange range = MappedRange(Memory(), Offset(), Size(), m_block->size, m_memoryPool->m_memoryTypePools[m_memoryTypeId].minAlignment);
 					if (vkFlushMappedMemoryRanges(*m_memoryPool->GraphicsDevice(), 1, &range) != VK_SUCCESS)
 						m_memoryPool->GraphicsDevice()->Log()->Fatal("VulkanMemoryAllocation - Failed to flush memory ranges");
 				}
 			}
 
 			void VulkanMemoryAllocation::OnOutOfScope()const {
-				if (m_memoryPool == nullptr) return;
-				BlockPool& blockPool = reinterpret_cast<MemoryTypePool*>(m_memoryPool->m_memoryTypePools)[m_memoryTypeId].blockPools[m_blockPoolId];
-				std::unique_lock<std::mutex> lock(blockPool.lock);
-				blockPool.freeAllocations.push((VulkanMemoryAllocation*)((void*)this));
-				m_memoryPool->GraphicsDevice()->ReleaseRef();
+				if (m_memoryPool == nullptr) {
+					Object::OnOutOfScope();
+					return;
+				}
+				VulkanMemoryPool::MemoryTypePool& memoryTypePool = m_memoryPool->m_memoryTypePools[m_memoryTypeId];
+				{
+					std::unique_lock<std::mutex> lock(memoryTypePool.lock);
+					VulkanMemoryPool::MemoryBlock* block = m_block;
+					block->allocationCount--;
+					memoryTypePool.allocationCount--;
+					memoryTypePool.usedBytes -= m_size;
+					memoryTypePool.wastedBytes -= (m_reservedSize - m_size);
+					if (block->strategy == VulkanMemoryPool::AllocationStrategy::DEDICATED) {
+						memoryTypePool.dedicatedAllocationCount--;
+						m_memoryPool->FreeBlock(memoryTypePool, block);
+					}
+					else if (block->strategy == VulkanMemoryPool::AllocationStrategy::TRANSIENT) {
+						block->reservedBytes -= m_reservedSize;
+						if (block->allocationCount <= 0 && block != memoryTypePool.transientPage) {
+							// Retired page is empty; we keep one around and let go of the rest:
+							if (memoryTypePool.spareTransientPage == nullptr) {
+								block->linearOffset = 0;
+								memoryTypePool.spareTransientPage = block;
+							}
+							else m_memoryPool->FreeBlock(memoryTypePool, block);
+						}
+					}
+					else {
+						block->subAllocator->Free(m_blockAllocationId);
+						if (m_relocatable) block->relocatableCount--;
+						if (block->allocationCount <= 0) block->emptySinceTick = m_memoryPool->m_defragmentationTick;
+					}
+				}
+				VulkanDevice* device = m_memoryPool->GraphicsDevice();
+				delete this;
+				device->ReleaseRef();
 			}
 		}
 	}
 }
+#pragma warning(default: 26812)
@@ -8,27 +8,146 @@ namespace Jimara {
 	}
 }
 #include "../VulkanDevice.h"
+#include "VulkanMemoryTLSF.h"
+#include <atomic>
+#include <mutex>
 
 
 namespace Jimara {
 	namespace Graphics {
 		namespace Vulkan {
 			/// <summary>
-			/// Vulkan memory pool, responsible for memory allocations
+			/// Vulkan memory pool, responsible for memory allocations.
+			/// Notes:
+			///		0. Regular allocations are sub-allocated from large per-memory-type blocks with a TLSF allocator (see VulkanMemoryTLSF);
+			///		1. Allocations that would take up a significant portion of a block get their own VkDeviceMemory;
+			///		2. Transient allocations (staging data and alike) are bump-allocated from linear pages that get recycled once everything within them is released;
+			///		3. When choosing between compatible memory types, the pool prefers heaps that still fit within their budget
+			///			(VK_EXT_memory_budget, if available, BUDGET_FALLBACK_PERCENT of the heap size otherwise);
+			///		4. Empty shared blocks are released with a delay (see Defragment()), sparse ones get evacuated by moving the RELOCATABLE allocations elsewhere.
 			/// </summary>
 			class VulkanMemoryPool {
 			public:
+				/// <summary> Allocation strategy </summary>
+				enum class AllocationStrategy : uint8_t {
+					/// <summary> Sub-allocate from a shared block (large requests still get a dedicated allocation) </summary>
+					DEFAULT = 0,
+
+					/// <summary> Always create a separate VkDeviceMemory for the allocation </summary>
+					DEDICATED = 1,
+
+					/// <summary> Short-lived allocation (bump-allocated from a linear page; best for staging buffers and alike) </summary>
+					TRANSIENT = 2,
+
+					/// <summary> Same as DEFAULT, but the owner is able to move the data elsewhere once VulkanMemoryAllocation::ShouldRelocate() asks it to </summary>
+					RELOCATABLE = 3
+				};
+
+				/// <summary> Size of the blocks, regular allocations are sub-allocated from (smaller heaps get smaller blocks) </summary>
+				static const VkDeviceSize DEFAULT_BLOCK_SIZE = (static_cast<VkDeviceSize>(64) << 20);
+
+				/// <summary> Size of the linear pages for transient allocations </summary>
+				static const VkDeviceSize TRANSIENT_PAGE_SIZE = (static_cast<VkDeviceSize>(8) << 20);
+
+				/// <summary> Heap budget, assumed when VK_EXT_memory_budget is not available (percentage of the heap size) </summary>
+				static const VkDeviceSize BUDGET_FALLBACK_PERCENT = 80;
+
+				/// <summary> Number of Defragment() calls, an empty shared block survives for (one empty block per memory type is kept regardless) </summary>
+				static const uint64_t EMPTY_BLOCK_RELEASE_DELAY = 120;
+
+				/// <summary> Shared blocks, occupied less than this percentage, are evacuated by Defragment() </summary>
+				static const VkDeviceSize DEFRAGMENTATION_OCCUPANCY_PERCENT = 25;
+
+				/// <summary> Number of Defragment() calls, after which an unfinished block evacuation is abandoned (and the block is left alone for as long) </summary>
+				static const uint64_t EVACUATION_TIMEOUT = 600;
+
+				/// <summary> Default number of bytes, the owners of the RELOCATABLE allocations may move per Defragment() call </summary>
+				static const VkDeviceSize DEFAULT_RELOCATION_BUDGET = (static_cast<VkDeviceSize>(4) << 20);
+
+				/// <summary> Result of a Defragment() call </summary>
+				struct DefragmentationReport {
+					/// <summary> Number of bytes, relocated since the previous Defragment() call </summary>
+					VkDeviceSize movedBytes = 0;
+
+					/// <summary> Size of the empty and evacuated blocks, released back to the driver since the previous Defragment() call </summary>
+					VkDeviceSize reclaimedBytes = 0;
+
+					/// <summary> Number of blocks, currently being evacuated </summary>
+					size_t evacuatingBlockCount = 0;
+				};
+
+				/// <summary> Memory heap usage statistics </summary>
+				struct HeapStatistics {
+					/// <summary> Heap size </summary>
+					VkDeviceSize heapSize = 0;
+
+					/// <summary> Heap budget for the process </summary>
+					VkDeviceSize budget = 0;
+
+					/// <summary> Total size of VkDeviceMemory objects, allocated by the pool from the heap </summary>
+					VkDeviceSize allocatedBytes = 0;
+
+					/// <summary> Total size of the live allocations (as requested by the resources) </summary>
+					VkDeviceSize usedBytes = 0;
+
+					/// <summary> Memory lost to size rounding within the live allocations </summary>
+					VkDeviceSize wastedBytes = 0;
+
+					/// <summary> Unoccupied memory within the shared blocks and linear pages </summary>
+					VkDeviceSize freeBytes = 0;
+
+					/// <summary> Largest contiguous free range within the shared blocks </summary>
+					VkDeviceSize largestFreeRange = 0;
+
+					/// <summary> External fragmentation of the shared blocks (0 - all free memory is contiguous; 1 - free memory is scattered in tiny chunks) </summary>
+					float fragmentation = 0.0f;
+
+					/// <summary> Number of shared blocks and linear pages </summary>
+					size_t blockCount = 0;
+
+					/// <summary> Number of dedicated allocations </summary>
+					size_t dedicatedAllocationCount = 0;
+
+					/// <summary> Number of live allocations (including dedicated ones) </summary>
+					size_t allocationCount = 0;
+				};
+
 				/// <summary>
 				/// Allocates vulkan memory
 				/// </summary>
 				/// <param name="requirements"> Memory requirements </param>
 				/// <param name="properties"> Required memory property flags </param>
+				/// <param name="strategy"> Allocation strategy </param>
+				/// <param name="nonLinearResource"> Should be true for images with optimal tiling (those are kept apart from buffers to respect bufferImageGranularity) </param>
 				/// <returns> New vulkan memory allocation </returns>
-				Reference<VulkanMemoryAllocation> Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties)const;
+				Reference<VulkanMemoryAllocation> Allocate(
+					const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+					AllocationStrategy strategy = AllocationStrategy::DEFAULT, bool nonLinearResource = false)const;
 
 				/// <summary> "Owner" graphics device </summary>
 				VulkanDevice* GraphicsDevice()const;
 
+				/// <summary> Number of memory heaps </summary>
+				size_t HeapCount()const;
+
+				/// <summary>
+				/// Memory heap usage statistics
+				/// </summary>
+				/// <param name="heapIndex"> Heap index (0 - HeapCount()) </param>
+				/// <returns> Usage statistics </returns>
+				HeapStatistics Statistics(size_t heapIndex)const;
+
+				/// <summary>
+				/// Incremental maintenance step, meant to be invoked once per frame (VulkanSurfaceRenderEngine does that after each present):
+				///		0. Releases empty shared blocks that stayed empty for EMPTY_BLOCK_RELEASE_DELAY calls, as well as fully evacuated ones;
+				///		1. Picks the sparsest shared block per memory type that contains only RELOCATABLE allocations and can be fit in the other blocks,
+				///			and flags it for evacuation (the owners move the data out with GPU copies the next time they are accessed);
+				///		2. Resets the relocation budget, limiting the number of bytes the owners may move before the next call.
+				/// </summary>
+				/// <param name="relocationBudget"> Relocation budget till the next call </param>
+				/// <returns> Moved and reclaimed memory since the last call </returns>
+				DefragmentationReport Defragment(VkDeviceSize relocationBudget = DEFAULT_RELOCATION_BUDGET)const;
+
 
 
 			private:
@@ -45,6 +164,17 @@ namespace Jimara {
 				friend class VulkanDevice;
 				friend class VulkanMemoryAllocation;
 
+				// Single VkDeviceMemory (shared block, linear page or a dedicated allocation; defined in the source file)
+				struct MemoryBlock;
+
+				// Per memory type allocation data (defined in the source file)
+				struct MemoryTypePool;
+
+				// Per heap counters
+				struct HeapState {
+					std::atomic<VkDeviceSize> allocatedBytes = { 0 };
+				};
+
 				// "Owner" graphics device
 				VulkanDevice* m_device;
 
@@ -52,7 +182,44 @@ namespace Jimara {
 				size_t m_memoryTypeCount;
 
 				// Underlying allocation data
-				void* m_memoryTypePools;
+				MemoryTypePool* m_memoryTypePools;
+
+				// Number of memory heaps
+				size_t m_heapCount;
+
+				// Per heap counters
+				HeapState* m_heaps;
+
+				// True, if VK_EXT_memory_budget is supported
+				bool m_budgetExtensionSupported;
+
+				// Number of Defragment() calls so far
+				mutable std::atomic<uint64_t> m_defragmentationTick;
+
+				// Bytes, the owners of the RELOCATABLE allocations are still allowed to move till the next Defragment() call
+				mutable std::atomic<VkDeviceSize> m_relocationBudget;
+
+				// Bytes, moved since the last Defragment() call
+				mutable std::atomic<VkDeviceSize> m_movedBytes;
+
+				// Bytes, reclaimed since the last Defragment() call
+				mutable std::atomic<VkDeviceSize> m_reclaimedBytes;
+
+				// Deducts from the relocation budget (fails if the budget is exhausted)
+				bool ClaimRelocationBudget(VkDeviceSize size)const;
+
+				// Retrieves heap budget and current usage
+				void QueryBudget(uint32_t heapIndex, VkDeviceSize& budget, VkDeviceSize& usage)const;
+
+				// Allocates a VkDeviceMemory (nullptr on failure or if the allocation would not fit in the heap budget and respectBudget is set)
+				MemoryBlock* AllocateBlock(MemoryTypePool& typePool, VkDeviceSize size, AllocationStrategy strategy, bool respectBudget)const;
+
+				// Releases a VkDeviceMemory
+				void FreeBlock(MemoryTypePool& typePool, MemoryBlock* block)const;
+
+				// Attempts to allocate from a given memory type (nullptr on failure)
+				Reference<VulkanMemoryAllocation> AllocateFromType(
+					MemoryTypePool& typePool, const VkMemoryRequirements& requirements, AllocationStrategy strategy, bool nonLinearResource, bool respectBudget)const;
 
 				// We don't need someone playing around, copying class that's not supposed to be copied
 				VulkanMemoryPool(const VulkanMemoryPool&) = delete;
@@ -78,6 +245,17 @@ namespace Jimara {
 				/// <summary> Memory property flags (may and likely will contain some characteristics beyond ones requested during allocation) </summary>
 				VkMemoryPropertyFlags Flags()const;
 
+				/// <summary> True, if the allocation is RELOCATABLE and resides in a block that is being evacuated (cheap check) </summary>
+				bool RelocationRequested()const;
+
+				/// <summary>
+				/// Checks if the owner should move the data elsewhere right away
+				/// Note: Returning true deducts the allocation size from the relocation budget, so the caller is expected to follow through
+				/// (allocate a new RELOCATABLE allocation, copy the data over and release this one once the copy is done).
+				/// </summary>
+				/// <returns> True, if the owner should relocate the data </returns>
+				bool ShouldRelocate()const;
+
 				/// <summary>
 				/// Maps memory data to CPU buffer
 				/// (Note: NEEDS corresponding Unmap() call)
@@ -102,30 +280,33 @@ namespace Jimara {
 			private:
 				// 'Owner' memory pool
 				const VulkanMemoryPool* m_memoryPool;
-				
+
 				// Memory type
 				uint32_t m_memoryTypeId;
 
-				// Memory block pool id (same block pool Id means similarly sized allocations, no matter the type id)
-				size_t m_blockPoolId;
+				// Memory block, the allocation resides in
+				VulkanMemoryPool::MemoryBlock* m_block;
 
-				// Memory block id within the block pool (block is a set of batch allocations of similarely sized memories)
-				size_t m_memoryBlockId;
-
-				// Memory allocation id within the memory block
-				size_t m_blockAllocationId;
+				// Sub-allocator handle within the block (VulkanMemoryTLSF::NO_ALLOCATION for dedicated and transient allocations)
+				uint32_t m_blockAllocationId;
 
 				// Memory type properties
 				VkMemoryPropertyFlags m_flags;
-				
+
 				// Vulkan memory
 				VkDeviceMemory m_memory;
-				
+
 				// Vulkan memory offset
-				volatile VkDeviceSize m_offset;
+				VkDeviceSize m_offset;
 
 				// Allocation size
-				volatile VkDeviceSize m_size;
+				VkDeviceSize m_size;
+
+				// Size of the range, reserved within the block
+				VkDeviceSize m_reservedSize;
+
+				// True, if the owner is able to move the data on request
+				bool m_relocatable;
 
 				// VulkanMemoryPool has to access constructor and alike
 				friend class VulkanMemoryPool;
@@ -0,0 +1,242 @@
+#include "VulkanMemoryTLSF.h"
+
+
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			namespace {
+				inline static uint32_t HighestBit(uint64_t value) {
+					uint32_t index = 0;
+					if (value >= (static_cast<uint64_t>(1) << 32)) { value >>= 32; index += 32; }
+					if (value >= (static_cast<uint64_t>(1) << 16)) { value >>= 16; index += 16; }
+					if (value >= (static_cast<uint64_t>(1) << 8)) { value >>= 8; index += 8; }
+					if (value >= (static_cast<uint64_t>(1) << 4)) { value >>= 4; index += 4; }
+					if (value >= (static_cast<uint64_t>(1) << 2)) { value >>= 2; index += 2; }
+					if (value >= (static_cast<uint64_t>(1) << 1)) index += 1;
+					return index;
+				}
+
+				inline static uint32_t LowestBit(uint64_t value) {
+					return HighestBit(value & (~value + 1));
+				}
+
+				inline static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment) {
+					const VkDeviceSize remainder = (value % alignment);
+					return (remainder == 0) ? value : (value + alignment - remainder);
+				}
+			}
+
+			VulkanMemoryTLSF::VulkanMemoryTLSF(VkDeviceSize capacity)
+				: m_capacity(capacity - (capacity % GRANULARITY)) {
+				for (uint32_t i = 0; i < FL_COUNT; i++)
+					for (uint32_t j = 0; j < SL_COUNT; j++)
+						m_freeLists[i][j] = NO_ALLOCATION;
+				if (m_capacity > 0) {
+					uint32_t node = CreateNode(0, m_capacity);
+					InsertFree(node);
+				}
+			}
+
+			VulkanMemoryTLSF::Allocation VulkanMemoryTLSF::Allocate(VkDeviceSize size, VkDeviceSize alignment) {
+				Allocation allocation;
+				size = AlignUp((size > 0) ? size : 1, GRANULARITY);
+				if (alignment < GRANULARITY) alignment = GRANULARITY;
+				if (size > m_capacity) return allocation;
+
+				// Worst case, we need (alignment - GRANULARITY) bytes of padding:
+				const VkDeviceSize request = size + alignment - GRANULARITY;
+				uint32_t nodeId = FindFree(request);
+				if (nodeId == NO_ALLOCATION) {
+					// Good fit search skips the bucket that may contain a large enough range; we can still check it linearly before giving up:
+					uint32_t firstLevel, secondLevel;
+					Mapping(request, firstLevel, secondLevel);
+					for (uint32_t node = m_freeLists[firstLevel][secondLevel]; node != NO_ALLOCATION; node = m_nodes[node].nextFree)
+						if (m_nodes[node].size >= request) {
+							nodeId = node;
+							break;
+						}
+					if (nodeId == NO_ALLOCATION) return allocation;
+				}
+				RemoveFree(nodeId);
+
+				// Padding in front is returned to the free lists (previous physical node is never free, so there's nothing to merge with):
+				const VkDeviceSize alignedOffset = AlignUp(m_nodes[nodeId].offset, alignment);
+				const VkDeviceSize padding = alignedOffset - m_nodes[nodeId].offset;
+				if (padding > 0) {
+					const uint32_t front = CreateNode(m_nodes[nodeId].offset, padding);
+					Node& frontNode = m_nodes[front];
+					Node& node = m_nodes[nodeId];
+					frontNode.prevPhysical = node.prevPhysical;
+					frontNode.nextPhysical = nodeId;
+					if (node.prevPhysical != NO_ALLOCATION)
+						m_nodes[node.prevPhysical].nextPhysical = front;
+					node.prevPhysical = front;
+					node.offset = alignedOffset;
+					node.size -= padding;
+					InsertFree(front);
+				}
+
+				// Same goes for whatever remains after the range:
+				if (m_nodes[nodeId].size > size) {
+					const uint32_t back = CreateNode(alignedOffset + size, m_nodes[nodeId].size - size);
+					Node& backNode = m_nodes[back];
+					Node& node = m_nodes[nodeId];
+					backNode.prevPhysical = nodeId;
+					backNode.nextPhysical = node.nextPhysical;
+					if (node.nextPhysical != NO_ALLOCATION)
+						m_nodes[node.nextPhysical].prevPhysical = back;
+					node.nextPhysical = back;
+					node.size = size;
+					InsertFree(back);
+				}
+
+				m_allocatedBytes += size;
+				m_allocationCount++;
+				allocation.handle = nodeId;
+				allocation.offset = alignedOffset;
+				allocation.size = size;
+				return allocation;
+			}
+
+			void VulkanMemoryTLSF::Free(uint32_t handle) {
+				if (handle >= m_nodes.size() || m_nodes[handle].free) return;
+				m_allocatedBytes -= m_nodes[handle].size;
+				m_allocationCount--;
+				m_nodes[handle].free = true;
+
+				uint32_t nodeId = handle;
+				const uint32_t prev = m_nodes[nodeId].prevPhysical;
+				if (prev != NO_ALLOCATION && m_nodes[prev].free) {
+					RemoveFree(prev);
+					Node& prevNode = m_nodes[prev];
+					const Node& node = m_nodes[nodeId];
+					prevNode.size += node.size;
+					prevNode.nextPhysical = node.nextPhysical;
+					if (node.nextPhysical != NO_ALLOCATION)
+						m_nodes[node.nextPhysical].prevPhysical = prev;
+					DestroyNode(nodeId);
+					nodeId = prev;
+				}
+
+				const uint32_t next = m_nodes[nodeId].nextPhysical;
+				if (next != NO_ALLOCATION && m_nodes[next].free) {
+					RemoveFree(next);
+					Node& node = m_nodes[nodeId];
+					const Node& nextNode = m_nodes[next];
+					node.size += nextNode.size;
+					node.nextPhysical = nextNode.nextPhysical;
+					if (nextNode.nextPhysical != NO_ALLOCATION)
+						m_nodes[nextNode.nextPhysical].prevPhysical = nodeId;
+					DestroyNode(next);
+				}
+
+				InsertFree(nodeId);
+			}
+
+			VkDeviceSize VulkanMemoryTLSF::Capacity()const { return m_capacity; }
+
+			VkDeviceSize VulkanMemoryTLSF::AllocatedBytes()const { return m_allocatedBytes; }
+
+			VkDeviceSize VulkanMemoryTLSF::FreeBytes()const { return (m_capacity - m_allocatedBytes); }
+
+			VkDeviceSize VulkanMemoryTLSF::LargestFreeRange()const {
+				if (m_firstLevelBitmap == 0) return 0;
+				const uint32_t firstLevel = HighestBit(m_firstLevelBitmap);
+				const uint32_t secondLevel = HighestBit(m_secondLevelBitmaps[firstLevel]);
+				VkDeviceSize largest = 0;
+				for (uint32_t node = m_freeLists[firstLevel][secondLevel]; node != NO_ALLOCATION; node = m_nodes[node].nextFree)
+					if (largest < m_nodes[node].size) largest = m_nodes[node].size;
+				return largest;
+			}
+
+			size_t VulkanMemoryTLSF::AllocationCount()const { return m_allocationCount; }
+
+			bool VulkanMemoryTLSF::Empty()const { return m_allocationCount <= 0; }
+
+			void VulkanMemoryTLSF::Mapping(VkDeviceSize size, uint32_t& firstLevel, uint32_t& secondLevel) {
+				if (size < (static_cast<VkDeviceSize>(1) << FL_SHIFT)) {
+					firstLevel = 0;
+					secondLevel = static_cast<uint32_t>(size / ((static_cast<VkDeviceSize>(1) << FL_SHIFT) / SL_COUNT));
+				}
+				else {
+					const uint32_t highestBit = HighestBit(size);
+					firstLevel = highestBit - FL_SHIFT + 1;
+					secondLevel = static_cast<uint32_t>(size >> (highestBit - SL_COUNT_LOG2)) - SL_COUNT;
+				}
+			}
+
+			uint32_t VulkanMemoryTLSF::CreateNode(VkDeviceSize offset, VkDeviceSize size) {
+				uint32_t index;
+				if (m_unusedNodes.size() > 0) {
+					index = m_unusedNodes.back();
+					m_unusedNodes.pop_back();
+				}
+				else {
+					index = static_cast<uint32_t>(m_nodes.size());
+					m_nodes.push_back(Node());
+				}
+				Node& node = m_nodes[index];
+				node = Node();
+				node.offset = offset;
+				node.size = size;
+				return index;
+			}
+
+			void VulkanMemoryTLSF::DestroyNode(uint32_t node) {
+				m_nodes[node] = Node();
+				m_unusedNodes.push_back(node);
+			}
+
+			void VulkanMemoryTLSF::InsertFree(uint32_t nodeId) {
+				Node& node = m_nodes[nodeId];
+				uint32_t firstLevel, secondLevel;
+				Mapping(node.size, firstLevel, secondLevel);
+				uint32_t& head = m_freeLists[firstLevel][secondLevel];
+				node.free = true;
+				node.prevFree = NO_ALLOCATION;
+				node.nextFree = head;
+				if (head != NO_ALLOCATION) m_nodes[head].prevFree = nodeId;
+				head = nodeId;
+				m_firstLevelBitmap |= (static_cast<uint64_t>(1) << firstLevel);
+				m_secondLevelBitmaps[firstLevel] |= (1u << secondLevel);
+			}
+
+			void VulkanMemoryTLSF::RemoveFree(uint32_t nodeId) {
+				Node& node = m_nodes[nodeId];
+				uint32_t firstLevel, secondLevel;
+				Mapping(node.size, firstLevel, secondLevel);
+				if (node.prevFree != NO_ALLOCATION) m_nodes[node.prevFree].nextFree = node.nextFree;
+				else m_freeLists[firstLevel][secondLevel] = node.nextFree;
+				if (node.nextFree != NO_ALLOCATION) m_nodes[node.nextFree].prevFree = node.prevFree;
+				node.prevFree = node.nextFree = NO_ALLOCATION;
+				node.free = false;
+				if (m_freeLists[firstLevel][secondLevel] == NO_ALLOCATION) {
+					m_secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+					if (m_secondLevelBitmaps[firstLevel] == 0)
+						m_firstLevelBitmap &= ~(static_cast<uint64_t>(1) << firstLevel);
+				}
+			}
+
+			uint32_t VulkanMemoryTLSF::FindFree(VkDeviceSize size)const {
+				// Rounding up to the next bucket boundary guarantees any range from the found bucket is large enough:
+				if (size >= (static_cast<VkDeviceSize>(1) << FL_SHIFT)) {
+					const VkDeviceSize roundUp = (static_cast<VkDeviceSize>(1) << (HighestBit(size) - SL_COUNT_LOG2)) - 1;
+					if (roundUp >= m_capacity || size > (m_capacity - roundUp)) return NO_ALLOCATION;
+					size += roundUp;
+				}
+				uint32_t firstLevel, secondLevel;
+				Mapping(size, firstLevel, secondLevel);
+				uint32_t secondLevelMap = (m_secondLevelBitmaps[firstLevel] & (~0u << secondLevel));
+				if (secondLevelMap == 0) {
+					if ((firstLevel + 1) >= FL_COUNT) return NO_ALLOCATION;
+					const uint64_t firstLevelMap = (m_firstLevelBitmap & (~static_cast<uint64_t>(0) << (firstLevel + 1)));
+					if (firstLevelMap == 0) return NO_ALLOCATION;
+					firstLevel = LowestBit(firstLevelMap);
+					secondLevelMap = m_secondLevelBitmaps[firstLevel];
+				}
+				secondLevel = LowestBit(secondLevelMap);
+				return m_freeLists[firstLevel][secondLevel];
+			}
+		}
+	}
+}
@@ -0,0 +1,151 @@
+#pragma once
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			class VulkanMemoryTLSF;
+		}
+	}
+}
+#include "../VulkanAPIIncludes.h"
+#include <vector>
+#include <cstdint>
+
+
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			/// <summary>
+			/// Two-Level Segregated Fit range allocator, used by VulkanMemoryPool to sub-allocate large VkDeviceMemory blocks.
+			/// Notes:
+			///		0. Allocation and release are O(1) (bitmap lookups), adjacent free ranges get coalesced on release;
+			///		1. The allocator does not touch any memory itself, it only hands out [offset; offset + size) ranges within [0; Capacity());
+			///		2. The class is not thread-safe.
+			/// </summary>
+			class VulkanMemoryTLSF {
+			public:
+				/// <summary> Range granularity (every range offset and size is a multiple of this) </summary>
+				static const VkDeviceSize GRANULARITY = 16;
+
+				/// <summary> Invalid allocation handle </summary>
+				static const uint32_t NO_ALLOCATION = ~static_cast<uint32_t>(0);
+
+				/// <summary> Allocated range </summary>
+				struct Allocation {
+					/// <summary> Handle for Free() calls (NO_ALLOCATION, if the allocation failed) </summary>
+					uint32_t handle = NO_ALLOCATION;
+
+					/// <summary> Aligned offset of the range </summary>
+					VkDeviceSize offset = 0;
+
+					/// <summary> Size of the reserved range (requested size, rounded up to GRANULARITY) </summary>
+					VkDeviceSize size = 0;
+				};
+
+				/// <summary>
+				/// Constructor
+				/// </summary>
+				/// <param name="capacity"> Size of the managed range </param>
+				VulkanMemoryTLSF(VkDeviceSize capacity);
+
+				/// <summary>
+				/// Reserves a range
+				/// </summary>
+				/// <param name="size"> Requested size </param>
+				/// <param name="alignment"> Offset alignment (has to be a power of two) </param>
+				/// <returns> Allocated range (handle will be NO_ALLOCATION, if there was no suitable free range) </returns>
+				Allocation Allocate(VkDeviceSize size, VkDeviceSize alignment);
+
+				/// <summary>
+				/// Releases a range
+				/// </summary>
+				/// <param name="handle"> Allocation handle </param>
+				void Free(uint32_t handle);
+
+				/// <summary> Size of the managed range </summary>
+				VkDeviceSize Capacity()const;
+
+				/// <summary> Total size of all allocated ranges </summary>
+				VkDeviceSize AllocatedBytes()const;
+
+				/// <summary> Total size of the free ranges </summary>
+				VkDeviceSize FreeBytes()const;
+
+				/// <summary> Size of the largest free range </summary>
+				VkDeviceSize LargestFreeRange()const;
+
+				/// <summary> Number of live allocations </summary>
+				size_t AllocationCount()const;
+
+				/// <summary> True, if there are no live allocations </summary>
+				bool Empty()const;
+
+
+			private:
+				// Second level subdivision count (log2)
+				static const uint32_t SL_COUNT_LOG2 = 5;
+
+				// Second level subdivision count
+				static const uint32_t SL_COUNT = (1u << SL_COUNT_LOG2);
+
+				// Sizes below (1 << FL_SHIFT) all land in the first level bucket 0, divided linearly
+				static const uint32_t FL_SHIFT = SL_COUNT_LOG2 + 4;
+
+				// Number of first level buckets
+				static const uint32_t FL_COUNT = 64 - FL_SHIFT + 1;
+
+				// Physical range (free or allocated)
+				struct Node {
+					VkDeviceSize offset = 0;
+					VkDeviceSize size = 0;
+					uint32_t prevPhysical = NO_ALLOCATION;
+					uint32_t nextPhysical = NO_ALLOCATION;
+					uint32_t prevFree = NO_ALLOCATION;
+					uint32_t nextFree = NO_ALLOCATION;
+					bool free = false;
+				};
+
+				// Size of the managed range
+				VkDeviceSize m_capacity;
+
+				// Total size of the allocated ranges
+				VkDeviceSize m_allocatedBytes = 0;
+
+				// Number of allocated ranges
+				size_t m_allocationCount = 0;
+
+				// Node storage (handles are indices within this list)
+				std::vector<Node> m_nodes;
+
+				// Unused entries within m_nodes
+				std::vector<uint32_t> m_unusedNodes;
+
+				// Non-empty first level buckets
+				uint64_t m_firstLevelBitmap = 0;
+
+				// Non-empty second level buckets per first level bucket
+				uint32_t m_secondLevelBitmaps[FL_COUNT] = {};
+
+				// Free list heads
+				uint32_t m_freeLists[FL_COUNT][SL_COUNT];
+
+				// Calculates bucket indices for given size
+				static void Mapping(VkDeviceSize size, uint32_t& firstLevel, uint32_t& secondLevel);
+
+				// Creates a new node
+				uint32_t CreateNode(VkDeviceSize offset, VkDeviceSize size);
+
+				// Returns node to m_unusedNodes
+				void DestroyNode(uint32_t node);
+
+				// Inserts a node into the corresponding free list
+				void InsertFree(uint32_t node);
+
+				// Removes a node from it's free list
+				void RemoveFree(uint32_t node);
+
+				// Finds a free node, guaranteed to be at least as large as size (NO_ALLOCATION, if not found)
+				uint32_t FindFree(VkDeviceSize size)const;
+			};
+		}
+	}
+}
@@ -0,0 +1,260 @@
+#include "VulkanUploadRing.h"
+
+
+#pragma warning(disable: 26812)
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			namespace {
+				class UploadRingCache : public virtual ObjectCache<VulkanDevice*> {
+				public:
+					inline static Reference<VulkanUploadRing> Instance(VulkanDevice* device) {
+						static UploadRingCache cache;
+						return cache.GetCachedOrCreate(device, false,
+							[&]() -> Reference<VulkanUploadRing> { return Object::Instantiate<VulkanUploadRing>(device); });
+					}
+				};
+
+				inline static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment) {
+					const VkDeviceSize remainder = (value % alignment);
+					return (remainder == 0) ? value : (value + alignment - remainder);
+				}
+
+				inline static Reference<VulkanPrimaryCommandBuffer> CreateCommandBuffer(VulkanCommandPool* commandPool) {
+					Reference<PrimaryCommandBuffer> commandBuffer = commandPool->CreatePrimaryCommandBuffer();
+					return dynamic_cast<VulkanPrimaryCommandBuffer*>(commandBuffer.operator->());
+				}
+
+				inline static VkBufferMemoryBarrier OwnershipTransferBarrier(VulkanStaticBuffer* buffer, uint32_t srcQueueFamily, uint32_t dstQueueFamily) {
+					VkBufferMemoryBarrier barrier = {};
+					barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+					barrier.srcQueueFamilyIndex = srcQueueFamily;
+					barrier.dstQueueFamilyIndex = dstQueueFamily;
+					barrier.buffer = *buffer;
+					barrier.offset = 0;
+					barrier.size = VK_WHOLE_SIZE;
+					return barrier;
+				}
+			}
+
+			Reference<VulkanUploadRing> VulkanUploadRing::Instance(VulkanDevice* device) {
+				if (device == nullptr) return nullptr;
+				else return UploadRingCache::Instance(device);
+			}
+
+			VulkanUploadRing::VulkanUploadRing(VulkanDevice* device, VkDeviceSize capacity)
+				: m_device(device), m_capacity(capacity), m_data(nullptr)
+				, m_timeline(Object::Instantiate<VulkanTimelineSemaphore>(*device, 0))
+				, m_transferTimeline(device->HasDedicatedTransferQueue() ? Object::Instantiate<VulkanTimelineSemaphore>(*device, 0) : nullptr)
+				, m_head(0), m_tail(0), m_submittedBatch(0), m_completedBatch(0), m_submissionCount(0) {
+				VulkanDeviceQueue* graphicsQueue = dynamic_cast<VulkanDeviceQueue*>(m_device->GraphicsQueue());
+				if (graphicsQueue == nullptr) {
+					m_device->Log()->Fatal("VulkanUploadRing - Device has no graphics queue!");
+					return;
+				}
+				m_graphicsCommandPool = Object::Instantiate<VulkanCommandPool>(graphicsQueue);
+				if (m_transferTimeline != nullptr)
+					m_transferCommandPool = Object::Instantiate<VulkanCommandPool>(dynamic_cast<VulkanDeviceQueue*>(m_device->TransferQueue()));
+				else m_transferCommandPool = m_graphicsCommandPool;
+				if (m_capacity > 0) {
+					m_buffer = Object::Instantiate<VulkanStaticBuffer>(m_device, static_cast<size_t>(m_capacity), 1, true
+						, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+						, VulkanMemoryPool::AllocationStrategy::DEDICATED);
+					m_data = static_cast<uint8_t*>(m_buffer->Map());
+				}
+			}
+
+			VulkanUploadRing::~VulkanUploadRing() {
+				std::unique_lock<std::mutex> lock(m_lock);
+				SubmitOpenBatch();
+				if (m_submittedBatch > 0) m_timeline->Wait(m_submittedBatch);
+				PollCompletedBatches();
+				m_freeCommandBuffers.clear();
+				if (m_buffer != nullptr) {
+					m_buffer->Unmap(false);
+					m_buffer = nullptr;
+				}
+			}
+
+			VulkanDevice* VulkanUploadRing::Device()const { return m_device; }
+
+			VkDeviceSize VulkanUploadRing::Capacity()const { return m_capacity; }
+
+			bool VulkanUploadRing::OwnershipTransferRequired()const { return m_transferTimeline != nullptr; }
+
+			VulkanUploadRing::Range VulkanUploadRing::Allocate(VkDeviceSize size, VkDeviceSize alignment) {
+				Range range;
+				range.size = (size > 0) ? size : 1;
+				if (alignment <= 0) alignment = 1;
+				{
+					std::unique_lock<std::mutex> lock(m_lock);
+					PollCompletedBatches();
+
+					// Nothing in flight means nothing but the outstanding ranges can be using the ring:
+					if (m_inFlightBatches.empty() && m_openBatch.transfer == nullptr)
+						m_tail = m_outstandingRanges.empty() ? m_head : (*m_outstandingRanges.begin());
+
+					if (m_data != nullptr && range.size <= (m_capacity / 2)) {
+						const VkDeviceSize headOffset = (m_head % m_capacity);
+						VkDeviceSize offset = AlignUp(headOffset, alignment);
+						uint64_t position = m_head + (offset - headOffset);
+						if ((offset + range.size) > m_capacity) {
+							// Ranges never wrap around; we skip to the beginning instead:
+							position = m_head + (m_capacity - headOffset);
+							offset = 0;
+						}
+						if ((position + range.size - m_tail) <= m_capacity) {
+							m_head = position + range.size;
+							m_outstandingRanges.insert(position);
+							range.buffer = m_buffer;
+							range.offset = offset;
+							range.data = static_cast<void*>(m_data + offset);
+							range.position = position;
+							return range;
+						}
+					}
+				}
+
+				// Ring is full or the request is too large, so we fall back to a standalone buffer:
+				range.buffer = Object::Instantiate<VulkanStaticBuffer>(m_device, static_cast<size_t>(range.size), 1, true
+					, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+					, VulkanMemoryPool::AllocationStrategy::TRANSIENT);
+				range.offset = 0;
+				range.data = range.buffer->Map();
+				range.position = NO_POSITION;
+				return range;
+			}
+
+			void VulkanUploadRing::Release(const Range& range) {
+				if (range.buffer == nullptr) return;
+				else if (range.position == NO_POSITION) range.buffer->Unmap(true);
+				else {
+					std::unique_lock<std::mutex> lock(m_lock);
+					m_outstandingRanges.erase(range.position);
+				}
+			}
+
+			uint64_t VulkanUploadRing::Record(const Callback<VulkanCommandBuffer*>& recordCommands, Stage stage) {
+				std::unique_lock<std::mutex> lock(m_lock);
+				if (m_graphicsCommandPool == nullptr) return 0;
+				PollCompletedBatches();
+				if (m_openBatch.transfer == nullptr) {
+					if (m_freeCommandBuffers.size() > 0) {
+						m_openBatch = m_freeCommandBuffers.back();
+						m_freeCommandBuffers.pop_back();
+					}
+					else {
+						m_openBatch.transfer = CreateCommandBuffer(m_transferCommandPool);
+						m_openBatch.graphics = (m_transferCommandPool == m_graphicsCommandPool) ? m_openBatch.transfer : CreateCommandBuffer(m_graphicsCommandPool);
+					}
+					m_openBatch.transfer->BeginRecording();
+					if (m_openBatch.graphics != m_openBatch.transfer)
+						m_openBatch.graphics->BeginRecording();
+				}
+				recordCommands((stage == Stage::GRAPHICS) ? m_openBatch.graphics : m_openBatch.transfer);
+				return (m_submittedBatch + 1);
+			}
+
+			bool VulkanUploadRing::RecordInto(uint64_t batchId, const Callback<VulkanCommandBuffer*>& recordCommands, Stage stage) {
+				std::unique_lock<std::mutex> lock(m_lock);
+				if (m_openBatch.transfer == nullptr || batchId != (m_submittedBatch + 1)) return false;
+				recordCommands((stage == Stage::GRAPHICS) ? m_openBatch.graphics : m_openBatch.transfer);
+				return true;
+			}
+
+			void VulkanUploadRing::ReleaseOwnership(VulkanCommandBuffer* commandBuffer, VulkanStaticBuffer* buffer)const {
+				if (!OwnershipTransferRequired()) return;
+				VkBufferMemoryBarrier barrier = OwnershipTransferBarrier(buffer, m_transferCommandPool->Queue()->FamilyId(), m_graphicsCommandPool->Queue()->FamilyId());
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				vkCmdPipelineBarrier(*commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+			}
+
+			void VulkanUploadRing::AcquireOwnership(VulkanCommandBuffer* commandBuffer, VulkanStaticBuffer* buffer)const {
+				if (!OwnershipTransferRequired()) return;
+				VkBufferMemoryBarrier barrier = OwnershipTransferBarrier(buffer, m_transferCommandPool->Queue()->FamilyId(), m_graphicsCommandPool->Queue()->FamilyId());
+				barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+				vkCmdPipelineBarrier(*commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+			}
+
+			void VulkanUploadRing::ReleaseOwnership(VulkanCommandBuffer* commandBuffer, VulkanImage* image, VkImageLayout layout, uint32_t mipLevels, uint32_t arrayLayers)const {
+				if (!OwnershipTransferRequired()) return;
+				VkImageMemoryBarrier barrier = image->LayoutTransitionBarrier(commandBuffer, layout, layout
+					, image->VulkanImageAspectFlags(), 0, mipLevels, 0, arrayLayers, VK_ACCESS_TRANSFER_WRITE_BIT, 0);
+				barrier.srcQueueFamilyIndex = m_transferCommandPool->Queue()->FamilyId();
+				barrier.dstQueueFamilyIndex = m_graphicsCommandPool->Queue()->FamilyId();
+				vkCmdPipelineBarrier(*commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+			}
+
+			void VulkanUploadRing::AcquireOwnership(VulkanCommandBuffer* commandBuffer, VulkanImage* image, VkImageLayout layout, uint32_t mipLevels, uint32_t arrayLayers)const {
+				if (!OwnershipTransferRequired()) return;
+				VkImageMemoryBarrier barrier = image->LayoutTransitionBarrier(commandBuffer, layout, layout
+					, image->VulkanImageAspectFlags(), 0, mipLevels, 0, arrayLayers, 0, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT);
+				barrier.srcQueueFamilyIndex = m_transferCommandPool->Queue()->FamilyId();
+				barrier.dstQueueFamilyIndex = m_graphicsCommandPool->Queue()->FamilyId();
+				vkCmdPipelineBarrier(*commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+			}
+
+			void VulkanUploadRing::Flush() {
+				std::unique_lock<std::mutex> lock(m_lock);
+				SubmitOpenBatch();
+				PollCompletedBatches();
+			}
+
+			void VulkanUploadRing::WaitForBatch(VulkanCommandBuffer* commandBuffer, uint64_t batchId) {
+				if (batchId <= m_completedBatch) return;
+				{
+					std::unique_lock<std::mutex> lock(m_lock);
+					if (batchId > m_submittedBatch) SubmitOpenBatch();
+					PollCompletedBatches();
+				}
+				if (batchId > m_completedBatch)
+					commandBuffer->WaitForSemaphore(m_timeline, batchId, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+			}
+
+			size_t VulkanUploadRing::SubmissionCount()const { return m_submissionCount; }
+
+			uint64_t VulkanUploadRing::CompletedBatch()const { return m_timeline->Count(); }
+
+			void VulkanUploadRing::PollCompletedBatches() {
+				if (m_inFlightBatches.empty()) return;
+				m_completedBatch = m_timeline->Count();
+				while (m_inFlightBatches.size() > 0 && m_inFlightBatches.front().batchId <= m_completedBatch) {
+					InFlightBatch& batch = m_inFlightBatches.front();
+					m_tail = batch.releasePosition;
+					batch.commandBuffers.transfer->Reset();
+					if (batch.commandBuffers.graphics != batch.commandBuffers.transfer)
+						batch.commandBuffers.graphics->Reset();
+					m_freeCommandBuffers.push_back(batch.commandBuffers);
+					m_inFlightBatches.pop();
+				}
+			}
+
+			void VulkanUploadRing::SubmitOpenBatch() {
+				if (m_openBatch.transfer == nullptr) return;
+				InFlightBatch batch;
+				batch.commandBuffers = m_openBatch;
+				batch.batchId = (m_submittedBatch + 1);
+				// Ranges that are still being written to stay reserved:
+				batch.releasePosition = m_outstandingRanges.empty() ? m_head : (*m_outstandingRanges.begin());
+				m_openBatch = BatchCommandBuffers();
+
+				// Graphics part waits for the transfer queue to finish (the timeline handoff):
+				VulkanPrimaryCommandBuffer* transferCommands = batch.commandBuffers.transfer;
+				VulkanPrimaryCommandBuffer* graphicsCommands = batch.commandBuffers.graphics;
+				if (transferCommands != graphicsCommands) {
+					transferCommands->SignalSemaphore(m_transferTimeline, batch.batchId);
+					transferCommands->EndRecording();
+					m_transferCommandPool->Queue()->ExecuteCommandBuffer(transferCommands);
+					graphicsCommands->WaitForSemaphore(m_transferTimeline, batch.batchId, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+				}
+				graphicsCommands->SignalSemaphore(m_timeline, batch.batchId);
+				graphicsCommands->EndRecording();
+				m_graphicsCommandPool->Queue()->ExecuteCommandBuffer(graphicsCommands);
+				m_submittedBatch = batch.batchId;
+				m_submissionCount++;
+				m_inFlightBatches.push(batch);
+			}
+		}
+	}
+}
+#pragma warning(default: 26812)
@@ -0,0 +1,264 @@
+#pragma once
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			class VulkanUploadRing;
+		}
+	}
+}
+#include "Buffers/VulkanStaticBuffer.h"
+#include "Textures/VulkanTexture.h"
+#include "../Pipeline/VulkanCommandBuffer.h"
+#include "../../../Core/ObjectCache.h"
+#include "../../../Core/Function.h"
+#include <atomic>
+#include <mutex>
+#include <queue>
+#include <set>
+
+
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			/// <summary>
+			/// Device-wide staging allocator and upload batcher, shared by the dynamic buffers and textures.
+			/// Notes:
+			///		0. Staging ranges are bump-allocated from a single persistently mapped host-visible ring buffer;
+			///			space gets reclaimed once the batches that consumed it are executed (requests that do not fit fall back to standalone TRANSIENT buffers);
+			///		1. Upload commands from all users are recorded into a single batch, that gets submitted with a single timeline semaphore signal
+			///			either when someone needs the result (WaitForBatch()) or on Flush() (once per frame by the render engine);
+			///		2. Stage::TRANSFER commands are executed on the device's transfer queue; if it's a dedicated one, the resources have to be released
+			///			with ReleaseOwnership() from TRANSFER and acquired with AcquireOwnership() from Stage::GRAPHICS commands, that are executed on the graphics queue
+			///			after the transfer queue is done (without a dedicated transfer queue, both stages share a single command buffer and ownership calls do nothing);
+			///		3. Expected usage: Allocate() -> write to Range::data -> Record() copy commands -> Release();
+			///		4. All calls are thread-safe.
+			/// </summary>
+			class VulkanUploadRing : public virtual ObjectCache<VulkanDevice*>::StoredObject {
+			public:
+				/// <summary> Default size of the ring buffer </summary>
+				static const VkDeviceSize DEFAULT_CAPACITY = (static_cast<VkDeviceSize>(16) << 20);
+
+				/// <summary> Position of the ranges that do not reside within the ring buffer </summary>
+				static const uint64_t NO_POSITION = ~static_cast<uint64_t>(0);
+
+				/// <summary> Part of the batch, the commands are recorded into </summary>
+				enum class Stage : uint8_t {
+					/// <summary> Copies from the staging ranges (transfer queue) </summary>
+					TRANSFER = 0,
+
+					/// <summary> Commands that require the graphics queue or resources owned by it (ownership acquisition, mip generation, relocation); executed after TRANSFER part of the batch </summary>
+					GRAPHICS = 1
+				};
+
+				/// <summary> Staging range </summary>
+				struct Range {
+					/// <summary> Buffer, the range resides in (ring buffer or a standalone one) </summary>
+					Reference<VulkanStaticBuffer> buffer;
+
+					/// <summary> Offset within the buffer </summary>
+					VkDeviceSize offset = 0;
+
+					/// <summary> Range size </summary>
+					VkDeviceSize size = 0;
+
+					/// <summary> Mapped memory </summary>
+					void* data = nullptr;
+
+					/// <summary> Position within the ring (NO_POSITION for standalone buffers) </summary>
+					uint64_t position = NO_POSITION;
+				};
+
+				/// <summary>
+				/// Upload ring, shared by the users of the device
+				/// </summary>
+				/// <param name="device"> Graphics device </param>
+				/// <returns> Shared instance </returns>
+				static Reference<VulkanUploadRing> Instance(VulkanDevice* device);
+
+				/// <summary>
+				/// Constructor
+				/// </summary>
+				/// <param name="device"> Graphics device </param>
+				/// <param name="capacity"> Size of the ring buffer </param>
+				VulkanUploadRing(VulkanDevice* device, VkDeviceSize capacity = DEFAULT_CAPACITY);
+
+				/// <summary> Virtual destructor (submits and waits for the pending batches) </summary>
+				virtual ~VulkanUploadRing();
+
+				/// <summary> Graphics device </summary>
+				VulkanDevice* Device()const;
+
+				/// <summary> Size of the ring buffer </summary>
+				VkDeviceSize Capacity()const;
+
+				/// <summary>
+				/// Reserves a staging range
+				/// </summary>
+				/// <param name="size"> Range size </param>
+				/// <param name="alignment"> Offset alignment (does not have to be a power of two) </param>
+				/// <returns> Mapped staging range </returns>
+				Range Allocate(VkDeviceSize size, VkDeviceSize alignment);
+
+				/// <summary>
+				/// Lets go of a staging range (it gets recycled once all the batches, recorded so far, are executed)
+				/// </summary>
+				/// <param name="range"> Range from Allocate() </param>
+				void Release(const Range& range);
+
+				/// <summary> True, if the transfer commands are executed on a dedicated transfer queue and require queue family ownership transfers </summary>
+				bool OwnershipTransferRequired()const;
+
+				/// <summary>
+				/// Records commands into the current batch
+				/// </summary>
+				/// <param name="recordCommands"> Callback, recording the commands (invoked immediately, with the batch command buffer as the argument) </param>
+				/// <param name="stage"> Part of the batch to record into </param>
+				/// <returns> Identifier of the batch, the commands were recorded into (same as the timeline value it signals) </returns>
+				uint64_t Record(const Callback<VulkanCommandBuffer*>& recordCommands, Stage stage = Stage::TRANSFER);
+
+				/// <summary>
+				/// Records commands into the given batch, if it still is the one being recorded
+				/// (lets the users patch resources that were created within the current batch and are not yet visible to anyone else)
+				/// </summary>
+				/// <param name="batchId"> Batch identifier, returned by Record() </param>
+				/// <param name="recordCommands"> Callback, recording the commands (invoked immediately, with the batch command buffer as the argument) </param>
+				/// <param name="stage"> Part of the batch to record into </param>
+				/// <returns> True, if the batch was still open and the commands got recorded </returns>
+				bool RecordInto(uint64_t batchId, const Callback<VulkanCommandBuffer*>& recordCommands, Stage stage = Stage::TRANSFER);
+
+				/// <summary>
+				/// Records a queue family ownership release barrier for a buffer, written by Stage::TRANSFER commands (does nothing if OwnershipTransferRequired() is false)
+				/// </summary>
+				/// <param name="commandBuffer"> Stage::TRANSFER command buffer </param>
+				/// <param name="buffer"> Buffer to release </param>
+				void ReleaseOwnership(VulkanCommandBuffer* commandBuffer, VulkanStaticBuffer* buffer)const;
+
+				/// <summary>
+				/// Records a queue family ownership acquire barrier for a buffer, released with ReleaseOwnership() (does nothing if OwnershipTransferRequired() is false)
+				/// </summary>
+				/// <param name="commandBuffer"> Stage::GRAPHICS command buffer </param>
+				/// <param name="buffer"> Buffer to acquire </param>
+				void AcquireOwnership(VulkanCommandBuffer* commandBuffer, VulkanStaticBuffer* buffer)const;
+
+				/// <summary>
+				/// Records a queue family ownership release barrier for all subresources of an image, written by Stage::TRANSFER commands (does nothing if OwnershipTransferRequired() is false)
+				/// </summary>
+				/// <param name="commandBuffer"> Stage::TRANSFER command buffer </param>
+				/// <param name="image"> Image to release </param>
+				/// <param name="layout"> Current image layout (stays the same) </param>
+				/// <param name="mipLevels"> Image mip level count </param>
+				/// <param name="arrayLayers"> Image array layer count </param>
+				void ReleaseOwnership(VulkanCommandBuffer* commandBuffer, VulkanImage* image, VkImageLayout layout, uint32_t mipLevels, uint32_t arrayLayers)const;
+
+				/// <summary>
+				/// Records a queue family ownership acquire barrier for an image, released with ReleaseOwnership() (does nothing if OwnershipTransferRequired() is false)
+				/// </summary>
+				/// <param name="commandBuffer"> Stage::GRAPHICS command buffer </param>
+				/// <param name="image"> Image to acquire </param>
+				/// <param name="layout"> Image layout (same as the one during release) </param>
+				/// <param name="mipLevels"> Image mip level count </param>
+				/// <param name="arrayLayers"> Image array layer count </param>
+				void AcquireOwnership(VulkanCommandBuffer* commandBuffer, VulkanImage* image, VkImageLayout layout, uint32_t mipLevels, uint32_t arrayLayers)const;
+
+				/// <summary> Submits the current batch, if it has any commands in it </summary>
+				void Flush();
+
+				/// <summary>
+				/// Makes the command buffer wait for the given batch (submits the batch if it is still being recorded)
+				/// </summary>
+				/// <param name="commandBuffer"> Command buffer, relying on the batch results </param>
+				/// <param name="batchId"> Value, returned by Record() (0 means no batch and is ignored) </param>
+				void WaitForBatch(VulkanCommandBuffer* commandBuffer, uint64_t batchId);
+
+				/// <summary> Number of batches, submitted so far </summary>
+				size_t SubmissionCount()const;
+
+				/// <summary> Identifier of the last batch, executed by the device (queries the timeline; batches with lower identifiers are executed too) </summary>
+				uint64_t CompletedBatch()const;
+
+
+			private:
+				// Command buffers of a batch
+				struct BatchCommandBuffers {
+					// Stage::TRANSFER command buffer
+					Reference<VulkanPrimaryCommandBuffer> transfer;
+
+					// Stage::GRAPHICS command buffer (same as transfer, if there's no dedicated transfer queue)
+					Reference<VulkanPrimaryCommandBuffer> graphics;
+				};
+
+				// Submitted batch
+				struct InFlightBatch {
+					// Batch command buffers
+					BatchCommandBuffers commandBuffers;
+
+					// Batch id (timeline value)
+					uint64_t batchId = 0;
+
+					// Ring position, the tail can be moved to, once the batch is executed
+					uint64_t releasePosition = 0;
+				};
+
+				// "Owner" device
+				const Reference<VulkanDevice> m_device;
+
+				// Size of the ring buffer
+				const VkDeviceSize m_capacity;
+
+				// Ring buffer
+				Reference<VulkanStaticBuffer> m_buffer;
+
+				// Persistent mapping of the ring buffer
+				uint8_t* m_data;
+
+				// Command pool for Stage::TRANSFER command buffers
+				Reference<VulkanCommandPool> m_transferCommandPool;
+
+				// Command pool for Stage::GRAPHICS command buffers (same as m_transferCommandPool, if there's no dedicated transfer queue)
+				Reference<VulkanCommandPool> m_graphicsCommandPool;
+
+				// Timeline, signalled by the batches
+				const Reference<VulkanTimelineSemaphore> m_timeline;
+
+				// Timeline, signalled by the Stage::TRANSFER command buffers (only used with a dedicated transfer queue)
+				const Reference<VulkanTimelineSemaphore> m_transferTimeline;
+
+				// Lock for everything below
+				std::mutex m_lock;
+
+				// Ring position, next allocation starts from
+				uint64_t m_head;
+
+				// Ring position, anything before which is free
+				uint64_t m_tail;
+
+				// Ranges, allocated but not yet released
+				std::set<uint64_t> m_outstandingRanges;
+
+				// Batch, currently being recorded (nullptr command buffers, if nothing was recorded since the last submission)
+				BatchCommandBuffers m_openBatch;
+
+				// Last submitted batch id
+				uint64_t m_submittedBatch;
+
+				// Last batch id, known to be complete
+				std::atomic<uint64_t> m_completedBatch;
+
+				// Submitted batches that were not yet known to be complete
+				std::queue<InFlightBatch> m_inFlightBatches;
+
+				// Command buffers from the executed batches
+				std::vector<BatchCommandBuffers> m_freeCommandBuffers;
+
+				// Number of submissions
+				std::atomic<size_t> m_submissionCount;
+
+				// Recycles the batches that are already executed
+				void PollCompletedBatches();
+
+				// Submits m_openBatch
+				void SubmitOpenBatch();
+			};
+		}
+	}
+}
@@ -0,0 +1,360 @@
+#include "VulkanBindlessSet.h"
+#include <deque>
+
+
+#pragma warning(disable: 26812)
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			namespace {
+				inline static VkDescriptorPool CreateDescriptorPool(VkDeviceHandle* device, uint32_t maxSamplers, uint32_t maxStructuredBuffers, uint32_t setCount) {
+					VkDescriptorPoolSize sizes[2];
+					{
+						sizes[0] = {};
+						sizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+						sizes[0].descriptorCount = maxSamplers * setCount;
+					}
+					{
+						sizes[1] = {};
+						sizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+						sizes[1].descriptorCount = maxStructuredBuffers * setCount;
+					}
+
+					VkDescriptorPoolCreateInfo createInfo = {};
+					{
+						createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+						createInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+						createInfo.poolSizeCount = 2;
+						createInfo.pPoolSizes = sizes;
+						createInfo.maxSets = setCount;
+					}
+					VkDescriptorPool pool;
+					if (vkCreateDescriptorPool(*device, &createInfo, nullptr, &pool) != VK_SUCCESS) {
+						device->Log()->Fatal("VulkanBindlessSet - Failed to create descriptor pool!");
+						pool = VK_NULL_HANDLE;
+					}
+					return pool;
+				}
+
+				inline static std::vector<VkDescriptorSet> CreateDescriptorSets(VkDeviceHandle* device, VkDescriptorPool pool, VkDescriptorSetLayout layout, uint32_t setCount) {
+					std::vector<VkDescriptorSet> sets(setCount, VK_NULL_HANDLE);
+					if (pool == VK_NULL_HANDLE || layout == VK_NULL_HANDLE) return sets;
+					const std::vector<VkDescriptorSetLayout> layouts(setCount, layout);
+					VkDescriptorSetAllocateInfo allocInfo = {};
+					{
+						allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+						allocInfo.descriptorPool = pool;
+						allocInfo.descriptorSetCount = setCount;
+						allocInfo.pSetLayouts = layouts.data();
+					}
+					if (vkAllocateDescriptorSets(*device, &allocInfo, sets.data()) != VK_SUCCESS) {
+						device->Log()->Fatal("VulkanBindlessSet - Failed to allocate descriptor sets!");
+						for (size_t i = 0; i < sets.size(); i++) sets[i] = VK_NULL_HANDLE;
+					}
+					return sets;
+				}
+
+				inline static void WriteDescriptor(
+					VkDeviceHandle* device, VkDescriptorSet set, uint32_t binding, uint32_t index, VkDescriptorType type,
+					const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo) {
+					if (set == VK_NULL_HANDLE) return;
+					VkWriteDescriptorSet write = {};
+					write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+					write.dstSet = set;
+					write.dstBinding = binding;
+					write.dstArrayElement = index;
+					write.descriptorType = type;
+					write.descriptorCount = 1;
+					write.pImageInfo = imageInfo;
+					write.pBufferInfo = bufferInfo;
+					vkUpdateDescriptorSets(*device, 1, &write, 0, nullptr);
+				}
+			}
+
+
+			class VulkanBindlessSet::SlotPool : public virtual Object {
+			private:
+				// Index allocator for a single array
+				struct SlotAllocator {
+					// Array size
+					uint32_t capacity = 0;
+
+					// Number of indices, ever allocated
+					uint32_t allocated = 0;
+
+					// Retired indices (reused in FIFO order and only after the array runs out of fresh slots)
+					std::deque<uint32_t> released;
+				};
+
+				// Lock for the allocators (may be taken while the set's lock is held, but never the other way around)
+				std::mutex m_lock;
+
+				// Sampler indices
+				SlotAllocator m_samplers;
+
+				// Structured buffer indices
+				SlotAllocator m_buffers;
+
+			public:
+				inline SlotPool(uint32_t maxSamplers, uint32_t maxStructuredBuffers) {
+					m_samplers.capacity = maxSamplers;
+					m_buffers.capacity = maxStructuredBuffers;
+				}
+
+				inline uint32_t Capacity(bool sampler)const { return sampler ? m_samplers.capacity : m_buffers.capacity; }
+
+				// Allocates an index (returns Capacity(sampler) on failure)
+				inline uint32_t Allocate(bool sampler) {
+					std::unique_lock<std::mutex> lock(m_lock);
+					SlotAllocator& slots = sampler ? m_samplers : m_buffers;
+					if (slots.allocated < slots.capacity) return (slots.allocated++);
+					else if (slots.released.size() > 0) {
+						uint32_t index = slots.released.front();
+						slots.released.pop_front();
+						return index;
+					}
+					else return slots.capacity;
+				}
+
+				// Makes retired indices available for reuse
+				inline void Release(const std::vector<uint32_t>& samplers, const std::vector<uint32_t>& buffers) {
+					if (samplers.empty() && buffers.empty()) return;
+					std::unique_lock<std::mutex> lock(m_lock);
+					m_samplers.released.insert(m_samplers.released.end(), samplers.begin(), samplers.end());
+					m_buffers.released.insert(m_buffers.released.end(), buffers.begin(), buffers.end());
+				}
+			};
+
+
+			class VulkanBindlessSet::Epoch : public virtual Object {
+			private:
+				// Slot pool, retired indices go back to
+				const Reference<SlotPool> m_slots;
+
+				// Next epoch (kept alive by this one, so that the slots of the newer epochs never get recycled before the older ones)
+				Reference<Epoch> m_next;
+
+				// Sampler indices, retired during the epoch
+				std::vector<uint32_t> m_samplers;
+
+				// Structured buffer indices, retired during the epoch
+				std::vector<uint32_t> m_buffers;
+
+				// Static handles of the retired bindings (pending command buffers may still be reading them)
+				std::vector<Reference<Object>> m_handles;
+
+			public:
+				inline Epoch(SlotPool* slots) : m_slots(slots) {}
+
+				inline virtual ~Epoch() {
+					m_slots->Release(m_samplers, m_buffers);
+					// Unlinking the chain iteratively to avoid deep recursion, when many epochs retire at once:
+					Reference<Epoch> next = m_next;
+					m_next = nullptr;
+					while (next != nullptr && next->RefCount() == 1) {
+						Reference<Epoch> after = next->m_next;
+						next->m_next = nullptr;
+						next = after;
+					}
+				}
+
+				// Retires a slot (set's lock has to be locked and the epoch has to be the current one)
+				inline void Retire(bool sampler, uint32_t index, const std::vector<Reference<Object>>& handles) {
+					(sampler ? m_samplers : m_buffers).push_back(index);
+					for (size_t i = 0; i < handles.size(); i++)
+						if (handles[i] != nullptr) m_handles.push_back(handles[i]);
+				}
+
+				inline bool Empty()const { return m_samplers.empty() && m_buffers.empty(); }
+
+				inline void SetNext(Epoch* next) { m_next = next; }
+			};
+
+
+			class VulkanBindlessSet::ResourceBinding : public virtual BindlessSet::Binding, public virtual ObjectCache<const Object*>::StoredObject {
+			private:
+				// "Owner" set
+				const Reference<VulkanBindlessSet> m_set;
+
+				// Sampler (nullptr for buffers)
+				const Reference<VulkanImageSampler> m_sampler;
+
+				// Buffer (nullptr for samplers)
+				const Reference<VulkanArrayBuffer> m_buffer;
+
+				// Static handles, the descriptors were last written with (one per descriptor set copy)
+				std::vector<Reference<Object>> m_boundHandles;
+
+				// Index within the array
+				uint32_t m_index;
+
+				// Writes the descriptor to the given set copy, if the static handle has changed (m_set->m_lock has to be locked)
+				inline void Write(size_t setId, Object* handle) {
+					if (handle == nullptr || m_boundHandles[setId] == handle) return;
+					m_boundHandles[setId] = handle;
+					if (m_sampler != nullptr) {
+						VulkanStaticImageSampler* sampler = dynamic_cast<VulkanStaticImageSampler*>(handle);
+						VkDescriptorImageInfo info = {};
+						info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+						info.imageView = *dynamic_cast<VulkanStaticImageView*>(sampler->TargetView());
+						info.sampler = *sampler;
+						WriteDescriptor(m_set->m_device, m_set->m_sets[setId], SAMPLER_BINDING, m_index, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &info, nullptr);
+					}
+					else {
+						VkDescriptorBufferInfo info = {};
+						info.buffer = *dynamic_cast<VulkanStaticBuffer*>(handle);
+						info.offset = 0;
+						info.range = VK_WHOLE_SIZE;
+						WriteDescriptor(m_set->m_device, m_set->m_sets[setId], STRUCTURED_BUFFER_BINDING, m_index, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &info);
+					}
+				}
+
+				// Current static handle of the resource
+				inline Reference<Object> StaticHandle(VulkanCommandBuffer* commandBuffer)const {
+					if (m_sampler != nullptr) return m_sampler->GetStaticHandle(commandBuffer);
+					else return m_buffer->GetStaticHandle(commandBuffer);
+				}
+
+			public:
+				inline ResourceBinding(VulkanBindlessSet* set, VulkanImageSampler* sampler, VulkanArrayBuffer* buffer)
+					: m_set(set), m_sampler(sampler), m_buffer(buffer), m_boundHandles(set->m_sets.size()) {
+					std::unique_lock<std::mutex> lock(m_set->m_lock);
+					m_index = m_set->m_slots->Allocate(m_sampler != nullptr);
+					if (!Valid()) {
+						// Slots, retired since the last Update() call, may already be free:
+						m_set->BeginEpoch();
+						m_index = m_set->m_slots->Allocate(m_sampler != nullptr);
+					}
+					if (!Valid()) {
+						m_set->m_device->Log()->Error(std::string("VulkanBindlessSet - Out of free ") + ((m_sampler != nullptr) ? "sampler" : "structured buffer") + " slots!");
+						return;
+					}
+					const bool isStatic = (m_sampler != nullptr)
+						? (dynamic_cast<VulkanStaticImageSampler*>(m_sampler.operator->()) != nullptr)
+						: (dynamic_cast<VulkanStaticBuffer*>(m_buffer.operator->()) != nullptr);
+					if (isStatic) {
+						// The slot is not used by any pending command buffer, so all the copies can be written right away:
+						const Reference<Object> handle = StaticHandle(nullptr);
+						for (size_t i = 0; i < m_boundHandles.size(); i++) Write(i, handle);
+					}
+					else m_set->m_dynamicBindings.insert(this);
+				}
+
+				inline virtual ~ResourceBinding() {
+					std::unique_lock<std::mutex> lock(m_set->m_lock);
+					if (!Valid()) return;
+					m_set->m_dynamicBindings.erase(this);
+					m_set->m_epoch->Retire(m_sampler != nullptr, m_index, m_boundHandles);
+				}
+
+				inline virtual uint32_t Index()const override { return m_index; }
+
+				inline bool Valid()const { return m_index < m_set->m_slots->Capacity(m_sampler != nullptr); }
+
+				// Rewrites the descriptor within the given set copy if the static handle has changed (m_set->m_lock has to be locked)
+				inline void Refresh(VulkanCommandBuffer* commandBuffer, size_t setId) {
+					Write(setId, StaticHandle(commandBuffer));
+				}
+			};
+
+
+			class VulkanBindlessSet::BindingCache : public virtual ObjectCache<const Object*> {
+			public:
+				inline Reference<ResourceBinding> Get(VulkanBindlessSet* set, VulkanImageSampler* sampler, VulkanArrayBuffer* buffer) {
+					const Object* key = (sampler != nullptr) ? static_cast<const Object*>(sampler) : static_cast<const Object*>(buffer);
+					return GetCachedOrCreate(key, false, [&]() -> Reference<StoredObject> {
+						return Object::Instantiate<ResourceBinding>(set, sampler, buffer);
+						});
+				}
+			};
+
+
+			VulkanBindlessSet::VulkanBindlessSet(VkDeviceHandle* device, uint32_t maxSamplers, uint32_t maxStructuredBuffers, uint32_t inFlightSetCount)
+				: m_device(device), m_pool(VK_NULL_HANDLE)
+				, m_slots(Object::Instantiate<SlotPool>(maxSamplers, maxStructuredBuffers))
+				, m_bindings(Object::Instantiate<BindingCache>()) {
+				if (inFlightSetCount <= 0) inFlightSetCount = 1;
+				m_epoch = Object::Instantiate<Epoch>(m_slots);
+
+				const VkShaderStageFlags stages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+				std::vector<VkDescriptorSetLayoutBinding> bindings(2);
+				{
+					bindings[0] = {};
+					bindings[0].binding = SAMPLER_BINDING;
+					bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+					bindings[0].descriptorCount = maxSamplers;
+					bindings[0].stageFlags = stages;
+				}
+				{
+					bindings[1] = {};
+					bindings[1].binding = STRUCTURED_BUFFER_BINDING;
+					bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+					bindings[1].descriptorCount = maxStructuredBuffers;
+					bindings[1].stageFlags = stages;
+				}
+				m_layout = Object::Instantiate<VulkanPipelineObjectCache::DescriptorSetLayout>(m_device, bindings, true);
+				m_pool = CreateDescriptorPool(m_device, maxSamplers, maxStructuredBuffers, inFlightSetCount);
+				m_sets = CreateDescriptorSets(m_device, m_pool, *m_layout, inFlightSetCount);
+			}
+
+			VulkanBindlessSet::~VulkanBindlessSet() {
+				if (m_pool != VK_NULL_HANDLE) {
+					vkDestroyDescriptorPool(*m_device, m_pool, nullptr);
+					m_pool = VK_NULL_HANDLE;
+				}
+				for (size_t i = 0; i < m_sets.size(); i++)
+					m_sets[i] = VK_NULL_HANDLE;
+			}
+
+			Reference<BindlessSet::Binding> VulkanBindlessSet::GetBinding(TextureSampler* sampler) {
+				if (sampler == nullptr) return nullptr;
+				VulkanImageSampler* vulkanSampler = dynamic_cast<VulkanImageSampler*>(sampler);
+				if (vulkanSampler == nullptr) {
+					m_device->Log()->Error("VulkanBindlessSet::GetBinding - Unsupported sampler type!");
+					return nullptr;
+				}
+				Reference<ResourceBinding> binding = m_bindings->Get(this, vulkanSampler, nullptr);
+				return binding->Valid() ? binding : nullptr;
+			}
+
+			Reference<BindlessSet::Binding> VulkanBindlessSet::GetBinding(ArrayBuffer* buffer) {
+				if (buffer == nullptr) return nullptr;
+				VulkanArrayBuffer* vulkanBuffer = dynamic_cast<VulkanArrayBuffer*>(buffer);
+				if (vulkanBuffer == nullptr) {
+					m_device->Log()->Error("VulkanBindlessSet::GetBinding - Unsupported buffer type!");
+					return nullptr;
+				}
+				Reference<ResourceBinding> binding = m_bindings->Get(this, nullptr, vulkanBuffer);
+				return binding->Valid() ? binding : nullptr;
+			}
+
+			VulkanPipelineObjectCache::DescriptorSetLayout* VulkanBindlessSet::SetLayout()const { return m_layout; }
+
+			VkDescriptorSet VulkanBindlessSet::DescriptorSet(size_t inFlightBufferId)const {
+				if (inFlightBufferId >= m_sets.size()) {
+					m_device->Log()->Error("VulkanBindlessSet::DescriptorSet - In-flight buffer id out of range! (bindless set copies may end up shared between in-flight command buffers)");
+					inFlightBufferId %= m_sets.size();
+				}
+				return m_sets[inFlightBufferId];
+			}
+
+			void VulkanBindlessSet::Update(VulkanCommandBuffer* commandBuffer, size_t inFlightBufferId) {
+				std::unique_lock<std::mutex> lock(m_lock);
+				inFlightBufferId %= m_sets.size();
+				for (std::unordered_set<ResourceBinding*>::const_iterator it = m_dynamicBindings.begin(); it != m_dynamicBindings.end(); ++it)
+					(*it)->Refresh(commandBuffer, inFlightBufferId);
+				// Slots, retired from now on, will not be recycled till the command buffer gets reset:
+				BeginEpoch();
+				commandBuffer->RecordBufferDependency(m_epoch);
+			}
+
+			void VulkanBindlessSet::BeginEpoch() {
+				if (m_epoch->Empty()) return;
+				const Reference<Epoch> epoch = Object::Instantiate<Epoch>(m_slots);
+				m_epoch->SetNext(epoch);
+				m_epoch = epoch;
+			}
+		}
+	}
+}
+#pragma warning(default: 26812)
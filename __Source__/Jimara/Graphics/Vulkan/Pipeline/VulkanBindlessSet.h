@@ -0,0 +1,132 @@
+#pragma once
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			class VulkanBindlessSet;
+		}
+	}
+}
+#include "VulkanCommandPool.h"
+#include "VulkanPipelineObjectCache.h"
+#include "../Memory/Buffers/VulkanStaticBuffer.h"
+#include "../Memory/TextureSamplers/VulkanTextureSampler.h"
+#include "../../Pipeline/BindlessSet.h"
+#include <unordered_set>
+#include <mutex>
+
+
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			/// <summary>
+			/// Vulkan-backed bindless resource set (update-after-bind descriptor sets with a sampler and a storage buffer array)
+			/// Notes:
+			///		0. There is a separate copy of the descriptor set per in-flight command buffer index and the copy is only rewritten while recording a command buffer with the same index,
+			///			so (just like with the per-pipeline descriptor sets) descriptors, used by pending command buffers never change underneath them;
+			///		1. Released slots get recycled only after all the command buffers, that were recorded before the release (and could still be reading the slot) get reset.
+			/// </summary>
+			class VulkanBindlessSet : public virtual BindlessSet {
+			public:
+				/// <summary> Default size of the sampler array </summary>
+				static const uint32_t DEFAULT_SAMPLER_COUNT = 4096;
+
+				/// <summary> Default size of the structured buffer array </summary>
+				static const uint32_t DEFAULT_STRUCTURED_BUFFER_COUNT = 4096;
+
+				/// <summary> Default number of descriptor set copies (has to cover the largest in-flight command buffer count of the pipelines, that bind the set) </summary>
+				static const uint32_t DEFAULT_IN_FLIGHT_SET_COUNT = 8;
+
+				/// <summary>
+				/// Constructor
+				/// </summary>
+				/// <param name="device"> Device handle </param>
+				/// <param name="maxSamplers"> Size of the sampler array </param>
+				/// <param name="maxStructuredBuffers"> Size of the structured buffer array </param>
+				/// <param name="inFlightSetCount"> Number of descriptor set copies (one per in-flight command buffer index) </param>
+				VulkanBindlessSet(VkDeviceHandle* device
+					, uint32_t maxSamplers = DEFAULT_SAMPLER_COUNT, uint32_t maxStructuredBuffers = DEFAULT_STRUCTURED_BUFFER_COUNT
+					, uint32_t inFlightSetCount = DEFAULT_IN_FLIGHT_SET_COUNT);
+
+				/// <summary> Virtual destructor </summary>
+				virtual ~VulkanBindlessSet();
+
+				/// <summary>
+				/// Registers a texture sampler within the set (or returns the existing binding)
+				/// </summary>
+				/// <param name="sampler"> Texture sampler </param>
+				/// <returns> Sampler binding (nullptr, if the sampler is null or the set ran out of free slots) </returns>
+				virtual Reference<Binding> GetBinding(TextureSampler* sampler) override;
+
+				/// <summary>
+				/// Registers a structured buffer within the set (or returns the existing binding)
+				/// </summary>
+				/// <param name="buffer"> Structured buffer </param>
+				/// <returns> Buffer binding (nullptr, if the buffer is null or the set ran out of free slots) </returns>
+				virtual Reference<Binding> GetBinding(ArrayBuffer* buffer) override;
+
+				/// <summary> Descriptor set layout </summary>
+				VulkanPipelineObjectCache::DescriptorSetLayout* SetLayout()const;
+
+				/// <summary>
+				/// Descriptor set copy for an in-flight command buffer index
+				/// </summary>
+				/// <param name="inFlightBufferId"> In-flight command buffer index </param>
+				/// <returns> API object </returns>
+				VkDescriptorSet DescriptorSet(size_t inFlightBufferId)const;
+
+				/// <summary>
+				/// Refreshes the descriptors of the resources, that are not static (dynamic textures and buffers may change their underlying handles)
+				/// Notes: 
+				///		0. Pipelines, that bind the set, invoke this from UpdateDescriptors(); static resources are written once, when they get registered;
+				///		1. Only the copy for inFlightBufferId gets rewritten and the command buffer keeps released slots from being recycled till it gets reset.
+				/// </summary>
+				/// <param name="commandBuffer"> Command buffer, that may rely on the resources </param>
+				/// <param name="inFlightBufferId"> In-flight index of the command buffer </param>
+				void Update(VulkanCommandBuffer* commandBuffer, size_t inFlightBufferId);
+
+			private:
+				// Registered resource (defined in the source file)
+				class ResourceBinding;
+
+				// Resource to binding map
+				class BindingCache;
+
+				// Slot allocators (defined in the source file; shared with the epochs, since those may outlive the set)
+				class SlotPool;
+
+				// Slots, released between two Update() calls (defined in the source file; returns them to the pool once nobody is using it)
+				class Epoch;
+
+				// Device handle
+				const Reference<VkDeviceHandle> m_device;
+
+				// Descriptor set layout
+				Reference<VulkanPipelineObjectCache::DescriptorSetLayout> m_layout;
+
+				// Descriptor pool
+				VkDescriptorPool m_pool;
+
+				// Descriptor sets (one per in-flight command buffer index)
+				std::vector<VkDescriptorSet> m_sets;
+
+				// Lock for bindings and descriptor writes
+				std::mutex m_lock;
+
+				// Sampler and structured buffer indices
+				const Reference<SlotPool> m_slots;
+
+				// Current epoch (recorded as a dependency by the command buffers, that invoke Update())
+				Reference<Epoch> m_epoch;
+
+				// Bindings, that have to be refreshed on each Update() call
+				std::unordered_set<ResourceBinding*> m_dynamicBindings;
+
+				// Starts a new epoch, if the current one has any released slots (m_lock has to be locked)
+				void BeginEpoch();
+
+				// Resource to binding map
+				const Reference<BindingCache> m_bindings;
+			};
+		}
+	}
+}
@@ -22,9 +22,16 @@ namespace Jimara {
 					queue->Device()->Log()->Fatal("VulkanCommandPool - Failed to create command pool!");
 				}
 				return pool;
-					}()) {}
+					}())
+				, m_submissionTimeline(Object::Instantiate<VulkanTimelineSemaphore>(queue->Device(), 0))
+				, m_lastSubmission(0) {}
 
 			VulkanCommandPool::~VulkanCommandPool() {
+				{
+					std::unique_lock<std::mutex> lock(m_submissionLock);
+					if (m_lastSubmission > 0) m_submissionTimeline->Wait(m_lastSubmission);
+					ReleaseCompletedSubmissions();
+				}
 				FreeOutOfScopeCommandBuffers();
 				if (m_commandPool != VK_NULL_HANDLE)
 					vkDestroyCommandPool(*m_queue->Device(), m_commandPool, nullptr);
@@ -158,6 +165,61 @@ namespace Jimara {
 				return buffers;
 			}
 
+			VulkanTimelineSemaphore* VulkanCommandPool::SubmissionTimeline()const { return m_submissionTimeline; }
+
+			bool VulkanCommandPool::SubmissionComplete(uint64_t token)const {
+				return m_submissionTimeline->Count() >= token;
+			}
+
+			void VulkanCommandPool::WaitForSubmission(uint64_t token)const {
+				if (token <= 0) return;
+				m_submissionTimeline->Wait(token, UINT64_MAX);
+				std::unique_lock<std::mutex> lock(m_submissionLock);
+				ReleaseCompletedSubmissions();
+			}
+
+			uint64_t VulkanCommandPool::SubmitAsynchronous(VkCommandBuffer commandBuffer) {
+				std::unique_lock<std::mutex> lock(m_submissionLock);
+				ReleaseCompletedSubmissions();
+
+				const uint64_t token = (m_lastSubmission + 1);
+				const VkSemaphore semaphore = *m_submissionTimeline;
+
+				VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+				{
+					timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+					timelineInfo.signalSemaphoreValueCount = 1;
+					timelineInfo.pSignalSemaphoreValues = &token;
+				}
+				VkSubmitInfo submitInfo = {};
+				{
+					submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+					submitInfo.pNext = &timelineInfo;
+					submitInfo.commandBufferCount = 1;
+					submitInfo.pCommandBuffers = &commandBuffer;
+					submitInfo.signalSemaphoreCount = 1;
+					submitInfo.pSignalSemaphores = &semaphore;
+				}
+				if (m_queue->Submit(submitInfo) != VK_SUCCESS) {
+					m_queue->Device()->Log()->Fatal("VulkanCommandPool - Failed to submit single-time command buffer!");
+					DestroyCommandBuffer(commandBuffer);
+					return 0;
+				}
+
+				m_lastSubmission = token;
+				m_pendingSubmissions.push(std::make_pair(token, commandBuffer));
+				return token;
+			}
+
+			void VulkanCommandPool::ReleaseCompletedSubmissions()const {
+				if (m_pendingSubmissions.empty()) return;
+				const uint64_t completed = m_submissionTimeline->Count();
+				while (m_pendingSubmissions.size() > 0 && m_pendingSubmissions.front().first <= completed) {
+					DestroyCommandBuffer(m_pendingSubmissions.front().second);
+					m_pendingSubmissions.pop();
+				}
+			}
+
 			void VulkanCommandPool::FreeOutOfScopeCommandBuffers()const {
 				std::unique_lock<std::mutex> lock(m_outOfScopeLock);
 				if (m_outOfScopeBuffers.size() > 0) {
@@ -8,6 +8,7 @@ namespace Jimara {
 }
 #include "VulkanDeviceQueue.h"
 #include <mutex>
+#include <queue>
 
 
 namespace Jimara {
@@ -72,12 +73,13 @@ namespace Jimara {
 				void DestroyCommandBuffer(VkCommandBuffer buffer)const;
 
 				/// <summary>
-				/// Creates and runs a single-time command buffer (introduces sync point, so use this one with an amount of caution)
+				/// Creates and submits a single-time command buffer without waiting for it
 				/// </summary>
 				/// <typeparam name="FunctionType"> Some function type that gets a VkCommandBuffer as parameter, records some commands to it and returns </typeparam>
 				/// <param name="recordCallback"> Some function that gets a VkCommandBuffer as parameter, records some commands to it and returns </param>
+				/// <returns> Completion token (SubmissionTimeline() value, the submission signals once it's done; 0 if submission failed) </returns>
 				template<typename FunctionType>
-				inline void SubmitSingleTimeCommandBuffer(FunctionType recordCallback) {
+				inline uint64_t SubmitAsynchronousCommandBuffer(FunctionType recordCallback) {
 					VkCommandBuffer commandBuffer = CreateCommandBuffer();
 					{
 						VkCommandBufferBeginInfo beginInfo = {};
@@ -87,17 +89,35 @@ namespace Jimara {
 					}
 					recordCallback(commandBuffer);
 					vkEndCommandBuffer(commandBuffer);
-					{
-						VkSubmitInfo submitInfo = {};
-						submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-						submitInfo.commandBufferCount = 1;
-						submitInfo.pCommandBuffers = &commandBuffer;
-						vkQueueSubmit(*Queue(), 1, &submitInfo, VK_NULL_HANDLE);
-					}
-					vkQueueWaitIdle(*Queue());
-					DestroyCommandBuffer(commandBuffer);
+					return SubmitAsynchronous(commandBuffer);
+				}
+
+				/// <summary>
+				/// Creates and runs a single-time command buffer and waits for it to finish (unlike vkQueueWaitIdle, does not wait for anything else on the queue)
+				/// </summary>
+				/// <typeparam name="FunctionType"> Some function type that gets a VkCommandBuffer as parameter, records some commands to it and returns </typeparam>
+				/// <param name="recordCallback"> Some function that gets a VkCommandBuffer as parameter, records some commands to it and returns </param>
+				template<typename FunctionType>
+				inline void SubmitSingleTimeCommandBuffer(FunctionType recordCallback) {
+					WaitForSubmission(SubmitAsynchronousCommandBuffer(recordCallback));
 				}
 
+				/// <summary> Timeline semaphore, signalled by asynchronous submissions (GPU-side waits can use it together with completion tokens) </summary>
+				VulkanTimelineSemaphore* SubmissionTimeline()const;
+
+				/// <summary>
+				/// Checks if an asynchronous submission is finished
+				/// </summary>
+				/// <param name="token"> Value, returned by SubmitAsynchronousCommandBuffer() </param>
+				/// <returns> True, if the submission is complete </returns>
+				bool SubmissionComplete(uint64_t token)const;
+
+				/// <summary>
+				/// Waits for an asynchronous submission to finish
+				/// </summary>
+				/// <param name="token"> Value, returned by SubmitAsynchronousCommandBuffer() </param>
+				void WaitForSubmission(uint64_t token)const;
+
 				/// <summary> Creates a primary command buffer </summary>
 				virtual Reference<PrimaryCommandBuffer> CreatePrimaryCommandBuffer() override;
 
@@ -136,8 +156,26 @@ namespace Jimara {
 				// Collection of command buffers, that went out of scope
 				mutable std::vector<VkCommandBuffer> m_outOfScopeBuffers;
 
+				// Timeline, signalled by asynchronous submissions
+				const Reference<VulkanTimelineSemaphore> m_submissionTimeline;
+
+				// Lock for asynchronous submissions
+				mutable std::mutex m_submissionLock;
+
+				// Last completion token
+				uint64_t m_lastSubmission;
+
+				// Asynchronously submitted command buffers, that were not yet known to be complete
+				mutable std::queue<std::pair<uint64_t, VkCommandBuffer>> m_pendingSubmissions;
+
 				// Frees all command buffers within m_outOfScopeBuffers collection
 				void FreeOutOfScopeCommandBuffers()const;
+
+				// Submits a recorded command buffer, signalling the next token value
+				uint64_t SubmitAsynchronous(VkCommandBuffer commandBuffer);
+
+				// Moves the completed asynchronous submissions to m_outOfScopeBuffers (requires m_submissionLock)
+				void ReleaseCompletedSubmissions()const;
 			};
 		}
 	}
@@ -37,6 +37,11 @@ namespace Jimara {
 				std::unique_lock<std::mutex> lock(m_submitionLock);
 				vulkanBuffer->SumbitOnQueue(*this);
 			}
+
+			VkResult VulkanDeviceQueue::Submit(const VkSubmitInfo& submitInfo, VkFence fence) {
+				std::unique_lock<std::mutex> lock(m_submitionLock);
+				return vkQueueSubmit(m_queue, 1, &submitInfo, fence);
+			}
 		}
 	}
 }
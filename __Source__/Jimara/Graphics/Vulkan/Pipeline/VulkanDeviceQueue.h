@@ -42,6 +42,14 @@ namespace Jimara {
 				/// <param name="buffer"> Command buffer </param>
 				virtual void ExecuteCommandBuffer(PrimaryCommandBuffer* buffer) override;
 
+				/// <summary>
+				/// Submits raw command buffers to the queue (synchronized with ExecuteCommandBuffer() calls)
+				/// </summary>
+				/// <param name="submitInfo"> Submit info </param>
+				/// <param name="fence"> Fence to signal (optional) </param>
+				/// <returns> vkQueueSubmit result </returns>
+				VkResult Submit(const VkSubmitInfo& submitInfo, VkFence fence = VK_NULL_HANDLE);
+
 
 			private:
 				// Device handle
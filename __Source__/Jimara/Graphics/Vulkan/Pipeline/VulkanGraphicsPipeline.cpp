@@ -1,5 +1,6 @@
 #include "VulkanGraphicsPipeline.h"
 #include "VulkanShader.h"
+#include "VulkanPipelineCache.h"
 
 #pragma warning(disable: 26812)
 
@@ -7,11 +8,112 @@ namespace Jimara {
 	namespace Graphics {
 		namespace Vulkan {
 			namespace {
-				inline static VkPipeline CreateVulkanPipeline(GraphicsPipeline::Descriptor* descriptor, VulkanRenderPass* renderPass, VkPipelineLayout layout) {
+				inline static void CollectVertexInput(GraphicsPipeline::Descriptor* descriptor, VulkanRenderPass* renderPass
+					, std::vector<VkVertexInputBindingDescription>& vertexInputBindingDescriptions
+					, std::vector<VkVertexInputAttributeDescription>& vertexInputAttributeDescriptions) {
+					vertexInputBindingDescriptions.clear();
+					vertexInputAttributeDescriptions.clear();
+					
+					auto addVertexBuffer = [&](Reference<const VertexBuffer> vertexBuffer, VkVertexInputRate inputRate) {
+						VkVertexInputBindingDescription bindingDescription = {};
+						{	
+							bindingDescription.binding = static_cast<uint32_t>(vertexInputBindingDescriptions.size());
+							bindingDescription.stride = static_cast<uint32_t>(vertexBuffer->BufferElemSize());
+							bindingDescription.inputRate = inputRate;
+							vertexInputBindingDescriptions.push_back(bindingDescription);
+						}
+
+						const size_t attributeCount = vertexBuffer->AttributeCount();
+						for (size_t i = 0; i < attributeCount; i++) {
+							VertexBuffer::AttributeInfo attribute = vertexBuffer->Attribute(i);
+							VkVertexInputAttributeDescription attributeDescription = {};
+							attributeDescription.location = attribute.location;
+							attributeDescription.binding = bindingDescription.binding;
+
+							if (attribute.type >= VertexBuffer::AttributeInfo::Type::TYPE_COUNT) {
+								renderPass->Device()->Log()->Fatal("VulkanGraphicsPipeline - A vertex attribute with incorrect format provided");
+								continue;
+							}
+							static const VkFormat* BINDING_TYPE_TO_FORMAT = []() -> VkFormat* {
+								const uint8_t BINDING_TYPE_COUNT = static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::TYPE_COUNT);
+								static VkFormat bindingTypeToFormats[BINDING_TYPE_COUNT];
+								for (size_t i = 0; i < BINDING_TYPE_COUNT; i++) bindingTypeToFormats[i] = VK_FORMAT_MAX_ENUM;
+
+								bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::FLOAT)] = VK_FORMAT_R32_SFLOAT;
+								bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::FLOAT2)] = VK_FORMAT_R32G32_SFLOAT;
+								bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::FLOAT3)] = VK_FORMAT_R32G32B32_SFLOAT;
+								bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::FLOAT4)] = VK_FORMAT_R32G32B32A32_SFLOAT;
+
+								bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::INT)] = VK_FORMAT_R32_SINT;
+								bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::INT2)] = VK_FORMAT_R32G32_SINT;
+								bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::INT3)] = VK_FORMAT_R32G32B32_SINT;
+								bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::INT4)] = VK_FORMAT_R32G32B32A32_SINT;
+
+								bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::UINT)] = VK_FORMAT_R32_UINT;
+								bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::UINT2)] = VK_FORMAT_R32G32_UINT;
+								bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::UINT3)] = VK_FORMAT_R32G32B32_UINT;
+								bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::UINT4)] = VK_FORMAT_R32G32B32A32_UINT;
+
+								bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::BOOL32)] = VK_FORMAT_R32_UINT;
+
+								return bindingTypeToFormats;
+							}();
+							attributeDescription.format = BINDING_TYPE_TO_FORMAT[static_cast<uint8_t>(attribute.type)];
+							
+							attributeDescription.offset = static_cast<uint32_t>(attribute.offset);
+
+							if (attributeDescription.format == VK_FORMAT_MAX_ENUM) {
+								size_t numAdditions = 0;
+								uint32_t offsetDelta = 0;
+								if (attribute.type == VertexBuffer::AttributeInfo::Type::MAT_2X2) {
+									attributeDescription.format = VK_FORMAT_R32G32_SFLOAT;
+									numAdditions = 2;
+									Matrix2 mat;
+									offsetDelta = static_cast<uint32_t>(((char*)(&mat[1])) - ((char*)(&mat)));
+								}
+								else if (attribute.type == VertexBuffer::AttributeInfo::Type::MAT_3X3) {
+									attributeDescription.format = VK_FORMAT_R32G32B32_SFLOAT;
+									numAdditions = 3;
+									Matrix3 mat;
+									offsetDelta = static_cast<uint32_t>(((char*)(&mat[1])) - ((char*)(&mat)));
+								}
+								else if (attribute.type == VertexBuffer::AttributeInfo::Type::MAT_4X4) {
+									attributeDescription.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+									numAdditions = 4;
+									Matrix4 mat;
+									offsetDelta = static_cast<uint32_t>(((char*)(&mat[1])) - ((char*)(&mat)));
+								}
+								else {
+									renderPass->Device()->Log()->Fatal("VulkanGraphicsPipeline - A vertex attribute with unknown format provided");
+									continue;
+								}
+								for (size_t i = 0; i < numAdditions; i++) {
+									vertexInputAttributeDescriptions.push_back(attributeDescription);
+									attributeDescription.offset += offsetDelta;
+									attributeDescription.location++;
+								}
+							}
+							else vertexInputAttributeDescriptions.push_back(attributeDescription);
+						}
+					};
+
+					const size_t vertexBufferCount = descriptor->VertexBufferCount();
+					for (size_t bindingId = 0; bindingId < vertexBufferCount; bindingId++)
+						addVertexBuffer(descriptor->VertexBuffer(bindingId), VK_VERTEX_INPUT_RATE_VERTEX);
+
+					const size_t instanceBufferCount = descriptor->InstanceBufferCount();
+					for (size_t bindingId = 0; bindingId < instanceBufferCount; bindingId++)
+						addVertexBuffer(descriptor->InstanceBuffer(bindingId), VK_VERTEX_INPUT_RATE_INSTANCE);
+				}
+
+				inline static VkPipeline CreateVulkanPipeline(
+					VulkanShader* vertexShader, VulkanShader* fragmentShader, VulkanRenderPass* renderPass, VkPipelineLayout layout
+					, const std::vector<VkVertexInputBindingDescription>& vertexInputBindingDescriptions
+					, const std::vector<VkVertexInputAttributeDescription>& vertexInputAttributeDescriptions
+					, GraphicsPipeline::DepthTest depthTest) {
 					// ShaderStageInfos:
 					VkPipelineShaderStageCreateInfo shaderStages[2] = { {}, {} };
 
-					Reference<VulkanShader> vertexShader = descriptor->VertexShader();
 					if (vertexShader != nullptr) {
 						VkPipelineShaderStageCreateInfo& vertShaderStageInfo = shaderStages[0];
 						vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -21,7 +123,6 @@ namespace Jimara {
 					}
 					else renderPass->Device()->Log()->Fatal("VulkanRenderPipeline - Can not create render pipeline without vulkan shader module for Vertex shader!");
 
-					Reference<VulkanShader> fragmentShader = descriptor->FragmentShader();
 					if (fragmentShader != nullptr) {
 						VkPipelineShaderStageCreateInfo& fragShaderStageInfo = shaderStages[1];
 						fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -33,103 +134,6 @@ namespace Jimara {
 
 
 					// Vertex input:
-					static thread_local std::vector<VkVertexInputBindingDescription> vertexInputBindingDescriptions;
-					static thread_local std::vector<VkVertexInputAttributeDescription> vertexInputAttributeDescriptions;
-					{
-						vertexInputBindingDescriptions.clear();
-						vertexInputAttributeDescriptions.clear();
-						
-						auto addVertexBuffer = [&](Reference<const VertexBuffer> vertexBuffer, VkVertexInputRate inputRate) {
-							VkVertexInputBindingDescription bindingDescription = {};
-							{	
-								bindingDescription.binding = static_cast<uint32_t>(vertexInputBindingDescriptions.size());
-								bindingDescription.stride = static_cast<uint32_t>(vertexBuffer->BufferElemSize());
-								bindingDescription.inputRate = inputRate;
-								vertexInputBindingDescriptions.push_back(bindingDescription);
-							}
-
-							const size_t attributeCount = vertexBuffer->AttributeCount();
-							for (size_t i = 0; i < attributeCount; i++) {
-								VertexBuffer::AttributeInfo attribute = vertexBuffer->Attribute(i);
-								VkVertexInputAttributeDescription attributeDescription = {};
-								attributeDescription.location = attribute.location;
-								attributeDescription.binding = bindingDescription.binding;
-
-								if (attribute.type >= VertexBuffer::AttributeInfo::Type::TYPE_COUNT) {
-									renderPass->Device()->Log()->Fatal("VulkanGraphicsPipeline - A vertex attribute with incorrect format provided");
-									continue;
-								}
-								static const VkFormat* BINDING_TYPE_TO_FORMAT = []() -> VkFormat* {
-									const uint8_t BINDING_TYPE_COUNT = static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::TYPE_COUNT);
-									static VkFormat bindingTypeToFormats[BINDING_TYPE_COUNT];
-									for (size_t i = 0; i < BINDING_TYPE_COUNT; i++) bindingTypeToFormats[i] = VK_FORMAT_MAX_ENUM;
-
-									bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::FLOAT)] = VK_FORMAT_R32_SFLOAT;
-									bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::FLOAT2)] = VK_FORMAT_R32G32_SFLOAT;
-									bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::FLOAT3)] = VK_FORMAT_R32G32B32_SFLOAT;
-									bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::FLOAT4)] = VK_FORMAT_R32G32B32A32_SFLOAT;
-
-									bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::INT)] = VK_FORMAT_R32_SINT;
-									bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::INT2)] = VK_FORMAT_R32G32_SINT;
-									bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::INT3)] = VK_FORMAT_R32G32B32_SINT;
-									bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::INT4)] = VK_FORMAT_R32G32B32A32_SINT;
-
-									bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::UINT)] = VK_FORMAT_R32_UINT;
-									bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::UINT2)] = VK_FORMAT_R32G32_UINT;
-									bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::UINT3)] = VK_FORMAT_R32G32B32_UINT;
-									bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::UINT4)] = VK_FORMAT_R32G32B32A32_UINT;
-
-									bindingTypeToFormats[static_cast<uint8_t>(VertexBuffer::AttributeInfo::Type::BOOL32)] = VK_FORMAT_R32_UINT;
-
-									return bindingTypeToFormats;
-								}();
-								attributeDescription.format = BINDING_TYPE_TO_FORMAT[static_cast<uint8_t>(attribute.type)];
-								
-								attributeDescription.offset = static_cast<uint32_t>(attribute.offset);
-
-								if (attributeDescription.format == VK_FORMAT_MAX_ENUM) {
-									size_t numAdditions = 0;
-									uint32_t offsetDelta = 0;
-									if (attribute.type == VertexBuffer::AttributeInfo::Type::MAT_2X2) {
-										attributeDescription.format = VK_FORMAT_R32G32_SFLOAT;
-										numAdditions = 2;
-										Matrix2 mat;
-										offsetDelta = static_cast<uint32_t>(((char*)(&mat[1])) - ((char*)(&mat)));
-									}
-									else if (attribute.type == VertexBuffer::AttributeInfo::Type::MAT_3X3) {
-										attributeDescription.format = VK_FORMAT_R32G32B32_SFLOAT;
-										numAdditions = 3;
-										Matrix3 mat;
-										offsetDelta = static_cast<uint32_t>(((char*)(&mat[1])) - ((char*)(&mat)));
-									}
-									else if (attribute.type == VertexBuffer::AttributeInfo::Type::MAT_4X4) {
-										attributeDescription.format = VK_FORMAT_R32G32B32A32_SFLOAT;
-										numAdditions = 4;
-										Matrix4 mat;
-										offsetDelta = static_cast<uint32_t>(((char*)(&mat[1])) - ((char*)(&mat)));
-									}
-									else {
-										renderPass->Device()->Log()->Fatal("VulkanGraphicsPipeline - A vertex attribute with unknown format provided");
-										continue;
-									}
-									for (size_t i = 0; i < numAdditions; i++) {
-										vertexInputAttributeDescriptions.push_back(attributeDescription);
-										attributeDescription.offset += offsetDelta;
-										attributeDescription.location++;
-									}
-								}
-								else vertexInputAttributeDescriptions.push_back(attributeDescription);
-							}
-						};
-
-						const size_t vertexBufferCount = descriptor->VertexBufferCount();
-						for (size_t bindingId = 0; bindingId < vertexBufferCount; bindingId++)
-							addVertexBuffer(descriptor->VertexBuffer(bindingId), VK_VERTEX_INPUT_RATE_VERTEX);
-
-						const size_t instanceBufferCount = descriptor->InstanceBufferCount();
-						for (size_t bindingId = 0; bindingId < instanceBufferCount; bindingId++)
-							addVertexBuffer(descriptor->InstanceBuffer(bindingId), VK_VERTEX_INPUT_RATE_INSTANCE);
-					}
 					VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
 					{
 						vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -198,9 +202,11 @@ namespace Jimara {
 					{
 						depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
 						depthStencil.depthTestEnable = VK_TRUE;
-						depthStencil.depthWriteEnable = VK_TRUE;
+						depthStencil.depthWriteEnable = (depthTest == GraphicsPipeline::DepthTest::EQUAL) ? VK_FALSE : VK_TRUE;
 
-						depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+						depthStencil.depthCompareOp =
+							(depthTest == GraphicsPipeline::DepthTest::EQUAL) ? VK_COMPARE_OP_EQUAL :
+							(depthTest == GraphicsPipeline::DepthTest::LESS_OR_EQUAL) ? VK_COMPARE_OP_LESS_OR_EQUAL : VK_COMPARE_OP_LESS;
 
 						depthStencil.depthBoundsTestEnable = VK_FALSE;
 						depthStencil.minDepthBounds = 0.0f; // Optional
@@ -225,13 +231,17 @@ namespace Jimara {
 						colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD; // Optional
 					}
 
+					// One blend state per color attachment (depth-only passes have none):
+					static thread_local std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments;
+					colorBlendAttachments.assign(renderPass->ColorAttachmentCount(), colorBlendAttachment);
+
 					VkPipelineColorBlendStateCreateInfo colorBlending = {};
 					{
 						colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
 						colorBlending.logicOpEnable = VK_FALSE;
 						colorBlending.logicOp = VK_LOGIC_OP_COPY; // Optional
-						colorBlending.attachmentCount = 1;
-						colorBlending.pAttachments = &colorBlendAttachment;
+						colorBlending.attachmentCount = static_cast<uint32_t>(colorBlendAttachments.size());
+						colorBlending.pAttachments = colorBlendAttachments.data();
 						colorBlending.blendConstants[0] = 0.0f; // Optional
 						colorBlending.blendConstants[1] = 0.0f; // Optional
 						colorBlending.blendConstants[2] = 0.0f; // Optional
@@ -273,8 +283,9 @@ namespace Jimara {
 						pipelineInfo.basePipelineIndex = -1; // Optional
 					}
 
+					VulkanDevice* device = dynamic_cast<VulkanDevice*>(renderPass->Device());
 					VkPipeline graphicsPipeline;
-					if (vkCreateGraphicsPipelines(*dynamic_cast<VulkanDevice*>(renderPass->Device()), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+					if (vkCreateGraphicsPipelines(*device, *device->PipelineCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
 						renderPass->Device()->Log()->Fatal("VulkanGraphicsPipeline - Failed to create graphics pipeline!");
 						return VK_NULL_HANDLE;
 					}
@@ -284,109 +295,151 @@ namespace Jimara {
 
 			VulkanGraphicsPipeline::VulkanGraphicsPipeline(GraphicsPipeline::Descriptor* descriptor, VulkanRenderPass* renderPass, size_t maxInFlightCommandBuffers)
 				: VulkanPipeline(dynamic_cast<VulkanDevice*>(renderPass->Device()), descriptor, maxInFlightCommandBuffers), m_descriptor(descriptor), m_renderPass(renderPass)
-				, m_graphicsPipeline(VK_NULL_HANDLE) {
-				m_graphicsPipeline = CreateVulkanPipeline(m_descriptor, m_renderPass, PipelineLayout());
+				, m_recordedBindings(maxInFlightCommandBuffers) {
+				const Reference<VulkanShader> vertexShader = m_descriptor->VertexShader();
+				const Reference<VulkanShader> fragmentShader = m_descriptor->FragmentShader();
+				const DepthTest depthTest = m_descriptor->DepthTestMode();
+
+				static thread_local std::vector<VkVertexInputBindingDescription> vertexInputBindingDescriptions;
+				static thread_local std::vector<VkVertexInputAttributeDescription> vertexInputAttributeDescriptions;
+				CollectVertexInput(m_descriptor, m_renderPass, vertexInputBindingDescriptions, vertexInputAttributeDescriptions);
+
+				// Everything that ends up baked into the VkPipeline (pipelines with matching keys share the native object):
+				VulkanPipelineStateKey key;
+				{
+					key.Push(m_renderPass.operator->()).Push(PipelineLayout())
+						.Push(vertexShader.operator->()).Push(fragmentShader.operator->())
+						.Push(static_cast<uint64_t>(depthTest))
+						.Push(static_cast<uint64_t>(vertexInputBindingDescriptions.size()));
+					for (size_t i = 0; i < vertexInputBindingDescriptions.size(); i++) {
+						const VkVertexInputBindingDescription& binding = vertexInputBindingDescriptions[i];
+						key.Push((static_cast<uint64_t>(binding.stride) << 32) | static_cast<uint64_t>(binding.inputRate));
+					}
+					for (size_t i = 0; i < vertexInputAttributeDescriptions.size(); i++) {
+						const VkVertexInputAttributeDescription& attribute = vertexInputAttributeDescriptions[i];
+						key.Push((static_cast<uint64_t>(attribute.location) << 32) | static_cast<uint64_t>(attribute.binding))
+							.Push((static_cast<uint64_t>(attribute.format) << 32) | static_cast<uint64_t>(attribute.offset));
+					}
+				}
+
+				const std::vector<Reference<Object>> dependencies = { Reference<Object>(m_renderPass), PipelineLayoutObject(), vertexShader, fragmentShader };
+				m_graphicsPipeline = Device()->PipelineObjectCache()->GetPipeline(key, dependencies, [&]() -> VkPipeline {
+					return CreateVulkanPipeline(vertexShader, fragmentShader, m_renderPass, PipelineLayout(), vertexInputBindingDescriptions, vertexInputAttributeDescriptions, depthTest);
+					});
 			}
 
 			VulkanGraphicsPipeline::~VulkanGraphicsPipeline() {
-				if (m_graphicsPipeline != VK_NULL_HANDLE) {
-					vkDestroyPipeline(*dynamic_cast<VulkanDevice*>(m_renderPass->Device()), m_graphicsPipeline, nullptr);
-					m_graphicsPipeline = VK_NULL_HANDLE;
-				}
+				m_graphicsPipeline = nullptr;
 			}
 
 			void VulkanGraphicsPipeline::Execute(const CommandBufferInfo& bufferInfo) {
 				VulkanCommandBuffer* commandBuffer = dynamic_cast<VulkanCommandBuffer*>(bufferInfo.commandBuffer);
-				if (commandBuffer == nullptr) m_renderPass->Device()->Log()->Fatal("VulkanGraphicsPipeline::Execute - Incompatible command buffer!");
+				if (commandBuffer == nullptr) {
+					m_renderPass->Device()->Log()->Fatal("VulkanGraphicsPipeline::Execute - Incompatible command buffer!");
+					return;
+				}
 
 				PipelineDescriptor::ReadLock descriptorReadLock(m_descriptor);
 
-				const uint32_t INDEX_COUNT = static_cast<uint32_t>(m_descriptor->IndexCount());
+				// Update index and vertex buffer bindings:
+				DrawBindings& bindings = m_recordedBindings[bufferInfo.inFlightBufferId];
+				UpdateBindings(commandBuffer, bindings);
+
+				// No rendering is necessary if there are no indices or instances to speak of:
+				if (!bindings.Drawable()) return;
+
+				// Execute the pipeline:
+				{
+					vkCmdBindPipeline(*commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, *m_graphicsPipeline);
+
+					UpdateDescriptors(bufferInfo);
+					BindDescriptors(bufferInfo, VK_PIPELINE_BIND_POINT_GRAPHICS);
+
+					if (bindings.vertexBuffers.size() > 0) {
+						static thread_local std::vector<VkDeviceSize> vertexBindingOffsets;
+						if (vertexBindingOffsets.size() < bindings.vertexBuffers.size())
+							vertexBindingOffsets.resize(bindings.vertexBuffers.size(), 0);
+						vkCmdBindVertexBuffers(*commandBuffer, 0, static_cast<uint32_t>(bindings.vertexBuffers.size()), bindings.vertexBuffers.data(), vertexBindingOffsets.data());
+					}
+
+					vkCmdBindIndexBuffer(*commandBuffer, bindings.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+					vkCmdDrawIndexed(*commandBuffer, bindings.indexCount, bindings.instanceCount, 0, 0, 0);
+				}
+				commandBuffer->RecordBufferDependency(this);
+			}
+
+			bool VulkanGraphicsPipeline::Refresh(const CommandBufferInfo& bufferInfo) {
+				VulkanCommandBuffer* commandBuffer = dynamic_cast<VulkanCommandBuffer*>(bufferInfo.commandBuffer);
+				if (commandBuffer == nullptr) {
+					m_renderPass->Device()->Log()->Fatal("VulkanGraphicsPipeline::Refresh - Incompatible command buffer!");
+					return false;
+				}
+
+				PipelineDescriptor::ReadLock descriptorReadLock(m_descriptor);
+
+				static thread_local DrawBindings bindings;
+				UpdateBindings(commandBuffer, bindings);
+
+				// If nothing was drawn, the recorded commands stay valid for as long as there's still nothing to draw:
+				const DrawBindings& recordedBindings = m_recordedBindings[bufferInfo.inFlightBufferId];
+				if (!recordedBindings.Drawable()) return (!bindings.Drawable());
+				else if (!(bindings == recordedBindings)) return false;
+
+				if (!RefreshDescriptors(bufferInfo)) return false;
+				commandBuffer->RecordBufferDependency(this);
+				return true;
+			}
+
+			void VulkanGraphicsPipeline::UpdateBindings(VulkanCommandBuffer* commandBuffer, DrawBindings& bindings) {
+				bindings.indexBuffer = VK_NULL_HANDLE;
+				bindings.vertexBuffers.clear();
+				bindings.indexCount = static_cast<uint32_t>(m_descriptor->IndexCount());
+				bindings.instanceCount = 0;
 
 				// Update index buffer binding:
-				if (INDEX_COUNT > 0) {
+				if (bindings.indexCount > 0) {
 					Reference<VulkanArrayBuffer> indexBuffer = m_descriptor->IndexBuffer();
 					if (indexBuffer != nullptr) {
 						m_indexBuffer = indexBuffer->GetStaticHandle(commandBuffer);
 						if (m_indexBuffer == indexBuffer) commandBuffer->RecordBufferDependency(indexBuffer);
 					}
-					else if (m_indexBuffer == nullptr || m_indexBuffer->ObjectCount() < INDEX_COUNT) {
-						ArrayBufferReference<uint32_t> buffer = ((GraphicsDevice*)m_renderPass->Device())->CreateArrayBuffer<uint32_t>(INDEX_COUNT);
+					else if (m_indexBuffer == nullptr || m_indexBuffer->ObjectCount() < bindings.indexCount) {
+						ArrayBufferReference<uint32_t> buffer = ((GraphicsDevice*)m_renderPass->Device())->CreateArrayBuffer<uint32_t>(bindings.indexCount);
 						{
 							uint32_t* indices = buffer.Map();
-							for (uint32_t i = 0; i < INDEX_COUNT; i++)
+							for (uint32_t i = 0; i < bindings.indexCount; i++)
 								indices[i] = i;
 							buffer->Unmap(true);
 						}
 						m_indexBuffer = (dynamic_cast<VulkanArrayBuffer*>(buffer.operator->()))->GetStaticHandle(commandBuffer);
 					}
 					else commandBuffer->RecordBufferDependency(m_indexBuffer);
+					bindings.indexBuffer = *m_indexBuffer;
 				}
 				else return;
 
-
-				// No rendering is necessary if there are no instances to speak of:
-				const uint32_t INSTANCE_COUNT = static_cast<uint32_t>(m_descriptor->InstanceCount());
-				if (INSTANCE_COUNT <= 0) return;
-
-				static thread_local std::vector<VulkanStaticBuffer*> vertexBuffers;
-				static thread_local std::vector<VkBuffer> vertexBindings;
-				static thread_local std::vector<VkDeviceSize> vertexBindingOffsets;
-
-				const uint32_t VERTEX_BUFFER_COUNT = static_cast<uint32_t>(m_descriptor->VertexBufferCount());
-				const uint32_t INSTANCE_BUFFER_COUNT = static_cast<uint32_t>(m_descriptor->InstanceBufferCount());
-				const uint32_t VERTEX_BINDING_COUNT = VERTEX_BUFFER_COUNT + VERTEX_BUFFER_COUNT;
+				bindings.instanceCount = static_cast<uint32_t>(m_descriptor->InstanceCount());
+				if (bindings.instanceCount <= 0) return;
 
 				// Update vertex bindings:
-				if (VERTEX_BINDING_COUNT > 0) {
-
-					if (vertexBuffers.size() < VERTEX_BINDING_COUNT) {
-						vertexBuffers.resize(VERTEX_BINDING_COUNT, nullptr);
-						vertexBindings.resize(VERTEX_BINDING_COUNT, VK_NULL_HANDLE);
-						vertexBindingOffsets.resize(VERTEX_BINDING_COUNT, 0);
+				auto addBuffer = [&](Reference<VulkanArrayBuffer> buffer) {
+					if (buffer != nullptr) {
+						VulkanStaticBuffer* reference = buffer->GetStaticHandle(commandBuffer);
+						if (reference == buffer) commandBuffer->RecordBufferDependency(buffer);
+						bindings.vertexBuffers.push_back(*reference);
 					}
-
-					size_t index = 0;
-					auto addBuffer = [&](Reference<VulkanArrayBuffer> buffer) {
-						VulkanStaticBuffer*& reference = vertexBuffers[index];
-						if (buffer != nullptr) {
-							reference = buffer->GetStaticHandle(commandBuffer);
-							if (reference == buffer) commandBuffer->RecordBufferDependency(buffer);
-							vertexBindings[index] = *reference;
-						}
-						else {
-							reference = nullptr;
-							vertexBindings[index] = VK_NULL_HANDLE;
-						}
-						index++;
-					};
-
-					// Vertex buffers:
-					for (size_t bindingId = 0; bindingId < VERTEX_BUFFER_COUNT; bindingId++)
-						addBuffer(m_descriptor->VertexBuffer(bindingId)->Buffer());
-
-					// Instance buffers:
-					for (size_t bindingId = 0; bindingId < INSTANCE_BUFFER_COUNT; bindingId++)
-						addBuffer(m_descriptor->InstanceBuffer(bindingId)->Buffer());
-
-					// Bind buffers
-					vkCmdBindVertexBuffers(*commandBuffer, 0, VERTEX_BINDING_COUNT, vertexBindings.data(), vertexBindingOffsets.data());
-				}
-				
-				// Execute the pipeline:
-				{
-					vkCmdBindPipeline(*commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
-
-					UpdateDescriptors(bufferInfo);
-					BindDescriptors(bufferInfo, VK_PIPELINE_BIND_POINT_GRAPHICS);
-
-					if (VERTEX_BINDING_COUNT > 0)
-						vkCmdBindVertexBuffers(*commandBuffer, 0, VERTEX_BINDING_COUNT, vertexBindings.data(), vertexBindingOffsets.data());
-
-					vkCmdBindIndexBuffer(*commandBuffer, *m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-					vkCmdDrawIndexed(*commandBuffer, INDEX_COUNT, INSTANCE_COUNT, 0, 0, 0);
-				}
-				commandBuffer->RecordBufferDependency(this);
+					else bindings.vertexBuffers.push_back(VK_NULL_HANDLE);
+				};
+
+				// Vertex buffers:
+				const size_t vertexBufferCount = m_descriptor->VertexBufferCount();
+				for (size_t bindingId = 0; bindingId < vertexBufferCount; bindingId++)
+					addBuffer(m_descriptor->VertexBuffer(bindingId)->Buffer());
+
+				// Instance buffers:
+				const size_t instanceBufferCount = m_descriptor->InstanceBufferCount();
+				for (size_t bindingId = 0; bindingId < instanceBufferCount; bindingId++)
+					addBuffer(m_descriptor->InstanceBuffer(bindingId)->Buffer());
 			}
 		}
 	}
@@ -31,6 +31,13 @@ namespace Jimara {
 				/// <param name="bufferInfo"> Command buffer, alongside it's index </param>
 				virtual void Execute(const CommandBufferInfo& bufferInfo) override;
 
+				/// <summary>
+				/// Refreshes buffers and descriptors, used by the commands, previously recorded with Execute() for the same in-flight buffer
+				/// </summary>
+				/// <param name="bufferInfo"> Command buffer (receives dependencies only), alongside it's index </param>
+				/// <returns> True, if the previously recorded commands are still valid </returns>
+				virtual bool Refresh(const CommandBufferInfo& bufferInfo) override;
+
 			private:
 				// Pipeline descriptor
 				const Reference<GraphicsPipeline::Descriptor> m_descriptor;
@@ -38,11 +45,44 @@ namespace Jimara {
 				// Render pass
 				const Reference<VulkanRenderPass> m_renderPass;
 
-				// Vulkan API object
-				VkPipeline m_graphicsPipeline;
+				// Vulkan API object (shared with the pipelines that have the same shaders, vertex input, layout and render pass)
+				Reference<VulkanPipelineObjectCache::PipelineObject> m_graphicsPipeline;
 
 				// Index buffer (can be internally instantiated as a substitude, so we keep a reference)
 				Reference<VulkanStaticBuffer> m_indexBuffer;
+
+				// Buffers and counts, the draw commands are recorded with
+				struct DrawBindings {
+					// Index buffer
+					VkBuffer indexBuffer;
+
+					// Vertex and instance buffers
+					std::vector<VkBuffer> vertexBuffers;
+
+					// Number of indices
+					uint32_t indexCount;
+
+					// Number of instances
+					uint32_t instanceCount;
+
+					// Constructor
+					inline DrawBindings() : indexBuffer(VK_NULL_HANDLE), indexCount(0), instanceCount(0) {}
+
+					// True, if there is anything to draw
+					inline bool Drawable()const { return (indexCount > 0) && (instanceCount > 0); }
+
+					// Comparator
+					inline bool operator==(const DrawBindings& other)const {
+						return (indexBuffer == other.indexBuffer) && (indexCount == other.indexCount) 
+							&& (instanceCount == other.instanceCount) && (vertexBuffers == other.vertexBuffers);
+					}
+				};
+
+				// Bindings from the last Execute() call per in-flight command buffer
+				std::vector<DrawBindings> m_recordedBindings;
+
+				// Retrieves current buffers and counts from the descriptor (and uploads pending data, if there is any)
+				void UpdateBindings(VulkanCommandBuffer* commandBuffer, DrawBindings& bindings);
 			};
 		}
 	}
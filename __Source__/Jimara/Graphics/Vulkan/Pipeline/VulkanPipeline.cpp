@@ -5,78 +5,12 @@ namespace Jimara {
 	namespace Graphics {
 		namespace Vulkan {
 			namespace {
-				inline static std::vector<VkDescriptorSetLayout> CreateDescriptorSetLayouts(VulkanDevice* device, const PipelineDescriptor* descriptor) {
-					std::vector<VkDescriptorSetLayout> layouts;
-					const size_t setCount = descriptor->BindingSetCount();
-					for (size_t setIndex = 0; setIndex < setCount; setIndex++) {
-						const PipelineDescriptor::BindingSetDescriptor* setDescriptor = descriptor->BindingSet(setIndex);
-
-						static thread_local std::vector<VkDescriptorSetLayoutBinding> bindings;
-						bindings.clear();
-
-						auto addBinding = [](const PipelineDescriptor::BindingSetDescriptor::BindingInfo info, VkDescriptorType type) {
-							VkDescriptorSetLayoutBinding binding = {};
-							binding.binding = info.binding;
-							binding.descriptorType = type;
-							binding.descriptorCount = 1;
-							binding.stageFlags = 
-								(((info.stages & StageMask(PipelineStage::COMPUTE)) != 0) ? VK_SHADER_STAGE_COMPUTE_BIT : 0) |
-								(((info.stages & StageMask(PipelineStage::VERTEX)) != 0) ? VK_SHADER_STAGE_VERTEX_BIT : 0) |
-								(((info.stages & StageMask(PipelineStage::FRAGMENT)) != 0) ? VK_SHADER_STAGE_FRAGMENT_BIT : 0);
-							binding.pImmutableSamplers = nullptr;
-							bindings.push_back(binding);
-						};
-
-						{
-							const size_t count = setDescriptor->ConstantBufferCount();
-							for (size_t i = 0; i < count; i++)
-								addBinding(setDescriptor->ConstantBufferInfo(i), VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-						}
-						{
-							const size_t count = setDescriptor->StructuredBufferCount();
-							for (size_t i = 0; i < count; i++)
-								addBinding(setDescriptor->StructuredBufferInfo(i), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
-						}
-						{
-							const size_t count = setDescriptor->TextureSamplerCount();
-							for (size_t i = 0; i < count; i++)
-								addBinding(setDescriptor->TextureSamplerInfo(i), VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-						}
-
-						VkDescriptorSetLayoutCreateInfo layoutInfo = {};
-						{
-							layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-							layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-							layoutInfo.pBindings = bindings.data();
-						}
-						VkDescriptorSetLayout layout;
-						if (vkCreateDescriptorSetLayout(*device, &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
-							device->Log()->Fatal("VulkanPipeline - Failed to create descriptor set layout!");
-							layout = VK_NULL_HANDLE;
-						}
-						layouts.push_back(layout);
-					}
-					return layouts;
-				}
-
-				inline static VkPipelineLayout CreateVulkanPipelineLayout(VulkanDevice* device, const std::vector<VkDescriptorSetLayout>& setLayouts) {
-					VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-					{
-						pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-						pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
-						pipelineLayoutInfo.pSetLayouts = (setLayouts.size() > 0) ? setLayouts.data() : nullptr;
-						pipelineLayoutInfo.pushConstantRangeCount = 0;
-					}
-					VkPipelineLayout pipelineLayout;
-					if (vkCreatePipelineLayout(*device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
-						device->Log()->Fatal("VulkanPipeline - Failed to create pipeline layout!");
-						return VK_NULL_HANDLE;
-					}
-					return pipelineLayout;
+				inline static bool IsBindlessSet(const PipelineDescriptor::BindingSetDescriptor* setDescriptor, VulkanBindlessSet* bindlessSet) {
+					return (bindlessSet != nullptr) && (!setDescriptor->SetByEnvironment()) && setDescriptor->IsBindlessSet();
 				}
 
-
-				inline static VkDescriptorPool CreateDescriptorPool(VulkanDevice* device, const PipelineDescriptor* descriptor, size_t maxInFlightCommandBuffers) {
+				inline static VkDescriptorPool CreateDescriptorPool(
+					VulkanDevice* device, const PipelineDescriptor* descriptor, size_t maxInFlightCommandBuffers, VulkanBindlessSet* bindlessSet) {
 					VkDescriptorPoolSize sizes[3];
 
 					uint32_t sizeCount = 0;
@@ -87,7 +21,7 @@ namespace Jimara {
 					const size_t setCount = descriptor->BindingSetCount();
 					for (size_t setIndex = 0; setIndex < setCount; setIndex++) {
 						const PipelineDescriptor::BindingSetDescriptor* setDescriptor = descriptor->BindingSet(setIndex);
-						if (setDescriptor->SetByEnvironment()) continue;
+						if (setDescriptor->SetByEnvironment() || IsBindlessSet(setDescriptor, bindlessSet)) continue;
 
 						constantBufferCount += static_cast<uint32_t>(setDescriptor->ConstantBufferCount());
 						structuredBufferCount += static_cast<uint32_t>(setDescriptor->StructuredBufferCount());
@@ -133,7 +67,7 @@ namespace Jimara {
 
 				inline static std::vector<VkDescriptorSet> CreateDescriptorSets(
 					VulkanDevice* device, PipelineDescriptor* descriptor, size_t maxInFlightCommandBuffers
-					, VkDescriptorPool pool, const std::vector<VkDescriptorSetLayout>& setLayouts) {
+					, VkDescriptorPool pool, const std::vector<VkDescriptorSetLayout>& setLayouts, VulkanBindlessSet* bindlessSet) {
 
 					static thread_local std::vector<VkDescriptorSetLayout> layouts;
 
@@ -143,7 +77,7 @@ namespace Jimara {
 
 					uint32_t setCountPerCommandBuffer = 0;
 					for (size_t i = 0; i < setLayouts.size(); i++)
-						if (!descriptor->BindingSet(i)->SetByEnvironment()) {
+						if (!(descriptor->BindingSet(i)->SetByEnvironment() || IsBindlessSet(descriptor->BindingSet(i), bindlessSet))) {
 							layouts[setCountPerCommandBuffer] = setLayouts[i];
 							setCountPerCommandBuffer++;
 						}
@@ -170,43 +104,46 @@ namespace Jimara {
 					}
 					return sets;
 				}
-
-
-				inline static void PrepareCache(const PipelineDescriptor* descriptor, size_t maxInFlightCommandBuffers
-					, std::vector<Reference<VulkanPipelineConstantBuffer>>& constantBuffers
-					, std::vector<Reference<VulkanStaticBuffer>>& structuredBuffers
-					, std::vector<Reference<VulkanStaticImageSampler>>& samplerRefs) {
-					
-					size_t constantBufferCount = 0;
-					size_t structuredBufferCount = 0;
-					size_t textureSamplerCount = 0;
-					
-					const size_t setCount = descriptor->BindingSetCount();
-					for (size_t setIndex = 0; setIndex < setCount; setIndex++) {
-						const PipelineDescriptor::BindingSetDescriptor* setDescriptor = descriptor->BindingSet(setIndex);
-						if (setDescriptor->SetByEnvironment()) continue;
-						constantBufferCount += setDescriptor->ConstantBufferCount();
-						structuredBufferCount += setDescriptor->StructuredBufferCount();
-						textureSamplerCount += setDescriptor->TextureSamplerCount();
-					}
-
-					constantBuffers.resize(constantBufferCount);
-					structuredBuffers.resize(structuredBufferCount * maxInFlightCommandBuffers);
-					samplerRefs.resize(textureSamplerCount * maxInFlightCommandBuffers);
-				}
 			}
 
 			VulkanPipeline::VulkanPipeline(VulkanDevice* device, PipelineDescriptor* descriptor, size_t maxInFlightCommandBuffers)
 				: m_device(device), m_descriptor(descriptor), m_commandBufferCount(maxInFlightCommandBuffers)
-				, m_descriptorPool(VK_NULL_HANDLE), m_pipelineLayout(VK_NULL_HANDLE) {
+				, m_descriptorPool(VK_NULL_HANDLE)
+				, m_descriptorRevision(1), m_boundDescriptorRevisions(maxInFlightCommandBuffers, 0) {
 				
-				m_descriptorSetLayouts = CreateDescriptorSetLayouts(m_device, m_descriptor);
-				m_pipelineLayout = CreateVulkanPipelineLayout(m_device, m_descriptorSetLayouts);
+				{
+					VulkanBindlessSet* bindlessSet = dynamic_cast<VulkanBindlessSet*>(m_device->BindlessResources());
+					const size_t setCount = m_descriptor->BindingSetCount();
+					for (size_t setIndex = 0; setIndex < setCount; setIndex++)
+						if (IsBindlessSet(m_descriptor->BindingSet(setIndex), bindlessSet)) {
+							m_bindlessSet = bindlessSet;
+							break;
+						}
+				}
 
-				m_descriptorPool = CreateDescriptorPool(m_device, m_descriptor, m_commandBufferCount);
-				m_descriptorSets = CreateDescriptorSets(m_device, m_descriptor, m_commandBufferCount, m_descriptorPool, m_descriptorSetLayouts);
+				m_pipelineLayout = m_device->PipelineObjectCache()->GetPipelineLayout(m_descriptor, (m_bindlessSet != nullptr) ? m_bindlessSet->SetLayout() : nullptr);
 
-				PrepareCache(m_descriptor, m_commandBufferCount, m_descriptorCache.constantBuffers, m_descriptorCache.structuredBuffers, m_descriptorCache.samplers);
+				m_descriptorPool = CreateDescriptorPool(m_device, m_descriptor, m_commandBufferCount, m_bindlessSet);
+				m_descriptorSets = CreateDescriptorSets(m_device, m_descriptor, m_commandBufferCount, m_descriptorPool, m_pipelineLayout->SetLayouts(), m_bindlessSet);
+
+				{
+					const size_t setCount = m_descriptor->BindingSetCount();
+					for (size_t setIndex = 0; setIndex < setCount; setIndex++) {
+						const PipelineDescriptor::BindingSetDescriptor* setDescriptor = m_descriptor->BindingSet(setIndex);
+						if (setDescriptor->SetByEnvironment() || IsBindlessSet(setDescriptor, m_bindlessSet)) continue;
+						BindingSetState state;
+						state.setIndex = setIndex;
+						state.layout = m_pipelineLayout->SetLayout(setIndex);
+						state.constantBuffers.resize(setDescriptor->ConstantBufferCount());
+						state.structuredBuffers.resize(setDescriptor->StructuredBufferCount());
+						state.samplers.resize(setDescriptor->TextureSamplerCount());
+						state.boundStructuredBuffers.resize(state.structuredBuffers.size() * m_commandBufferCount);
+						state.boundSamplers.resize(state.samplers.size() * m_commandBufferCount);
+						state.descriptorInfos.resize(state.layout->BindingCount() * m_commandBufferCount);
+						state.dirty.resize(m_commandBufferCount, true);
+						m_bindingSets.push_back(std::move(state));
+					}
+				}
 
 				m_bindingRanges.resize(m_commandBufferCount);
 				if (m_commandBufferCount > 0) {
@@ -228,6 +165,11 @@ namespace Jimara {
 							}
 							shouldStartNew = false;
 						}
+						if (IsBindlessSet(setDescriptor, m_bindlessSet)) {
+							for (size_t buffer = 0; buffer < m_commandBufferCount; buffer++)
+								m_bindingRanges[buffer].back().sets.push_back(m_bindlessSet->DescriptorSet(buffer));
+							continue;
+						}
 						for (size_t buffer = 0; buffer < m_commandBufferCount; buffer++)
 							m_bindingRanges[buffer].back().sets.push_back(m_descriptorSets[(setsPerCommandBuffer * buffer) + setId]);
 						setId++;
@@ -237,17 +179,11 @@ namespace Jimara {
 
 			VulkanPipeline::~VulkanPipeline() {
 				m_bindingRanges.clear();
-				if (m_pipelineLayout != VK_NULL_HANDLE) {
-					vkDestroyPipelineLayout(*m_device, m_pipelineLayout, nullptr);
-					m_pipelineLayout = VK_NULL_HANDLE;
-				}
 				if (m_descriptorPool != VK_NULL_HANDLE) {
 					vkDestroyDescriptorPool(*m_device, m_descriptorPool, nullptr);
 					m_descriptorPool = VK_NULL_HANDLE;
 				}
-				for (size_t i = 0; i < m_descriptorSetLayouts.size(); i++)
-					vkDestroyDescriptorSetLayout(*m_device, m_descriptorSetLayouts[i], nullptr);
-				m_descriptorSetLayouts.clear();
+				m_pipelineLayout = nullptr;
 			}
 
 			VulkanDevice* VulkanPipeline::Device()const {
@@ -255,7 +191,11 @@ namespace Jimara {
 			}
 
 			VkPipelineLayout VulkanPipeline::PipelineLayout()const { 
-				return m_pipelineLayout; 
+				return *m_pipelineLayout; 
+			}
+
+			VulkanPipelineObjectCache::PipelineLayout* VulkanPipeline::PipelineLayoutObject()const {
+				return m_pipelineLayout;
 			}
 
 			PipelineDescriptor* VulkanPipeline::Descriptor()const {
@@ -263,145 +203,115 @@ namespace Jimara {
 			}
 
 			void VulkanPipeline::UpdateDescriptors(const CommandBufferInfo& bufferInfo) {
-				static thread_local std::vector<VkWriteDescriptorSet> updates;
-
-				static thread_local std::vector<VkDescriptorBufferInfo> bufferInfos;
-				if (bufferInfos.size() < m_descriptorCache.constantBuffers.size() * m_commandBufferCount)
-					bufferInfos.resize(m_descriptorCache.constantBuffers.size() * m_commandBufferCount);
-
-				static thread_local std::vector<VkDescriptorBufferInfo> structuredBufferInfos;
-				if (structuredBufferInfos.size() < m_descriptorCache.structuredBuffers.size())
-					structuredBufferInfos.resize(m_descriptorCache.structuredBuffers.size());
-
-				static thread_local std::vector<VkDescriptorImageInfo> samplerInfos;
-				if (samplerInfos.size() < m_descriptorCache.samplers.size())
-					samplerInfos.resize(m_descriptorCache.samplers.size());
+				if (m_commandBufferCount <= 0) return;
+				const size_t commandBufferIndex = bufferInfo.inFlightBufferId;
+				const size_t setsPerCommandBuffer = (m_descriptorSets.size() / m_commandBufferCount);
+				VulkanCommandBuffer* commandBuffer = dynamic_cast<VulkanCommandBuffer*>(bufferInfo.commandBuffer);
+				bool descriptorsWritten = false;
 
-				if(m_commandBufferCount > 0) {
-					const size_t commandBufferIndex = bufferInfo.inFlightBufferId;
-					const size_t setsPerCommandBuffer = (m_descriptorSets.size() / m_commandBufferCount);
+				// Bindless set is update-after-bind, so refreshing it never invalidates the recorded bindings (only the copy for commandBufferIndex gets rewritten):
+				if (m_bindlessSet != nullptr) {
+					m_bindlessSet->Update(commandBuffer, commandBufferIndex);
+					commandBuffer->RecordBufferDependency(m_bindlessSet);
+				}
 
-					VulkanCommandBuffer* commandBuffer = dynamic_cast<VulkanCommandBuffer*>(bufferInfo.commandBuffer);
+				for (size_t setId = 0; setId < m_bindingSets.size(); setId++) {
+					BindingSetState& state = m_bindingSets[setId];
+					const PipelineDescriptor::BindingSetDescriptor* setDescriptor = m_descriptor->BindingSet(state.setIndex);
 
-					size_t constantBufferId = 0;
-					auto addConstantBuffers = [&](const PipelineDescriptor::BindingSetDescriptor* setDescriptor, size_t setIndex) {
-						const size_t cbufferCount = setDescriptor->ConstantBufferCount();
-						for (size_t cbufferId = 0; cbufferId < cbufferCount; cbufferId++) {
-							Reference<VulkanConstantBuffer> buffer = setDescriptor->ConstantBuffer(cbufferId);
-							Reference<VulkanPipelineConstantBuffer>& pipelineBuffer = m_descriptorCache.constantBuffers[constantBufferId];
-							
+					// Query resources only if the descriptor does not track it's revision or the revision has changed:
+					const size_t revision = setDescriptor->Revision();
+					if (revision == 0 || revision != state.revision) {
+						for (size_t i = 0; i < state.constantBuffers.size(); i++) {
+							Reference<VulkanConstantBuffer> buffer = setDescriptor->ConstantBuffer(i);
+							Reference<VulkanPipelineConstantBuffer>& pipelineBuffer = state.constantBuffers[i];
 							if (pipelineBuffer == nullptr || pipelineBuffer->TargetBuffer() != buffer) {
 								pipelineBuffer = (buffer == nullptr) ? nullptr : Object::Instantiate<VulkanPipelineConstantBuffer>(m_device, buffer, m_commandBufferCount);
-
-								uint32_t binding = setDescriptor->ConstantBufferInfo(cbufferId).binding;
-								for (size_t i = 0; i < m_commandBufferCount; i++) {
-									VkDescriptorBufferInfo& bufferInfo = bufferInfos[(i * m_descriptorCache.constantBuffers.size()) + constantBufferId];
-									bufferInfo = {};
-									std::pair<VkBuffer, VkDeviceSize> bufferAndOffset = (pipelineBuffer != nullptr)
-										? pipelineBuffer->GetBuffer(i) : std::pair<VkBuffer, VkDeviceSize>(VK_NULL_HANDLE, 0);
-									bufferInfo.buffer = bufferAndOffset.first;
-									bufferInfo.offset = bufferAndOffset.second;
-									bufferInfo.range = buffer->ObjectSize();
-
-									VkWriteDescriptorSet write = {};
-									write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-									write.dstSet = m_descriptorSets[(setsPerCommandBuffer * i) + setIndex];
-									write.dstBinding = binding;
-									write.dstArrayElement = 0;
-									write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-									write.descriptorCount = 1;
-									write.pBufferInfo = &bufferInfo;
-
-									updates.push_back(write);
-								}
+								for (size_t j = 0; j < m_commandBufferCount; j++) state.dirty[j] = true;
 							}
-							else pipelineBuffer->GetBuffer(commandBufferIndex);
-
-							if (pipelineBuffer != nullptr) commandBuffer->RecordBufferDependency(pipelineBuffer);
-
-							constantBufferId++;
 						}
-					};
+						for (size_t i = 0; i < state.structuredBuffers.size(); i++)
+							state.structuredBuffers[i] = setDescriptor->StructuredBuffer(i);
+						for (size_t i = 0; i < state.samplers.size(); i++)
+							state.samplers[i] = setDescriptor->Sampler(i);
+						state.revision = revision;
+					}
 
-					size_t structuredBufferId = commandBufferIndex;
-					auto addStructuredBuffers = [&](const PipelineDescriptor::BindingSetDescriptor* setDescriptor, VkDescriptorSet set) {
-						const size_t structuredBufferCount = setDescriptor->StructuredBufferCount();
-						for (size_t bufferId = 0; bufferId < structuredBufferCount; bufferId++) {
-							Reference<VulkanArrayBuffer> buffer = setDescriptor->StructuredBuffer(bufferId);
+					// Refresh static handles (these may have to upload data, so we can not skip them):
+					bool dirty = state.dirty[commandBufferIndex];
+					{
+						Reference<VulkanStaticBuffer>* boundBuffers = state.boundStructuredBuffers.data() + (state.structuredBuffers.size() * commandBufferIndex);
+						for (size_t i = 0; i < state.structuredBuffers.size(); i++) {
+							VulkanArrayBuffer* buffer = state.structuredBuffers[i];
 							Reference<VulkanStaticBuffer> staticBuffer = (buffer != nullptr) ? buffer->GetStaticHandle(commandBuffer) : nullptr;
-							Reference<VulkanStaticBuffer>& cachedBuffer = m_descriptorCache.structuredBuffers[structuredBufferId];
-							if (cachedBuffer != staticBuffer) {
-								cachedBuffer = staticBuffer;
-
-								VkDescriptorBufferInfo& bufferInfo = structuredBufferInfos[structuredBufferId];
-								bufferInfo = {};
-								bufferInfo.buffer = (staticBuffer == nullptr) ? VK_NULL_HANDLE : ((VkBuffer)(*staticBuffer));
-								bufferInfo.offset = 0;
-								bufferInfo.range = VK_WHOLE_SIZE;
-
-								VkWriteDescriptorSet write = {};
-								write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-								write.dstSet = set;
-								write.dstBinding = setDescriptor->StructuredBufferInfo(bufferId).binding;
-								write.dstArrayElement = 0;
-								write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-								write.descriptorCount = 1;
-								write.pBufferInfo = &bufferInfo;
-
-								updates.push_back(write);
+							if (boundBuffers[i] != staticBuffer) {
+								boundBuffers[i] = staticBuffer;
+								dirty = true;
 							}
-							structuredBufferId += m_commandBufferCount;
 						}
-					};
-
-					size_t samplerCacheIndex = commandBufferIndex;
-					auto addSamplers = [&](const PipelineDescriptor::BindingSetDescriptor* setDescriptor, VkDescriptorSet set) {
-						const size_t samplerCount = setDescriptor->TextureSamplerCount();
-						for (size_t samplerId = 0; samplerId < samplerCount; samplerId++) {
-							Reference<VulkanImageSampler> sampler = setDescriptor->Sampler(samplerId);
+					}
+					{
+						Reference<VulkanStaticImageSampler>* boundSamplers = state.boundSamplers.data() + (state.samplers.size() * commandBufferIndex);
+						for (size_t i = 0; i < state.samplers.size(); i++) {
+							VulkanImageSampler* sampler = state.samplers[i];
 							Reference<VulkanStaticImageSampler> staticSampler = (sampler != nullptr) ? sampler->GetStaticHandle(commandBuffer) : nullptr;
-							Reference<VulkanStaticImageSampler>& cachedSampler = m_descriptorCache.samplers[samplerCacheIndex];
-							if (cachedSampler != staticSampler) {
-								cachedSampler = staticSampler;
-
-								VkDescriptorImageInfo& samplerInfo = samplerInfos[samplerCacheIndex];
-								samplerInfo = {};
-								samplerInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-								samplerInfo.imageView = *dynamic_cast<VulkanStaticImageView*>(cachedSampler->TargetView());
-								samplerInfo.sampler = *cachedSampler;
-
-								VkWriteDescriptorSet write = {};
-								write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-								write.dstSet = set;
-								write.dstBinding = setDescriptor->TextureSamplerInfo(samplerId).binding;
-								write.dstArrayElement = 0;
-								write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-								write.descriptorCount = 1;
-								write.pImageInfo = &samplerInfo;
-
-								updates.push_back(write);
+							if (boundSamplers[i] != staticSampler) {
+								boundSamplers[i] = staticSampler;
+								dirty = true;
 							}
-							samplerCacheIndex += m_commandBufferCount;
 						}
-					};
+					}
 
-					VkDescriptorSet* sets = m_descriptorSets.data() + (setsPerCommandBuffer * commandBufferIndex);
-					const size_t setCount = m_descriptor->BindingSetCount();
-					size_t setIndex = 0;
-					for (size_t i = 0; i < setCount; i++) {
-						const PipelineDescriptor::BindingSetDescriptor* setDescriptor = m_descriptor->BindingSet(i);
-						if (setDescriptor->SetByEnvironment()) continue;
-						VkDescriptorSet set = sets[setIndex];
-						addConstantBuffers(setDescriptor, setIndex);
-						addStructuredBuffers(setDescriptor, set);
-						addSamplers(setDescriptor, set);
-						setIndex++;
+					// Constant buffers have to be refreshed regardless:
+					VulkanPipelineObjectCache::DescriptorInfo* infos = state.descriptorInfos.data() + (state.layout->BindingCount() * commandBufferIndex);
+					for (size_t i = 0; i < state.constantBuffers.size(); i++) {
+						VulkanPipelineConstantBuffer* pipelineBuffer = state.constantBuffers[i];
+						if (pipelineBuffer == nullptr) continue;
+						std::pair<VkBuffer, VkDeviceSize> bufferAndOffset = pipelineBuffer->GetBuffer(commandBufferIndex);
+						commandBuffer->RecordBufferDependency(pipelineBuffer);
+						if (dirty) {
+							VkDescriptorBufferInfo& info = infos[i].buffer;
+							info = {};
+							info.buffer = bufferAndOffset.first;
+							info.offset = bufferAndOffset.second;
+							info.range = pipelineBuffer->TargetBuffer()->ObjectSize();
+						}
 					}
+
+					if (!dirty) continue;
+
+					// Fill the rest of the template data and update the set (binding order is defined by VulkanPipelineObjectCache::GetPipelineLayout):
+					{
+						VulkanPipelineObjectCache::DescriptorInfo* structuredInfos = infos + state.constantBuffers.size();
+						const Reference<VulkanStaticBuffer>* boundBuffers = state.boundStructuredBuffers.data() + (state.structuredBuffers.size() * commandBufferIndex);
+						for (size_t i = 0; i < state.structuredBuffers.size(); i++) {
+							VkDescriptorBufferInfo& info = structuredInfos[i].buffer;
+							info = {};
+							info.buffer = (boundBuffers[i] == nullptr) ? VK_NULL_HANDLE : ((VkBuffer)(*boundBuffers[i]));
+							info.offset = 0;
+							info.range = VK_WHOLE_SIZE;
+						}
+					}
+					{
+						VulkanPipelineObjectCache::DescriptorInfo* samplerInfos = infos + state.constantBuffers.size() + state.structuredBuffers.size();
+						const Reference<VulkanStaticImageSampler>* boundSamplers = state.boundSamplers.data() + (state.samplers.size() * commandBufferIndex);
+						for (size_t i = 0; i < state.samplers.size(); i++) {
+							VkDescriptorImageInfo& info = samplerInfos[i].image;
+							info = {};
+							info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+							if (boundSamplers[i] == nullptr) continue;
+							info.imageView = *dynamic_cast<VulkanStaticImageView*>(boundSamplers[i]->TargetView());
+							info.sampler = *boundSamplers[i];
+						}
+					}
+					if (state.layout->UpdateTemplate() != VK_NULL_HANDLE) {
+						vkUpdateDescriptorSetWithTemplate(*m_device, m_descriptorSets[(setsPerCommandBuffer * commandBufferIndex) + setId], state.layout->UpdateTemplate(), infos);
+						descriptorsWritten = true;
+					}
+					state.dirty[commandBufferIndex] = false;
 				}
-				if (updates.size() > 0) {
-					vkUpdateDescriptorSets(*m_device, static_cast<uint32_t>(updates.size()), updates.data(), 0, nullptr);
-					updates.clear();
-				}
+
+				if (descriptorsWritten) m_descriptorRevision++;
 			}
 
 			void VulkanPipeline::BindDescriptors(const CommandBufferInfo& bufferInfo, VkPipelineBindPoint bindPoint) {
@@ -411,8 +321,14 @@ namespace Jimara {
 
 				for (size_t i = 0; i < ranges.size(); i++) {
 					const DescriptorBindingRange& range = ranges[i];
-					vkCmdBindDescriptorSets(commandBuffer, bindPoint, m_pipelineLayout, range.start, static_cast<uint32_t>(range.sets.size()), range.sets.data(), 0, nullptr);
+					vkCmdBindDescriptorSets(commandBuffer, bindPoint, *m_pipelineLayout, range.start, static_cast<uint32_t>(range.sets.size()), range.sets.data(), 0, nullptr);
 				}
+				m_boundDescriptorRevisions[bufferInfo.inFlightBufferId] = m_descriptorRevision;
+			}
+
+			bool VulkanPipeline::RefreshDescriptors(const CommandBufferInfo& bufferInfo) {
+				UpdateDescriptors(bufferInfo);
+				return (m_boundDescriptorRevisions[bufferInfo.inFlightBufferId] == m_descriptorRevision);
 			}
 
 
@@ -432,6 +348,17 @@ namespace Jimara {
 					BindDescriptors(bufferInfo, m_bindPoints[i]);
 				commandBuffer->RecordBufferDependency(this);
 			}
+
+			bool VulkanEnvironmentPipeline::Refresh(const CommandBufferInfo& bufferInfo) {
+				VulkanCommandBuffer* commandBuffer = dynamic_cast<VulkanCommandBuffer*>(bufferInfo.commandBuffer);
+				if (commandBuffer == nullptr) {
+					Device()->Log()->Fatal("VulkanEnvironmentPipeline::Refresh - Unsupported command buffer!");
+					return false;
+				}
+				PipelineDescriptor::ReadLock descriptorReadLock(Descriptor());
+				commandBuffer->RecordBufferDependency(this);
+				return RefreshDescriptors(bufferInfo);
+			}
 		}
 	}
 }
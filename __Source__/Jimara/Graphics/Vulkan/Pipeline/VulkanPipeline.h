@@ -8,6 +8,8 @@ namespace Jimara {
 }
 #include "../VulkanDevice.h"
 #include "../Pipeline/VulkanCommandPool.h"
+#include "../Pipeline/VulkanPipelineObjectCache.h"
+#include "../Pipeline/VulkanBindlessSet.h"
 #include "../Memory/Buffers/VulkanConstantBuffer.h"
 #include "../Memory/Buffers/VulkanStaticBuffer.h"
 #include "../Memory/TextureSamplers/VulkanTextureSampler.h"
@@ -40,6 +42,9 @@ namespace Jimara {
 				/// <summary> Pipeline layout </summary>
 				VkPipelineLayout PipelineLayout()const;
 
+				/// <summary> Shared pipeline layout object </summary>
+				VulkanPipelineObjectCache::PipelineLayout* PipelineLayoutObject()const;
+
 				/// <summary> Input descriptor </summary>
 				PipelineDescriptor* Descriptor()const;
 
@@ -56,6 +61,13 @@ namespace Jimara {
 				/// <param name="bindPoint"> Bind point </param>
 				void BindDescriptors(const CommandBufferInfo& bufferInfor, VkPipelineBindPoint bindPoint);
 
+				/// <summary>
+				/// Refreshes descriptor buffer references and content without binding anything
+				/// </summary>
+				/// <param name="bufferInfo"> Buffer information (command buffer receives dependencies only) </param>
+				/// <returns> True, if the descriptor sets, bound by the last BindDescriptors() call with the same inFlightBufferId did not have to be rewritten </returns>
+				bool RefreshDescriptors(const CommandBufferInfo& bufferInfo);
+
 
 			private:
 				// "Owner" device
@@ -67,26 +79,58 @@ namespace Jimara {
 				// Number of in-flight command buffers
 				const size_t m_commandBufferCount;
 
-				// Descriptor set layouts
-				std::vector<VkDescriptorSetLayout> m_descriptorSetLayouts;
+				// Bindless resource set (nullptr, if none of the binding sets is bindless)
+				Reference<VulkanBindlessSet> m_bindlessSet;
 
-				// Pipeline layout
-				VkPipelineLayout m_pipelineLayout;
+				// Pipeline layout (shared with all pipelines with the same binding set shapes)
+				Reference<VulkanPipelineObjectCache::PipelineLayout> m_pipelineLayout;
 				
 				// Descriptor pool
 				VkDescriptorPool m_descriptorPool;
 
 				// Descriptor sets 
-				// (indices 0 to {however many internally set (SetByEnvironment() == false) layouts there are} correspond to the sets for the first command buffer;
+				// (indices 0 to {however many internally set (SetByEnvironment() == false, not bindless) layouts there are} correspond to the sets for the first command buffer;
 				// Same number of following sets are for second command buffer and so on)
 				std::vector<VkDescriptorSet> m_descriptorSets;
 				
-				// Cached attachments from last UpdateDescriptors() call (cache misses result in descriptor set writes)
-				struct {
+				// Cached attachments of an internally set (SetByEnvironment() == false) binding set (cache misses result in descriptor set writes)
+				struct BindingSetState {
+					// Binding set index within the descriptor
+					size_t setIndex;
+
+					// Descriptor set layout (provides the update template)
+					Reference<VulkanPipelineObjectCache::DescriptorSetLayout> layout;
+
+					// BindingSetDescriptor::Revision() during the last resource query
+					size_t revision;
+
+					// Constant buffers (each covers all in-flight command buffers)
 					std::vector<Reference<VulkanPipelineConstantBuffer>> constantBuffers;
-					std::vector<Reference<VulkanStaticBuffer>> structuredBuffers;
-					std::vector<Reference<VulkanStaticImageSampler>> samplers;
-				} m_descriptorCache;
+
+					// Structured buffers, as returned by the binding set descriptor
+					std::vector<Reference<VulkanArrayBuffer>> structuredBuffers;
+
+					// Texture samplers, as returned by the binding set descriptor
+					std::vector<Reference<VulkanImageSampler>> samplers;
+
+					// Static buffers, the descriptor sets were written with (structuredBuffers.size() entries per in-flight command buffer)
+					std::vector<Reference<VulkanStaticBuffer>> boundStructuredBuffers;
+
+					// Static samplers, the descriptor sets were written with (samplers.size() entries per in-flight command buffer)
+					std::vector<Reference<VulkanStaticImageSampler>> boundSamplers;
+
+					// Update template data (layout->BindingCount() entries per in-flight command buffer)
+					std::vector<VulkanPipelineObjectCache::DescriptorInfo> descriptorInfos;
+
+					// Per in-flight command buffer flag, telling that the descriptor set has to be rewritten
+					std::vector<bool> dirty;
+
+					// Constructor
+					inline BindingSetState() : setIndex(0), revision(0) {}
+				};
+
+				// Per-set attachment cache
+				std::vector<BindingSetState> m_bindingSets;
 
 				// Grouped descriptors to set togather
 				struct DescriptorBindingRange {
@@ -98,6 +142,12 @@ namespace Jimara {
 
 				// Grouped descriptors to set togather
 				std::vector<std::vector<DescriptorBindingRange>> m_bindingRanges;
+
+				// Incremented each time UpdateDescriptors() writes to the descriptor sets
+				size_t m_descriptorRevision;
+
+				// Value of m_descriptorRevision during the last BindDescriptors() call per in-flight command buffer
+				std::vector<size_t> m_boundDescriptorRevisions;
 			};
 
 
@@ -123,6 +173,13 @@ namespace Jimara {
 				/// <param name="bufferInfo"> Command buffer information </param>
 				virtual void Execute(const CommandBufferInfo& bufferInfo) override;
 
+				/// <summary>
+				/// Refreshes the environment without binding anything
+				/// </summary>
+				/// <param name="bufferInfo"> Command buffer information </param>
+				/// <returns> True, if the descriptors bound by the previous Execute() call with the same inFlightBufferId are still valid </returns>
+				virtual bool Refresh(const CommandBufferInfo& bufferInfo) override;
+
 			private:
 				// Pipeline bind points
 				const std::vector<VkPipelineBindPoint> m_bindPoints;
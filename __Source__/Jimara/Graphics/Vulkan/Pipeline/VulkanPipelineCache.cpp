@@ -0,0 +1,222 @@
+#include "VulkanPipelineCache.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <atomic>
+#include <random>
+#include <cstring>
+
+
+#pragma warning(disable: 26812)
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			namespace {
+				// Cache file header (stored in front of the data, returned by vkGetPipelineCacheData)
+				struct CacheFileHeader {
+					uint32_t magic;
+					uint32_t version;
+					uint32_t vendorID;
+					uint32_t deviceID;
+					uint32_t driverVersion;
+					uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+					uint64_t dataSize;
+					uint64_t checksum;
+				};
+
+				static const uint32_t CACHE_FILE_MAGIC = 0x434C504A; // "JPLC"
+				static const uint32_t CACHE_FILE_VERSION = 1;
+
+				inline static uint64_t Checksum(const char* data, size_t size) {
+					// FNV-1a:
+					uint64_t hash = 14695981039346656037ull;
+					for (size_t i = 0; i < size; i++) {
+						hash ^= static_cast<uint8_t>(data[i]);
+						hash *= 1099511628211ull;
+					}
+					return hash;
+				}
+
+				inline static CacheFileHeader MakeHeader(const VkPhysicalDeviceProperties& properties, const char* data, size_t size) {
+					CacheFileHeader header = {};
+					header.magic = CACHE_FILE_MAGIC;
+					header.version = CACHE_FILE_VERSION;
+					header.vendorID = properties.vendorID;
+					header.deviceID = properties.deviceID;
+					header.driverVersion = properties.driverVersion;
+					memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+					header.dataSize = static_cast<uint64_t>(size);
+					header.checksum = Checksum(data, size);
+					return header;
+				}
+
+				inline static std::vector<char> LoadFile(const std::string& filename) {
+					std::ifstream file(filename, std::ios::ate | std::ios::binary);
+					if (!file.is_open())
+						return std::vector<char>();
+					size_t fileSize = (size_t)file.tellg();
+					std::vector<char> content(fileSize);
+					file.seekg(0);
+					file.read(content.data(), fileSize);
+					file.close();
+					return content;
+				}
+
+				// Returns pointer to the valid VkPipelineCache data within the file content (nullptr if the content is not compatible with the device)
+				inline static const char* ValidateCacheData(const std::vector<char>& content, const VkPhysicalDeviceProperties& properties, size_t& dataSize, OS::Logger* logger) {
+					auto invalid = [&](const char* reason) -> const char* {
+						logger->Warning(std::string("VulkanPipelineCache - Ignoring cache file (") + reason + ")");
+						dataSize = 0;
+						return nullptr;
+					};
+
+					// Our own header:
+					if (content.size() < sizeof(CacheFileHeader)) return invalid("file too small");
+					CacheFileHeader header;
+					memcpy(&header, content.data(), sizeof(CacheFileHeader));
+					if (header.magic != CACHE_FILE_MAGIC || header.version != CACHE_FILE_VERSION) return invalid("unknown format");
+					if (header.vendorID != properties.vendorID || header.deviceID != properties.deviceID) return invalid("different device");
+					if (header.driverVersion != properties.driverVersion) return invalid("different driver version");
+					if (memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) return invalid("pipeline cache UUID mismatch");
+					if (header.dataSize != (content.size() - sizeof(CacheFileHeader))) return invalid("size mismatch");
+					const char* data = content.data() + sizeof(CacheFileHeader);
+					if (header.checksum != Checksum(data, static_cast<size_t>(header.dataSize))) return invalid("checksum mismatch");
+
+					// Vulkan's own header (VkPipelineCacheHeaderVersionOne layout; drivers should validate this too, but some of them crash instead):
+					static const size_t VULKAN_HEADER_SIZE = 16 + VK_UUID_SIZE;
+					if (header.dataSize < VULKAN_HEADER_SIZE) return invalid("no pipeline cache header");
+					uint32_t headerLength, headerVersion, vendorID, deviceID;
+					memcpy(&headerLength, data, sizeof(uint32_t));
+					memcpy(&headerVersion, data + 4, sizeof(uint32_t));
+					memcpy(&vendorID, data + 8, sizeof(uint32_t));
+					memcpy(&deviceID, data + 12, sizeof(uint32_t));
+					if (headerLength < VULKAN_HEADER_SIZE || headerLength > header.dataSize
+						|| headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+						|| vendorID != properties.vendorID || deviceID != properties.deviceID
+						|| memcmp(data + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) return invalid("pipeline cache header mismatch");
+
+					dataSize = static_cast<size_t>(header.dataSize);
+					return data;
+				}
+			}
+
+			VulkanPipelineCache::VulkanPipelineCache(VkDeviceHandle* device, const std::string& filename)
+				: m_device(device), m_filename(filename), m_cache(VK_NULL_HANDLE), m_loadedFromFile(false) {
+				const VkPhysicalDeviceProperties& properties = m_device->PhysicalDevice()->DeviceProperties();
+
+				const std::vector<char> content = (m_filename.size() > 0) ? LoadFile(m_filename) : std::vector<char>();
+				size_t dataSize = 0;
+				const char* data = (content.size() > 0) ? ValidateCacheData(content, properties, dataSize, m_device->Log()) : nullptr;
+
+				VkPipelineCacheCreateInfo createInfo = {};
+				createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+				createInfo.initialDataSize = dataSize;
+				createInfo.pInitialData = data;
+				if (vkCreatePipelineCache(*m_device, &createInfo, nullptr, &m_cache) == VK_SUCCESS)
+					m_loadedFromFile = (data != nullptr);
+				else if (data != nullptr) {
+					m_device->Log()->Warning("VulkanPipelineCache - Failed to create pipeline cache from file data; starting with an empty one...");
+					createInfo.initialDataSize = 0;
+					createInfo.pInitialData = nullptr;
+					if (vkCreatePipelineCache(*m_device, &createInfo, nullptr, &m_cache) != VK_SUCCESS) m_cache = VK_NULL_HANDLE;
+				}
+				else m_cache = VK_NULL_HANDLE;
+
+				if (m_cache == VK_NULL_HANDLE)
+					m_device->Log()->Error("VulkanPipelineCache - Failed to create pipeline cache!");
+			}
+
+			VulkanPipelineCache::~VulkanPipelineCache() {
+				if (m_cache != VK_NULL_HANDLE) {
+					Save();
+					vkDestroyPipelineCache(*m_device, m_cache, nullptr);
+					m_cache = VK_NULL_HANDLE;
+				}
+			}
+
+			VulkanPipelineCache::operator VkPipelineCache()const { return m_cache; }
+
+			const std::string& VulkanPipelineCache::Filename()const { return m_filename; }
+
+			bool VulkanPipelineCache::LoadedFromFile()const { return m_loadedFromFile; }
+
+			bool VulkanPipelineCache::Save()const {
+				if (m_cache == VK_NULL_HANDLE || m_filename.size() <= 0) return false;
+				std::unique_lock<std::mutex> lock(m_saveLock);
+
+				std::vector<char> content;
+				{
+					size_t dataSize = 0;
+					if (vkGetPipelineCacheData(*m_device, m_cache, &dataSize, nullptr) != VK_SUCCESS) {
+						m_device->Log()->Warning("VulkanPipelineCache::Save - Failed to get pipeline cache data size!");
+						return false;
+					}
+					content.resize(sizeof(CacheFileHeader) + dataSize);
+					VkResult result = vkGetPipelineCacheData(*m_device, m_cache, &dataSize, content.data() + sizeof(CacheFileHeader));
+					if (result != VK_SUCCESS && result != VK_INCOMPLETE) {
+						m_device->Log()->Warning("VulkanPipelineCache::Save - Failed to get pipeline cache data!");
+						return false;
+					}
+					content.resize(sizeof(CacheFileHeader) + dataSize);
+					const CacheFileHeader header = MakeHeader(m_device->PhysicalDevice()->DeviceProperties(), content.data() + sizeof(CacheFileHeader), dataSize);
+					memcpy(content.data(), &header, sizeof(CacheFileHeader));
+				}
+
+				std::error_code error;
+				const std::filesystem::path path(m_filename);
+				if (path.has_parent_path()) {
+					std::filesystem::create_directories(path.parent_path(), error);
+					if (error) {
+						m_device->Log()->Warning("VulkanPipelineCache::Save - Failed to create directory \"" + path.parent_path().string() + "\"!");
+						return false;
+					}
+				}
+
+				// Write to a temporary file first, so that a crash mid-way does not leave a half-written cache behind
+				// (the name is unique per save, so that devices sharing the cache file never write to the same temporary file):
+				const std::string tmpFilename = [&]() {
+					static std::atomic<uint64_t> saveCounter(0);
+					static const uint64_t processToken = std::random_device()();
+					std::stringstream stream;
+					stream << m_filename << "." << std::hex << processToken << "_" << (saveCounter++) << ".tmp";
+					return stream.str();
+				}();
+				{
+					std::ofstream file(tmpFilename, std::ios::binary | std::ios::trunc);
+					if (!file.is_open()) {
+						m_device->Log()->Warning("VulkanPipelineCache::Save - Failed to open \"" + tmpFilename + "\" for writing!");
+						return false;
+					}
+					file.write(content.data(), content.size());
+					file.flush();
+					if (!file.good()) {
+						m_device->Log()->Warning("VulkanPipelineCache::Save - Failed to write \"" + tmpFilename + "\"!");
+						file.close();
+						std::filesystem::remove(tmpFilename, error);
+						return false;
+					}
+				}
+
+				// Replacing rename (the old content stays in place till the new one takes over):
+				std::filesystem::rename(tmpFilename, path, error);
+				if (error) {
+					m_device->Log()->Warning("VulkanPipelineCache::Save - Failed to replace \"" + m_filename + "\" (" + error.message() + ")!");
+					std::filesystem::remove(tmpFilename, error);
+					return false;
+				}
+				return true;
+			}
+
+			std::string VulkanPipelineCache::DefaultFilename(const std::string& directory, VulkanPhysicalDevice* physicalDevice) {
+				if (directory.size() <= 0) return "";
+				const VkPhysicalDeviceProperties& properties = physicalDevice->DeviceProperties();
+				std::stringstream stream;
+				stream << "Jimara_VulkanPipelineCache_" << std::hex << std::setfill('0')
+					<< std::setw(4) << properties.vendorID << "_" << std::setw(4) << properties.deviceID << ".bin";
+				return (std::filesystem::path(directory) / stream.str()).string();
+			}
+		}
+	}
+}
+#pragma warning(default: 26812)
@@ -0,0 +1,77 @@
+#pragma once
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			class VulkanPipelineCache;
+		}
+	}
+}
+#include "../VulkanDevice.h"
+#include <mutex>
+
+
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			/// <summary>
+			/// Wrapper on top of VkPipelineCache, persisted on disk between runs.
+			/// Notes:
+			///		0. Cache file is tagged with vendor/device ids, driver version and pipeline cache UUID of the physical device;
+			///			if any of those mismatch on load (or the file is damaged), the cache starts empty and the file gets overwritten on save;
+			///		1. VkPipelineCache is internally synchronized, so the same cache can safely be used for concurrent pipeline creation;
+			///		2. Save() writes to a uniquely named temporary file and renames it over the cache file, so devices sharing the file never see a partially written one.
+			/// </summary>
+			class VulkanPipelineCache : public virtual Object {
+			public:
+				/// <summary>
+				/// Constructor
+				/// </summary>
+				/// <param name="device"> Device handle </param>
+				/// <param name="filename"> Cache file to load the initial data from and store the contents to (empty string means 'in-memory only') </param>
+				VulkanPipelineCache(VkDeviceHandle* device, const std::string& filename);
+
+				/// <summary> Virtual destructor (saves the cache) </summary>
+				virtual ~VulkanPipelineCache();
+
+				/// <summary> Type cast to API object </summary>
+				operator VkPipelineCache()const;
+
+				/// <summary> Cache file name </summary>
+				const std::string& Filename()const;
+
+				/// <summary> True, if the initial cache data was successfully loaded from the file </summary>
+				bool LoadedFromFile()const;
+
+				/// <summary>
+				/// Stores the current content of the cache to the file
+				/// </summary>
+				/// <returns> True, if the cache got saved successfully </returns>
+				bool Save()const;
+
+				/// <summary>
+				/// Default cache file name for the physical device
+				/// </summary>
+				/// <param name="directory"> Cache directory (Application::AppInformation::CacheDirectory(), for example; empty string disables the on-disk cache) </param>
+				/// <param name="physicalDevice"> Physical device </param>
+				/// <returns> Cache file path (empty, if the directory is empty) </returns>
+				static std::string DefaultFilename(const std::string& directory, VulkanPhysicalDevice* physicalDevice);
+
+			private:
+				// Device handle
+				const Reference<VkDeviceHandle> m_device;
+
+				// Cache file name
+				const std::string m_filename;
+
+				// Underlying API object
+				VkPipelineCache m_cache;
+
+				// True, if the initial data came from the file
+				bool m_loadedFromFile;
+
+				// Lock for Save() calls
+				mutable std::mutex m_saveLock;
+			};
+		}
+	}
+}
@@ -0,0 +1,218 @@
+#include "VulkanPipelineObjectCache.h"
+
+
+#pragma warning(disable: 26812)
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			namespace {
+				inline static VkDescriptorSetLayout CreateDescriptorSetLayout(VkDeviceHandle* device, const std::vector<VkDescriptorSetLayoutBinding>& bindings, bool updateAfterBind) {
+					static thread_local std::vector<VkDescriptorBindingFlags> bindingFlags;
+					bindingFlags.clear();
+					VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {};
+					if (updateAfterBind) {
+						bindingFlags.resize(bindings.size(),
+							VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT);
+						bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+						bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+						bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+					}
+
+					VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+					{
+						layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+						layoutInfo.pNext = updateAfterBind ? (&bindingFlagsInfo) : nullptr;
+						layoutInfo.flags = updateAfterBind ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT : 0;
+						layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+						layoutInfo.pBindings = bindings.data();
+					}
+					VkDescriptorSetLayout layout;
+					if (vkCreateDescriptorSetLayout(*device, &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+						device->Log()->Fatal("VulkanPipeline - Failed to create descriptor set layout!");
+						layout = VK_NULL_HANDLE;
+					}
+					return layout;
+				}
+
+				inline static VkDescriptorUpdateTemplate CreateUpdateTemplate(
+					VkDeviceHandle* device, VkDescriptorSetLayout layout, const std::vector<VkDescriptorSetLayoutBinding>& bindings) {
+					if (layout == VK_NULL_HANDLE || bindings.size() <= 0) return VK_NULL_HANDLE;
+
+					static thread_local std::vector<VkDescriptorUpdateTemplateEntry> entries;
+					entries.clear();
+					for (size_t i = 0; i < bindings.size(); i++) {
+						VkDescriptorUpdateTemplateEntry entry = {};
+						entry.dstBinding = bindings[i].binding;
+						entry.dstArrayElement = 0;
+						entry.descriptorCount = 1;
+						entry.descriptorType = bindings[i].descriptorType;
+						entry.offset = sizeof(VulkanPipelineObjectCache::DescriptorInfo) * i;
+						entry.stride = sizeof(VulkanPipelineObjectCache::DescriptorInfo);
+						entries.push_back(entry);
+					}
+
+					VkDescriptorUpdateTemplateCreateInfo createInfo = {};
+					{
+						createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+						createInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+						createInfo.pDescriptorUpdateEntries = entries.data();
+						createInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+						createInfo.descriptorSetLayout = layout;
+					}
+					VkDescriptorUpdateTemplate updateTemplate;
+					if (vkCreateDescriptorUpdateTemplate(*device, &createInfo, nullptr, &updateTemplate) != VK_SUCCESS) {
+						device->Log()->Fatal("VulkanPipeline - Failed to create descriptor update template!");
+						updateTemplate = VK_NULL_HANDLE;
+					}
+					return updateTemplate;
+				}
+
+				inline static VkPipelineLayout CreateVulkanPipelineLayout(VkDeviceHandle* device, const std::vector<VkDescriptorSetLayout>& setLayouts) {
+					VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+					{
+						pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+						pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+						pipelineLayoutInfo.pSetLayouts = (setLayouts.size() > 0) ? setLayouts.data() : nullptr;
+						pipelineLayoutInfo.pushConstantRangeCount = 0;
+					}
+					VkPipelineLayout pipelineLayout;
+					if (vkCreatePipelineLayout(*device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+						device->Log()->Fatal("VulkanPipeline - Failed to create pipeline layout!");
+						return VK_NULL_HANDLE;
+					}
+					return pipelineLayout;
+				}
+			}
+
+
+			VulkanPipelineObjectCache::DescriptorSetLayout::DescriptorSetLayout(VkDeviceHandle* device, const std::vector<VkDescriptorSetLayoutBinding>& bindings, bool updateAfterBind)
+				: m_device(device), m_bindingCount(bindings.size()), m_layout(VK_NULL_HANDLE), m_updateTemplate(VK_NULL_HANDLE) {
+				m_layout = CreateDescriptorSetLayout(m_device, bindings, updateAfterBind);
+				if (!updateAfterBind)
+					m_updateTemplate = CreateUpdateTemplate(m_device, m_layout, bindings);
+			}
+
+			VulkanPipelineObjectCache::DescriptorSetLayout::~DescriptorSetLayout() {
+				if (m_updateTemplate != VK_NULL_HANDLE) {
+					vkDestroyDescriptorUpdateTemplate(*m_device, m_updateTemplate, nullptr);
+					m_updateTemplate = VK_NULL_HANDLE;
+				}
+				if (m_layout != VK_NULL_HANDLE) {
+					vkDestroyDescriptorSetLayout(*m_device, m_layout, nullptr);
+					m_layout = VK_NULL_HANDLE;
+				}
+			}
+
+			VulkanPipelineObjectCache::DescriptorSetLayout::operator VkDescriptorSetLayout()const { return m_layout; }
+
+			size_t VulkanPipelineObjectCache::DescriptorSetLayout::BindingCount()const { return m_bindingCount; }
+
+			VkDescriptorUpdateTemplate VulkanPipelineObjectCache::DescriptorSetLayout::UpdateTemplate()const { return m_updateTemplate; }
+
+
+			VulkanPipelineObjectCache::PipelineLayout::PipelineLayout(VkDeviceHandle* device, const std::vector<Reference<DescriptorSetLayout>>& setLayouts)
+				: m_device(device), m_setLayoutObjects(setLayouts), m_layout(VK_NULL_HANDLE) {
+				for (size_t i = 0; i < m_setLayoutObjects.size(); i++)
+					m_setLayouts.push_back(*m_setLayoutObjects[i]);
+				m_layout = CreateVulkanPipelineLayout(m_device, m_setLayouts);
+			}
+
+			VulkanPipelineObjectCache::PipelineLayout::~PipelineLayout() {
+				if (m_layout != VK_NULL_HANDLE) {
+					vkDestroyPipelineLayout(*m_device, m_layout, nullptr);
+					m_layout = VK_NULL_HANDLE;
+				}
+			}
+
+			VulkanPipelineObjectCache::PipelineLayout::operator VkPipelineLayout()const { return m_layout; }
+
+			const std::vector<VkDescriptorSetLayout>& VulkanPipelineObjectCache::PipelineLayout::SetLayouts()const { return m_setLayouts; }
+
+			VulkanPipelineObjectCache::DescriptorSetLayout* VulkanPipelineObjectCache::PipelineLayout::SetLayout(size_t index)const { return m_setLayoutObjects[index]; }
+
+
+			VulkanPipelineObjectCache::PipelineObject::PipelineObject(VkDeviceHandle* device, VkPipeline pipeline, const std::vector<Reference<Object>>& dependencies)
+				: m_device(device), m_pipeline(pipeline), m_dependencies(dependencies) {}
+
+			VulkanPipelineObjectCache::PipelineObject::~PipelineObject() {
+				if (m_pipeline != VK_NULL_HANDLE)
+					vkDestroyPipeline(*m_device, m_pipeline, nullptr);
+			}
+
+			VulkanPipelineObjectCache::PipelineObject::operator VkPipeline()const { return m_pipeline; }
+
+
+			VulkanPipelineObjectCache::VulkanPipelineObjectCache(VkDeviceHandle* device)
+				: m_device(device)
+				, m_setLayouts(Object::Instantiate<Cache>())
+				, m_pipelineLayouts(Object::Instantiate<Cache>())
+				, m_pipelines(Object::Instantiate<Cache>()) {}
+
+			VulkanPipelineObjectCache::~VulkanPipelineObjectCache() {}
+
+			Reference<VulkanPipelineObjectCache::PipelineLayout> VulkanPipelineObjectCache::GetPipelineLayout(const PipelineDescriptor* descriptor, DescriptorSetLayout* bindlessSetLayout) {
+				std::vector<Reference<DescriptorSetLayout>> setLayouts;
+				VulkanPipelineStateKey layoutKey;
+
+				const size_t setCount = descriptor->BindingSetCount();
+				for (size_t setIndex = 0; setIndex < setCount; setIndex++) {
+					const PipelineDescriptor::BindingSetDescriptor* setDescriptor = descriptor->BindingSet(setIndex);
+
+					if ((!setDescriptor->SetByEnvironment()) && setDescriptor->IsBindlessSet()) {
+						if (bindlessSetLayout != nullptr) {
+							setLayouts.push_back(bindlessSetLayout);
+							layoutKey.Push(static_cast<const void*>(bindlessSetLayout));
+							continue;
+						}
+						else m_device->Log()->Error("VulkanPipelineObjectCache::GetPipelineLayout - Bindless resources not supported by the device; falling back to a regular set!");
+					}
+
+					static thread_local std::vector<VkDescriptorSetLayoutBinding> bindings;
+					bindings.clear();
+					VulkanPipelineStateKey setKey;
+
+					auto addBinding = [&](const PipelineDescriptor::BindingSetDescriptor::BindingInfo info, VkDescriptorType type) {
+						VkDescriptorSetLayoutBinding binding = {};
+						binding.binding = info.binding;
+						binding.descriptorType = type;
+						binding.descriptorCount = 1;
+						binding.stageFlags =
+							(((info.stages & StageMask(PipelineStage::COMPUTE)) != 0) ? VK_SHADER_STAGE_COMPUTE_BIT : 0) |
+							(((info.stages & StageMask(PipelineStage::VERTEX)) != 0) ? VK_SHADER_STAGE_VERTEX_BIT : 0) |
+							(((info.stages & StageMask(PipelineStage::FRAGMENT)) != 0) ? VK_SHADER_STAGE_FRAGMENT_BIT : 0);
+						binding.pImmutableSamplers = nullptr;
+						bindings.push_back(binding);
+						setKey.Push((static_cast<uint64_t>(binding.binding) << 32) | static_cast<uint64_t>(binding.descriptorType)).Push(static_cast<uint64_t>(binding.stageFlags));
+					};
+
+					{
+						const size_t count = setDescriptor->ConstantBufferCount();
+						for (size_t i = 0; i < count; i++)
+							addBinding(setDescriptor->ConstantBufferInfo(i), VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+					}
+					{
+						const size_t count = setDescriptor->StructuredBufferCount();
+						for (size_t i = 0; i < count; i++)
+							addBinding(setDescriptor->StructuredBufferInfo(i), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+					}
+					{
+						const size_t count = setDescriptor->TextureSamplerCount();
+						for (size_t i = 0; i < count; i++)
+							addBinding(setDescriptor->TextureSamplerInfo(i), VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+					}
+
+					Reference<DescriptorSetLayout> setLayout = m_setLayouts->Get(setKey, [&]() -> Reference<DescriptorSetLayout> {
+						return Object::Instantiate<DescriptorSetLayout>(m_device, bindings);
+						});
+					setLayouts.push_back(setLayout);
+					layoutKey.Push(setLayout.operator->());
+				}
+
+				return m_pipelineLayouts->Get(layoutKey, [&]() -> Reference<PipelineLayout> {
+					return Object::Instantiate<PipelineLayout>(m_device, setLayouts);
+					});
+			}
+		}
+	}
+}
+#pragma warning(default: 26812)
@@ -0,0 +1,256 @@
+#pragma once
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			class VulkanPipelineStateKey;
+			class VulkanPipelineObjectCache;
+		}
+	}
+}
+#include "../VulkanDevice.h"
+#include "../../Pipeline/Pipeline.h"
+#include "../../../Core/ObjectCache.h"
+
+
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			/// <summary>
+			/// Hashable description of the state, baked into a native pipeline object (pipeline, pipeline layout, descriptor set layout)
+			/// </summary>
+			class VulkanPipelineStateKey {
+			public:
+				/// <summary> Constructor </summary>
+				inline VulkanPipelineStateKey() : m_hash(0) {}
+
+				/// <summary>
+				/// Appends a value to the key
+				/// </summary>
+				/// <param name="value"> Value to append </param>
+				/// <returns> self </returns>
+				inline VulkanPipelineStateKey& Push(uint64_t value) {
+					m_words.push_back(value);
+					m_hash ^= (std::hash<uint64_t>()(value) + 0x9e3779b9 + (m_hash << 6) + (m_hash >> 2));
+					return (*this);
+				}
+
+				/// <summary>
+				/// Appends an object address to the key (caller is responsible for keeping the object alive while the key is in use)
+				/// </summary>
+				/// <param name="address"> Object address </param>
+				/// <returns> self </returns>
+				inline VulkanPipelineStateKey& Push(const void* address) { return Push(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(address))); }
+
+				/// <summary> Hash of the key </summary>
+				inline size_t Hash()const { return m_hash; }
+
+				/// <summary> Comparator </summary>
+				inline bool operator==(const VulkanPipelineStateKey& other)const { return (m_hash == other.m_hash) && (m_words == other.m_words); }
+
+			private:
+				// Key content
+				std::vector<uint64_t> m_words;
+
+				// Hash of m_words
+				size_t m_hash;
+			};
+		}
+	}
+}
+
+namespace std {
+	template<>
+	struct hash<Jimara::Graphics::Vulkan::VulkanPipelineStateKey> {
+		size_t operator()(const Jimara::Graphics::Vulkan::VulkanPipelineStateKey& key)const { return key.Hash(); }
+	};
+}
+
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			/// <summary>
+			/// Device-wide cache of native pipeline objects;
+			/// Lets any number of pipelines with the same shaders, vertex layouts, bindings and render pass share a single VkPipeline, VkPipelineLayout and VkDescriptorSetLayout-s.
+			/// </summary>
+			class VulkanPipelineObjectCache : public virtual Object {
+			public:
+				/// <summary>
+				/// Single entry of the data, DescriptorSetLayout::UpdateTemplate() reads from
+				/// </summary>
+				union DescriptorInfo {
+					/// <summary> Buffer info (constant and structured buffers) </summary>
+					VkDescriptorBufferInfo buffer;
+
+					/// <summary> Image info (texture samplers) </summary>
+					VkDescriptorImageInfo image;
+				};
+
+				/// <summary>
+				/// Shared VkDescriptorSetLayout
+				/// </summary>
+				class DescriptorSetLayout : public virtual ObjectCache<VulkanPipelineStateKey>::StoredObject {
+				public:
+					/// <summary>
+					/// Constructor
+					/// </summary>
+					/// <param name="device"> Device handle </param>
+					/// <param name="bindings"> Layout bindings </param>
+					/// <param name="updateAfterBind"> If true, the bindings will be partially bound and updatable after bind (used by bindless sets; no update template will be created) </param>
+					DescriptorSetLayout(VkDeviceHandle* device, const std::vector<VkDescriptorSetLayoutBinding>& bindings, bool updateAfterBind = false);
+
+					/// <summary> Virtual destructor </summary>
+					virtual ~DescriptorSetLayout();
+
+					/// <summary> Type cast to API object </summary>
+					operator VkDescriptorSetLayout()const;
+
+					/// <summary> Number of bindings within the layout </summary>
+					size_t BindingCount()const;
+
+					/// <summary>
+					/// Descriptor update template, covering all the bindings in the order they were provided to the constructor;
+					/// Expects an array of BindingCount() DescriptorInfo entries (VK_NULL_HANDLE if there are no bindings)
+					/// </summary>
+					VkDescriptorUpdateTemplate UpdateTemplate()const;
+
+				private:
+					// Device handle
+					const Reference<VkDeviceHandle> m_device;
+
+					// Number of bindings
+					const size_t m_bindingCount;
+
+					// Underlying API object
+					VkDescriptorSetLayout m_layout;
+
+					// Update template
+					VkDescriptorUpdateTemplate m_updateTemplate;
+				};
+
+				/// <summary>
+				/// Shared VkPipelineLayout
+				/// </summary>
+				class PipelineLayout : public virtual ObjectCache<VulkanPipelineStateKey>::StoredObject {
+				public:
+					/// <summary>
+					/// Constructor
+					/// </summary>
+					/// <param name="device"> Device handle </param>
+					/// <param name="setLayouts"> Descriptor set layouts </param>
+					PipelineLayout(VkDeviceHandle* device, const std::vector<Reference<DescriptorSetLayout>>& setLayouts);
+
+					/// <summary> Virtual destructor </summary>
+					virtual ~PipelineLayout();
+
+					/// <summary> Type cast to API object </summary>
+					operator VkPipelineLayout()const;
+
+					/// <summary> Descriptor set layouts (one per binding set) </summary>
+					const std::vector<VkDescriptorSetLayout>& SetLayouts()const;
+
+					/// <summary>
+					/// Descriptor set layout object by index
+					/// </summary>
+					/// <param name="index"> Binding set index </param>
+					/// <returns> Descriptor set layout </returns>
+					DescriptorSetLayout* SetLayout(size_t index)const;
+
+				private:
+					// Device handle
+					const Reference<VkDeviceHandle> m_device;
+
+					// Descriptor set layout references
+					const std::vector<Reference<DescriptorSetLayout>> m_setLayoutObjects;
+
+					// Descriptor set layouts
+					std::vector<VkDescriptorSetLayout> m_setLayouts;
+
+					// Underlying API object
+					VkPipelineLayout m_layout;
+				};
+
+				/// <summary>
+				/// Shared VkPipeline
+				/// </summary>
+				class PipelineObject : public virtual ObjectCache<VulkanPipelineStateKey>::StoredObject {
+				public:
+					/// <summary>
+					/// Constructor
+					/// </summary>
+					/// <param name="device"> Device handle </param>
+					/// <param name="pipeline"> Pipeline (will be destroyed with the object) </param>
+					/// <param name="dependencies"> Objects, the pipeline state key refers to (render pass, layout, shaders and alike; kept alive alongside the pipeline) </param>
+					PipelineObject(VkDeviceHandle* device, VkPipeline pipeline, const std::vector<Reference<Object>>& dependencies);
+
+					/// <summary> Virtual destructor </summary>
+					virtual ~PipelineObject();
+
+					/// <summary> Type cast to API object </summary>
+					operator VkPipeline()const;
+
+				private:
+					// Device handle
+					const Reference<VkDeviceHandle> m_device;
+
+					// Underlying API object
+					const VkPipeline m_pipeline;
+
+					// Objects, the pipeline state key refers to
+					const std::vector<Reference<Object>> m_dependencies;
+				};
+
+				/// <summary>
+				/// Constructor
+				/// </summary>
+				/// <param name="device"> Device handle </param>
+				VulkanPipelineObjectCache(VkDeviceHandle* device);
+
+				/// <summary> Virtual destructor </summary>
+				virtual ~VulkanPipelineObjectCache();
+
+				/// <summary>
+				/// Gets (or creates) the pipeline layout, compatible with the descriptor
+				/// </summary>
+				/// <param name="descriptor"> Pipeline descriptor </param>
+				/// <param name="bindlessSetLayout"> Layout for the sets with IsBindlessSet() flag (nullptr if bindless resources are not supported) </param>
+				/// <returns> Shared pipeline layout (set bindings are ordered as constant buffers, structured buffers and samplers) </returns>
+				Reference<PipelineLayout> GetPipelineLayout(const PipelineDescriptor* descriptor, DescriptorSetLayout* bindlessSetLayout = nullptr);
+
+				/// <summary>
+				/// Gets (or creates) a pipeline
+				/// </summary>
+				/// <typeparam name="CreateFn"> Callable, returning a new VkPipeline (or VK_NULL_HANDLE on failure) </typeparam>
+				/// <param name="key"> Full description of the state, baked into the pipeline (everything referenced by address should be present in dependencies) </param>
+				/// <param name="dependencies"> Objects, the key refers to </param>
+				/// <param name="createPipeline"> Invoked to create the pipeline if there is no matching entry in the cache </param>
+				/// <returns> Shared pipeline (wraps VK_NULL_HANDLE if createPipeline fails) </returns>
+				template<typename CreateFn>
+				inline Reference<PipelineObject> GetPipeline(const VulkanPipelineStateKey& key, const std::vector<Reference<Object>>& dependencies, const CreateFn& createPipeline) {
+					return m_pipelines->Get(key, [&]() -> Reference<PipelineObject> {
+						return Object::Instantiate<PipelineObject>(m_device, createPipeline(), dependencies);
+						});
+				}
+
+			private:
+				// Cache of objects of the same kind
+				class Cache : public virtual ObjectCache<VulkanPipelineStateKey> {
+				public:
+					template<typename CreateFn>
+					inline Reference<StoredObject> Get(const VulkanPipelineStateKey& key, const CreateFn& create) { return GetCachedOrCreate(key, false, create); }
+				};
+
+				// Device handle
+				const Reference<VkDeviceHandle> m_device;
+
+				// Descriptor set layouts
+				const Reference<Cache> m_setLayouts;
+
+				// Pipeline layouts
+				const Reference<Cache> m_pipelineLayouts;
+
+				// Pipelines
+				const Reference<Cache> m_pipelines;
+			};
+		}
+	}
+}
@@ -11,10 +11,10 @@ namespace Jimara {
 			VulkanRenderPass::VulkanRenderPass(
 				VulkanDevice* device, Texture::Multisampling sampleCount
 				, size_t numColorAttachments, Texture::PixelFormat* colorAttachmentFormats
-				, Texture::PixelFormat depthFormat, bool includeResolveAttachments)
+				, Texture::PixelFormat depthFormat, bool includeResolveAttachments, bool loadDepthAttachment)
 				: m_device(device), m_sampleCount(sampleCount)
 				, m_colorAttachmentFormats(colorAttachmentFormats, colorAttachmentFormats + numColorAttachments)
-				, m_depthAttachmentFormat(depthFormat), m_hasResolveAttachments(includeResolveAttachments)
+				, m_depthAttachmentFormat(depthFormat), m_hasResolveAttachments(includeResolveAttachments), m_loadDepthAttachment(loadDepthAttachment)
 				, m_renderPass(VK_NULL_HANDLE) {
 
 				static thread_local std::vector<VkAttachmentDescription> attachments;
@@ -67,13 +67,14 @@ namespace Jimara {
 					desc.format = VulkanImage::NativeFormatFromPixelFormat(m_depthAttachmentFormat);
 					desc.samples = samples;
 
-					desc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+					// Loaded depth comes from an earlier pass of ours, so it's in the same layout, every render pass leaves it's attachments in:
+					desc.loadOp = m_loadDepthAttachment ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
 					desc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 
 					desc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 					desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 
-					desc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+					desc.initialLayout = m_loadDepthAttachment ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
 					desc.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
 					VkAttachmentReference ref = {};
@@ -96,14 +97,26 @@ namespace Jimara {
 				}
 
 				// Subpass dependencies:
-				VkSubpassDependency dependency = {};
+				VkSubpassDependency dependencies[2] = {};
 				{
+					// Attachments may still be sampled by the previously submitted passes (shadow maps and alike), so we wait for the fragment shaders as well:
+					VkSubpassDependency& dependency = dependencies[0];
 					dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
 					dependency.dstSubpass = 0;
-					dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+					dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
 					dependency.srcAccessMask = 0;
 					dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-					dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+					dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+				}
+				{
+					// Attachments end up in SHADER_READ_ONLY_OPTIMAL layout, so the later passes should see the results from their fragment shaders:
+					VkSubpassDependency& dependency = dependencies[1];
+					dependency.srcSubpass = 0;
+					dependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+					dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+					dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+					dependency.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+					dependency.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 				}
 
 				// Render pass:
@@ -114,8 +127,8 @@ namespace Jimara {
 					renderPassInfo.pAttachments = attachments.data();
 					renderPassInfo.subpassCount = 1;
 					renderPassInfo.pSubpasses = &subpass;
-					renderPassInfo.dependencyCount = 1;
-					renderPassInfo.pDependencies = &dependency;
+					renderPassInfo.dependencyCount = static_cast<uint32_t>(sizeof(dependencies) / sizeof(VkSubpassDependency));
+					renderPassInfo.pDependencies = dependencies;
 				}
 				if (vkCreateRenderPass(*m_device, &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS) {
 					m_renderPass = VK_NULL_HANDLE;
@@ -163,6 +176,10 @@ namespace Jimara {
 				return m_colorAttachmentFormats.size() << 1;
 			}
 
+			bool VulkanRenderPass::LoadsDepthAttachment()const {
+				return m_loadDepthAttachment;
+			}
+
 			bool VulkanRenderPass::HasResolveAttachments()const {
 				return m_hasResolveAttachments;
 			}
@@ -19,9 +19,10 @@ namespace Jimara {
 				/// <param name="colorAttachmentFormats"> Pixel format per color attachment </param>
 				/// <param name="depthFormat"> Depth format (if value is outside [FIRST_DEPTH_FORMAT; LAST_DEPTH_FORMAT] range, the render pass will not have a depth format) </param>
 				/// <param name="includeResolveAttachments"> If true, the render pass will include a resolve attachment for each of the multisampled color attachment </param>
+				/// <param name="loadDepthAttachment"> If true, the depth attachment keeps the content, an earlier pass has left in it (expected to be in SHADER_READ_ONLY_OPTIMAL layout), instead of getting cleared </param>
 				VulkanRenderPass(VulkanDevice* device, Texture::Multisampling sampleCount
 					, size_t numColorAttachments, Texture::PixelFormat* colorAttachmentFormats
-					, Texture::PixelFormat depthFormat, bool includeResolveAttachments);
+					, Texture::PixelFormat depthFormat, bool includeResolveAttachments, bool loadDepthAttachment = false);
 
 				/// <summary> Virtual destructor </summary>
 				virtual ~VulkanRenderPass();
@@ -54,6 +55,9 @@ namespace Jimara {
 				/// <summary> Index of the depth attachment witin the framebuffer layout </summary>
 				size_t DepthAttachmentId()const;
 
+				/// <summary> True, if the depth attachment keeps it's content from an earlier pass, instead of getting cleared </summary>
+				bool LoadsDepthAttachment()const;
+
 				/// <summary> True, if there are supposed to be resolve attachments corresponding to color attachments </summary>
 				bool HasResolveAttachments()const;
 
@@ -114,6 +118,9 @@ namespace Jimara {
 				// True, if resolve attachments are present
 				const bool m_hasResolveAttachments;
 
+				// True, if the depth attachment is loaded, instead of being cleared
+				const bool m_loadDepthAttachment;
+
 				// Underlying API object
 				VkRenderPass m_renderPass;
 			};
@@ -0,0 +1,81 @@
+#include "VulkanTimestampQuery.h"
+
+
+#pragma warning(disable: 26812)
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			VulkanTimestampQuery::VulkanTimestampQuery(VkDeviceHandle* device, uint32_t queueFamilyId, size_t count)
+				: m_device(device), m_count(static_cast<uint32_t>(count)), m_validBits(0), m_period(0.0), m_queryPool(VK_NULL_HANDLE) {
+				if (m_count <= 0) return;
+				VulkanPhysicalDevice* physicalDevice = m_device->PhysicalDevice();
+				if (queueFamilyId < physicalDevice->QueueFamilyCount())
+					m_validBits = physicalDevice->QueueFamilyProperties(queueFamilyId).timestampValidBits;
+				m_period = static_cast<double>(physicalDevice->DeviceProperties().limits.timestampPeriod) * 0.000000001;
+
+				VkQueryPoolCreateInfo createInfo = {};
+				{
+					createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+					createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+					createInfo.queryCount = m_count;
+				}
+				if (vkCreateQueryPool(*m_device, &createInfo, nullptr, &m_queryPool) != VK_SUCCESS) {
+					m_queryPool = VK_NULL_HANDLE;
+					m_device->Log()->Error("VulkanTimestampQuery - Failed to create query pool!");
+				}
+			}
+
+			VulkanTimestampQuery::~VulkanTimestampQuery() {
+				if (m_queryPool != VK_NULL_HANDLE) {
+					vkDestroyQueryPool(*m_device, m_queryPool, nullptr);
+					m_queryPool = VK_NULL_HANDLE;
+				}
+			}
+
+			size_t VulkanTimestampQuery::Count()const { return m_count; }
+
+			bool VulkanTimestampQuery::Supported()const { return m_validBits > 0 && m_queryPool != VK_NULL_HANDLE; }
+
+			void VulkanTimestampQuery::Reset(CommandBuffer* commandBuffer) {
+				VulkanCommandBuffer* buffer = GetCommandBuffer(commandBuffer, "Reset");
+				if (buffer == nullptr) return;
+				vkCmdResetQueryPool(*buffer, m_queryPool, 0, m_count);
+				buffer->RecordBufferDependency(this);
+			}
+
+			void VulkanTimestampQuery::Write(CommandBuffer* commandBuffer, size_t index) {
+				VulkanCommandBuffer* buffer = GetCommandBuffer(commandBuffer, "Write");
+				if (buffer == nullptr) return;
+				else if (index >= m_count) {
+					m_device->Log()->Error("VulkanTimestampQuery::Write - Index out of bounds!");
+					return;
+				}
+				vkCmdWriteTimestamp(*buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, static_cast<uint32_t>(index));
+				buffer->RecordBufferDependency(this);
+			}
+
+			bool VulkanTimestampQuery::Read(size_t first, size_t count, double* seconds) {
+				if ((!Supported()) || count <= 0 || (first + count) > m_count) return false;
+				static thread_local std::vector<uint64_t> values;
+				values.resize(count);
+				if (vkGetQueryPoolResults(*m_device, m_queryPool, static_cast<uint32_t>(first), static_cast<uint32_t>(count),
+					sizeof(uint64_t) * count, values.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) return false;
+				const uint64_t mask = (m_validBits >= 64) ? (~static_cast<uint64_t>(0)) : ((static_cast<uint64_t>(1) << m_validBits) - 1);
+				for (size_t i = 0; i < count; i++)
+					seconds[i] = static_cast<double>(values[i] & mask) * m_period;
+				return true;
+			}
+
+			VulkanTimestampQuery::operator VkQueryPool()const { return m_queryPool; }
+
+			VulkanCommandBuffer* VulkanTimestampQuery::GetCommandBuffer(CommandBuffer* commandBuffer, const char* caller)const {
+				if (m_queryPool == VK_NULL_HANDLE) return nullptr;
+				VulkanCommandBuffer* buffer = dynamic_cast<VulkanCommandBuffer*>(commandBuffer);
+				if (buffer == nullptr)
+					m_device->Log()->Error(std::string("VulkanTimestampQuery::") + caller + " - Unsupported command buffer type!");
+				return buffer;
+			}
+		}
+	}
+}
+#pragma warning(default: 26812)
@@ -0,0 +1,85 @@
+#pragma once
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			class VulkanTimestampQuery;
+		}
+	}
+}
+#include "VulkanCommandBuffer.h"
+#include "../../Pipeline/TimestampQuery.h"
+
+
+namespace Jimara {
+	namespace Graphics {
+		namespace Vulkan {
+			/// <summary>
+			/// Vulkan-backed timestamp query (wrapper around a VkQueryPool of VK_QUERY_TYPE_TIMESTAMP type)
+			/// </summary>
+			class VulkanTimestampQuery : public virtual TimestampQuery {
+			public:
+				/// <summary>
+				/// Constructor
+				/// </summary>
+				/// <param name="device"> Device handle </param>
+				/// <param name="queueFamilyId"> Family of the queue, the timestamps will be written from </param>
+				/// <param name="count"> Number of timestamps </param>
+				VulkanTimestampQuery(VkDeviceHandle* device, uint32_t queueFamilyId, size_t count);
+
+				/// <summary> Virtual destructor </summary>
+				virtual ~VulkanTimestampQuery();
+
+				/// <summary> Number of timestamps within the set </summary>
+				virtual size_t Count()const override;
+
+				/// <summary> True, if the queue family supports timestamps (if false, Read() will always fail) </summary>
+				virtual bool Supported()const override;
+
+				/// <summary>
+				/// Records a reset of all timestamps
+				/// </summary>
+				/// <param name="commandBuffer"> Command buffer to record the reset on (should not be inside a render pass) </param>
+				virtual void Reset(CommandBuffer* commandBuffer) override;
+
+				/// <summary>
+				/// Records a timestamp write, that happens once all the commands, recorded before it, are complete
+				/// </summary>
+				/// <param name="commandBuffer"> Command buffer to record the write on </param>
+				/// <param name="index"> Timestamp index (has to be less than Count()) </param>
+				virtual void Write(CommandBuffer* commandBuffer, size_t index) override;
+
+				/// <summary>
+				/// Reads timestamps back (should be invoked after the command buffer that writes them is done executing)
+				/// </summary>
+				/// <param name="first"> Index of the first timestamp to read </param>
+				/// <param name="count"> Number of timestamps to read </param>
+				/// <param name="seconds"> Timestamp values in seconds (result) </param>
+				/// <returns> True, if all of the requested timestamps were available </returns>
+				virtual bool Read(size_t first, size_t count, double* seconds) override;
+
+				/// <summary> Type cast to API object </summary>
+				operator VkQueryPool()const;
+
+
+			private:
+				// Device handle
+				const Reference<VkDeviceHandle> m_device;
+
+				// Number of timestamps
+				const uint32_t m_count;
+
+				// Number of valid bits within the timestamps (0, if the queue does not support timestamps)
+				uint32_t m_validBits;
+
+				// Duration of a single timestamp tick in seconds
+				double m_period;
+
+				// Underlying query pool
+				VkQueryPool m_queryPool;
+
+				// Returns Vulkan command buffer if the timestamps can be recorded on it (logs an error otherwise)
+				VulkanCommandBuffer* GetCommandBuffer(CommandBuffer* commandBuffer, const char* caller)const;
+			};
+		}
+	}
+}
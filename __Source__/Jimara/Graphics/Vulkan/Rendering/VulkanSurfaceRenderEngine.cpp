@@ -8,9 +8,12 @@ namespace Jimara {
 			VulkanSurfaceRenderEngine::VulkanSurfaceRenderEngine(VulkanDevice* device, VulkanWindowSurface* surface) 
 				: VulkanRenderEngine(device)
 				, m_engineInfo(this), m_commandPool(device->GraphicsQueue()->CreateCommandPool())
+				, m_uploadRing(VulkanUploadRing::Instance(device))
+				, m_textureStreamer(VulkanTextureStreamer::Instance(device))
 				, m_windowSurface(surface)
 				, m_semaphoreIndex(0)
-				, m_shouldRecreateComponents(false) {
+				, m_shouldRecreateComponents(false)
+				, m_swapChainInitializationToken(0) {
 				RecreateComponents();
 				m_windowSurface->OnSizeChanged() += Callback<VulkanWindowSurface*>(&VulkanSurfaceRenderEngine::SurfaceSizeChanged, this);
 			}
@@ -49,6 +52,8 @@ namespace Jimara {
 					commandBuffer->Reset();
 					commandBuffer->BeginRecording();
 					commandBuffer->WaitForSemaphore(imageAvailableSemaphore, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+					if (!m_commandPool->SubmissionComplete(m_swapChainInitializationToken))
+						commandBuffer->WaitForSemaphore(m_commandPool->SubmissionTimeline(), m_swapChainInitializationToken, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
 					commandBuffer->SignalSemaphore(renderFinishedSemaphore);
 				}
 
@@ -71,11 +76,17 @@ namespace Jimara {
 					commandBuffer->EndRecording();
 				}
 
-				// Submit command buffer:
+				// Record queued texture uploads within the frame budget and submit pending uploads (if there are any left after recording) and the command buffer:
+				m_textureStreamer->Flush();
+				m_uploadRing->Flush();
 				Device()->GraphicsQueue()->ExecuteCommandBuffer(commandBuffer);
 
 				// Present rendered image
 				if (!m_swapChain->Present(imageId, *renderFinishedSemaphore)) m_shouldRecreateComponents = true;
+
+				// Release idle memory blocks and let the resources from sparse ones move out during the next frames (within the per-frame relocation budget):
+				Device()->MemoryPool()->Defragment();
+
 				if (m_shouldRecreateComponents) RecreateComponents();
 			}
 
@@ -124,7 +135,8 @@ namespace Jimara {
 				m_swapChain = Object::Instantiate<VulkanSwapChain>(Device(), m_windowSurface);
 
 				// Let us make sure the swap chain images have VK_IMAGE_LAYOUT_PRESENT_SRC_KHR layout in case no attached renderer bothers to make proper changes
-				m_commandPool->SubmitSingleTimeCommandBuffer([&](VkCommandBuffer buffer) {
+				// (nothing waits for the transitions on CPU; the first frame that needs them waits on the GPU side):
+				m_swapChainInitializationToken = m_commandPool->SubmitAsynchronousCommandBuffer([&](VkCommandBuffer buffer) {
 					VulkanPrimaryCommandBuffer commandBuffer(m_commandPool, buffer);
 					
 					static thread_local std::vector<VkImageMemoryBarrier> transitions;
@@ -6,6 +6,8 @@
 #include "../Synch/VulkanFence.h"
 #include "../Synch/VulkanTimelineSemaphore.h"
 #include "../Pipeline/VulkanCommandBuffer.h"
+#include "../Memory/VulkanUploadRing.h"
+#include "../Memory/Textures/VulkanTextureStreamer.h"
 #include <unordered_map>
 
 namespace Jimara {
@@ -65,6 +67,12 @@ namespace Jimara {
 
 				// Command pool for main render commands
 				Reference<VulkanCommandPool> m_commandPool;
+
+				// Shared upload ring (flushed once per frame)
+				const Reference<VulkanUploadRing> m_uploadRing;
+
+				// Shared texture streamer (flushed once per frame, right before the upload ring)
+				const Reference<VulkanTextureStreamer> m_textureStreamer;
 				
 				// Target window surface
 				Reference<VulkanWindowSurface> m_windowSurface;
@@ -84,6 +92,9 @@ namespace Jimara {
 				// True, if swap chain gets invalidated
 				bool m_shouldRecreateComponents;
 
+				// Completion token of the swap chain image layout initialization (m_commandPool submission)
+				uint64_t m_swapChainInitializationToken;
+
 				// Main command buffers
 				std::vector<Reference<PrimaryCommandBuffer>> m_mainCommandBuffers;
 
@@ -6,6 +6,10 @@
 #include "Pipeline/VulkanPipeline.h"
 #include "Pipeline/VulkanRenderPass.h"
 #include "Pipeline/VulkanDeviceQueue.h"
+#include "Pipeline/VulkanPipelineCache.h"
+#include "Pipeline/VulkanPipelineObjectCache.h"
+#include "Pipeline/VulkanBindlessSet.h"
+#include "Pipeline/VulkanTimestampQuery.h"
 #include "Rendering/VulkanSurfaceRenderEngine.h"
 #include <sstream>
 
@@ -47,6 +51,11 @@ namespace Jimara {
 							stream << device->AsynchComputeQueue(i) << ((i >= (device->AsynchComputeQueueCount() - 1)) ? "]" : "; ");
 					}
 
+					stream << std::endl << "    TRANSFER:       ";
+					if (device->TransferQueue() != nullptr)
+						stream << (device->HasDedicatedTransferQueue() ? "DEDICATED" : "SHARED") << " <" << device->TransferQueue() << ">";
+					else stream << "NO";
+
 					stream << std::endl << "    SWAP_CHAIN:     " <<
 						(device->PhysicalDeviceInfo()->HasFeature(PhysicalDevice::DeviceFeature::SWAP_CHAIN) ? "YES" : "NO");
 
@@ -81,6 +90,15 @@ namespace Jimara {
 				{
 					device12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
 					device12Features.timelineSemaphore = VK_TRUE;
+					if (m_physicalDevice->HasFeature(PhysicalDevice::DeviceFeature::BINDLESS_DESCRIPTORS)) {
+						device12Features.runtimeDescriptorArray = VK_TRUE;
+						device12Features.descriptorBindingPartiallyBound = VK_TRUE;
+						device12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+						device12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+						device12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+						device12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+						device12Features.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+					}
 				}
 
 				// Creating the logical device:
@@ -95,6 +113,8 @@ namespace Jimara {
 						m_deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 					m_deviceExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
 					m_deviceExtensions.push_back(VK_KHR_MAINTENANCE1_EXTENSION_NAME);
+					if (m_physicalDevice->DeviceExtensionVerison(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME).has_value())
+						m_deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
 					createInfo.enabledExtensionCount = static_cast<uint32_t>(m_deviceExtensions.size());
 					createInfo.ppEnabledExtensionNames = (m_deviceExtensions.size() > 0 ? m_deviceExtensions.data() : nullptr);
 				}
@@ -137,9 +157,18 @@ namespace Jimara {
 					}
 					for (size_t i = 0; i < m_device->PhysicalDevice()->AsynchComputeQueueCount(); i++)
 						m_asynchComputeQueues.push_back(Object::Instantiate<VulkanDeviceQueue>(m_device, m_device->PhysicalDevice()->AsynchComputeQueueId(i)));
+					const std::optional<uint32_t> TRANSFER_QUEUE = m_device->PhysicalDevice()->TransferQueueId();
+					if (TRANSFER_QUEUE.has_value() && MAIN_GRAPHICS_QUEUE.has_value() && MAIN_GRAPHICS_QUEUE.value() != TRANSFER_QUEUE.value())
+						m_transferQueue = Object::Instantiate<VulkanDeviceQueue>(m_device, TRANSFER_QUEUE.value());
+					else m_transferQueue = m_graphicsQueue;
 				}
 
 				m_memoryPool = new VulkanMemoryPool(this);
+				m_pipelineCache = Object::Instantiate<VulkanPipelineCache>(m_device,
+					VulkanPipelineCache::DefaultFilename(GraphicsInstance()->AppInfo()->CacheDirectory(), m_device->PhysicalDevice()));
+				m_pipelineObjectCache = Object::Instantiate<VulkanPipelineObjectCache>(m_device);
+				if (PhysicalDeviceInfo()->HasFeature(PhysicalDevice::DeviceFeature::BINDLESS_DESCRIPTORS))
+					m_bindlessSet = Object::Instantiate<VulkanBindlessSet>(m_device);
 
 #ifndef NDEBUG
 				// Log creation status:
@@ -150,6 +179,9 @@ namespace Jimara {
 			VulkanDevice::~VulkanDevice() {
 				if (m_device != VK_NULL_HANDLE)
 					vkDeviceWaitIdle(*m_device);
+				m_bindlessSet = nullptr;
+				m_pipelineObjectCache = nullptr;
+				m_pipelineCache = nullptr;
 				if (m_memoryPool != nullptr) {
 					delete m_memoryPool;
 					m_memoryPool = nullptr;
@@ -176,8 +208,16 @@ namespace Jimara {
 
 			VkQueue VulkanDevice::AsynchComputeQueue(size_t index)const { return *dynamic_cast<VulkanDeviceQueue*>(m_asynchComputeQueues[index].operator->()); }
 
+			DeviceQueue* VulkanDevice::TransferQueue()const { return m_transferQueue; }
+
+			bool VulkanDevice::HasDedicatedTransferQueue()const { return m_transferQueue != nullptr && m_transferQueue != m_graphicsQueue; }
+
 			VulkanMemoryPool* VulkanDevice::MemoryPool()const { return m_memoryPool; }
 
+			VulkanPipelineCache* VulkanDevice::PipelineCache()const { return m_pipelineCache; }
+
+			VulkanPipelineObjectCache* VulkanDevice::PipelineObjectCache()const { return m_pipelineObjectCache; }
+
 			Reference<RenderEngine> VulkanDevice::CreateRenderEngine(RenderSurface* targetSurface) {
 				VulkanWindowSurface* windowSurface = dynamic_cast<VulkanWindowSurface*>(targetSurface);
 				if (windowSurface != nullptr) return Object::Instantiate<VulkanSurfaceRenderEngine>(this, windowSurface);
@@ -242,14 +282,21 @@ namespace Jimara {
 
 			Reference<RenderPass> VulkanDevice::CreateRenderPass(Texture::Multisampling sampleCount
 				, size_t numColorAttachments, Texture::PixelFormat* colorAttachmentFormats
-				, Texture::PixelFormat depthFormat, bool includeResolveAttachments) {
-				return Object::Instantiate<VulkanRenderPass>(this, sampleCount, numColorAttachments, colorAttachmentFormats, depthFormat, includeResolveAttachments);
+				, Texture::PixelFormat depthFormat, bool includeResolveAttachments, bool loadDepthAttachment) {
+				return Object::Instantiate<VulkanRenderPass>(this, sampleCount, numColorAttachments, colorAttachmentFormats, depthFormat, includeResolveAttachments, loadDepthAttachment);
 			}
 
 			Reference<Pipeline> VulkanDevice::CreateEnvironmentPipeline(PipelineDescriptor* descriptor, size_t maxInFlightCommandBuffers) {
 				static const VkPipelineBindPoint BIND_POINTS[] = { VK_PIPELINE_BIND_POINT_GRAPHICS, VK_PIPELINE_BIND_POINT_COMPUTE };
 				return Object::Instantiate<VulkanEnvironmentPipeline>(this, descriptor, maxInFlightCommandBuffers, sizeof(BIND_POINTS) / sizeof(VkPipelineBindPoint), BIND_POINTS);
 			}
+
+			BindlessSet* VulkanDevice::BindlessResources()const { return m_bindlessSet; }
+
+			Reference<TimestampQuery> VulkanDevice::CreateTimestampQuery(size_t count) {
+				const VulkanDeviceQueue* queue = dynamic_cast<const VulkanDeviceQueue*>(m_graphicsQueue.operator->());
+				return Object::Instantiate<VulkanTimestampQuery>(m_device, (queue == nullptr) ? ~static_cast<uint32_t>(0) : queue->FamilyId(), count);
+			}
 		}
 	}
 }
@@ -4,6 +4,9 @@ namespace Jimara {
 		namespace Vulkan {
 			class VulkanDevice;
 			class VkDeviceHandle;
+			class VulkanPipelineCache;
+			class VulkanPipelineObjectCache;
+			class VulkanBindlessSet;
 		}
 	}
 }
@@ -97,9 +100,21 @@ namespace Jimara {
 				/// <returns> ASynchronous compute queue </returns>
 				VkQueue AsynchComputeQueue(size_t index)const;
 
+				/// <summary> Queue for the staging uploads (dedicated transfer queue if the device has one, GraphicsQueue otherwise) </summary>
+				DeviceQueue* TransferQueue()const;
+
+				/// <summary> True, if TransferQueue is a dedicated transfer queue (resources written by it need queue family ownership transfers) </summary>
+				bool HasDedicatedTransferQueue()const;
+
 				/// <summary> Memory pool </summary>
 				VulkanMemoryPool* MemoryPool()const;
 
+				/// <summary> Pipeline cache, shared by all pipeline creations (persisted on disk) </summary>
+				VulkanPipelineCache* PipelineCache()const;
+
+				/// <summary> Cache of native pipeline objects, shared between identical pipelines </summary>
+				VulkanPipelineObjectCache* PipelineObjectCache()const;
+
 				/// <summary>
 				/// Instantiates a render engine (Depending on the context/os etc only one per surface may be allowed)
 				/// </summary>
@@ -167,10 +182,11 @@ namespace Jimara {
 				/// <param name="colorAttachmentFormats"> Pixel format per color attachment </param>
 				/// <param name="depthFormat"> Depth format (if value is outside [FIRST_DEPTH_FORMAT; LAST_DEPTH_FORMAT] range, the render pass will not have a depth format) </param>
 				/// <param name="includeResolveAttachments"> If true, the render pass will include a resolve attachment for each of the multisampled color attachment </param>
+				/// <param name="loadDepthAttachment"> If true, the depth attachment keeps the content, an earlier pass has left in it (depth prepass), instead of getting cleared </param>
 				/// <returns> New instance of a render pass </returns>
 				virtual Reference<RenderPass> CreateRenderPass(Texture::Multisampling sampleCount
 					, size_t numColorAttachments, Texture::PixelFormat* colorAttachmentFormats
-					, Texture::PixelFormat depthFormat, bool includeResolveAttachments) override;
+					, Texture::PixelFormat depthFormat, bool includeResolveAttachments, bool loadDepthAttachment = false) override;
 
 				/// <summary>
 				/// Creates an environment pipeline
@@ -180,6 +196,16 @@ namespace Jimara {
 				/// <returns> New instance of an environment pipeline object </returns>
 				virtual Reference<Pipeline> CreateEnvironmentPipeline(PipelineDescriptor* descriptor, size_t maxInFlightCommandBuffers) override;
 
+				/// <summary> Device-wide bindless resource set (VulkanBindlessSet; nullptr, if the device does not have PhysicalDevice::DeviceFeature::BINDLESS_DESCRIPTORS) </summary>
+				virtual BindlessSet* BindlessResources()const override;
+
+				/// <summary>
+				/// Creates a set of GPU timestamps, that can be written from the command buffers, executed on GraphicsQueue()
+				/// </summary>
+				/// <param name="count"> Number of timestamps </param>
+				/// <returns> New instance of a timestamp query (VulkanTimestampQuery) </returns>
+				virtual Reference<TimestampQuery> CreateTimestampQuery(size_t count) override;
+
 
 			private:
 				// Underlying API object
@@ -197,8 +223,20 @@ namespace Jimara {
 				// Asynchronous compute queues
 				std::vector<Reference<DeviceQueue>> m_asynchComputeQueues;
 
+				// Transfer queue (dedicated one or m_graphicsQueue)
+				Reference<DeviceQueue> m_transferQueue;
+
 				// Memory pool
 				VulkanMemoryPool* m_memoryPool;
+
+				// Pipeline cache
+				Reference<VulkanPipelineCache> m_pipelineCache;
+
+				// Shared pipeline objects
+				Reference<VulkanPipelineObjectCache> m_pipelineObjectCache;
+
+				// Bindless resource set
+				Reference<VulkanBindlessSet> m_bindlessSet;
 			};
 		}
 	}
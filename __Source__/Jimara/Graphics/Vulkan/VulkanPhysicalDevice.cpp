@@ -16,6 +16,23 @@ namespace Jimara {
 					if (m_deviceFeatures.samplerAnisotropy)
 						m_features |= static_cast<uint64_t>(PhysicalDevice::DeviceFeature::SAMPLER_ANISOTROPY);
 				}
+				{
+					m_device12Features = {};
+					m_device12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+					VkPhysicalDeviceFeatures2 features = {};
+					features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+					features.pNext = &m_device12Features;
+					vkGetPhysicalDeviceFeatures2(device, &features);
+					m_device12Features.pNext = nullptr;
+					if (m_device12Features.runtimeDescriptorArray
+						&& m_device12Features.descriptorBindingPartiallyBound
+						&& m_device12Features.descriptorBindingUpdateUnusedWhilePending
+						&& m_device12Features.descriptorBindingSampledImageUpdateAfterBind
+						&& m_device12Features.descriptorBindingStorageBufferUpdateAfterBind
+						&& m_device12Features.shaderSampledImageArrayNonUniformIndexing
+						&& m_device12Features.shaderStorageBufferArrayNonUniformIndexing)
+						m_features |= static_cast<uint64_t>(PhysicalDevice::DeviceFeature::BINDLESS_DESCRIPTORS);
+				}
 
 
 				// Device properties:
@@ -51,6 +68,11 @@ namespace Jimara {
 
 						bool hasGraphics = ((family.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0);
 						bool hasCompute = ((family.queueFlags & VK_QUEUE_COMPUTE_BIT) != 0);
+						bool hasTransfer = ((family.queueFlags & VK_QUEUE_TRANSFER_BIT) != 0);
+
+						// Transfer-only families are usually backed by separate DMA engines:
+						if (hasTransfer && (!hasGraphics) && (!hasCompute) && (!m_queueIds.transfer.has_value()))
+							m_queueIds.transfer = queueFamilyId;
 
 						bool foundGraphicsBit = (hasGraphics && ((!m_queueIds.graphics.has_value()) || ((!m_queueIds.compute.has_value()) && hasCompute)));
 						if (foundGraphicsBit) m_queueIds.graphics = queueFamilyId;
@@ -94,6 +116,8 @@ namespace Jimara {
 
 			const VkPhysicalDeviceFeatures& VulkanPhysicalDevice::DeviceFeatures()const { return m_deviceFeatures; }
 
+			const VkPhysicalDeviceVulkan12Features& VulkanPhysicalDevice::DeviceFeatures12()const { return m_device12Features; }
+
 			const VkPhysicalDeviceProperties& VulkanPhysicalDevice::DeviceProperties()const { return m_deviceProperties; }
 
 			const VkPhysicalDeviceMemoryProperties& VulkanPhysicalDevice::MemoryProperties()const { return m_memoryProps; }
@@ -110,6 +134,8 @@ namespace Jimara {
 
 			uint32_t VulkanPhysicalDevice::AsynchComputeQueueId(size_t asynchQueueId)const { return m_queueIds.asynchronous_compute[asynchQueueId]; }
 
+			std::optional<uint32_t> VulkanPhysicalDevice::TransferQueueId()const { return m_queueIds.transfer; }
+
 			std::optional<uint32_t> VulkanPhysicalDevice::DeviceExtensionVerison(const std::string& extensionName)const {
 				std::unordered_map<std::string, uint32_t>::const_iterator it = m_availableExtensions.find(extensionName);
 				return (it == m_availableExtensions.end() ? std::optional<uint32_t>() : it->second);
@@ -19,6 +19,9 @@ namespace Jimara {
 				/// <summary> Full Vulkan device features structure </summary>
 				const VkPhysicalDeviceFeatures& DeviceFeatures()const;
 
+				/// <summary> Vulkan 1.2 device features structure (pNext is always nullptr) </summary>
+				const VkPhysicalDeviceVulkan12Features& DeviceFeatures12()const;
+
 				/// <summary> Full Vulkan device properties structure </summary>
 				const VkPhysicalDeviceProperties& DeviceProperties()const;
 
@@ -44,6 +47,9 @@ namespace Jimara {
 				/// <summary> Number of available asynchronous compute queues </summary>
 				size_t AsynchComputeQueueCount()const;
 
+				/// <summary> Dedicated transfer queue id (transfer-only queue family; does not have value if the device does not expose one) </summary>
+				std::optional<uint32_t> TransferQueueId()const;
+
 				/// <summary>
 				/// Asynchronous compute queue index(global) from asynchronous index(ei 0 - AsynchComputeQueueCount)
 				/// </summary>
@@ -112,6 +118,9 @@ namespace Jimara {
 
 					// Asynchronous compute queue indices
 					std::vector<uint32_t> asynchronous_compute;
+
+					// Dedicated transfer queue
+					std::optional<uint32_t> transfer;
 				} m_queueIds;
 
 				// Device type
@@ -126,6 +135,9 @@ namespace Jimara {
 				// Vulkan-reported device features
 				VkPhysicalDeviceFeatures m_deviceFeatures;
 
+				// Vulkan-reported 1.2 device features
+				VkPhysicalDeviceVulkan12Features m_device12Features;
+
 				// Vulkan-reported device properties
 				VkPhysicalDeviceProperties m_deviceProperties;
 
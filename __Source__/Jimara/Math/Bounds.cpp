@@ -0,0 +1,159 @@
+#include "Bounds.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define JIMARA_BOUNDS_SSE2
+#include <emmintrin.h>
+#endif
+
+
+namespace Jimara {
+	namespace Math {
+#ifdef JIMARA_BOUNDS_SSE2
+		namespace {
+			// Frustum planes in SoA layout (two groups of four; the last group is padded with duplicates of the first plane):
+			struct FrustumPlanesSoA {
+				__m128 normalX[2];
+				__m128 normalY[2];
+				__m128 normalZ[2];
+				__m128 distance[2];
+
+				inline FrustumPlanesSoA(const Frustum& frustum) {
+					alignas(16) float x[8], y[8], z[8], d[8];
+					for (size_t i = 0; i < 8; i++) {
+						const Plane& plane = frustum.planes[(i < Frustum::PLANE_COUNT) ? i : 0];
+						x[i] = plane.normal.x;
+						y[i] = plane.normal.y;
+						z[i] = plane.normal.z;
+						d[i] = plane.distance;
+					}
+					for (size_t i = 0; i < 2; i++) {
+						normalX[i] = _mm_load_ps(x + (i << 2));
+						normalY[i] = _mm_load_ps(y + (i << 2));
+						normalZ[i] = _mm_load_ps(z + (i << 2));
+						distance[i] = _mm_load_ps(d + (i << 2));
+					}
+				}
+			};
+
+			inline static __m128 Select(__m128 mask, __m128 a, __m128 b) {
+				return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+			}
+		}
+#endif
+
+		size_t Intersects(const Frustum& frustum, const AABB* boxes, size_t count, uint8_t* results) {
+			size_t intersectionCount = 0;
+#ifdef JIMARA_BOUNDS_SSE2
+			const FrustumPlanesSoA planes(frustum);
+			const __m128 zero = _mm_setzero_ps();
+			__m128 positiveX[2], positiveY[2], positiveZ[2];
+			for (size_t i = 0; i < 2; i++) {
+				positiveX[i] = _mm_cmpge_ps(planes.normalX[i], zero);
+				positiveY[i] = _mm_cmpge_ps(planes.normalY[i], zero);
+				positiveZ[i] = _mm_cmpge_ps(planes.normalZ[i], zero);
+			}
+			for (size_t boxId = 0; boxId < count; boxId++) {
+				const AABB& box = boxes[boxId];
+				const __m128 startX = _mm_set1_ps(box.start.x), startY = _mm_set1_ps(box.start.y), startZ = _mm_set1_ps(box.start.z);
+				const __m128 endX = _mm_set1_ps(box.end.x), endY = _mm_set1_ps(box.end.y), endZ = _mm_set1_ps(box.end.z);
+				int outsideMask = 0;
+				for (size_t i = 0; i < 2; i++) {
+					const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+						_mm_mul_ps(planes.normalX[i], Select(positiveX[i], endX, startX)),
+						_mm_mul_ps(planes.normalY[i], Select(positiveY[i], endY, startY))),
+						_mm_mul_ps(planes.normalZ[i], Select(positiveZ[i], endZ, startZ))),
+						planes.distance[i]);
+					outsideMask |= _mm_movemask_ps(_mm_cmplt_ps(distance, zero));
+				}
+				const bool intersects = (outsideMask == 0);
+				results[boxId] = intersects ? 1 : 0;
+				if (intersects) intersectionCount++;
+			}
+#else
+			for (size_t boxId = 0; boxId < count; boxId++) {
+				const bool intersects = Intersects(boxes[boxId], frustum);
+				results[boxId] = intersects ? 1 : 0;
+				if (intersects) intersectionCount++;
+			}
+#endif
+			return intersectionCount;
+		}
+
+		size_t Intersects(const AABB& box, const Sphere* spheres, size_t count, uint8_t* results) {
+			size_t intersectionCount = 0;
+			size_t sphereId = 0;
+#ifdef JIMARA_BOUNDS_SSE2
+			static_assert(sizeof(Sphere) == (sizeof(float) * 4), "Sphere expected to be tightly packed");
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 startX = _mm_set1_ps(box.start.x), startY = _mm_set1_ps(box.start.y), startZ = _mm_set1_ps(box.start.z);
+			const __m128 endX = _mm_set1_ps(box.end.x), endY = _mm_set1_ps(box.end.y), endZ = _mm_set1_ps(box.end.z);
+			auto axisDistance = [&](__m128 value, __m128 start, __m128 end) {
+				return _mm_max_ps(_mm_max_ps(_mm_sub_ps(start, value), _mm_sub_ps(value, end)), zero);
+			};
+			for (; (sphereId + 4) <= count; sphereId += 4) {
+				// Four spheres get loaded and transposed, so that each register holds the same component of every sphere:
+				const float* data = &spheres[sphereId].center.x;
+				__m128 x = _mm_loadu_ps(data);
+				__m128 y = _mm_loadu_ps(data + 4);
+				__m128 z = _mm_loadu_ps(data + 8);
+				__m128 r = _mm_loadu_ps(data + 12);
+				_MM_TRANSPOSE4_PS(x, y, z, r);
+				const __m128 deltaX = axisDistance(x, startX, endX);
+				const __m128 deltaY = axisDistance(y, startY, endY);
+				const __m128 deltaZ = axisDistance(z, startZ, endZ);
+				const __m128 sqrDistance = _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(deltaX, deltaX), _mm_mul_ps(deltaY, deltaY)), _mm_mul_ps(deltaZ, deltaZ));
+				const int mask = _mm_movemask_ps(_mm_cmple_ps(sqrDistance, _mm_mul_ps(r, r)));
+				for (size_t i = 0; i < 4; i++) {
+					const bool intersects = ((mask >> i) & 1) != 0;
+					results[sphereId + i] = intersects ? 1 : 0;
+					if (intersects) intersectionCount++;
+				}
+			}
+#endif
+			for (; sphereId < count; sphereId++) {
+				const bool intersects = Intersects(spheres[sphereId], box);
+				results[sphereId] = intersects ? 1 : 0;
+				if (intersects) intersectionCount++;
+			}
+			return intersectionCount;
+		}
+
+		void Transform(const Matrix4& transform, const AABB* boxes, size_t count, AABB* results) {
+#ifdef JIMARA_BOUNDS_SSE2
+			const __m128 signMask = _mm_set1_ps(-0.0f);
+			const __m128 half = _mm_set1_ps(0.5f);
+			const __m128 column0 = _mm_loadu_ps(&transform[0][0]);
+			const __m128 column1 = _mm_loadu_ps(&transform[1][0]);
+			const __m128 column2 = _mm_loadu_ps(&transform[2][0]);
+			const __m128 column3 = _mm_loadu_ps(&transform[3][0]);
+			const __m128 absColumn0 = _mm_andnot_ps(signMask, column0);
+			const __m128 absColumn1 = _mm_andnot_ps(signMask, column1);
+			const __m128 absColumn2 = _mm_andnot_ps(signMask, column2);
+			for (size_t boxId = 0; boxId < count; boxId++) {
+				// Both loads stay within the AABB (start.xyz, end.x) and (start.z, end.xyz):
+				const float* data = &boxes[boxId].start.x;
+				const __m128 start = _mm_loadu_ps(data);
+				const __m128 end = _mm_shuffle_ps(_mm_loadu_ps(data + 2), _mm_loadu_ps(data + 2), _MM_SHUFFLE(3, 3, 2, 1));
+				const __m128 center = _mm_mul_ps(_mm_add_ps(start, end), half);
+				const __m128 extents = _mm_mul_ps(_mm_sub_ps(end, start), half);
+				const __m128 newCenter = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(column0, _mm_shuffle_ps(center, center, _MM_SHUFFLE(0, 0, 0, 0))),
+					_mm_mul_ps(column1, _mm_shuffle_ps(center, center, _MM_SHUFFLE(1, 1, 1, 1)))),
+					_mm_mul_ps(column2, _mm_shuffle_ps(center, center, _MM_SHUFFLE(2, 2, 2, 2)))),
+					column3);
+				const __m128 newExtents = _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(absColumn0, _mm_shuffle_ps(extents, extents, _MM_SHUFFLE(0, 0, 0, 0))),
+					_mm_mul_ps(absColumn1, _mm_shuffle_ps(extents, extents, _MM_SHUFFLE(1, 1, 1, 1)))),
+					_mm_mul_ps(absColumn2, _mm_shuffle_ps(extents, extents, _MM_SHUFFLE(2, 2, 2, 2))));
+				alignas(16) float newStart[4], newEnd[4];
+				_mm_store_ps(newStart, _mm_sub_ps(newCenter, newExtents));
+				_mm_store_ps(newEnd, _mm_add_ps(newCenter, newExtents));
+				results[boxId] = AABB{ Vector3(newStart[0], newStart[1], newStart[2]), Vector3(newEnd[0], newEnd[1], newEnd[2]) };
+			}
+#else
+			for (size_t boxId = 0; boxId < count; boxId++)
+				results[boxId] = Transform(transform, boxes[boxId]);
+#endif
+		}
+	}
+}
@@ -0,0 +1,276 @@
+#pragma once
+#include "Math.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace Jimara {
+	/// <summary>
+	/// Axis-aligned bounding box
+	/// </summary>
+	struct AABB {
+		/// <summary> Minimal coordinates </summary>
+		Vector3 start;
+
+		/// <summary> Maximal coordinates </summary>
+		Vector3 end;
+	};
+
+	/// <summary>
+	/// Bounding sphere (16 bytes, so that a batch of spheres can be loaded directly into SIMD registers)
+	/// </summary>
+	struct Sphere {
+		/// <summary> Sphere center </summary>
+		Vector3 center;
+
+		/// <summary> Sphere radius </summary>
+		float radius;
+	};
+
+	/// <summary>
+	/// Plane, defined as a set of points p, for which Dot(normal, p) + distance == 0 (points with positive values are "in front" of the plane)
+	/// </summary>
+	struct Plane {
+		/// <summary> Plane normal </summary>
+		Vector3 normal;
+
+		/// <summary> Signed distance from the origin (negated) </summary>
+		float distance;
+	};
+
+	/// <summary>
+	/// View frustum, defined by six planes, facing inwards
+	/// </summary>
+	struct Frustum {
+		/// <summary> Plane indices </summary>
+		enum PlaneId : uint8_t {
+			/// <summary> Left plane </summary>
+			LEFT = 0,
+
+			/// <summary> Right plane </summary>
+			RIGHT = 1,
+
+			/// <summary> Bottom plane </summary>
+			BOTTOM = 2,
+
+			/// <summary> Top plane </summary>
+			TOP = 3,
+
+			/// <summary> Near plane </summary>
+			NEAR_PLANE = 4,
+
+			/// <summary> Far plane </summary>
+			FAR_PLANE = 5,
+
+			/// <summary> Number of planes </summary>
+			PLANE_COUNT = 6
+		};
+
+		/// <summary> Frustum planes (normals point inside the frustum) </summary>
+		Plane planes[PLANE_COUNT];
+	};
+
+	namespace Math {
+		/// <summary>
+		/// Signed distance from the plane
+		/// </summary>
+		/// <param name="plane"> Plane </param>
+		/// <param name="point"> Point </param>
+		/// <returns> Signed distance (exact for normalized planes; positive values are in front of the plane) </returns>
+		inline static float SignedDistance(const Plane& plane, const Vector3& point) {
+			return Dot(plane.normal, point) + plane.distance;
+		}
+
+		/// <summary>
+		/// Normalizes plane equation
+		/// </summary>
+		/// <param name="plane"> Plane </param>
+		/// <returns> Plane with a unit length normal </returns>
+		inline static Plane Normalize(const Plane& plane) {
+			const float magnitude = std::sqrt(Dot(plane.normal, plane.normal));
+			if (magnitude <= 0.0f) return plane;
+			return Plane{ plane.normal / magnitude, plane.distance / magnitude };
+		}
+
+		/// <summary>
+		/// Extracts the view frustum from a view-projection matrix (expects clip space depth range to be [0; 1])
+		/// </summary>
+		/// <param name="viewProjection"> World space to clip space transformation </param>
+		/// <returns> World space frustum </returns>
+		inline static Frustum FrustumFromMatrix(const Matrix4& viewProjection) {
+			auto row = [&](int index) {
+				return Vector4(viewProjection[0][index], viewProjection[1][index], viewProjection[2][index], viewProjection[3][index]);
+			};
+			const Vector4 x = row(0), y = row(1), z = row(2), w = row(3);
+			auto plane = [](const Vector4& equation) {
+				return Normalize(Plane{ Vector3(equation.x, equation.y, equation.z), equation.w });
+			};
+			Frustum frustum;
+			frustum.planes[Frustum::LEFT] = plane(w + x);
+			frustum.planes[Frustum::RIGHT] = plane(w - x);
+			frustum.planes[Frustum::BOTTOM] = plane(w + y);
+			frustum.planes[Frustum::TOP] = plane(w - y);
+			frustum.planes[Frustum::NEAR_PLANE] = plane(z);
+			frustum.planes[Frustum::FAR_PLANE] = plane(w - z);
+			return frustum;
+		}
+
+		/// <summary>
+		/// Checks if a bounding box is (at least partially) inside the frustum
+		/// Note: The test is conservative; some of the boxes near the frustum edges may be reported as intersecting even if they are outside.
+		/// </summary>
+		/// <param name="box"> Bounding box </param>
+		/// <param name="frustum"> Frustum </param>
+		/// <returns> False, if the box is fully behind any of the frustum planes </returns>
+		inline static bool Intersects(const AABB& box, const Frustum& frustum) {
+			for (size_t i = 0; i < Frustum::PLANE_COUNT; i++) {
+				const Plane& plane = frustum.planes[i];
+				const Vector3 positiveVertex(
+					(plane.normal.x >= 0.0f) ? box.end.x : box.start.x,
+					(plane.normal.y >= 0.0f) ? box.end.y : box.start.y,
+					(plane.normal.z >= 0.0f) ? box.end.z : box.start.z);
+				if (SignedDistance(plane, positiveVertex) < 0.0f) return false;
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// Checks if a sphere is (at least partially) inside the frustum (conservative, just like the AABB variant)
+		/// </summary>
+		/// <param name="sphere"> Sphere </param>
+		/// <param name="frustum"> Frustum </param>
+		/// <returns> False, if the sphere is fully behind any of the frustum planes </returns>
+		inline static bool Intersects(const Sphere& sphere, const Frustum& frustum) {
+			for (size_t i = 0; i < Frustum::PLANE_COUNT; i++)
+				if (SignedDistance(frustum.planes[i], sphere.center) < -sphere.radius) return false;
+			return true;
+		}
+
+		/// <summary>
+		/// Checks if a bounding box is empty (start is greater than end on any of the axis; empty light slots and inactive objects use those)
+		/// </summary>
+		/// <param name="box"> Bounding box </param>
+		/// <returns> True, if the box does not contain any point </returns>
+		inline static bool IsEmpty(const AABB& box) {
+			return (box.start.x > box.end.x) || (box.start.y > box.end.y) || (box.start.z > box.end.z);
+		}
+
+		/// <summary>
+		/// Checks if all the coordinates of a bounding box are finite (lights without a range, for example, report infinite bounds)
+		/// </summary>
+		/// <param name="box"> Bounding box </param>
+		/// <returns> False, if any of the coordinates is infinite or NaN </returns>
+		inline static bool IsFinite(const AABB& box) {
+			return
+				std::isfinite(box.start.x) && std::isfinite(box.start.y) && std::isfinite(box.start.z) &&
+				std::isfinite(box.end.x) && std::isfinite(box.end.y) && std::isfinite(box.end.z);
+		}
+
+		/// <summary>
+		/// Squared distance from a point to a bounding box
+		/// </summary>
+		/// <param name="point"> Point </param>
+		/// <param name="box"> Bounding box </param>
+		/// <returns> Squared distance (0 if the point is inside the box) </returns>
+		inline static float SqrDistance(const Vector3& point, const AABB& box) {
+			auto axisDistance = [](float value, float start, float end) {
+				return (value < start) ? (start - value) : ((value > end) ? (value - end) : 0.0f);
+			};
+			const Vector3 delta(
+				axisDistance(point.x, box.start.x, box.end.x),
+				axisDistance(point.y, box.start.y, box.end.y),
+				axisDistance(point.z, box.start.z, box.end.z));
+			return Dot(delta, delta);
+		}
+
+		/// <summary>
+		/// Distance from a point to a bounding box
+		/// </summary>
+		/// <param name="point"> Point </param>
+		/// <param name="box"> Bounding box </param>
+		/// <returns> Distance (0 if the point is inside the box) </returns>
+		inline static float Distance(const Vector3& point, const AABB& box) {
+			return std::sqrt(SqrDistance(point, box));
+		}
+
+		/// <summary>
+		/// Checks if a sphere and a bounding box overlap
+		/// </summary>
+		/// <param name="sphere"> Sphere </param>
+		/// <param name="box"> Bounding box </param>
+		/// <returns> True, if the sphere touches the box </returns>
+		inline static bool Intersects(const Sphere& sphere, const AABB& box) {
+			return SqrDistance(sphere.center, box) <= (sphere.radius * sphere.radius);
+		}
+
+		/// <summary>
+		/// Checks if two bounding boxes overlap
+		/// </summary>
+		/// <param name="a"> First box </param>
+		/// <param name="b"> Second box </param>
+		/// <returns> True, if the boxes touch </returns>
+		inline static bool Intersects(const AABB& a, const AABB& b) {
+			return
+				a.start.x <= b.end.x && b.start.x <= a.end.x &&
+				a.start.y <= b.end.y && b.start.y <= a.end.y &&
+				a.start.z <= b.end.z && b.start.z <= a.end.z;
+		}
+
+		/// <summary>
+		/// Transforms a bounding box (the result is the bounding box of the transformed corners)
+		/// </summary>
+		/// <param name="transform"> Affine transformation </param>
+		/// <param name="box"> Bounding box </param>
+		/// <returns> Transformed bounding box </returns>
+		inline static AABB Transform(const Matrix4& transform, const AABB& box) {
+			const Vector3 center = (box.start + box.end) * 0.5f;
+			const Vector3 extents = (box.end - box.start) * 0.5f;
+			const Vector3 newCenter = Vector3(transform * Vector4(center, 1.0f));
+			const Vector3 newExtents =
+				glm::abs(Vector3(transform[0])) * extents.x +
+				glm::abs(Vector3(transform[1])) * extents.y +
+				glm::abs(Vector3(transform[2])) * extents.z;
+			return AABB{ newCenter - newExtents, newCenter + newExtents };
+		}
+
+		/// <summary>
+		/// Bounding box of a sphere
+		/// </summary>
+		/// <param name="sphere"> Sphere </param>
+		/// <returns> Bounding box </returns>
+		inline static AABB BoundingBox(const Sphere& sphere) {
+			const Vector3 extents(sphere.radius);
+			return AABB{ sphere.center - extents, sphere.center + extents };
+		}
+
+		/// <summary>
+		/// Tests a batch of bounding boxes against a frustum (SIMD, where available; same results as Intersects(box, frustum))
+		/// </summary>
+		/// <param name="frustum"> Frustum </param>
+		/// <param name="boxes"> Bounding boxes </param>
+		/// <param name="count"> Number of boxes </param>
+		/// <param name="results"> Per-box results (1 if the box intersects the frustum, 0 otherwise) </param>
+		/// <returns> Number of intersecting boxes </returns>
+		size_t Intersects(const Frustum& frustum, const AABB* boxes, size_t count, uint8_t* results);
+
+		/// <summary>
+		/// Tests a batch of spheres against a bounding box (SIMD, where available; same results as Intersects(sphere, box))
+		/// </summary>
+		/// <param name="box"> Bounding box </param>
+		/// <param name="spheres"> Spheres </param>
+		/// <param name="count"> Number of spheres </param>
+		/// <param name="results"> Per-sphere results (1 if the sphere touches the box, 0 otherwise) </param>
+		/// <returns> Number of intersecting spheres </returns>
+		size_t Intersects(const AABB& box, const Sphere* spheres, size_t count, uint8_t* results);
+
+		/// <summary>
+		/// Transforms a batch of bounding boxes (SIMD, where available; same results as Transform(transform, box))
+		/// </summary>
+		/// <param name="transform"> Affine transformation </param>
+		/// <param name="boxes"> Bounding boxes </param>
+		/// <param name="count"> Number of boxes </param>
+		/// <param name="results"> Transformed bounding boxes (can be the same as boxes) </param>
+		void Transform(const Matrix4& transform, const AABB* boxes, size_t count, AABB* results);
+	}
+}